@@ -0,0 +1,157 @@
+#include "CPUExactDistanceDispatch.h"
+#include "CPUJumpFloodResources.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+}
+
+CPUExactDistanceDispatch::CPUExactDistanceDispatch(CPUJumpFloodResources* resources, size_t num_threads, CPUThreadPool* pool) :
+resources(resources), num_threads(std::max<size_t>(1, num_threads)), pool(pool ? pool : CPUThreadPool::shared().get()) {
+    if (resources == nullptr)
+    {
+        throw std::runtime_error("Resources cannot be null.");
+    }
+}
+
+void CPUExactDistanceDispatch::distance_transform_1d(const double* f, size_t n, double* out, size_t* v, double* z) {
+    //find the first finite sample, everything before it is skipped.
+    size_t first = 0;
+    while (first < n && f[first] == inf)
+    {
+        first++;
+    }
+
+    if (first == n)
+    {
+        std::fill(out, out + n, inf);
+        return;
+    }
+
+    size_t k = 0;
+    v[0] = first;
+    z[0] = -inf;
+    z[1] = inf;
+
+    for (size_t q = first + 1; q < n; q++)
+    {
+        if (f[q] == inf)
+        {
+            continue;
+        }
+
+        const auto fq = f[q] + static_cast<double>(q) * static_cast<double>(q);
+        const auto intersection = [&](size_t vk) {
+            const auto p = static_cast<double>(vk);
+            return (fq - (f[vk] + p * p)) / (2.0 * static_cast<double>(q) - 2.0 * p);
+        };
+
+        //z[0] is -inf, so the first parabola is never popped.
+        double s = intersection(v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = intersection(v[k]);
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = inf;
+    }
+
+    k = 0;
+    for (size_t q = 0; q < n; q++)
+    {
+        while (z[k + 1] < static_cast<double>(q))
+        {
+            k++;
+        }
+        const auto delta = static_cast<double>(q) - static_cast<double>(v[k]);
+        out[q] = delta * delta + f[v[k]];
+    }
+}
+
+std::pair<float, float> CPUExactDistanceDispatch::dispatch_distance_transform(bool invert, float max_distance,
+                                                                             const float2* normalise_range) {
+    const auto& mask = resources->get_mask(invert);
+    auto& distance = resources->create_distance_buffer(false);
+    const size_t width = mask.width;
+    const size_t height = mask.height;
+
+    constexpr auto no_seed = std::numeric_limits<float>::infinity();
+
+    //column pass: distance in rows to the nearest seed in the same column. Each band owns a range of columns but
+    //walks every row, so memory is still read row-major. Distances are stored unsquared, as squares of large
+    //textures are not exactly representable in a float.
+    pool->parallel_for(width, num_threads, [&](size_t begin, size_t end) {
+        for (size_t y = 0; y < height; y++)
+        {
+            const cpu_bitmask::word_type* mask_row = mask.row(y);
+            float* out_row = distance.row(y);
+            const float* previous_row = y > 0 ? distance.row(y - 1) : nullptr;
+
+            for (size_t x = begin; x < end; x++)
+            {
+                out_row[x] = cpu_bitmask::test(mask_row, x) ? 0.0f : (previous_row ? previous_row[x] + 1.0f : no_seed);
+            }
+        }
+
+        for (size_t y = height - 1; y-- > 0;)
+        {
+            float* out_row = distance.row(y);
+            const float* next_row = distance.row(y + 1);
+            for (size_t x = begin; x < end; x++)
+            {
+                out_row[x] = std::min(out_row[x], next_row[x] + 1.0f);
+            }
+        }
+    });
+
+    const double clamp_distance = max_distance > 0 ? static_cast<double>(max_distance) : inf;
+    std::optional<cpuutils::distance_normaliser> normaliser;
+    if (normalise_range)
+    {
+        normaliser.emplace(normalise_range->x, normalise_range->y, 0.0f);
+    }
+
+    cpuutils::min_max_accumulator range;
+
+    //row pass: lower envelope of the column distances along each row.
+    pool->parallel_for(height, num_threads, [&](size_t begin, size_t end) {
+        //a copy per band, so stores to the distance buffer cannot alias it and force a reload per texel.
+        const auto band_normaliser = normaliser;
+        float2 band_range = {std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+        std::vector<double> f (width);
+        std::vector<double> row_out (width);
+        std::vector<size_t> v (width);
+        std::vector<double> z (width + 1);
+
+        for (size_t y = begin; y < end; y++)
+        {
+            float* row = distance.row(y);
+            for (size_t x = 0; x < width; x++)
+            {
+                const auto column_distance = static_cast<double>(row[x]);
+                f[x] = column_distance * column_distance;
+            }
+
+            distance_transform_1d(f.data(), width, row_out.data(), v.data(), z.data());
+
+            for (size_t x = 0; x < width; x++)
+            {
+                const auto d = static_cast<float>(std::min(std::sqrt(row_out[x]), clamp_distance));
+                cpuutils::expand_min_max(band_range, d);
+                row[x] = band_normaliser ? (*band_normaliser)(d) : d;
+            }
+        }
+        range.merge(band_range);
+    });
+
+    return range.get();
+}
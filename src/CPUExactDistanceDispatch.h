@@ -0,0 +1,45 @@
+#ifndef IMG2SDF_CPUEXACTDISTANCEDISPATCH_H
+#define IMG2SDF_CPUEXACTDISTANCEDISPATCH_H
+
+#include <cstddef>
+#include <utility>
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+
+///Exact euclidean distance transform of the input mask, as an alternative to the jump flood passes.
+///Uses the separable algorithm of Felzenszwalb & Huttenlocher: a column pass finds the distance to the nearest seed
+///in each column, then a row pass takes the lower envelope of the parabolas rooted at those distances.
+///Both passes are O(width * height), and each runs across independent columns/rows in parallel.
+class CPUExactDistanceDispatch {
+public:
+    ///@param resources a non-owning pointer to the resources to run the transform on. Only the input and distance
+    ///buffers are used, so the output can be fed into CPUJumpFloodDispatch's reduce, normalise and composite stages.
+    ///@param num_threads the number of column/row bands each pass is split into.
+    ///@param pool the pool the bands run on, or null for CPUThreadPool::shared().
+    explicit CPUExactDistanceDispatch(class CPUJumpFloodResources* resources, size_t num_threads = cpuutils::default_thread_count(),
+                                      CPUThreadPool* pool = nullptr);
+
+    ///Writes the exact distance from each texel to the nearest seed into the distance buffer.
+    ///Texels greater than 0 are seeds, or if `invert`, texels where 1 - value is greater than 0 (matching invert.hlsl).
+    ///If the mask has no seeds at all every distance is infinite.
+    ///@param max_distance if greater than 0, distances are clamped to this spread.
+    ///@param normalise_range if not null, the row pass normalises each distance from this fixed range (x = minimum,
+    ///y = maximum) to [0, 1] as it writes it.
+    ///@returns the {minimum, maximum} of the distances, gathered by the row pass before any normalisation.
+    std::pair<float, float> dispatch_distance_transform(bool invert = false, float max_distance = 0,
+                                                        const float2* normalise_range = nullptr);
+
+    ///1D squared distance transform of sampled function `f` (Felzenszwalb & Huttenlocher, 2012).
+    ///@param f n samples, infinite where there is no seed.
+    ///@param out n output squared distances. May not alias `f`.
+    ///@param v, z scratch space of n and n + 1 elements respectively.
+    static void distance_transform_1d(const double* f, size_t n, double* out, size_t* v, double* z);
+
+private:
+    class CPUJumpFloodResources* resources = nullptr;
+    size_t num_threads = 1;
+    CPUThreadPool* pool = nullptr;
+};
+
+#endif //IMG2SDF_CPUEXACTDISTANCEDISPATCH_H
@@ -0,0 +1,153 @@
+#include "CPUFeatureTransformDispatch.h"
+#include "CPUJumpFloodResources.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr int64_t no_seed = -1;
+
+    ///floor division, as Meijster's Sep is defined on integer division rounding down.
+    inline int64_t floor_div(int64_t numerator, int64_t denominator)
+    {
+        const int64_t quotient = numerator / denominator;
+        return (numerator % denominator != 0 && ((numerator < 0) != (denominator < 0))) ? quotient - 1 : quotient;
+    }
+}
+
+CPUFeatureTransformDispatch::CPUFeatureTransformDispatch(CPUJumpFloodResources* resources, size_t num_threads, CPUThreadPool* pool) :
+resources(resources), num_threads(std::max<size_t>(1, num_threads)), pool(pool ? pool : CPUThreadPool::shared().get()) {
+    if (resources == nullptr)
+    {
+        throw std::runtime_error("Resources cannot be null.");
+    }
+}
+
+void CPUFeatureTransformDispatch::dispatch_feature_transform(bool invert) {
+    const auto& mask = resources->get_mask(invert);
+    auto& seeds = resources->create_voronoi_buffer(false);
+    const size_t width = mask.width;
+    const size_t height = mask.height;
+
+    //column phase: the nearest seed in each column, or cpuutils::no_seed if the column has none.
+    pool->parallel_for(width, num_threads, [&](size_t begin, size_t end) {
+        for (size_t y = 0; y < height; y++)
+        {
+            const cpu_bitmask::word_type* mask_row = mask.row(y);
+            cpuutils::packed_seed* out_row = seeds.row(y);
+            const cpuutils::packed_seed* previous_row = y > 0 ? seeds.row(y - 1) : nullptr;
+
+            for (size_t x = begin; x < end; x++)
+            {
+                if (cpu_bitmask::test(mask_row, x))
+                {
+                    out_row[x] = cpuutils::pack_seed(x, y);
+                }
+                else
+                {
+                    out_row[x] = previous_row ? previous_row[x] : cpuutils::no_seed;
+                }
+            }
+        }
+
+        for (size_t y = height - 1; y-- > 0;)
+        {
+            cpuutils::packed_seed* out_row = seeds.row(y);
+            const cpuutils::packed_seed* next_row = seeds.row(y + 1);
+            for (size_t x = begin; x < end; x++)
+            {
+                if (next_row[x] == cpuutils::no_seed)
+                {
+                    continue;
+                }
+
+                const auto row = static_cast<int64_t>(y);
+                const auto next_seed_row = static_cast<int64_t>(cpuutils::seed_y(next_row[x]));
+                if (out_row[x] == cpuutils::no_seed ||
+                    next_seed_row - row < row - static_cast<int64_t>(cpuutils::seed_y(out_row[x])))
+                {
+                    out_row[x] = next_row[x];
+                }
+            }
+        }
+    });
+
+    //row phase: the lower envelope of f(x, i) = (x - i)^2 + g(i)^2 over the columns i that have a seed.
+    pool->parallel_for(height, num_threads, [&](size_t begin, size_t end) {
+        std::vector<int64_t> g (width);
+        std::vector<int64_t> s (width);
+        std::vector<int64_t> t (width);
+
+        for (size_t y = begin; y < end; y++)
+        {
+            cpuutils::packed_seed* row = seeds.row(y);
+            const auto row_index = static_cast<int64_t>(y);
+
+            for (size_t x = 0; x < width; x++)
+            {
+                g[x] = row[x] != cpuutils::no_seed ? static_cast<int64_t>(cpuutils::seed_y(row[x])) : no_seed;
+            }
+
+            const auto f = [&](int64_t x, int64_t i) {
+                const int64_t column_distance = row_index - g[i];
+                return (x - i) * (x - i) + column_distance * column_distance;
+            };
+
+            const auto sep = [&](int64_t i, int64_t u) {
+                const int64_t gi = row_index - g[i];
+                const int64_t gu = row_index - g[u];
+                return floor_div(u * u - i * i + gu * gu - gi * gi, 2 * (u - i));
+            };
+
+            const auto m = static_cast<int64_t>(width);
+            int64_t q = -1;
+            for (int64_t u = 0; u < m; u++)
+            {
+                if (g[u] == no_seed)
+                {
+                    continue;
+                }
+
+                while (q >= 0 && f(t[q], s[q]) > f(t[q], u))
+                {
+                    q--;
+                }
+
+                if (q < 0)
+                {
+                    q = 0;
+                    s[0] = u;
+                    t[0] = 0;
+                }
+                else
+                {
+                    const int64_t w = 1 + sep(s[q], u);
+                    if (w < m)
+                    {
+                        q++;
+                        s[q] = u;
+                        t[q] = w;
+                    }
+                }
+            }
+
+            //every column in the image is empty, so there are no seeds at all.
+            if (q < 0)
+            {
+                std::fill(row, row + width, cpuutils::no_seed);
+                continue;
+            }
+
+            for (int64_t u = m - 1; u >= 0; u--)
+            {
+                const int64_t i = s[q];
+                row[u] = cpuutils::pack_seed(static_cast<size_t>(i), static_cast<size_t>(g[i]));
+
+                if (u == t[q])
+                {
+                    q--;
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,34 @@
+#ifndef IMG2SDF_CPUFEATURETRANSFORMDISPATCH_H
+#define IMG2SDF_CPUFEATURETRANSFORMDISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+
+///Exact feature transform of the input mask: the nearest seed to every texel, rather than the nearest seed
+///jump flooding happens to propagate. Uses Meijster et al.'s two-phase algorithm, tracking the seed instead of only
+///its distance. The column phase finds the nearest seed row in each column, and the row phase picks the closest of
+///those column features with an integer lower envelope. Both phases are linear and run across columns/rows in parallel.
+class CPUFeatureTransformDispatch {
+public:
+    ///@param resources a non-owning pointer to the resources to run the transform on.
+    ///@param num_threads the number of column/row bands each phase is split into.
+    ///@param pool the pool the bands run on, or null for CPUThreadPool::shared().
+    explicit CPUFeatureTransformDispatch(class CPUJumpFloodResources* resources, size_t num_threads = cpuutils::default_thread_count(),
+                                         CPUThreadPool* pool = nullptr);
+
+    ///Writes the nearest seed of each texel into the packed voronoi buffer, as the jump flood does, so it can replace
+    ///preprocess + jump flood ahead of the distance stage.
+    ///Texels greater than 0 are seeds, or if `invert`, texels where 1 - value is greater than 0 (matching invert.hlsl).
+    ///Texels are set to cpuutils::no_seed if the mask has no seeds at all.
+    void dispatch_feature_transform(bool invert = false);
+
+private:
+    class CPUJumpFloodResources* resources = nullptr;
+    size_t num_threads = 1;
+    CPUThreadPool* pool = nullptr;
+};
+
+#endif //IMG2SDF_CPUFEATURETRANSFORMDISPATCH_H
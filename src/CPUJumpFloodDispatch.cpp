@@ -0,0 +1,701 @@
+#include "CPUJumpFloodDispatch.h"
+#include "CPUJumpFloodResources.h"
+#include "cpukernels.h"
+#include "cpureduce.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    ///position of a texel's seed, for the normalised voronoi diagram. A texel without a seed is at the origin, as in a
+    ///cleared voronoi UAV. Distances never measure from it: a texel without a seed is infinitely far from one.
+    inline float2 seed_position(cpuutils::packed_seed seed)
+    {
+        if (seed == cpuutils::no_seed)
+        {
+            return {0.0f, 0.0f};
+        }
+        return {static_cast<float>(cpuutils::seed_x(seed)), static_cast<float>(cpuutils::seed_y(seed))};
+    }
+
+    constexpr int64_t neighbour_offsets[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+    ///mask.hlsi: is_outside. Texels past the edge are neither inside nor outside.
+    inline bool is_outside(const cpu_bitmask& mask, int64_t x, int64_t y)
+    {
+        if (x < 0 || y < 0 || x >= static_cast<int64_t>(mask.width) || y >= static_cast<int64_t>(mask.height))
+        {
+            return false;
+        }
+        return !mask.at(static_cast<size_t>(x), static_cast<size_t>(y));
+    }
+
+    inline void prefetch_span(const cpuutils::packed_seed* span, int64_t count)
+    {
+        constexpr int64_t seeds_per_line = 64 / sizeof(cpuutils::packed_seed);
+        for (int64_t i = 0; i < count; i += seeds_per_line)
+        {
+            cpukernels::prefetch(span + i);
+        }
+    }
+
+    ///runs the jump flood kernel over texels [x_begin, x_end) of row y. The span is split where the left or right
+    ///neighbour enters the texture, so every texel of each piece has the same neighbours in bounds.
+    void flood_row_span(cpukernels::jump_flood_span kernel, const cpu_texture<cpuutils::packed_seed>& in_seeds,
+                        cpu_texture<cpuutils::packed_seed>& out_seeds, const cpuutils::packed_seed* offsets,
+                        int64_t y, int64_t x_begin, int64_t x_end, int64_t delta)
+    {
+        const auto width = static_cast<int64_t>(in_seeds.width);
+        const auto height = static_cast<int64_t>(in_seeds.height);
+
+        //rows past the top or bottom edge hold no seeds.
+        const cpuutils::packed_seed* const rows[3] = {
+                y - delta >= 0 ? in_seeds.row(y - delta) : nullptr,
+                in_seeds.row(y),
+                y + delta < height ? in_seeds.row(y + delta) : nullptr};
+
+        int64_t splits[4] = {x_begin, std::clamp(delta, x_begin, x_end), std::clamp(width - delta, x_begin, x_end), x_end};
+        std::sort(splits + 1, splits + 3);
+
+        for (int32_t piece = 0; piece < 3; piece++)
+        {
+            const int64_t begin = splits[piece];
+            const int64_t end = splits[piece + 1];
+            if (begin >= end)
+            {
+                continue;
+            }
+
+            const bool has_left = begin - delta >= 0;
+            const bool has_right = begin + delta < width;
+            const cpuutils::packed_seed* candidates[9] = {};
+            for (int32_t row = 0; row < 3; row++)
+            {
+                if (rows[row] == nullptr)
+                {
+                    continue;
+                }
+                candidates[row * 3 + 0] = has_left ? rows[row] + begin - delta : nullptr;
+                candidates[row * 3 + 1] = rows[row] + begin;
+                candidates[row * 3 + 2] = has_right ? rows[row] + begin + delta : nullptr;
+            }
+
+            kernel(candidates, out_seeds.row(y) + begin, offsets + begin,
+                   cpuutils::pack_seed(0, static_cast<size_t>(y)), static_cast<size_t>(end - begin));
+        }
+    }
+
+    ///float to unorm conversion of a UAV store: clamped to [0, 1], scaled and rounded to nearest. NaN stores 0.
+    template <typename unorm_type>
+    inline unorm_type to_unorm(float value)
+    {
+        constexpr auto unorm_max = static_cast<float>(std::numeric_limits<unorm_type>::max());
+        if (!(value > 0.0f))
+        {
+            return 0;
+        }
+        return static_cast<unorm_type>(std::min(value, 1.0f) * unorm_max + 0.5f);
+    }
+
+    ///quantise.hlsl: stores `value` as a texel of `format`.
+    template <OUTPUT_FORMAT format>
+    inline void store_texel(float value, uint8_t* out)
+    {
+        if constexpr (format == OUTPUT_FORMAT::FLOAT32)
+        {
+            std::memcpy(out, &value, sizeof(value));
+        }
+        else if constexpr (format == OUTPUT_FORMAT::FLOAT16)
+        {
+            const uint16_t half = cpuutils::float_to_half(value);
+            std::memcpy(out, &half, sizeof(half));
+        }
+        else if constexpr (format == OUTPUT_FORMAT::UNORM16)
+        {
+            const auto unorm = to_unorm<uint16_t>(value);
+            std::memcpy(out, &unorm, sizeof(unorm));
+        }
+        else
+        {
+            *out = to_unorm<uint8_t>(value);
+        }
+    }
+
+    ///normalises and encodes rows [begin, end) of `encoded` from rows [first_row + begin, first_row + end) of
+    ///`distance`, with the format fixed at compile time so the inner loop does not branch on it.
+    template <OUTPUT_FORMAT format>
+    void encode_rows(const cpu_texture<float>& distance, const encoded_view& encoded, size_t first_row, size_t begin,
+                     size_t end, const output_encoding& encoding, bool normalise, float minimum, float maximum,
+                     float out_low)
+    {
+        constexpr size_t texel_size = bytes_per_texel(format);
+        const cpuutils::distance_normaliser normaliser {minimum, maximum, out_low};
+        const bool swap_bytes = texel_size == 2 && encoded.big_endian != (std::endian::native == std::endian::big);
+        for (size_t y = begin; y < end; y++)
+        {
+            const float* in = distance.row(first_row + y);
+            uint8_t* out = encoded.row(y);
+            for (size_t x = 0; x < distance.width; x++, out += texel_size)
+            {
+                float value = in[x];
+                if (normalise)
+                {
+                    value = normaliser(value);
+                }
+                store_texel<format>(value * encoding.scale + encoding.bias, out);
+            }
+
+            //swapped while the row is still in cache, rather than in a second pass over the field.
+            if (swap_bytes)
+            {
+                uint8_t* texel = encoded.row(y);
+                for (size_t x = 0; x < distance.width; x++, texel += texel_size)
+                {
+                    std::swap(texel[0], texel[1]);
+                }
+            }
+        }
+    }
+}
+
+CPUJumpFloodDispatch::CPUJumpFloodDispatch(CPUJumpFloodResources* resources, size_t num_threads, CPUThreadPool* pool,
+                                           std::shared_ptr<const CPUJumpFloodPipeline> pipeline) :
+resources(resources), num_threads(std::max<size_t>(1, num_threads)), pool(pool ? pool : CPUThreadPool::shared().get()),
+pipeline(pipeline ? std::move(pipeline) : CPUJumpFloodPipeline::shared()) {
+    if (resources == nullptr)
+    {
+        throw std::runtime_error("Resources cannot be null.");
+    }
+}
+
+void CPUJumpFloodDispatch::set_simd_level(cpukernels::SIMD_LEVEL level) {
+    if (level != pipeline->get_simd_level())
+    {
+        this->pipeline = CPUJumpFloodPipeline::shared(level);
+    }
+}
+
+cpukernels::SIMD_LEVEL CPUJumpFloodDispatch::get_simd_level() const {
+    return pipeline->get_simd_level();
+}
+
+const std::shared_ptr<const CPUJumpFloodPipeline>& CPUJumpFloodDispatch::get_pipeline() const {
+    return this->pipeline;
+}
+
+void CPUJumpFloodDispatch::set_flood_schedule(FLOOD_SCHEDULE schedule) {
+    this->schedule = schedule;
+}
+
+FLOOD_SCHEDULE CPUJumpFloodDispatch::get_flood_schedule() const {
+    return this->schedule;
+}
+
+void CPUJumpFloodDispatch::dispatch_preprocess(bool invert) {
+    const auto& mask = resources->get_mask(invert);
+    auto& seeds = resources->create_voronoi_buffer(false);
+
+    pool->parallel_for(mask.height, num_threads, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            mask.for_each_set(y, [&](size_t x) { seeds.at(x, y) = cpuutils::pack_seed(x, y); });
+        }
+    });
+}
+
+void CPUJumpFloodDispatch::dispatch_boundary() {
+    const auto& mask = resources->get_mask();
+    auto& seeds = resources->create_voronoi_buffer(false);
+
+    pool->parallel_for(mask.height, num_threads, [&](size_t begin, size_t end) {
+        std::vector<cpu_bitmask::word_type> boundary (mask.words_per_row);
+        for (size_t y = begin; y < end; y++)
+        {
+            mask.boundary_row(y, boundary.data());
+            cpu_bitmask::for_each_set(boundary.data(), boundary.size(),
+                                      [&](size_t x) { seeds.at(x, y) = cpuutils::pack_seed(x, y); });
+        }
+    });
+}
+
+void CPUJumpFloodDispatch::dispatch_voronoi(float max_distance) {
+    const int32_t num_steps = resources->num_steps();
+    const int32_t start_step = max_distance > 0
+            ? std::min(std::max(static_cast<int32_t>(std::ceil(std::log2(max_distance))), 0), num_steps - 1)
+            : num_steps - 1;
+    const auto res = resources->get_resolution();
+
+    const cpukernels::jump_flood_span kernel = pipeline->get_flood_kernel(res.width, res.height);
+
+    resources->create_voronoi_buffer(false);
+
+    int32_t step = start_step;
+    if (schedule == FLOOD_SCHEDULE::MORTON)
+    {
+        step = flood_morton(kernel, start_step);
+    }
+
+    for (; step >= 0; step--)
+    {
+        const int64_t delta = int64_t {1} << step;
+        if (schedule == FLOOD_SCHEDULE::ROWS)
+        {
+            flood_rows(kernel, delta);
+        }
+        else
+        {
+            flood_blocked(kernel, delta);
+        }
+        resources->swap_voronoi_buffers();
+    }
+}
+
+void CPUJumpFloodDispatch::flood_rows(cpukernels::jump_flood_span kernel, int64_t delta) {
+    const auto& in_seeds = resources->create_voronoi_buffer(false);
+    auto& out_seeds = resources->get_voronoi_scratch();
+    const auto offsets = pipeline->get_row_offsets();
+    const auto width = static_cast<int64_t>(in_seeds.width);
+
+    pool->parallel_for(in_seeds.height, num_threads, [&](size_t begin, size_t end) {
+        for (auto y = static_cast<int64_t>(begin); y < static_cast<int64_t>(end); y++)
+        {
+            flood_row_span(kernel, in_seeds, out_seeds, offsets, y, 0, width, delta);
+        }
+    });
+}
+
+void CPUJumpFloodDispatch::flood_blocked(cpukernels::jump_flood_span kernel, int64_t delta) {
+    const auto& in_seeds = resources->create_voronoi_buffer(false);
+    auto& out_seeds = resources->get_voronoi_scratch();
+    const auto offsets = pipeline->get_row_offsets();
+    const auto width = static_cast<int64_t>(in_seeds.width);
+    const auto height = static_cast<int64_t>(in_seeds.height);
+
+    //rows y, y + delta, y + 2 delta... form a chain in which each row reads the one before and after it, so walking a
+    //chain reads one new input row per output row instead of three. Chains are walked one column block at a time so
+    //the rows in flight stay in L1 and on the same pages, and only within each row band: every pass, and the first
+    //touch of the buffers, splits the rows into the same bands, so on a NUMA placed pool each band writes only memory
+    //on its own node and reaches across bands just for the taps delta away.
+    pool->parallel_for(in_seeds.height, num_threads, [&](size_t band_begin, size_t band_end) {
+        const auto first = static_cast<int64_t>(band_begin);
+        const auto last = static_cast<int64_t>(band_end);
+
+        for (int64_t x_begin = 0; x_begin < width; x_begin += flood_block_width)
+        {
+            const int64_t x_end = std::min(width, x_begin + flood_block_width);
+            for (int64_t chain = first; chain < std::min(first + delta, last); chain++)
+            {
+                for (int64_t y = chain; y < last; y += delta)
+                {
+                    //the next link only needs row y + 2 delta that this one has not already touched.
+                    if (y + 2 * delta < height)
+                    {
+                        prefetch_span(in_seeds.row(y + 2 * delta) + x_begin, x_end - x_begin);
+                    }
+                    flood_row_span(kernel, in_seeds, out_seeds, offsets, y, x_begin, x_end, delta);
+                }
+            }
+        }
+    });
+}
+
+int32_t CPUJumpFloodDispatch::flood_morton(cpukernels::jump_flood_span kernel, int32_t start_step) {
+    if ((int64_t {1} << start_step) < morton_min_delta)
+    {
+        return start_step;
+    }
+
+    auto& seeds = resources->create_voronoi_buffer(false);
+    const auto width = static_cast<uint32_t>(seeds.width);
+    const auto height = static_cast<uint32_t>(seeds.height);
+
+    //padded to a power of two square, so every aligned block is a contiguous run of indices. Padding stays no_seed,
+    //which reads the same as an out of bounds neighbour. Every pass hands out equal runs of the copy in band order,
+    //so first touching it in the same runs keeps each run on the node that floods it.
+    const size_t side = size_t {1} << resources->num_steps();
+    std::vector<cpuutils::packed_seed, default_init_allocator<cpuutils::packed_seed>> in_seeds (side * side);
+    std::vector<cpuutils::packed_seed, default_init_allocator<cpuutils::packed_seed>> out_seeds (side * side);
+    pool->parallel_for(side * side, num_threads, [&](size_t begin, size_t end) {
+        std::fill(in_seeds.begin() + begin, in_seeds.begin() + end, cpuutils::no_seed);
+        std::fill(out_seeds.begin() + begin, out_seeds.begin() + end, cpuutils::no_seed);
+    });
+
+    pool->parallel_for(height, num_threads, [&](size_t begin, size_t end) {
+        for (auto y = static_cast<uint32_t>(begin); y < end; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                in_seeds[cpuutils::morton_encode(x, y)] = seeds.at(x, y);
+            }
+        }
+    });
+
+    const auto offsets = pipeline->get_morton_offsets();
+
+    int32_t step = start_step;
+    for (; step >= 0 && (int64_t {1} << step) >= morton_min_delta; step--)
+    {
+        //the neighbours of an aligned block of side delta are the aligned blocks either side of it, which are each
+        //contiguous too. Blocks are split into chunks of at most morton_chunk_side to bound the offsets table.
+        const auto delta = static_cast<uint32_t>(1u << step);
+        const uint32_t blocks_per_side = static_cast<uint32_t>(side) / delta;
+        const uint32_t chunk_side = std::min<uint32_t>(delta, morton_chunk_side);
+        const size_t chunk_size = static_cast<size_t>(chunk_side) * chunk_side;
+        const size_t chunks_per_block = (static_cast<size_t>(delta) / chunk_side) * (delta / chunk_side);
+        const size_t block_size = static_cast<size_t>(delta) * delta;
+        const size_t num_items = static_cast<size_t>(blocks_per_side) * blocks_per_side * chunks_per_block;
+
+        pool->parallel_for(num_items, num_threads, [&](size_t begin, size_t end) {
+            for (size_t item = begin; item < end; item++)
+            {
+                const auto block = static_cast<uint32_t>(item / chunks_per_block);
+                const auto chunk = static_cast<uint32_t>(item % chunks_per_block);
+                const uint32_t block_x = cpuutils::morton_x(block);
+                const uint32_t block_y = cpuutils::morton_y(block);
+                const uint32_t chunk_x = block_x * delta + cpuutils::morton_x(chunk) * chunk_side;
+                const uint32_t chunk_y = block_y * delta + cpuutils::morton_y(chunk) * chunk_side;
+                if (chunk_x >= width || chunk_y >= height)
+                {
+                    continue;
+                }
+
+                const cpuutils::packed_seed* candidates[9] = {};
+                for (int32_t dy = -1; dy <= 1; dy++)
+                {
+                    for (int32_t dx = -1; dx <= 1; dx++)
+                    {
+                        const int64_t neighbour_x = static_cast<int64_t>(block_x) + dx;
+                        const int64_t neighbour_y = static_cast<int64_t>(block_y) + dy;
+                        if (neighbour_x < 0 || neighbour_y < 0 || neighbour_x >= blocks_per_side || neighbour_y >= blocks_per_side)
+                        {
+                            continue;
+                        }
+                        const size_t neighbour = cpuutils::morton_encode(static_cast<uint32_t>(neighbour_x),
+                                                                         static_cast<uint32_t>(neighbour_y));
+                        candidates[(dy + 1) * 3 + dx + 1] = in_seeds.data() + neighbour * block_size + chunk * chunk_size;
+                    }
+                }
+
+                const size_t base = static_cast<size_t>(block) * block_size + chunk * chunk_size;
+                kernel(candidates, out_seeds.data() + base, offsets, cpuutils::pack_seed(chunk_x, chunk_y), chunk_size);
+
+                //chunks straddling the edge must leave their padding without seeds.
+                if (chunk_x + chunk_side > width || chunk_y + chunk_side > height)
+                {
+                    for (uint32_t i = 0; i < chunk_size; i++)
+                    {
+                        if (chunk_x + cpuutils::morton_x(i) >= width || chunk_y + cpuutils::morton_y(i) >= height)
+                        {
+                            out_seeds[base + i] = cpuutils::no_seed;
+                        }
+                    }
+                }
+            }
+        });
+
+        std::swap(in_seeds, out_seeds);
+    }
+
+    pool->parallel_for(height, num_threads, [&](size_t begin, size_t end) {
+        for (auto y = static_cast<uint32_t>(begin); y < end; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                seeds.at(x, y) = in_seeds[cpuutils::morton_encode(x, y)];
+            }
+        }
+    });
+
+    return step;
+}
+
+std::pair<float, float> CPUJumpFloodDispatch::dispatch_distance_transform(float max_distance, const float2* normalise_range) {
+    const auto& seeds = resources->create_voronoi_buffer(false);
+    auto& distance = resources->create_distance_buffer(false);
+    const size_t width = seeds.width;
+    std::optional<cpuutils::distance_normaliser> normaliser;
+    if (normalise_range)
+    {
+        normaliser.emplace(normalise_range->x, normalise_range->y, 0.0f);
+    }
+    cpuutils::min_max_accumulator range;
+
+    pool->parallel_for(seeds.height, num_threads, [&](size_t begin, size_t end) {
+        //a copy per band, so stores to the distance buffer cannot alias it and force a reload per texel.
+        const auto band_normaliser = normaliser;
+        float2 band_range = {inf, -inf};
+        for (size_t y = begin; y < end; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                const cpuutils::packed_seed seed = seeds.at(x, y);
+                float d = inf;
+                if (seed != cpuutils::no_seed)
+                {
+                    const float dx = static_cast<float>(cpuutils::seed_x(seed)) - static_cast<float>(x);
+                    const float dy = static_cast<float>(cpuutils::seed_y(seed)) - static_cast<float>(y);
+                    d = std::sqrt(dx * dx + dy * dy);
+                }
+
+                //band limited: texels the flood never reached are at least max_distance away.
+                if (max_distance > 0)
+                {
+                    d = std::min(d, max_distance);
+                }
+                cpuutils::expand_min_max(band_range, d);
+                distance.at(x, y) = band_normaliser ? (*band_normaliser)(d) : d;
+            }
+        }
+        range.merge(band_range);
+    });
+
+    return range.get();
+}
+
+std::pair<float, float> CPUJumpFloodDispatch::dispatch_signed_distance_transform(float max_distance,
+                                                                                 const float2* normalise_range) {
+    const auto& mask = resources->get_mask();
+    const auto& seeds = resources->create_voronoi_buffer(false);
+    auto& distance = resources->create_distance_buffer(false);
+    const size_t width = seeds.width;
+    std::optional<cpuutils::distance_normaliser> normaliser;
+    if (normalise_range)
+    {
+        normaliser.emplace(normalise_range->x, normalise_range->y, -1.0f);
+    }
+    cpuutils::min_max_accumulator range;
+
+    pool->parallel_for(seeds.height, num_threads, [&](size_t begin, size_t end) {
+        //a copy per band, so stores to the distance buffer cannot alias it and force a reload per texel.
+        const auto band_normaliser = normaliser;
+        float2 band_range = {inf, -inf};
+        for (size_t y = begin; y < end; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                const cpuutils::packed_seed seed = seeds.at(x, y);
+                const bool inside = mask.at(x, y);
+                const auto position_x = static_cast<float>(x);
+                const auto position_y = static_cast<float>(y);
+                const auto seed_x = static_cast<int64_t>(cpuutils::seed_x(seed));
+                const auto seed_y = static_cast<int64_t>(cpuutils::seed_y(seed));
+
+                //a mask with no boundary leaves every texel without a seed, infinitely far from the other side.
+                float d = inf;
+                if (seed != cpuutils::no_seed && !inside)
+                {
+                    d = std::hypot(static_cast<float>(seed_x) - position_x, static_cast<float>(seed_y) - position_y);
+                }
+                else if (seed != cpuutils::no_seed)
+                {
+                    //inside, the distance is to the nearest outside neighbour of the boundary seed.
+                    for (const auto& offset : neighbour_offsets)
+                    {
+                        const int64_t neighbour_x = seed_x + offset[0];
+                        const int64_t neighbour_y = seed_y + offset[1];
+                        if (is_outside(mask, neighbour_x, neighbour_y))
+                        {
+                            d = std::min(d, std::hypot(static_cast<float>(neighbour_x) - position_x,
+                                                       static_cast<float>(neighbour_y) - position_y));
+                        }
+                    }
+                }
+
+                //band limited: texels the flood never reached are at least max_distance away.
+                if (max_distance > 0)
+                {
+                    d = std::min(d, max_distance);
+                }
+                d = inside ? -d : d;
+                cpuutils::expand_min_max(band_range, d);
+                distance.at(x, y) = band_normaliser ? (*band_normaliser)(d) : d;
+            }
+        }
+        range.merge(band_range);
+    });
+
+    return range.get();
+}
+
+cpu_texture<float4> CPUJumpFloodDispatch::dispatch_voronoi_unpack() {
+    const auto& seeds = resources->create_voronoi_buffer(false);
+    const auto res = resources->get_resolution();
+    cpu_texture<float4> out (res.width, res.height);
+
+    pool->parallel_for(res.height, num_threads, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            for (size_t x = 0; x < res.width; x++)
+            {
+                out.at(x, y) = cpuutils::unpack_seed(seeds.at(x, y), x, y, res.width);
+            }
+        }
+    });
+
+    return out;
+}
+
+cpu_texture<float4> CPUJumpFloodDispatch::dispatch_voronoi_normalise() {
+    const auto& seeds = resources->create_voronoi_buffer(false);
+    const auto res = resources->get_resolution();
+    const auto width = static_cast<float>(res.width);
+    const auto height = static_cast<float>(res.height);
+    cpu_texture<float4> out (res.width, res.height);
+
+    pool->parallel_for(res.height, num_threads, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            const cpuutils::packed_seed* seed = seeds.row(y);
+            for (float4* texel = out.row(y); texel != out.row(y) + res.width; texel++, seed++)
+            {
+                const float2 position = seed_position(*seed);
+                *texel = {cpuutils::remap(position.x, 0, width, 0, 1), cpuutils::remap(position.y, 0, height, 0, 1), 0.0f, 1.0f};
+            }
+        }
+    });
+
+    return out;
+}
+
+std::pair<float, float> CPUJumpFloodDispatch::dispatch_minmax_reduce() {
+    const auto& distance = resources->create_distance_buffer(false);
+    return cpureduce::min_max(cpureduce::view(distance), num_threads, pool, pipeline->get_simd_level());
+}
+
+void CPUJumpFloodDispatch::dispatch_distance_normalise(float minimum, float maximum, bool is_signed_field) {
+    auto& distance = resources->create_distance_buffer(false);
+    const float out_low = is_signed_field ? -1.0f : 0.0f;
+
+    pool->parallel_for(distance.height, num_threads, [&](size_t begin, size_t end) {
+        const cpuutils::distance_normaliser normaliser {minimum, maximum, out_low};
+        for (size_t y = begin; y < end; y++)
+        {
+            for (float* value = distance.row(y); value != distance.row(y) + distance.width; value++)
+            {
+                *value = normaliser(*value);
+            }
+        }
+    });
+}
+
+encoded_texture CPUJumpFloodDispatch::dispatch_encode(const output_encoding& encoding, bool normalise, float minimum,
+                                                      float maximum, bool is_signed_field) {
+    const auto res = resources->get_resolution();
+    encoded_texture encoded (res.width, res.height, encoding.format);
+    dispatch_encode(encoding, encoded_view {encoded}, normalise, minimum, maximum, is_signed_field);
+    return encoded;
+}
+
+void CPUJumpFloodDispatch::dispatch_encode(const output_encoding& encoding, const encoded_view& encoded, bool normalise,
+                                           float minimum, float maximum, bool is_signed_field) {
+    const auto& distance = resources->create_distance_buffer(false);
+    if (encoded.width != distance.width || encoded.height != distance.height || encoded.format != encoding.format)
+    {
+        throw std::runtime_error("Encoded output must match the resolution of the distance buffer and the encoding.");
+    }
+
+    encode_band(encoding, encoded, 0, normalise, minimum, maximum, is_signed_field);
+}
+
+void CPUJumpFloodDispatch::dispatch_encode(const output_encoding& encoding, const cpuio::band_writer& writer,
+                                           bool normalise, float minimum, float maximum, bool is_signed_field,
+                                           size_t band_rows) {
+    const auto& distance = resources->create_distance_buffer(false);
+    band_rows = std::clamp<size_t>(band_rows, 1, std::max<size_t>(1, distance.height));
+
+    encoded_texture band (distance.width, band_rows, encoding.format);
+    for (size_t y = 0; y < distance.height; y += band_rows)
+    {
+        encoded_view rows {band};
+        rows.height = std::min(band_rows, distance.height - y);
+        encode_band(encoding, rows, y, normalise, minimum, maximum, is_signed_field);
+        writer(y, rows);
+    }
+}
+
+void CPUJumpFloodDispatch::encode_band(const output_encoding& encoding, const encoded_view& encoded, size_t first_row,
+                                       bool normalise, float minimum, float maximum, bool is_signed_field) {
+    const auto& distance = resources->create_distance_buffer(false);
+    const float out_low = is_signed_field ? -1.0f : 0.0f;
+
+    pool->parallel_for(encoded.height, num_threads, [&](size_t begin, size_t end) {
+        switch (encoding.format)
+        {
+            case OUTPUT_FORMAT::FLOAT16:
+                encode_rows<OUTPUT_FORMAT::FLOAT16>(distance, encoded, first_row, begin, end, encoding, normalise,
+                                                    minimum, maximum, out_low);
+                break;
+            case OUTPUT_FORMAT::UNORM16:
+                encode_rows<OUTPUT_FORMAT::UNORM16>(distance, encoded, first_row, begin, end, encoding, normalise,
+                                                    minimum, maximum, out_low);
+                break;
+            case OUTPUT_FORMAT::UNORM8:
+                encode_rows<OUTPUT_FORMAT::UNORM8>(distance, encoded, first_row, begin, end, encoding, normalise,
+                                                   minimum, maximum, out_low);
+                break;
+            case OUTPUT_FORMAT::FLOAT32:
+            default:
+                encode_rows<OUTPUT_FORMAT::FLOAT32>(distance, encoded, first_row, begin, end, encoding, normalise,
+                                                    minimum, maximum, out_low);
+                break;
+        }
+    });
+}
+
+std::pair<float, float> CPUJumpFloodDispatch::dispatch_composite(const cpu_texture<float>& outer, const float2* normalise_range) {
+    auto& inner = resources->create_distance_buffer(false);
+    if (outer.width != inner.width || outer.height != inner.height)
+    {
+        throw std::runtime_error("Outer distance buffer must match the resolution of the inner distance buffer.");
+    }
+    std::optional<cpuutils::distance_normaliser> normaliser;
+    if (normalise_range)
+    {
+        normaliser.emplace(normalise_range->x, normalise_range->y, -1.0f);
+    }
+
+    cpuutils::min_max_accumulator range;
+
+    pool->parallel_for(inner.height, num_threads, [&](size_t begin, size_t end) {
+        //a copy per band, so stores to the distance buffer cannot alias it and force a reload per texel.
+        const auto band_normaliser = normaliser;
+        float2 band_range = {inf, -inf};
+        for (size_t y = begin; y < end; y++)
+        {
+            for (size_t x = 0; x < inner.width; x++)
+            {
+                const float outer_value = outer.at(x, y);
+                float& inner_value = inner.at(x, y);
+
+                if (outer_value == 0 && inner_value > 0)
+                {
+                    inner_value = -inner_value;
+                }
+                else if (outer_value > 0 && inner_value == 0)
+                {
+                    inner_value = outer_value;
+                }
+                else if (outer_value == 0 && inner_value == 0)
+                {
+                    inner_value = 0;
+                }
+                cpuutils::expand_min_max(band_range, inner_value);
+                if (band_normaliser)
+                {
+                    inner_value = (*band_normaliser)(inner_value);
+                }
+            }
+        }
+        range.merge(band_range);
+    });
+
+    return range.get();
+}
@@ -0,0 +1,160 @@
+#ifndef IMG2SDF_CPUJUMPFLOODDISPATCH_H
+#define IMG2SDF_CPUJUMPFLOODDISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include "cpu_texture.h"
+#include "cpuio.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+#include "cpukernels.h"
+#include "CPUJumpFloodPipeline.h"
+#include "output_format.h"
+
+///Order the CPU jump flood visits texels in. Every schedule produces identical seeds; they differ in how far apart
+///the rows read together are, which matters once the early passes' offsets span more than the caches and TLB and the
+///pass is bound by memory rather than by the kernel; tools/cpu_benchmark measures which wins on a given machine.
+enum class FLOOD_SCHEDULE
+{
+    ///Row bands top to bottom, as each Dispatch covers the texture. Each output row reads three rows 2 delta apart.
+    ROWS,
+    ///Rows delta apart one after the other, a column block at a time: each output row shares two input rows with
+    ///the last, so only one new input row segment is read, and it is prefetched a row ahead.
+    BLOCKED,
+    ///Offsets of at least CPUJumpFloodDispatch::morton_min_delta are flooded on a Z-order copy of the seed buffer,
+    ///where the neighbours of an aligned block of side delta are contiguous blocks too, so every read is a linear
+    ///stream. The copy is padded to a power of two square (up to 4x the memory of the seed buffer), and shorter
+    ///offsets run BLOCKED.
+    MORTON,
+};
+
+///CPU equivalent of JumpFloodDispatch. Each dispatch_* runs the same computation as the matching HLSL kernel
+///in src/shaders/ over the host buffers in CPUJumpFloodResources, split across `num_threads` row bands.
+///Kernels and tables come from a CPUJumpFloodPipeline built once, so a dispatch is cheap to make for each call.
+class CPUJumpFloodDispatch {
+public:
+    ///@param resources a non-owning pointer to the resources to run the pipeline on.
+    ///@param num_threads the number of row bands each pass is split into.
+    ///@param pool the pool the bands run on, or null for CPUThreadPool::shared().
+    ///@param pipeline the kernels and tables to run, or null for CPUJumpFloodPipeline::shared().
+    explicit CPUJumpFloodDispatch(class CPUJumpFloodResources* resources, size_t num_threads = cpuutils::default_thread_count(),
+                                  CPUThreadPool* pool = nullptr, std::shared_ptr<const CPUJumpFloodPipeline> pipeline = nullptr);
+
+    ///Selects the instruction set of the jump flood and reduction kernels by switching to
+    ///CPUJumpFloodPipeline::shared(level). Defaults to the level of the pipeline given to the constructor.
+    ///Every level produces identical seeds. Throws a std::runtime_error if `level` is not supported on this CPU.
+    void set_simd_level(cpukernels::SIMD_LEVEL level);
+    [[nodiscard]] cpukernels::SIMD_LEVEL get_simd_level() const;
+    [[nodiscard]] const std::shared_ptr<const CPUJumpFloodPipeline>& get_pipeline() const;
+
+    ///Selects the order dispatch_voronoi visits texels in. Defaults to FLOOD_SCHEDULE::ROWS.
+    void set_flood_schedule(FLOOD_SCHEDULE schedule);
+    [[nodiscard]] FLOOD_SCHEDULE get_flood_schedule() const;
+
+    ///Width of the column blocks of FLOOD_SCHEDULE::BLOCKED: 16 KiB of each of the three rows in flight, so they stay
+    ///in a 48 KiB L1.
+    static constexpr int64_t flood_block_width = 4096;
+
+    ///Smallest offset FLOOD_SCHEDULE::MORTON floods in Z-order. Blocks of 16x16 are a 1 KiB contiguous run.
+    static constexpr int64_t morton_min_delta = 16;
+
+    ///Largest side of the Z-order chunks handed to the kernel at once.
+    static constexpr uint32_t morton_chunk_side = CPUJumpFloodPipeline::morton_chunk_side;
+
+    ///Seeds the voronoi buffer from the input mask (preprocess.hlsl, or invert.hlsl if `invert`).
+    void dispatch_preprocess(bool invert = false);
+
+    ///Seeds the voronoi buffer with the inside boundary of the mask: texels inside it with an outside 4-neighbour
+    ///(boundary.hlsl). One flood from these seeds serves both sides of a signed field.
+    void dispatch_boundary();
+
+    ///Runs the jump flood passes (jumpflood.hlsl), halving the offset from 2^(num_steps - 1) down to 1.
+    ///Passes ping-pong between two buffers, so the result does not depend on the thread count or SIMD level.
+    ///Texels are visited in the order of the selected FLOOD_SCHEDULE, by the cpukernels::jump_flood_span kernel of the
+    ///selected SIMD level.
+    ///@param max_distance if greater than 0, only seeds within this spread are needed, so the flood starts at the
+    ///smallest power of two >= max_distance rather than at 2^(num_steps - 1).
+    void dispatch_voronoi(float max_distance = 0);
+
+    ///Computes the distance from each texel to its voronoi seed (distance.hlsl).
+    ///@param max_distance if greater than 0, distances are clamped to this spread, and texels without a seed are set to it.
+    ///@param normalise_range if not null, each distance is normalised from this fixed range (x = minimum, y = maximum)
+    ///to [0, 1] as it is written, as dispatch_distance_normalise would, so no separate normalise pass is needed.
+    ///@returns the {minimum, maximum} of the distances, gathered per band before any normalisation.
+    std::pair<float, float> dispatch_distance_transform(float max_distance = 0, const float2* normalise_range = nullptr);
+
+    ///Computes a signed field, negative inside the mask, from a flood of the inside boundary (signed_distance.hlsl).
+    ///Outside texels are exact; inside texels measure to the nearest outside neighbour of their boundary seed, so a
+    ///boundary texel is -1, and can be up to a texel long at sharp concave corners.
+    ///@param max_distance if greater than 0, distances are clamped to this spread, and texels without a seed are set to it.
+    ///@param normalise_range if not null, each distance is normalised from this fixed range to [-1, 1] as it is written.
+    ///@returns the {minimum, maximum} of the signed distances, before any normalisation.
+    std::pair<float, float> dispatch_signed_distance_transform(float max_distance = 0, const float2* normalise_range = nullptr);
+
+    ///Expands the packed voronoi buffer to the float4 {seed x, seed y, id, squared distance} texels of the voronoi
+    ///UAV, recomputing the id and squared distance. Texels without a seed are all zeroes.
+    [[nodiscard]] cpu_texture<float4> dispatch_voronoi_unpack();
+
+    ///Expands the packed voronoi buffer to seed coordinates in normalised texel coordinates (voronoi_normalise.hlsl).
+    [[nodiscard]] cpu_texture<float4> dispatch_voronoi_normalise();
+
+    ///Computes the minimum and maximum of the distance buffer with cpureduce::min_max, at the SIMD level of this
+    ///dispatch. Each band reduces its own rows and the partials are combined on the calling thread, so there is no
+    ///early-out as in the GPU reduction.
+    ///The distance passes already return this range, so this is only needed after the buffer is modified elsewhere.
+    [[nodiscard]] std::pair<float, float> dispatch_minmax_reduce();
+
+    ///Remaps the distance buffer from [minimum, maximum] to [0, 1], or [-1, 1] if `is_signed_field` (normalise.hlsl).
+    ///Values outside [minimum, maximum] are clamped.
+    void dispatch_distance_normalise(float minimum, float maximum, bool is_signed_field);
+
+    ///Normalises the distance buffer as dispatch_distance_normalise does, then stores it as `encoding` in the same pass
+    ///(quantise.hlsl), so the normalised float field is never written and a narrow format is the only output.
+    ///@param normalise whether to normalise from [minimum, maximum] before encoding; if not, raw distances are encoded.
+    [[nodiscard]] encoded_texture dispatch_encode(const output_encoding& encoding, bool normalise, float minimum = 0,
+                                                  float maximum = 0, bool is_signed_field = false);
+
+    ///As above, storing the field in `output` rather than a new encoded_texture, e.g. straight into a mapped file.
+    ///`output` must match the resolution of the resources and the format of `encoding`.
+    void dispatch_encode(const output_encoding& encoding, const encoded_view& output, bool normalise, float minimum = 0,
+                         float maximum = 0, bool is_signed_field = false);
+
+    ///As above, encoding `band_rows` rows at a time into a band buffer and handing each finished band to `writer`
+    ///before starting the next, e.g. cpuimage::image_writer::band_writer, which compresses it on a thread of its own
+    ///while the pool quantises the next band. Only one band of the encoded field is held here.
+    void dispatch_encode(const output_encoding& encoding, const cpuio::band_writer& writer, bool normalise,
+                         float minimum = 0, float maximum = 0, bool is_signed_field = false, size_t band_rows = 64);
+
+    ///Combines an outer (mask) distance field into this resource's inner (inverted mask) distance field,
+    ///producing a signed field that is negative inside the mask (composite.hlsl).
+    ///@param normalise_range if not null, the signed field is normalised from this fixed range to [-1, 1] as it is
+    ///written.
+    ///@returns the {minimum, maximum} of the signed field, before any normalisation.
+    std::pair<float, float> dispatch_composite(const cpu_texture<float>& outer, const float2* normalise_range = nullptr);
+
+private:
+    ///Normalises and encodes the rows of `output` from the distance buffer, starting at row `first_row` of the buffer,
+    ///split across the pool.
+    void encode_band(const output_encoding& encoding, const encoded_view& output, size_t first_row, bool normalise,
+                     float minimum, float maximum, bool is_signed_field);
+
+    ///One pass of dispatch_voronoi in FLOOD_SCHEDULE::ROWS order, into the voronoi scratch buffer.
+    void flood_rows(cpukernels::jump_flood_span kernel, int64_t delta);
+
+    ///One pass of dispatch_voronoi in FLOOD_SCHEDULE::BLOCKED order, into the voronoi scratch buffer.
+    void flood_blocked(cpukernels::jump_flood_span kernel, int64_t delta);
+
+    ///Runs the passes from `start_step` down to morton_min_delta on a Z-order copy of the voronoi buffer, then copies
+    ///the result back. Returns the step to continue from.
+    int32_t flood_morton(cpukernels::jump_flood_span kernel, int32_t start_step);
+
+    class CPUJumpFloodResources* resources = nullptr;
+    size_t num_threads = 1;
+    CPUThreadPool* pool = nullptr;
+    std::shared_ptr<const CPUJumpFloodPipeline> pipeline;
+    FLOOD_SCHEDULE schedule = FLOOD_SCHEDULE::ROWS;
+};
+
+#endif //IMG2SDF_CPUJUMPFLOODDISPATCH_H
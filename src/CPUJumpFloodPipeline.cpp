@@ -0,0 +1,49 @@
+#include "CPUJumpFloodPipeline.h"
+#include <array>
+#include <mutex>
+
+CPUJumpFloodPipeline::CPUJumpFloodPipeline(cpukernels::SIMD_LEVEL simd_level) :
+simd_level(simd_level), flood_kernel(cpukernels::jump_flood_kernel(simd_level)),
+scalar_flood_kernel(cpukernels::jump_flood_kernel(cpukernels::SIMD_LEVEL::SCALAR)),
+row_offsets(cpuutils::max_packed_dimension), morton_offsets(size_t {morton_chunk_side} * morton_chunk_side) {
+    for (size_t x = 0; x < row_offsets.size(); x++)
+    {
+        row_offsets[x] = cpuutils::pack_seed(x, 0);
+    }
+
+    for (uint32_t i = 0; i < morton_offsets.size(); i++)
+    {
+        morton_offsets[i] = cpuutils::pack_seed(cpuutils::morton_x(i), cpuutils::morton_y(i));
+    }
+}
+
+std::shared_ptr<const CPUJumpFloodPipeline> CPUJumpFloodPipeline::shared(cpukernels::SIMD_LEVEL simd_level) {
+    static std::mutex pipelines_mutex;
+    static std::array<std::shared_ptr<const CPUJumpFloodPipeline>, static_cast<size_t>(cpukernels::SIMD_LEVEL::NEON) + 1> pipelines;
+
+    std::lock_guard lock (pipelines_mutex);
+    auto& pipeline = pipelines.at(static_cast<size_t>(simd_level));
+    if (!pipeline)
+    {
+        pipeline = std::make_shared<const CPUJumpFloodPipeline>(simd_level);
+    }
+    return pipeline;
+}
+
+cpukernels::SIMD_LEVEL CPUJumpFloodPipeline::get_simd_level() const {
+    return this->simd_level;
+}
+
+cpukernels::jump_flood_span CPUJumpFloodPipeline::get_flood_kernel(size_t width, size_t height) const {
+    //the vector kernels measure in 32 bit lanes, which only stay exact up to max_simd_dimension.
+    const bool fits_simd = width <= cpukernels::max_simd_dimension && height <= cpukernels::max_simd_dimension;
+    return fits_simd ? flood_kernel : scalar_flood_kernel;
+}
+
+const cpuutils::packed_seed* CPUJumpFloodPipeline::get_row_offsets() const {
+    return this->row_offsets.data();
+}
+
+const cpuutils::packed_seed* CPUJumpFloodPipeline::get_morton_offsets() const {
+    return this->morton_offsets.data();
+}
@@ -0,0 +1,48 @@
+#ifndef IMG2SDF_CPUJUMPFLOODPIPELINE_H
+#define IMG2SDF_CPUJUMPFLOODPIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cpukernels.h"
+#include "cpuutils.h"
+
+///CPU counterpart of JumpFloodPipeline: the parts of the jump flood that do not depend on the input, namely the
+///kernels of one SIMD level and the offset tables they read, built once and shared by every CPUJumpFloodDispatch.
+///A dispatch then only holds the state of a single run. Immutable, so it may be shared between threads.
+class CPUJumpFloodPipeline {
+public:
+    ///Throws a std::runtime_error if `simd_level` is not supported on this CPU.
+    explicit CPUJumpFloodPipeline(cpukernels::SIMD_LEVEL simd_level = cpukernels::best_simd_level());
+
+    ///The pipeline for `simd_level`, built on first use and shared by every caller after.
+    ///Throws a std::runtime_error if `simd_level` is not supported on this CPU.
+    [[nodiscard]] static std::shared_ptr<const CPUJumpFloodPipeline> shared(cpukernels::SIMD_LEVEL simd_level = cpukernels::best_simd_level());
+
+    ///Largest side of the Z-order chunks handed to the kernel at once by FLOOD_SCHEDULE::MORTON.
+    static constexpr uint32_t morton_chunk_side = 64;
+
+    [[nodiscard]] cpukernels::SIMD_LEVEL get_simd_level() const;
+
+    ///The flood kernel for a `width` x `height` texture: the kernel of this pipeline's level, or the scalar one if the
+    ///texture is larger than cpukernels::max_simd_dimension.
+    [[nodiscard]] cpukernels::jump_flood_span get_flood_kernel(size_t width, size_t height) const;
+
+    ///Packed coordinates of each texel of row 0, for every width up to cpuutils::max_packed_dimension; adding
+    ///pack_seed(0, y) moves them to row y.
+    [[nodiscard]] const cpuutils::packed_seed* get_row_offsets() const;
+
+    ///Packed coordinates of the texels of a Z-order chunk of side morton_chunk_side, relative to its top left texel.
+    [[nodiscard]] const cpuutils::packed_seed* get_morton_offsets() const;
+
+private:
+    cpukernels::SIMD_LEVEL simd_level;
+    cpukernels::jump_flood_span flood_kernel = nullptr;
+    cpukernels::jump_flood_span scalar_flood_kernel = nullptr;
+
+    std::vector<cpuutils::packed_seed> row_offsets;
+    std::vector<cpuutils::packed_seed> morton_offsets;
+};
+
+#endif //IMG2SDF_CPUJUMPFLOODPIPELINE_H
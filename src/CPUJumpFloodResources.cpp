@@ -0,0 +1,182 @@
+#include "CPUJumpFloodResources.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+namespace {
+    ///Stands in for a resource pool when none is given: with a cap of 0, every buffer is freed when returned.
+    CPUResourcePool& unpooled()
+    {
+        static CPUResourcePool pool {{}, 0};
+        return pool;
+    }
+}
+
+CPUJumpFloodResources::CPUJumpFloodResources(const cpu_texture<float>* input_texture, size_t num_bands, CPUThreadPool* pool,
+                                             CPUResourcePool* resource_pool) :
+input(input_texture), num_bands(std::max<size_t>(1, num_bands)), pool(pool),
+resource_pool(resource_pool ? resource_pool : &unpooled()) {
+    if (input_texture == nullptr)
+    {
+        throw std::runtime_error("Input texture is NULL");
+    }
+
+    if (input_texture->data.size() != input_texture->width * input_texture->height)
+    {
+        throw std::runtime_error("Input texture data does not match its width and height!");
+    }
+    else if (input_texture->width == 0 || input_texture->height == 0)
+    {
+        throw std::runtime_error("Texture must not be empty!");
+    }
+
+    this->res = input_texture->get_resolution();
+}
+
+CPUJumpFloodResources::CPUJumpFloodResources(const cpu_bitmask* input_mask, size_t num_bands, CPUThreadPool* pool,
+                                             CPUResourcePool* resource_pool) :
+input_mask(input_mask), num_bands(std::max<size_t>(1, num_bands)), pool(pool),
+resource_pool(resource_pool ? resource_pool : &unpooled()) {
+    if (input_mask == nullptr)
+    {
+        throw std::runtime_error("Input mask is NULL");
+    }
+
+    if (input_mask->data.size() != input_mask->words_per_row * input_mask->height ||
+        input_mask->words_per_row * cpu_bitmask::word_bits < input_mask->width)
+    {
+        throw std::runtime_error("Input mask data does not match its width and height!");
+    }
+    else if (input_mask->width == 0 || input_mask->height == 0)
+    {
+        throw std::runtime_error("Mask must not be empty!");
+    }
+
+    this->res = input_mask->get_resolution();
+}
+
+const cpu_bitmask& CPUJumpFloodResources::get_mask(bool invert) {
+    if (this->input_mask != nullptr && !invert)
+    {
+        return *this->input_mask;
+    }
+
+    auto& mask = invert ? this->inverted_mask : this->packed_mask;
+    if (mask.has_value())
+    {
+        return *mask;
+    }
+
+    mask.emplace(res.width, res.height, uninitialised);
+    for_each_band([&](size_t begin, size_t end) {
+        if (this->input_mask != nullptr)
+        {
+            std::copy(this->input_mask->row(begin), this->input_mask->row(end), mask->row(begin));
+            mask->invert_rows(begin, end);
+            return;
+        }
+
+        for (size_t y = begin; y < end; y++)
+        {
+            if (invert)
+            {
+                //as invert.hlsl, which is not quite the complement for texels between 0 and 1.
+                mask->pack_row(y, this->input->row(y), [](float value) { return std::clamp(1.0f - value, 0.0f, 1.0f) > 0.0f; });
+            }
+            else
+            {
+                mask->pack_row(y, this->input->row(y), [](float value) { return value > 0.0f; });
+            }
+        }
+    });
+    return *mask;
+}
+
+cpu_texture<cpuutils::packed_seed>& CPUJumpFloodResources::create_voronoi_buffer(bool regenerate) {
+    if (this->voronoi.has_value() && !regenerate)
+    {
+        return std::get<cpu_texture<cpuutils::packed_seed>>(*this->voronoi);
+    }
+
+    if (res.width > cpuutils::max_packed_dimension || res.height > cpuutils::max_packed_dimension)
+    {
+        throw std::runtime_error("Voronoi buffers are limited to 65535 texels along each axis; use tiled distance fields for larger masks.");
+    }
+
+    return clear(this->voronoi, CPU_BUFFER_FORMAT::PACKED_SEED, cpuutils::no_seed);
+}
+
+cpu_texture<float>& CPUJumpFloodResources::create_distance_buffer(bool regenerate) {
+    if (this->distance.has_value() && !regenerate)
+    {
+        return std::get<cpu_texture<float>>(*this->distance);
+    }
+
+    return clear(this->distance, CPU_BUFFER_FORMAT::FLOAT32, 0.0f);
+}
+
+cpu_texture<cpuutils::packed_seed>& CPUJumpFloodResources::get_voronoi_scratch() {
+    if (!this->voronoi_scratch.has_value())
+    {
+        return clear(this->voronoi_scratch, CPU_BUFFER_FORMAT::PACKED_SEED, cpuutils::no_seed);
+    }
+    return std::get<cpu_texture<cpuutils::packed_seed>>(*this->voronoi_scratch);
+}
+
+void CPUJumpFloodResources::swap_voronoi_buffers() {
+    std::swap(this->voronoi, this->voronoi_scratch);
+}
+
+cpu_texture<cpuutils::packed_seed> CPUJumpFloodResources::release_voronoi_buffer() {
+    if (!this->voronoi.has_value())
+    {
+        return {};
+    }
+    return std::get<cpu_texture<cpuutils::packed_seed>>(this->voronoi.release());
+}
+
+cpu_texture<float> CPUJumpFloodResources::release_distance_buffer() {
+    if (!this->distance.has_value())
+    {
+        return {};
+    }
+    return std::get<cpu_texture<float>>(this->distance.release());
+}
+
+resolution CPUJumpFloodResources::get_resolution() const {
+    return this->res;
+}
+
+template <typename format_type>
+cpu_texture<format_type>& CPUJumpFloodResources::clear(CPUResourcePool::lease& buffer, CPU_BUFFER_FORMAT format,
+                                                       format_type value) {
+    if (!buffer.has_value())
+    {
+        buffer = resource_pool->acquire(res.width, res.height, format);
+    }
+    auto& texture = std::get<cpu_texture<format_type>>(*buffer);
+
+    for_each_band([&](size_t begin, size_t end) {
+        std::fill(texture.row(begin), texture.row(begin) + (end - begin) * res.width, value);
+    });
+    return texture;
+}
+
+template <typename function_type>
+void CPUJumpFloodResources::for_each_band(function_type&& function) {
+    if (pool == nullptr)
+    {
+        function(size_t {0}, res.height);
+        return;
+    }
+
+    pool->parallel_for(res.height, num_bands, function);
+}
+
+int32_t CPUJumpFloodResources::num_steps() const {
+    return static_cast<int32_t>(ceil(log2(static_cast<double>(std::max(res.width, res.height)))));
+}
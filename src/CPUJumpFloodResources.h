@@ -0,0 +1,98 @@
+#ifndef IMG2SDF_CPUJUMPFLOODRESOURCES_H
+#define IMG2SDF_CPUJUMPFLOODRESOURCES_H
+
+#include <cstdint>
+#include <optional>
+#include "cpu_bitmask.h"
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "CPUResourcePool.h"
+#include "shader_globals.h"
+
+class CPUThreadPool;
+
+///Host-buffer equivalent of JumpFloodResources. Owns the intermediate voronoi and distance buffers
+///for a single run of the CPU pipeline, leased from a CPUResourcePool and returned to it on destruction.
+class CPUJumpFloodResources {
+public:
+    ///Wraps an existing seed mask.
+    ///@param input_texture a non-owning pointer to the seed mask. Must outlive this object.
+    ///Any non-zero width and height is supported.
+    ///@param num_bands, pool if `pool` is not null, buffers are first written in `num_bands` row bands on it, the same
+    ///bands the dispatches split their passes into, so with a THREAD_PLACEMENT::NUMA pool each band's pages are placed
+    ///on the node that processes them. Otherwise buffers are filled on the calling thread.
+    ///@param resource_pool if not null, the pool buffers are leased from, e.g. to reuse them across a batch of
+    ///same-sized masks. It is not owned. Otherwise every buffer is allocated afresh.
+    explicit CPUJumpFloodResources(const cpu_texture<float>* input_texture, size_t num_bands = 1,
+                                   CPUThreadPool* pool = nullptr, CPUResourcePool* resource_pool = nullptr);
+
+    ///Wraps an existing bit-packed seed mask, which the stages then read as it is.
+    ///@param input_mask a non-owning pointer to the mask. Must outlive this object.
+    ///The other parameters are as above.
+    explicit CPUJumpFloodResources(const cpu_bitmask* input_mask, size_t num_bands = 1,
+                                   CPUThreadPool* pool = nullptr, CPUResourcePool* resource_pool = nullptr);
+
+    ///Returns the seeds of the input as a bit-packed mask, the form every CPU stage reads it in: the texels greater
+    ///than 0, or if `invert`, the texels where 1 - value is greater than 0 (invert.hlsl), which for a bit-packed input
+    ///is its complement. Packed or inverted band by band on first use and kept for the life of the resources, at a
+    ///32nd of the size of a float mask.
+    const cpu_bitmask& get_mask(bool invert = false);
+
+    ///Creates the buffer for the output voronoi diagram, of same width and height as the input, with every texel set
+    ///to cpuutils::no_seed. Each texel holds its nearest seed as a cpuutils::packed_seed, a quarter of the size of the
+    ///float4 texels of the voronoi UAV; CPUJumpFloodDispatch::dispatch_voronoi_unpack expands it.
+    ///Throws if the width or height exceeds cpuutils::max_packed_dimension.
+    ///@param regenerate whether or not to clear the current voronoi buffer again, in place.
+    cpu_texture<cpuutils::packed_seed>& create_voronoi_buffer(bool regenerate = true);
+
+    ///Creates the buffer for the output distance transform, of same width and height as the input, zero initialised.
+    ///@param regenerate whether or not to clear the current distance buffer again, in place.
+    cpu_texture<float>& create_distance_buffer(bool regenerate = true);
+
+    ///The jump flood passes read one voronoi buffer and write the other. This returns the buffer that is
+    ///not currently the voronoi output; `swap_voronoi_buffers` makes it the output after a pass.
+    cpu_texture<cpuutils::packed_seed>& get_voronoi_scratch();
+
+    void swap_voronoi_buffers();
+
+    ///Moves the voronoi buffer out of the resources, and out of the resource pool, leaving it empty.
+    cpu_texture<cpuutils::packed_seed> release_voronoi_buffer();
+
+    ///Moves the distance buffer out of the resources, and out of the resource pool, leaving it empty.
+    cpu_texture<float> release_distance_buffer();
+
+    ///Gets the width and height of the resources. Every resource has the same pixel width and height.
+    [[nodiscard]] resolution get_resolution() const;
+
+    ///Returns the number of passes the JFA kernel needs to make, log2 of the larger dimension rounded up, so the
+    ///first offset 2^(num_steps - 1) covers at least half of both width and height.
+    [[nodiscard]] int32_t num_steps() const;
+
+private:
+    ///Leases an input-sized buffer into `buffer` if it is empty, then sets every texel to `value` in place, band by
+    ///band on the thread pool. A new buffer is allocated untouched, so this is also its first touch.
+    template <typename format_type>
+    cpu_texture<format_type>& clear(CPUResourcePool::lease& buffer, CPU_BUFFER_FORMAT format, format_type value);
+
+    ///Calls `function(begin, end)` for each band of rows on the thread pool, or once for every row without one.
+    template <typename function_type>
+    void for_each_band(function_type&& function);
+
+    ///exactly one of the inputs is set.
+    const cpu_texture<float>* input = nullptr;
+    const cpu_bitmask* input_mask = nullptr;
+    std::optional<cpu_bitmask> packed_mask;
+    std::optional<cpu_bitmask> inverted_mask;
+    size_t num_bands = 1;
+    CPUThreadPool* pool = nullptr;
+    CPUResourcePool* resource_pool = nullptr;
+
+    resolution res = {0, 0};
+
+    CPUResourcePool::lease voronoi;
+    CPUResourcePool::lease voronoi_scratch;
+
+    CPUResourcePool::lease distance;
+};
+
+#endif //IMG2SDF_CPUJUMPFLOODRESOURCES_H
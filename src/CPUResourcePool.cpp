@@ -0,0 +1,23 @@
+#include "CPUResourcePool.h"
+
+CPUBufferBackend::resource_type CPUBufferBackend::create(size_t width, size_t height, format_type format) const {
+    switch (format)
+    {
+        case CPU_BUFFER_FORMAT::PACKED_SEED:
+            return cpu_texture<cpuutils::packed_seed>(width, height, uninitialised);
+        case CPU_BUFFER_FORMAT::FLOAT32:
+        default:
+            return cpu_texture<float>(width, height, uninitialised);
+    }
+}
+
+size_t CPUBufferBackend::size_in_bytes(size_t width, size_t height, format_type format) const {
+    switch (format)
+    {
+        case CPU_BUFFER_FORMAT::PACKED_SEED:
+            return width * height * sizeof(cpuutils::packed_seed);
+        case CPU_BUFFER_FORMAT::FLOAT32:
+        default:
+            return width * height * sizeof(float);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef IMG2SDF_CPURESOURCEPOOL_H
+#define IMG2SDF_CPURESOURCEPOOL_H
+
+#include <cstddef>
+#include <variant>
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "ResourcePool.h"
+
+///Texel formats of the buffers CPUJumpFloodResources creates.
+enum class CPU_BUFFER_FORMAT
+{
+    ///cpuutils::packed_seed, the voronoi buffers.
+    PACKED_SEED,
+    ///float, the distance buffer.
+    FLOAT32,
+};
+
+///ResourcePool backend over host memory, so the CPU pipeline recycles its buffers the way the D3D11 one recycles its
+///textures.
+struct CPUBufferBackend
+{
+    using format_type = CPU_BUFFER_FORMAT;
+    using resource_type = std::variant<cpu_texture<cpuutils::packed_seed>, cpu_texture<float>>;
+
+    ///Allocates without writing a texel, so the caller's clear is also its first touch.
+    [[nodiscard]] resource_type create(size_t width, size_t height, format_type format) const;
+
+    [[nodiscard]] size_t size_in_bytes(size_t width, size_t height, format_type format) const;
+};
+
+using CPUResourcePool = ResourcePool<CPUBufferBackend>;
+
+#endif //IMG2SDF_CPURESOURCEPOOL_H
@@ -0,0 +1,290 @@
+#include "CPUSparseSeedDispatch.h"
+#include "CPUJumpFloodResources.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    inline bool is_seed(float value, bool invert)
+    {
+        return invert ? std::clamp(1.0f - value, 0.0f, 1.0f) > 0.0f : value > 0.0f;
+    }
+}
+
+CPUSparseSeedDispatch::CPUSparseSeedDispatch(CPUJumpFloodResources* resources, size_t num_threads, CPUThreadPool* pool) :
+resources(resources), num_threads(std::max<size_t>(1, num_threads)), pool(pool ? pool : CPUThreadPool::shared().get()) {
+    if (resources == nullptr)
+    {
+        throw std::runtime_error("Resources cannot be null.");
+    }
+}
+
+size_t CPUSparseSeedDispatch::count_seeds(const cpu_texture<float>& mask, bool invert, size_t num_threads,
+                                          CPUThreadPool* pool) {
+    const size_t num_bands = std::clamp<size_t>(num_threads, 1, std::max<size_t>(1, mask.height));
+    std::vector<size_t> counts (num_bands, 0);
+    const size_t band_size = (mask.height + num_bands - 1) / num_bands;
+
+    (pool ? pool : CPUThreadPool::shared().get())->parallel_for(num_bands, num_bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; band++)
+        {
+            const size_t row_end = std::min(mask.height, (band + 1) * band_size);
+            counts[band] = std::count_if(mask.row(std::min(mask.height, band * band_size)), mask.row(row_end),
+                                         [invert](float value) { return is_seed(value, invert); });
+        }
+    });
+
+    size_t total = 0;
+    for (const auto count : counts)
+    {
+        total += count;
+    }
+    return total;
+}
+
+size_t CPUSparseSeedDispatch::count_seeds(const cpu_bitmask& mask, size_t num_threads, CPUThreadPool* pool) {
+    const size_t num_bands = std::clamp<size_t>(num_threads, 1, std::max<size_t>(1, mask.height));
+    std::vector<size_t> counts (num_bands, 0);
+    const size_t band_size = (mask.height + num_bands - 1) / num_bands;
+
+    (pool ? pool : CPUThreadPool::shared().get())->parallel_for(num_bands, num_bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; band++)
+        {
+            counts[band] = mask.count_rows(std::min(mask.height, band * band_size),
+                                           std::min(mask.height, (band + 1) * band_size));
+        }
+    });
+
+    size_t total = 0;
+    for (const auto count : counts)
+    {
+        total += count;
+    }
+    return total;
+}
+
+CPUSparseSeedDispatch::seed_grid CPUSparseSeedDispatch::build_grid(bool invert) const {
+    const auto& mask = resources->get_mask(invert);
+    const size_t width = mask.width;
+    const size_t height = mask.height;
+
+    //gather seeds per band, in row order so the grid does not depend on the thread count.
+    const size_t num_bands = std::clamp<size_t>(num_threads, 1, std::max<size_t>(1, height));
+    const size_t band_size = (height + num_bands - 1) / num_bands;
+    std::vector<std::vector<float2>> band_seeds (num_bands);
+
+    pool->parallel_for(num_bands, num_bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; band++)
+        {
+            const size_t row_end = std::min(height, (band + 1) * band_size);
+            for (size_t y = band * band_size; y < row_end; y++)
+            {
+                mask.for_each_set(y, [&](size_t x) {
+                    band_seeds[band].push_back({static_cast<float>(x), static_cast<float>(y)});
+                });
+            }
+        }
+    });
+
+    seed_grid grid {};
+    size_t num_seeds = 0;
+    for (const auto& seeds : band_seeds)
+    {
+        num_seeds += seeds.size();
+    }
+
+    if (num_seeds == 0)
+    {
+        return grid;
+    }
+
+    //roughly one seed per cell.
+    const double area_per_seed = static_cast<double>(width) * static_cast<double>(height) / static_cast<double>(num_seeds);
+    grid.cell_size = std::max<size_t>(1, static_cast<size_t>(std::sqrt(area_per_seed)));
+    grid.cells_x = (width + grid.cell_size - 1) / grid.cell_size;
+    grid.cells_y = (height + grid.cell_size - 1) / grid.cell_size;
+
+    const auto cell_of = [&](const float2& seed) {
+        return (static_cast<size_t>(seed.y) / grid.cell_size) * grid.cells_x + static_cast<size_t>(seed.x) / grid.cell_size;
+    };
+
+    //counting sort into cells.
+    grid.cell_start.assign(grid.cells_x * grid.cells_y + 1, 0);
+    for (const auto& seeds : band_seeds)
+    {
+        for (const auto& seed : seeds)
+        {
+            grid.cell_start[cell_of(seed) + 1]++;
+        }
+    }
+    for (size_t cell = 1; cell < grid.cell_start.size(); cell++)
+    {
+        grid.cell_start[cell] += grid.cell_start[cell - 1];
+    }
+
+    std::vector<uint32_t> fill (grid.cell_start.begin(), grid.cell_start.end() - 1);
+    grid.seeds.resize(num_seeds);
+    for (const auto& seeds : band_seeds)
+    {
+        for (const auto& seed : seeds)
+        {
+            grid.seeds[fill[cell_of(seed)]++] = seed;
+        }
+    }
+
+    return grid;
+}
+
+void CPUSparseSeedDispatch::dispatch_nearest_seed(bool invert, float max_distance) {
+    auto& out_seeds = resources->create_voronoi_buffer(false);
+    const auto res = resources->get_resolution();
+
+    const seed_grid grid = build_grid(invert);
+    if (grid.seeds.empty())
+    {
+        std::fill(out_seeds.data.begin(), out_seeds.data.end(), cpuutils::no_seed);
+        return;
+    }
+
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    const float max_distance_squared = max_distance > 0 ? max_distance * max_distance : inf;
+    const auto cell_size = static_cast<int64_t>(grid.cell_size);
+    const auto cells_x = static_cast<int64_t>(grid.cells_x);
+    const auto cells_y = static_cast<int64_t>(grid.cells_y);
+
+    const size_t tiles_x = (res.width + tile_width - 1) / tile_width;
+    const size_t tiles_y = (res.height + tile_width - 1) / tile_width;
+
+    pool->parallel_for(tiles_x * tiles_y, num_threads, [&](size_t begin, size_t end) {
+        std::vector<float2> candidates;
+
+        for (size_t tile = begin; tile < end; tile++)
+        {
+            const size_t tile_x0 = (tile % tiles_x) * tile_width;
+            const size_t tile_y0 = (tile / tiles_x) * tile_width;
+            const size_t tile_x1 = std::min(res.width, tile_x0 + tile_width);
+            const size_t tile_y1 = std::min(res.height, tile_y0 + tile_width);
+
+            const auto box_x0 = static_cast<float>(tile_x0);
+            const auto box_y0 = static_cast<float>(tile_y0);
+            const auto box_x1 = static_cast<float>(tile_x1 - 1);
+            const auto box_y1 = static_cast<float>(tile_y1 - 1);
+
+            //squared distance from a seed to the closest and furthest texel of the tile.
+            const auto min_distance = [&](const float2& seed) {
+                const float dx = std::max({box_x0 - seed.x, 0.0f, seed.x - box_x1});
+                const float dy = std::max({box_y0 - seed.y, 0.0f, seed.y - box_y1});
+                return dx * dx + dy * dy;
+            };
+            const auto max_distance_to_tile = [&](const float2& seed) {
+                const float dx = std::max(seed.x - box_x0, box_x1 - seed.x);
+                const float dy = std::max(seed.y - box_y0, box_y1 - seed.y);
+                return dx * dx + dy * dy;
+            };
+
+            //upper bound on the nearest seed distance of every texel in the tile: search rings of cells outwards
+            //from the tile until a ring cannot hold anything closer than the best bound so far.
+            const auto tile_cell_x0 = static_cast<int64_t>(tile_x0) / cell_size;
+            const auto tile_cell_y0 = static_cast<int64_t>(tile_y0) / cell_size;
+            const auto tile_cell_x1 = static_cast<int64_t>(tile_x1 - 1) / cell_size;
+            const auto tile_cell_y1 = static_cast<int64_t>(tile_y1 - 1) / cell_size;
+
+            float bound = max_distance_squared;
+            const auto bound_cell = [&](int64_t cell_x, int64_t cell_y) {
+                if (cell_x < 0 || cell_y < 0 || cell_x >= cells_x || cell_y >= cells_y)
+                {
+                    return;
+                }
+                const size_t cell = cell_y * cells_x + cell_x;
+                for (uint32_t i = grid.cell_start[cell]; i < grid.cell_start[cell + 1]; i++)
+                {
+                    bound = std::min(bound, max_distance_to_tile(grid.seeds[i]));
+                }
+            };
+
+            for (int64_t ring = 0; ring <= std::max(cells_x, cells_y); ring++)
+            {
+                //seeds in this ring are at least (ring - 1) whole cells plus a texel from the tile.
+                if (ring > 0)
+                {
+                    const auto gap = static_cast<float>((ring - 1) * cell_size + 1);
+                    if (gap * gap > bound)
+                    {
+                        break;
+                    }
+                }
+
+                for (int64_t cx = tile_cell_x0 - ring; cx <= tile_cell_x1 + ring; cx++)
+                {
+                    bound_cell(cx, tile_cell_y0 - ring);
+                    if (ring > 0 || tile_cell_y1 != tile_cell_y0)
+                    {
+                        bound_cell(cx, tile_cell_y1 + ring);
+                    }
+                }
+                for (int64_t cy = tile_cell_y0 - ring + 1; cy < tile_cell_y1 + ring; cy++)
+                {
+                    bound_cell(tile_cell_x0 - ring, cy);
+                    if (ring > 0 || tile_cell_x1 != tile_cell_x0)
+                    {
+                        bound_cell(tile_cell_x1 + ring, cy);
+                    }
+                }
+            }
+
+            //only seeds that could be nearest to some texel of the tile are kept.
+            candidates.clear();
+            if (bound != inf)
+            {
+                const float reach = std::sqrt(bound);
+                const auto reach_x0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(box_x0 - reach)) / cell_size);
+                const auto reach_y0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(box_y0 - reach)) / cell_size);
+                const auto reach_x1 = std::min<int64_t>(cells_x - 1, static_cast<int64_t>(std::ceil(box_x1 + reach)) / cell_size);
+                const auto reach_y1 = std::min<int64_t>(cells_y - 1, static_cast<int64_t>(std::ceil(box_y1 + reach)) / cell_size);
+
+                for (int64_t cy = reach_y0; cy <= reach_y1; cy++)
+                {
+                    for (int64_t cx = reach_x0; cx <= reach_x1; cx++)
+                    {
+                        const size_t cell = cy * cells_x + cx;
+                        for (uint32_t i = grid.cell_start[cell]; i < grid.cell_start[cell + 1]; i++)
+                        {
+                            if (min_distance(grid.seeds[i]) <= bound)
+                            {
+                                candidates.push_back(grid.seeds[i]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (size_t y = tile_y0; y < tile_y1; y++)
+            {
+                for (size_t x = tile_x0; x < tile_x1; x++)
+                {
+                    const auto fx = static_cast<float>(x);
+                    const auto fy = static_cast<float>(y);
+
+                    float best_distance = inf;
+                    float2 best_seed {};
+                    for (const auto& seed : candidates)
+                    {
+                        const float dx = seed.x - fx;
+                        const float dy = seed.y - fy;
+                        const float distance = dx * dx + dy * dy;
+                        if (distance < best_distance)
+                        {
+                            best_distance = distance;
+                            best_seed = seed;
+                        }
+                    }
+
+                    out_seeds.at(x, y) = best_distance > max_distance_squared
+                            ? cpuutils::no_seed
+                            : cpuutils::pack_seed(static_cast<size_t>(best_seed.x), static_cast<size_t>(best_seed.y));
+                }
+            }
+        }
+    });
+}
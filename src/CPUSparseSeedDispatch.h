@@ -0,0 +1,62 @@
+#ifndef IMG2SDF_CPUSPARSESEEDDISPATCH_H
+#define IMG2SDF_CPUSPARSESEEDDISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "cpu_bitmask.h"
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+
+///Nearest seed transform for masks with very few seeds, e.g. a few hundred points on a large canvas.
+///Rather than flooding the whole image, the seeds are bucketed into a uniform grid. Each tile of texels searches the
+///grid outwards for an upper bound on its nearest seed distance, keeps only the seeds that could be nearest to one of
+///its texels, and tests just those. Tiles are answered in parallel.
+class CPUSparseSeedDispatch {
+public:
+    ///Seed density (seeds per texel) below which CPU_ENGINE::AUTO picks this engine.
+    static constexpr double sparse_density_threshold = 1.0 / 1024.0;
+
+    ///@param resources a non-owning pointer to the resources to run the transform on.
+    ///@param num_threads the number of tile bands the query is split into.
+    ///@param pool the pool the bands run on, or null for CPUThreadPool::shared().
+    explicit CPUSparseSeedDispatch(class CPUJumpFloodResources* resources, size_t num_threads = cpuutils::default_thread_count(),
+                                   CPUThreadPool* pool = nullptr);
+
+    ///Counts the seeds in `mask`: texels greater than 0, or if `invert`, texels where 1 - value is greater than 0.
+    static size_t count_seeds(const cpu_texture<float>& mask, bool invert = false,
+                              size_t num_threads = cpuutils::default_thread_count(), CPUThreadPool* pool = nullptr);
+
+    ///Counts the set texels of `mask`, by population count.
+    static size_t count_seeds(const cpu_bitmask& mask, size_t num_threads = cpuutils::default_thread_count(),
+                              CPUThreadPool* pool = nullptr);
+
+    ///Writes the nearest seed of each texel into the packed voronoi buffer, as the jump flood does.
+    ///Texels greater than 0 are seeds, or if `invert`, texels where 1 - value is greater than 0 (matching invert.hlsl).
+    ///The result is exact. Texels are set to cpuutils::no_seed if the mask has no seeds at all.
+    ///@param max_distance if greater than 0, texels with no seed within this spread are set to cpuutils::no_seed,
+    ///and the search stops there.
+    void dispatch_nearest_seed(bool invert = false, float max_distance = 0);
+
+    constexpr static size_t tile_width = 32;
+
+private:
+    ///Bucketed seed list. Seeds in cell c are seeds[cell_start[c]] to seeds[cell_start[c + 1]].
+    struct seed_grid
+    {
+        size_t cell_size = 1;
+        size_t cells_x = 0;
+        size_t cells_y = 0;
+        std::vector<uint32_t> cell_start;
+        std::vector<float2> seeds;
+    };
+
+    seed_grid build_grid(bool invert) const;
+
+    class CPUJumpFloodResources* resources = nullptr;
+    size_t num_threads = 1;
+    CPUThreadPool* pool = nullptr;
+};
+
+#endif //IMG2SDF_CPUSPARSESEEDDISPATCH_H
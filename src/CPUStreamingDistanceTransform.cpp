@@ -0,0 +1,206 @@
+#include "CPUStreamingDistanceTransform.h"
+#include "CPUExactDistanceDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+CPUStreamingDistanceTransform::CPUStreamingDistanceTransform(size_t width, size_t height, cpuio::row_writer sink,
+                                                             bool is_signed, float max_distance, bool normalise) :
+width(width), height(height), sink(std::move(sink)), is_signed(is_signed), max_distance(max_distance),
+normalise(normalise), out_row(width, 0.0f) {
+    if (width == 0 || height == 0)
+    {
+        throw std::runtime_error("Texture must not be empty!");
+    }
+    if (!this->sink)
+    {
+        throw std::runtime_error("Row sink cannot be empty.");
+    }
+    if (normalise && max_distance <= 0)
+    {
+        throw std::runtime_error("Streaming distance fields can only be normalised against a max_distance.");
+    }
+
+    const auto make_side = [width](uint8_t flag) {
+        side s {};
+        s.flag = flag;
+        s.above.assign(width, no_seed);
+        s.below.assign(width, no_seed);
+        s.unknown_below = width;
+        s.column_distance.resize(width);
+        s.row_distance.resize(width);
+        s.v.resize(width);
+        s.z.resize(width + 1);
+        return s;
+    };
+
+    sides.push_back(make_side(seed_flag));
+    if (is_signed)
+    {
+        sides.push_back(make_side(inverted_seed_flag));
+    }
+}
+
+void CPUStreamingDistanceTransform::push_row(const float* mask_row) {
+    if (pushed >= height)
+    {
+        throw std::runtime_error("Pushed more rows than the height of the mask.");
+    }
+
+    std::vector<uint8_t> flags (width);
+    for (size_t x = 0; x < width; x++)
+    {
+        //matches preprocess.hlsl and invert.hlsl.
+        flags[x] = static_cast<uint8_t>((mask_row[x] > 0.0f ? seed_flag : 0) |
+                                        (std::clamp(1.0f - mask_row[x], 0.0f, 1.0f) > 0.0f ? inverted_seed_flag : 0));
+    }
+
+    const auto row_index = static_cast<int64_t>(pushed);
+    for (auto& s : sides)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            if ((flags[x] & s.flag) && s.below[x] == no_seed)
+            {
+                s.below[x] = row_index;
+                s.unknown_below--;
+                //a column that had nothing below may have just brought a pending row within reach.
+                retry_at = 0;
+            }
+        }
+    }
+
+    band.push_back(std::move(flags));
+    pushed++;
+
+    emit_final_rows();
+}
+
+size_t CPUStreamingDistanceTransform::rows_pushed() const {
+    return pushed;
+}
+
+size_t CPUStreamingDistanceTransform::rows_emitted() const {
+    return emitted;
+}
+
+size_t CPUStreamingDistanceTransform::rows_buffered() const {
+    return band.size();
+}
+
+double CPUStreamingDistanceTransform::transform_row(side& s) {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    const auto y = static_cast<int64_t>(emitted);
+
+    for (size_t x = 0; x < width; x++)
+    {
+        double distance = inf;
+        if (s.above[x] != no_seed)
+        {
+            distance = static_cast<double>(y - s.above[x]);
+        }
+        if (s.below[x] != no_seed)
+        {
+            distance = std::min(distance, static_cast<double>(s.below[x] - y));
+        }
+        s.column_distance[x] = distance * distance;
+    }
+
+    CPUExactDistanceDispatch::distance_transform_1d(s.column_distance.data(), width, s.row_distance.data(),
+                                                    s.v.data(), s.z.data());
+
+    return *std::max_element(s.row_distance.begin(), s.row_distance.end());
+}
+
+void CPUStreamingDistanceTransform::emit_final_rows() {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    const double max_distance_squared = max_distance > 0 ? static_cast<double>(max_distance) * max_distance : inf;
+
+    while (emitted < pushed)
+    {
+        const bool end_of_input = pushed == height;
+        if (!end_of_input && pushed < retry_at)
+        {
+            return;
+        }
+
+        //any seed still to come is at least `look_ahead` rows below, so it cannot beat a distance within that.
+        const auto look_ahead = static_cast<double>(pushed - emitted);
+        double required = 0;
+        for (auto& s : sides)
+        {
+            const double largest = std::min(transform_row(s), max_distance_squared);
+            if (s.unknown_below > 0)
+            {
+                required = std::max(required, largest);
+            }
+        }
+
+        if (!end_of_input && required > look_ahead * look_ahead)
+        {
+            retry_at = std::isinf(required)
+                    ? std::numeric_limits<size_t>::max()
+                    : emitted + static_cast<size_t>(std::ceil(std::sqrt(required)));
+            return;
+        }
+
+        const auto& flags = band.front();
+        for (size_t x = 0; x < width; x++)
+        {
+            const bool inside = is_signed && (flags[x] & seed_flag);
+            auto value = static_cast<float>(std::sqrt(inside ? sides[1].row_distance[x] : sides[0].row_distance[x]));
+            if (max_distance > 0)
+            {
+                value = std::min(value, max_distance);
+            }
+            if (normalise)
+            {
+                value /= max_distance;
+            }
+            out_row[x] = inside ? -value : value;
+        }
+
+        sink(emitted, out_row.data());
+
+        for (auto& s : sides)
+        {
+            advance(s);
+        }
+        band.pop_front();
+        emitted++;
+    }
+}
+
+void CPUStreamingDistanceTransform::advance(side& s) {
+    const auto y = static_cast<int64_t>(emitted);
+
+    for (size_t x = 0; x < width; x++)
+    {
+        if (s.below[x] != y)
+        {
+            continue;
+        }
+
+        //the seed on this row is now above; find the next one down the column within the band.
+        s.above[x] = y;
+        s.below[x] = no_seed;
+        for (size_t row = emitted + 1; row < pushed; row++)
+        {
+            if (buffered_row(row)[x] & s.flag)
+            {
+                s.below[x] = static_cast<int64_t>(row);
+                break;
+            }
+        }
+
+        if (s.below[x] == no_seed)
+        {
+            s.unknown_below++;
+        }
+    }
+}
+
+const std::vector<uint8_t>& CPUStreamingDistanceTransform::buffered_row(size_t y) const {
+    return band[y - emitted];
+}
@@ -0,0 +1,88 @@
+#ifndef IMG2SDF_CPUSTREAMINGDISTANCETRANSFORM_H
+#define IMG2SDF_CPUSTREAMINGDISTANCETRANSFORM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "cpuio.h"
+
+///Exact euclidean distance transform of a mask fed in one row at a time, top to bottom.
+///Each output row is handed to the sink as soon as no later input row can change it, so only O(width) column state
+///and the band of rows still waiting on a seed below them are held in memory.
+///The column state is the nearest seed row above and below the current output row in every column (the column pass of
+///CPUExactDistanceDispatch), and each output row is the lower envelope of those distances (the row pass).
+///A row is final once the rows read past it are further away than its largest distance, so with a `max_distance` the
+///band is at most max_distance rows; without one, a long run of rows with no seed below them has to be buffered.
+class CPUStreamingDistanceTransform {
+public:
+    ///@param width, height size of the full mask.
+    ///@param sink receives each output row, in order.
+    ///@param is_signed whether to compute a signed field (negative inside the mask) or an unsigned one.
+    ///@param max_distance if greater than 0, distances are clamped to this spread, which also bounds the band.
+    ///@param normalise whether to normalise against max_distance, to [0, 1] or [-1, 1] if `is_signed`.
+    ///Streaming never sees the whole field, so normalising requires a max_distance.
+    CPUStreamingDistanceTransform(size_t width, size_t height, cpuio::row_writer sink, bool is_signed = false,
+                                  float max_distance = 0, bool normalise = false);
+
+    ///Feeds the next row of the mask. Texels greater than 0 are inside the mask.
+    ///Emits every output row that became final; after the last row, emits everything that is left.
+    void push_row(const float* mask_row);
+
+    [[nodiscard]] size_t rows_pushed() const;
+    [[nodiscard]] size_t rows_emitted() const;
+
+    ///Number of input rows held back waiting for a seed below them.
+    [[nodiscard]] size_t rows_buffered() const;
+
+private:
+    static constexpr uint8_t seed_flag = 1;
+    static constexpr uint8_t inverted_seed_flag = 2;
+    static constexpr int64_t no_seed = -1;
+
+    ///Column state for one side of the field: seeds of the mask, or seeds of the inverted mask.
+    struct side
+    {
+        uint8_t flag = seed_flag;
+        ///nearest seed row strictly above the current output row, per column.
+        std::vector<int64_t> above;
+        ///nearest seed row at or below the current output row among the rows pushed so far, per column.
+        std::vector<int64_t> below;
+        size_t unknown_below = 0;
+
+        ///squared distances of the current output row, and scratch for the 1D transform.
+        std::vector<double> column_distance;
+        std::vector<double> row_distance;
+        std::vector<size_t> v;
+        std::vector<double> z;
+    };
+
+    ///Runs the row pass for the current output row of `s`, returning the largest squared distance in the row.
+    double transform_row(side& s);
+
+    ///Emits rows for as long as the current output row is final.
+    void emit_final_rows();
+
+    ///Moves the current output row down by one, updating the column state from the band.
+    void advance(side& s);
+
+    [[nodiscard]] const std::vector<uint8_t>& buffered_row(size_t y) const;
+
+    size_t width = 0;
+    size_t height = 0;
+    cpuio::row_writer sink;
+    bool is_signed = false;
+    float max_distance = 0;
+    bool normalise = false;
+
+    std::vector<side> sides;
+    std::deque<std::vector<uint8_t>> band;
+    std::vector<float> out_row;
+
+    size_t pushed = 0;
+    size_t emitted = 0;
+    ///the band is only re-examined once this many rows are pushed, or a new seed fills an unknown column.
+    size_t retry_at = 0;
+};
+
+#endif //IMG2SDF_CPUSTREAMINGDISTANCETRANSFORM_H
@@ -0,0 +1,413 @@
+#include "CPUThreadPool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <filesystem>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+    ///the pool and worker index of the current thread, so nested parallel_for calls queue on the worker's own deque.
+    thread_local const CPUThreadPool* current_pool = nullptr;
+    thread_local size_t current_worker = 0;
+
+    bool pin_thread(std::thread& thread, const std::vector<size_t>& cpus)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const size_t cpu : cpus)
+        {
+            if (cpu >= CPU_SETSIZE)
+            {
+                return false;
+            }
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (const size_t cpu : cpus)
+        {
+            if (cpu >= sizeof(DWORD_PTR) * 8)
+            {
+                return false;
+            }
+            mask |= DWORD_PTR {1} << cpu;
+        }
+        return SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+#else
+        return true;
+#endif
+    }
+
+#ifdef __linux__
+    ///parses a sysfs cpulist such as "0-3,8-11".
+    std::vector<size_t> parse_cpu_list(const std::string& list)
+    {
+        std::vector<size_t> cpus;
+        size_t position = 0;
+        while (position < list.size())
+        {
+            const size_t comma = std::min(list.find(',', position), list.size());
+            const std::string range = list.substr(position, comma - position);
+            const size_t dash = range.find('-');
+            if (!range.empty() && range.find_first_not_of("0123456789-") == std::string::npos)
+            {
+                const size_t first = std::stoul(range.substr(0, dash));
+                const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (size_t cpu = first; cpu <= last; cpu++)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            position = comma + 1;
+        }
+        return cpus;
+    }
+#endif
+}
+
+CPUThreadPool::CPUThreadPool(size_t num_threads, std::vector<size_t> cpu_affinity) :
+num_workers(std::max<size_t>(1, num_threads) - 1) {
+    std::vector<std::vector<size_t>> worker_cpus (num_workers);
+    for (size_t i = 0; i < num_workers && !cpu_affinity.empty(); i++)
+    {
+        worker_cpus[i] = {cpu_affinity[i % cpu_affinity.size()]};
+    }
+    start_workers(worker_cpus, std::vector<size_t>(num_workers, 0));
+}
+
+CPUThreadPool::CPUThreadPool(size_t num_threads, THREAD_PLACEMENT placement) :
+num_workers(placement == THREAD_PLACEMENT::NUMA ? std::max<size_t>(1, num_threads) : std::max<size_t>(1, num_threads) - 1),
+placement(placement) {
+    std::vector<std::vector<size_t>> worker_cpus (num_workers);
+    std::vector<size_t> worker_nodes (num_workers, 0);
+    if (placement == THREAD_PLACEMENT::NUMA)
+    {
+        //consecutive workers share a node, so consecutive bands, which usually touch neighbouring rows, do too.
+        const auto nodes = numa_nodes();
+        for (size_t i = 0; i < num_workers; i++)
+        {
+            worker_nodes[i] = i * nodes.size() / num_workers;
+            worker_cpus[i] = nodes[worker_nodes[i]];
+        }
+    }
+    start_workers(worker_cpus, worker_nodes);
+}
+
+void CPUThreadPool::start_workers(const std::vector<std::vector<size_t>>& worker_cpus,
+                                  const std::vector<size_t>& worker_nodes) {
+    //one queue per worker, plus one for threads outside the pool.
+    for (size_t i = 0; i <= num_workers; i++)
+    {
+        queues.push_back(std::make_unique<task_queue>());
+    }
+
+    steal_order.resize(num_workers);
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        for (size_t offset = 1; offset < num_workers; offset++)
+        {
+            steal_order[i].push_back((i + offset) % num_workers);
+        }
+        std::stable_partition(steal_order[i].begin(), steal_order[i].end(), [&](size_t victim) {
+            return worker_nodes[victim] == worker_nodes[i];
+        });
+    }
+
+    workers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        workers.emplace_back(&CPUThreadPool::worker_loop, this, i);
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (!worker_cpus[i].empty() && !pin_thread(workers[i], worker_cpus[i]))
+        {
+            {
+                std::lock_guard lock (sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            throw std::runtime_error("Could not pin a worker thread to CPU " + std::to_string(worker_cpus[i].front()) + ".");
+        }
+    }
+}
+
+CPUThreadPool::~CPUThreadPool() {
+    {
+        std::lock_guard lock (sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+const std::shared_ptr<CPUThreadPool>& CPUThreadPool::shared() {
+    static const auto pool = std::make_shared<CPUThreadPool>();
+    return pool;
+}
+
+size_t CPUThreadPool::get_num_threads() const {
+    return placement == THREAD_PLACEMENT::NUMA ? num_workers : num_workers + 1;
+}
+
+THREAD_PLACEMENT CPUThreadPool::get_placement() const {
+    return placement;
+}
+
+std::vector<std::vector<size_t>> CPUThreadPool::numa_nodes() {
+    std::vector<std::vector<size_t>> nodes;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool has_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::vector<std::pair<size_t, std::vector<size_t>>> numbered;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.find_first_not_of("0123456789", 4) != std::string::npos || name.size() == 4)
+        {
+            continue;
+        }
+
+        std::ifstream cpu_list (entry.path() / "cpulist");
+        std::string list;
+        std::getline(cpu_list, list);
+
+        std::vector<size_t> cpus;
+        for (const size_t cpu : parse_cpu_list(list))
+        {
+            if (!has_allowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty())
+        {
+            numbered.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+        }
+    }
+
+    std::sort(numbered.begin(), numbered.end());
+    for (auto& node : numbered)
+    {
+        nodes.push_back(std::move(node.second));
+    }
+#elif defined(_WIN32)
+    ULONG highest = 0;
+    if (GetNumaHighestNodeNumber(&highest))
+    {
+        for (ULONG node = 0; node <= highest; node++)
+        {
+            ULONGLONG mask = 0;
+            if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) || mask == 0)
+            {
+                continue;
+            }
+
+            std::vector<size_t> cpus;
+            for (size_t cpu = 0; cpu < 64; cpu++)
+            {
+                if (mask & (ULONGLONG {1} << cpu))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            nodes.push_back(std::move(cpus));
+        }
+    }
+#endif
+
+    if (nodes.empty())
+    {
+        //no topology: one node, with the workers left unpinned.
+        nodes.emplace_back();
+    }
+    return nodes;
+}
+
+void CPUThreadPool::parallel_for(size_t count, size_t max_bands, const std::function<void(size_t, size_t)>& kernel) {
+    if (count == 0)
+    {
+        return;
+    }
+
+    const size_t num_bands = std::clamp<size_t>(max_bands, 1, count);
+    const size_t band_size = (count + num_bands - 1) / num_bands;
+    const size_t num_tasks = (count + band_size - 1) / band_size;
+
+    //kernels may index per-band results by band, so even a pool without workers runs each band separately.
+    if (num_tasks == 1 || num_workers == 0)
+    {
+        for (size_t begin = 0; begin < count; begin += band_size)
+        {
+            kernel(begin, std::min(count, begin + band_size));
+        }
+        return;
+    }
+
+    job j {};
+    j.kernel = &kernel;
+    j.remaining = num_tasks;
+
+    const bool is_worker = current_pool == this;
+    auto& home = *queues[is_worker ? current_worker : num_workers];
+
+    if (placement == THREAD_PLACEMENT::NUMA && !is_worker)
+    {
+        //band b always goes to the same worker, and so the same node, as it did in every earlier pass.
+        {
+            std::lock_guard lock (sleep_mutex);
+            queued += num_tasks;
+        }
+        for (size_t band = 0; band < num_tasks; band++)
+        {
+            auto& queue = *queues[band * num_workers / num_tasks];
+            std::lock_guard lock (queue.mutex);
+            queue.tasks.push_back({&j, band * band_size, std::min(count, (band + 1) * band_size)});
+        }
+        wake.notify_all();
+    }
+    else
+    {
+        {
+            std::lock_guard lock (sleep_mutex);
+            queued += num_tasks - 1;
+        }
+        {
+            std::lock_guard lock (home.mutex);
+            for (size_t begin = band_size; begin < count; begin += band_size)
+            {
+                home.tasks.push_back({&j, begin, std::min(count, begin + band_size)});
+            }
+        }
+        wake.notify_all();
+
+        //the calling thread takes the first band rather than idling, then any band no worker has taken yet. It only
+        //helps with its own bands, so a wait never runs unrelated work that could hold the caller up.
+        run({&j, 0, band_size});
+        task next {};
+        while (pop_newest(home, &j, next))
+        {
+            run(next);
+        }
+    }
+
+    std::unique_lock lock (j.mutex);
+    j.done.wait(lock, [&j] { return j.remaining == 0; });
+    if (j.error)
+    {
+        std::rethrow_exception(j.error);
+    }
+}
+
+void CPUThreadPool::worker_loop(size_t worker) {
+    current_pool = this;
+    current_worker = worker;
+
+    while (true)
+    {
+        task next {};
+        if (find_task(worker, next))
+        {
+            run(next);
+            continue;
+        }
+
+        std::unique_lock lock (sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+bool CPUThreadPool::pop_newest(task_queue& queue, job* owner, task& out) {
+    std::lock_guard lock (queue.mutex);
+    const auto found = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), [owner](const task& t) {
+        return owner == nullptr || t.owner == owner;
+    });
+    if (found == queue.tasks.rend())
+    {
+        return false;
+    }
+
+    out = *found;
+    queue.tasks.erase(std::next(found).base());
+    queued--;
+    return true;
+}
+
+bool CPUThreadPool::pop_oldest(task_queue& queue, task& out) {
+    std::lock_guard lock (queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+
+    out = queue.tasks.front();
+    queue.tasks.pop_front();
+    queued--;
+    return true;
+}
+
+bool CPUThreadPool::find_task(size_t worker, task& out) {
+    if (pop_newest(*queues[worker], nullptr, out))
+    {
+        return true;
+    }
+
+    for (const size_t victim : steal_order[worker])
+    {
+        if (pop_oldest(*queues[victim], out))
+        {
+            return true;
+        }
+    }
+
+    return pop_oldest(*queues[num_workers], out);
+}
+
+void CPUThreadPool::run(const task& t) {
+    std::exception_ptr error = nullptr;
+    try
+    {
+        (*t.owner->kernel)(t.begin, t.end);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    //notified under the lock, so the caller cannot return and destroy the job before this is done with it.
+    std::lock_guard lock (t.owner->mutex);
+    if (error && !t.owner->error)
+    {
+        t.owner->error = error;
+    }
+    if (--t.owner->remaining == 0)
+    {
+        t.owner->done.notify_all();
+    }
+}
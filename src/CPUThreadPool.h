@@ -0,0 +1,124 @@
+#ifndef IMG2SDF_CPUTHREADPOOL_H
+#define IMG2SDF_CPUTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cpuutils.h"
+
+///Where CPUThreadPool places its workers.
+enum class THREAD_PLACEMENT
+{
+    ///Wherever the OS schedules them, or on the CPUs they are pinned to.
+    ANY,
+    ///Spread evenly over the NUMA nodes, each pinned to the CPUs of its node. Band b of a parallel_for is queued on
+    ///the same worker every time, so memory a band first touches stays on the node of the worker that goes on to
+    ///process it, and idle workers steal from their own node before reaching across.
+    NUMA,
+};
+
+///Persistent work-stealing pool the CPU passes run on, so a pipeline of num_steps() + 4 passes starts its threads once
+///rather than once per pass. Each worker keeps its own deque of bands: it takes the newest band of its own, and an idle
+///worker steals the oldest band of another.
+///
+///parallel_for may be called from inside a band. The nested bands go on the calling worker's own deque, where it runs
+///them itself unless an idle worker steals them first, so a batch of images each split into bands never runs more
+///threads than the pool holds.
+class CPUThreadPool
+{
+public:
+    ///@param num_threads threads running bands, including the thread calling parallel_for: the pool starts
+    ///num_threads - 1 workers.
+    ///@param cpu_affinity if not empty, worker i is pinned to logical CPU cpu_affinity[i % size]. Ignored where the
+    ///platform has no affinity API. The calling thread is left as it is.
+    explicit CPUThreadPool(size_t num_threads = cpuutils::default_thread_count(), std::vector<size_t> cpu_affinity = {});
+
+    ///@param num_threads threads running bands. With THREAD_PLACEMENT::NUMA the pool starts num_threads workers and
+    ///the calling thread, which may be on any node, only waits for them.
+    CPUThreadPool(size_t num_threads, THREAD_PLACEMENT placement);
+    ~CPUThreadPool();
+
+    CPUThreadPool(const CPUThreadPool&) = delete;
+    CPUThreadPool& operator=(const CPUThreadPool&) = delete;
+
+    ///Process-wide pool of cpuutils::default_thread_count() threads, started on first use.
+    static const std::shared_ptr<CPUThreadPool>& shared();
+
+    [[nodiscard]] size_t get_num_threads() const;
+
+    [[nodiscard]] THREAD_PLACEMENT get_placement() const;
+
+    ///The logical CPUs of each NUMA node that this process may run on. A single node holding every CPU where the
+    ///platform reports no topology.
+    static std::vector<std::vector<size_t>> numa_nodes();
+
+    ///Splits the rows [0, count) into at most `max_bands` contiguous bands and runs `kernel(begin, end)` for each band
+    ///on the pool. The calling thread runs the first band and helps with the rest (unless it is outside a NUMA placed
+    ///pool), and returns once every band has completed, so each call acts as a barrier between pipeline passes, much
+    ///like successive Dispatch calls on the same UAV. The first exception thrown by a band is rethrown once every band
+    ///has finished.
+    void parallel_for(size_t count, size_t max_bands, const std::function<void(size_t, size_t)>& kernel);
+
+private:
+    struct job
+    {
+        const std::function<void(size_t, size_t)>* kernel = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining = 0;
+        std::exception_ptr error = nullptr;
+    };
+
+    struct task
+    {
+        job* owner = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    ///Starts one worker per entry of `worker_cpus`, pinned to those CPUs unless the entry is empty.
+    void start_workers(const std::vector<std::vector<size_t>>& worker_cpus, const std::vector<size_t>& worker_nodes);
+
+    void worker_loop(size_t worker);
+
+    ///Takes the newest task of `queue`, or only the newest task of `owner` if it is not null.
+    bool pop_newest(task_queue& queue, job* owner, task& out);
+
+    ///Takes the oldest task of `queue`.
+    bool pop_oldest(task_queue& queue, task& out);
+
+    ///Any task for an idle worker: its own newest, then another worker's oldest, nearest first, then the oldest
+    ///submitted from outside the pool.
+    bool find_task(size_t worker, task& out);
+
+    void run(const task& t);
+
+    ///set before any worker starts, as workers read them while `workers` is still being filled.
+    size_t num_workers = 0;
+    THREAD_PLACEMENT placement = THREAD_PLACEMENT::ANY;
+    ///steal_order[i] lists the other workers, those on worker i's node first.
+    std::vector<std::vector<size_t>> steal_order;
+
+    ///queues[i] belongs to worker i; the last one takes tasks submitted from threads outside the pool.
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued = 0;
+    bool stopping = false;
+};
+
+#endif //IMG2SDF_CPUTHREADPOOL_H
@@ -0,0 +1,171 @@
+#ifndef IMG2SDF_COMPUTEPIPELINE_H
+#define IMG2SDF_COMPUTEPIPELINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+struct jump_flood_shaders
+{
+    ///pointer to the preprocess shader bytecode
+    const uint8_t* preprocess;
+    size_t preprocess_size;
+
+    ///pointer to a preprocess shader that also inverts the input mask.
+    const uint8_t* preprocess_invert;
+    size_t preprocess_invert_size;
+
+    ///pointer to the voronoi diagram shader bytecode (jumpflood.hlsl)
+    const uint8_t* voronoi;
+    size_t voronoi_size;
+
+    ///pointer to the voronoi_normalisation shader bytecode, for debugging generated voronoi diagrams.
+    const uint8_t* voronoi_normalise;
+    size_t voronoi_normalise_size;
+
+    ///pointer to the distance transform shader bytecode
+    const uint8_t* distance_transform;
+    size_t distance_transform_size;
+
+    const uint8_t* min_max_reduce_firstpass;
+    size_t min_max_reduce_firstpass_size;
+
+    ///pointer to the min_max reduction shader bytecode
+    const uint8_t* min_max_reduce;
+    size_t min_max_reduce_size;
+
+    ///pointer to the distance normalisation shader bytecode.
+    const uint8_t* distance_normalise;
+    size_t distance_normalise_size;
+
+    const uint8_t* composite;
+    size_t composite_size;
+
+    ///pointer to the boundary seeding shader bytecode, for single flood signed fields.
+    const uint8_t* boundary;
+    size_t boundary_size;
+
+    ///pointer to the signed distance transform shader bytecode, for single flood signed fields.
+    const uint8_t* signed_distance;
+    size_t signed_distance_size;
+
+    ///pointer to the distance normalisation shader bytecode that reads the range from the reduction UAV.
+    const uint8_t* normalise_reduced;
+    size_t normalise_reduced_size;
+
+    ///pointer to the shader that normalises and stores the distance field in a narrower output format.
+    const uint8_t* quantise;
+    size_t quantise_size;
+
+};
+
+enum class SHADERS
+{
+    PREPROCESS,
+    PREPROCESS_INVERT,
+    VORONOI,
+    VORONOI_NORMALISE,
+    DISTANCE,
+    MINMAXREDUCE_FIRST,
+    MINMAXREDUCE,
+    DISTANCE_NORMALISE,
+    COMPOSITE,
+    BOUNDARY,
+    SIGNED_DISTANCE,
+    NORMALISE_REDUCED,
+    QUANTISE
+};
+
+constexpr size_t num_shaders = static_cast<size_t>(SHADERS::QUANTISE) + 1;
+
+///Name of `shader` for error messages, e.g. "signed distance transform".
+[[nodiscard]] constexpr const char* shader_name(SHADERS shader)
+{
+    switch (shader)
+    {
+        case SHADERS::PREPROCESS: return "preprocess";
+        case SHADERS::PREPROCESS_INVERT: return "preprocess inversion";
+        case SHADERS::VORONOI: return "voronoi";
+        case SHADERS::VORONOI_NORMALISE: return "voronoi normalisation";
+        case SHADERS::DISTANCE: return "distance transform";
+        case SHADERS::MINMAXREDUCE_FIRST: return "min max reduction first pass";
+        case SHADERS::MINMAXREDUCE: return "min max reduction";
+        case SHADERS::DISTANCE_NORMALISE: return "distance normalisation";
+        case SHADERS::COMPOSITE: return "composite";
+        case SHADERS::BOUNDARY: return "boundary";
+        case SHADERS::SIGNED_DISTANCE: return "signed distance transform";
+        case SHADERS::NORMALISE_REDUCED: return "reduced normalisation";
+        case SHADERS::QUANTISE: return "quantise";
+        default: return "unknown";
+    }
+}
+
+///The bytecode of each shader of `byte_code`, indexed by SHADERS.
+[[nodiscard]] constexpr std::array<std::pair<const uint8_t*, size_t>, num_shaders> shader_byte_code(const jump_flood_shaders& byte_code)
+{
+    return {{
+        {byte_code.preprocess, byte_code.preprocess_size},
+        {byte_code.preprocess_invert, byte_code.preprocess_invert_size},
+        {byte_code.voronoi, byte_code.voronoi_size},
+        {byte_code.voronoi_normalise, byte_code.voronoi_normalise_size},
+        {byte_code.distance_transform, byte_code.distance_transform_size},
+        {byte_code.min_max_reduce_firstpass, byte_code.min_max_reduce_firstpass_size},
+        {byte_code.min_max_reduce, byte_code.min_max_reduce_size},
+        {byte_code.distance_normalise, byte_code.distance_normalise_size},
+        {byte_code.composite, byte_code.composite_size},
+        {byte_code.boundary, byte_code.boundary_size},
+        {byte_code.signed_distance, byte_code.signed_distance_size},
+        {byte_code.normalise_reduced, byte_code.normalise_reduced_size},
+        {byte_code.quantise, byte_code.quantise_size},
+    }};
+}
+
+///The compute shaders of the jump flood pipeline, created once per device and shared by every dispatch on it, so a
+///call only records commands rather than creating shaders. JumpFloodDispatch is the per-call command object over one.
+///
+///`device_type` creates the shaders, and may throw if it cannot:
+///    using kernel_type = ...;  //default constructible, e.g. ComPtr<ID3D11ComputeShader>.
+///    kernel_type create_kernel(SHADERS shader, const uint8_t* byte_code, size_t size);
+///
+///A pipeline is immutable once built, so it may be shared between threads.
+template <typename device_type>
+class ComputePipeline
+{
+public:
+    using kernel_type = typename device_type::kernel_type;
+
+    ///Creates a shader for each field of `byte_code` that is not null; the others are left empty.
+    ComputePipeline(device_type device, const jump_flood_shaders& byte_code) : device(std::move(device))
+    {
+        const auto shaders = shader_byte_code(byte_code);
+        for (size_t shader = 0; shader < num_shaders; shader++)
+        {
+            if (shaders[shader].first != nullptr)
+            {
+                kernels[shader] = this->device.create_kernel(static_cast<SHADERS>(shader), shaders[shader].first,
+                                                             shaders[shader].second);
+            }
+        }
+    }
+
+    ///The shader created for `shader`, or an empty kernel if its bytecode was null.
+    [[nodiscard]] const kernel_type& get_shader(SHADERS shader) const
+    {
+        const auto index = static_cast<size_t>(shader);
+        if (index >= num_shaders)
+        {
+            throw std::runtime_error("Unknown shader.");
+        }
+        return kernels[index];
+    }
+
+    [[nodiscard]] const device_type& get_device() const { return device; }
+
+private:
+    device_type device;
+    std::array<kernel_type, num_shaders> kernels {};
+};
+
+#endif //IMG2SDF_COMPUTEPIPELINE_H
@@ -0,0 +1,56 @@
+#include "D3D11ResourcePool.h"
+#include <stdexcept>
+#include "jumpflooderror.h"
+
+D3D11TextureBackend::resource_type D3D11TextureBackend::create(size_t width, size_t height, format_type format) const {
+    if (device == nullptr)
+    {
+        throw std::runtime_error("ID3D11Device is NULL");
+    }
+
+    D3D11_TEXTURE2D_DESC desc = {0};
+    desc.Width = static_cast<UINT>(width);
+    desc.Height = static_cast<UINT>(height);
+    desc.Format = format.format;
+    desc.Usage = format.usage;
+    desc.BindFlags = format.bind_flags;
+    desc.CPUAccessFlags = format.cpu_access_flags;
+    desc.MiscFlags = 0;
+    desc.ArraySize = 1;
+    desc.MipLevels = 1;
+    desc.SampleDesc = {1, 0};
+
+    resource_type resource {};
+    HRESULT out_tex = device->CreateTexture2D(&desc, nullptr, resource.texture.GetAddressOf());
+    if (FAILED(out_tex))
+    {
+        throw jumpflood_error(out_tex, "Failed to create pooled texture.");
+    }
+
+    if ((format.bind_flags & D3D11_BIND_UNORDERED_ACCESS) != 0)
+    {
+        HRESULT out_uav = device->CreateUnorderedAccessView(resource.texture.Get(), nullptr, resource.uav.GetAddressOf());
+        if (FAILED(out_uav))
+        {
+            throw jumpflood_error(out_uav, "Failed to create UAV for pooled texture.");
+        }
+    }
+
+    return resource;
+}
+
+size_t D3D11TextureBackend::size_in_bytes(size_t width, size_t height, format_type format) const {
+    size_t texel_bytes;
+    switch (format.format)
+    {
+        case DXGI_FORMAT_R8_UNORM: texel_bytes = 1; break;
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R16_UNORM: texel_bytes = 2; break;
+        case DXGI_FORMAT_R32_FLOAT: texel_bytes = 4; break;
+        case DXGI_FORMAT_R32G32_FLOAT: texel_bytes = 8; break;
+        //the widest format the pipeline uses, so other formats are never undercounted.
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        default: texel_bytes = 16; break;
+    }
+    return width * height * texel_bytes;
+}
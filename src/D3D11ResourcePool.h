@@ -0,0 +1,47 @@
+#ifndef IMG2SDF_D3D11RESOURCEPOOL_H
+#define IMG2SDF_D3D11RESOURCEPOOL_H
+
+#include <compare>
+#include <cstddef>
+#include <d3d11.h>
+#include <wrl.h>
+#include "ResourcePool.h"
+
+///Everything but the size that decides whether a pooled texture can stand in for a new one: a DXGI format alone does
+///not tell a UAV from a staging texture.
+struct d3d11_texture_format
+{
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    D3D11_USAGE usage = D3D11_USAGE_DEFAULT;
+    UINT bind_flags = 0;
+    UINT cpu_access_flags = 0;
+
+    auto operator<=>(const d3d11_texture_format&) const = default;
+};
+
+///A texture, and its UAV if it is bound as one.
+struct d3d11_pooled_texture
+{
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav;
+};
+
+///ResourcePool backend creating Texture2Ds on a device. Textures are created without initial data; JumpFloodResources
+///clears them in place with ClearUnorderedAccessViewFloat, new or recycled.
+struct D3D11TextureBackend
+{
+    using format_type = d3d11_texture_format;
+    using resource_type = d3d11_pooled_texture;
+
+    ///non-owning.
+    ID3D11Device* device = nullptr;
+
+    ///may throw a jumpflood_error if texture or UAV creation fails.
+    [[nodiscard]] resource_type create(size_t width, size_t height, format_type format) const;
+
+    [[nodiscard]] size_t size_in_bytes(size_t width, size_t height, format_type format) const;
+};
+
+using D3D11ResourcePool = ResourcePool<D3D11TextureBackend>;
+
+#endif //IMG2SDF_D3D11RESOURCEPOOL_H
@@ -7,6 +7,10 @@
 #include "dxinit.h"
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
 
 
 //shaders
@@ -19,6 +23,10 @@
 #include "shaders/normalise.hcs"
 #include "shaders/invert.hcs"
 #include "shaders/composite.hcs"
+#include "shaders/boundary.hcs"
+#include "shaders/signed_distance.hcs"
+#include "shaders/normalise_reduced.hcs"
+#include "shaders/quantise.hcs"
 
 const jump_flood_shaders JumpFloodDispatch::JUMPFLOOD_SHADERS = {
 .preprocess = g_preprocess,
@@ -48,196 +56,178 @@ const jump_flood_shaders JumpFloodDispatch::JUMPFLOOD_SHADERS = {
 .composite = g_composite,
 .composite_size = sizeof(g_composite),
 
-};
+.boundary = g_boundary,
+.boundary_size = sizeof(g_boundary),
 
-JumpFloodDispatch::JumpFloodDispatch(ID3D11Device *device, ID3D11DeviceContext *context,
-                                     JumpFloodResources* resources, jump_flood_shaders byte_code) :
-device(device), context(context), resources(resources) {
+.signed_distance = g_signed_distance,
+.signed_distance_size = sizeof(g_signed_distance),
 
-    if (device == nullptr || context == nullptr)
-    {
-        throw std::runtime_error("Device or Context cannot be null.");
-    }
+.normalise_reduced = g_normalise_reduced,
+.normalise_reduced_size = sizeof(g_normalise_reduced),
 
-    if (resources == nullptr)
-    {
-        throw std::runtime_error("Resources cannot be null.");
-    }
-    HRESULT hr = ERROR_SUCCESS;
-    if (byte_code.preprocess != nullptr) {
-        hr = device->CreateComputeShader(byte_code.preprocess, byte_code.preprocess_size, nullptr,
-                                         preprocess_shader.GetAddressOf());
+.quantise = g_quantise,
+.quantise_size = sizeof(g_quantise),
 
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create preprocess shader. ");
-        }
-    }
+};
 
-    if (byte_code.preprocess_invert != nullptr) {
-        hr = device->CreateComputeShader(byte_code.preprocess_invert, byte_code.preprocess_invert_size, nullptr,
-                                         preprocess_invert_shader.GetAddressOf());
+namespace {
+    //matches the DISTANCE_* bits of utils.hlsi.
+    constexpr int32_t distance_normalise = 1;
 
-        if (FAILED(hr))
+    ///Sets up a distance shader to normalise from `normalise_range` as it writes, or to gather the minmax if it is null.
+    void set_distance_normalise(JFA_cbuffer& cbuffer, const float2* normalise_range, bool is_signed_field)
+    {
+        cbuffer.DistanceFlags = normalise_range ? distance_normalise : 0;
+        if (normalise_range)
         {
-            throw jumpflood_error(hr, "Could not create Preprocess inversion shader.");
+            cbuffer.Minimum = normalise_range->x;
+            cbuffer.Maximum = normalise_range->y;
+            cbuffer.Signed = is_signed_field ? -1 : 0;
         }
     }
+}
 
-    if (byte_code.voronoi != nullptr) {
-
+uint32_t JumpFloodDispatch::num_groups(size_t texels) {
+    return static_cast<uint32_t>((texels + threads_per_group_width - 1) / threads_per_group_width);
+}
 
-        hr = device->CreateComputeShader(byte_code.voronoi, byte_code.voronoi_size, nullptr,
-                                         voronoi_shader.GetAddressOf());
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create voronoi shader. ");
-        }
+D3D11ComputeDevice::kernel_type D3D11ComputeDevice::create_kernel(SHADERS shader, const uint8_t* byte_code,
+                                                                 size_t size) const {
+    kernel_type kernel = nullptr;
+    HRESULT hr = device->CreateComputeShader(byte_code, size, nullptr, kernel.GetAddressOf());
+    if (FAILED(hr))
+    {
+        throw jumpflood_error(hr, std::string {"Could not create "} + shader_name(shader) + " shader.");
     }
+    return kernel;
+}
 
-    if (byte_code.voronoi_normalise != nullptr) {
-        hr = device->CreateComputeShader(byte_code.voronoi_normalise, byte_code.voronoi_normalise_size, nullptr,
-                                         voronoi_normalise_shader.GetAddressOf());
-
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create voronoi normalisation shader. ");
-        }
+std::shared_ptr<const JumpFloodPipeline> JumpFloodDispatch::create_pipeline(ID3D11Device* device,
+                                                                            const jump_flood_shaders& byte_code) {
+    if (device == nullptr)
+    {
+        throw std::runtime_error("Device cannot be null.");
     }
+    return std::make_shared<const JumpFloodPipeline>(D3D11ComputeDevice {device}, byte_code);
+}
 
-    if (byte_code.distance_transform != nullptr) {
-        hr = device->CreateComputeShader(byte_code.distance_transform, byte_code.distance_transform_size, nullptr,
-                                         distance_transform_shader.GetAddressOf());
+JumpFloodDispatch::JumpFloodDispatch(ID3D11DeviceContext* context, JumpFloodResources* resources,
+                                     std::shared_ptr<const JumpFloodPipeline> pipeline) :
+context(context), resources(resources), pipeline(std::move(pipeline)) {
 
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create distance transform shader. ");
-        }
-    }
-    if (byte_code.min_max_reduce_firstpass != nullptr)
+    if (this->pipeline == nullptr || context == nullptr)
     {
-        hr = device->CreateComputeShader(byte_code.min_max_reduce_firstpass, byte_code.min_max_reduce_firstpass_size, nullptr,
-                                         min_max_reduce_firstpass_shader.GetAddressOf());
-        if (FAILED(hr))
-        {
-            throw jumpflood_error(hr, "Could not create min max reduction first pass shader. ");
-        }
+        throw std::runtime_error("Pipeline or Context cannot be null.");
     }
 
-    if (byte_code.min_max_reduce != nullptr) {
-
-
-        hr = device->CreateComputeShader(byte_code.min_max_reduce, byte_code.min_max_reduce_size, nullptr,
-                                         min_max_reduce_shader.GetAddressOf());
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create min max reduction shader. ");
-        }
+    if (resources == nullptr)
+    {
+        throw std::runtime_error("Resources cannot be null.");
     }
+    this->device = this->pipeline->get_device().device;
+}
 
-    if (byte_code.distance_normalise != nullptr) {
-        hr = device->CreateComputeShader(byte_code.distance_normalise, byte_code.distance_normalise_size, nullptr,
-                                         distance_normalise_shader.GetAddressOf());
+JumpFloodDispatch::JumpFloodDispatch(ID3D11Device *device, ID3D11DeviceContext *context,
+                                     JumpFloodResources* resources, jump_flood_shaders byte_code) :
+device(device), context(context), resources(resources) {
 
-        if (FAILED(hr)) {
-            throw jumpflood_error(hr, "Could not create distance transform shader.");
-        }
+    if (device == nullptr || context == nullptr)
+    {
+        throw std::runtime_error("Device or Context cannot be null.");
     }
 
-    if (byte_code.composite != nullptr)
+    if (resources == nullptr)
     {
-        hr = device->CreateComputeShader(byte_code.composite, byte_code.composite_size, nullptr,
-                                         composite_shader.GetAddressOf());
-        if (FAILED(hr))
-        {
-            throw jumpflood_error(hr, "Coud not create composite shader.");
-        }
+        throw std::runtime_error("Resources cannot be null.");
     }
 
+    this->pipeline = create_pipeline(device, byte_code);
 }
 
 
 
 ID3D11ComputeShader *JumpFloodDispatch::get_shader(SHADERS shader) const {
-    switch (shader)
-    {
-        case SHADERS::PREPROCESS: {return this->preprocess_shader.Get();}
-        case SHADERS::PREPROCESS_INVERT: {return this->preprocess_invert_shader.Get();}
-        case SHADERS::VORONOI: {return this->voronoi_shader.Get();}
-        case SHADERS::VORONOI_NORMALISE: {return this->voronoi_normalise_shader.Get();}
-        case SHADERS::DISTANCE: {return this->distance_transform_shader.Get();}
-        case SHADERS::DISTANCE_NORMALISE: {return this->distance_normalise_shader.Get();}
-        case SHADERS::MINMAXREDUCE: {return this->min_max_reduce_shader.Get();}
-        case SHADERS::MINMAXREDUCE_FIRST: { return this->min_max_reduce_firstpass_shader.Get(); }
-        default: return nullptr;
-    }
+    return this->pipeline->get_shader(shader).Get();
 }
 
 void
 JumpFloodDispatch::dispatch_preprocess_shader(bool invert) {
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
     auto srv = resources->get_input_srv();
     auto cbuffer = resources->create_const_buffer(false);
     auto uav = resources->create_voronoi_uav(false);
 
-    auto& shader = invert ? preprocess_invert_shader : preprocess_shader;
+    auto shader = get_shader(invert ? SHADERS::PREPROCESS_INVERT : SHADERS::PREPROCESS);
 
 
     assert(shader);
-    dxinit::run_compute_shader(context, shader.Get(), 1, &srv,
+    dxinit::run_compute_shader(context, shader, 1, &srv,
                        cbuffer, nullptr, 0, &uav, 1, num_groups_x, num_groups_y, 1);
 }
 
-void JumpFloodDispatch::dispatch_voronoi_shader() {
+void JumpFloodDispatch::dispatch_voronoi_shader(float max_distance) {
 
     const int32_t num_steps = resources->num_steps();
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
 
     auto cbuffer = resources->create_const_buffer(false);
     auto voronoi_uav = resources->create_voronoi_uav(false);
 
-    for (int32_t i = num_steps; i > 0; i--)
+    //jumpflood.hlsl offsets by 2^(num_steps - iteration - 1), so iteration i floods at offset 2^(num_steps - i - 1).
+    //start from the smallest power of two covering the spread, or from half the larger dimension without one, and
+    //halve down to an offset of 1, as CPUJumpFloodDispatch::dispatch_voronoi does.
+    const int32_t start_step = max_distance > 0
+            ? std::min(std::max(static_cast<int32_t>(ceil(log2(max_distance))), 0), num_steps - 1)
+            : num_steps - 1;
+    for (int32_t i = num_steps - start_step - 1; i < num_steps; i++)
     {
         auto local_buf = resources->get_local_cbuffer();
         local_buf.Iteration = i;
         resources->update_const_buffer(context, local_buf);
 
-        assert(this->voronoi_shader);
-        dxinit::run_compute_shader(context, voronoi_shader.Get(), 0,nullptr,
+        assert(get_shader(SHADERS::VORONOI));
+        dxinit::run_compute_shader(context, get_shader(SHADERS::VORONOI), 0,nullptr,
                                    cbuffer, nullptr, 0, &voronoi_uav, 1, num_groups_x, num_groups_y,1);
-
     }
-
-
 }
 
 void JumpFloodDispatch::dispatch_voronoi_normalise_shader() {
     const size_t num_steps = resources->num_steps();
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
     auto cbuffer = resources->create_const_buffer(false);
     auto voronoi_uav = resources->create_voronoi_uav(false);
 
-    assert(this->voronoi_normalise_shader);
-    dxinit::run_compute_shader(context, voronoi_normalise_shader.Get(), 0, nullptr,
+    assert(get_shader(SHADERS::VORONOI_NORMALISE));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::VORONOI_NORMALISE), 0, nullptr,
                                cbuffer, nullptr, 0, &voronoi_uav, 1, num_groups_x, num_groups_y, 1);
 
 }
 
-void JumpFloodDispatch::dispatch_distance_transform_shader() {
+void JumpFloodDispatch::dispatch_distance_transform_shader(float max_distance, const float2* normalise_range) {
 
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
-    auto cbuffer = resources->create_const_buffer(false);
+    resources->create_const_buffer(false);
+    auto local_buf = resources->get_local_cbuffer();
+    local_buf.MaxDistance = max_distance;
+    set_distance_normalise(local_buf, normalise_range, false);
+    auto cbuffer = resources->update_const_buffer(context, local_buf);
     auto voronoi_uav = resources->create_voronoi_uav(false);
     auto distance_uav = resources->create_distance_uav(false);
+    auto reduce_uav = resources->create_reduction_uav(num_groups_x, num_groups_y);
 
-    ID3D11UnorderedAccessView* UAVs[] = {voronoi_uav, distance_uav};
+    ID3D11UnorderedAccessView* UAVs[] = {voronoi_uav, distance_uav, reduce_uav};
 
-    assert(this->distance_transform_shader);
-    dxinit::run_compute_shader(context, distance_transform_shader.Get(), 0, nullptr,
-                               cbuffer, nullptr, 0, UAVs, 2, num_groups_x, num_groups_y, 1);
+    assert(get_shader(SHADERS::DISTANCE));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::DISTANCE), 0, nullptr,
+                               cbuffer, nullptr, 0, UAVs, 3, num_groups_x, num_groups_y, 1);
 
 }
 
@@ -260,12 +250,12 @@ bool JumpFloodDispatch::dispatch_minmax_reduce_shader(ID3D11ShaderResourceView*
         D3D11_TEXTURE2D_DESC desc;
         srv_texture->GetDesc(&desc);
 
-        num_groups_x = desc.Width / threads_per_group_width;
-        num_groups_y = desc.Height / threads_per_group_width;
+        num_groups_x = num_groups(desc.Width);
+        num_groups_y = num_groups(desc.Height);
     }
     else {
-        num_groups_x = resources->get_resolution().width / threads_per_group_width;
-        num_groups_y = resources->get_resolution().height / threads_per_group_width;
+        num_groups_x = num_groups(resources->get_resolution().width);
+        num_groups_y = num_groups(resources->get_resolution().height);
     }
 
     auto srv = explicit_srv == nullptr ? resources->create_reduction_view() : explicit_srv;
@@ -273,10 +263,10 @@ bool JumpFloodDispatch::dispatch_minmax_reduce_shader(ID3D11ShaderResourceView*
 
 
     //dispatch silently fails if shader is nullptr.
-    assert(this->min_max_reduce_shader);
-    assert(this->min_max_reduce_firstpass_shader);
+    assert(get_shader(SHADERS::MINMAXREDUCE));
+    assert(get_shader(SHADERS::MINMAXREDUCE_FIRST));
     //run the first pass, 'seeding' the reduction with the minmax from the input SRV.
-    dxinit::run_compute_shader(context, this->min_max_reduce_firstpass_shader.Get(), 1, &srv, nullptr, nullptr,
+    dxinit::run_compute_shader(context, get_shader(SHADERS::MINMAXREDUCE_FIRST), 1, &srv, nullptr, nullptr,
                                0, &uav, 1, num_groups_x, num_groups_y, 1);
 
 
@@ -285,27 +275,96 @@ bool JumpFloodDispatch::dispatch_minmax_reduce_shader(ID3D11ShaderResourceView*
     {
         return false;
     }
-    //recursively reduce, dropping the number of groups by half each time. Eventually UAV[0,0] will
-    //store the final min-max.
+    //recursively reduce, dividing the number of groups by the group width each time (rounding up, so edge groups
+    //are kept). Eventually UAV[0,0] will store the final min-max. Stale texels past the shrinking region still hold
+    //the min-max of real texels, so re-reading them is harmless; reads past the UAV itself are masked in the shader.
 
-    while (num_groups_x > 1u && num_groups_y > 1u)
+    while (num_groups_x > 1u || num_groups_y > 1u)
     {
 
-        num_groups_x = std::max(1ull, num_groups_x / threads_per_group_width);
-        num_groups_y = std::max(1ull, num_groups_y / threads_per_group_width);
+        num_groups_x = num_groups(num_groups_x);
+        num_groups_y = num_groups(num_groups_y);
 
 
-        dxinit::run_compute_shader(context, this->min_max_reduce_shader.Get(), 0, nullptr, nullptr ,
+        dxinit::run_compute_shader(context, get_shader(SHADERS::MINMAXREDUCE), 0, nullptr, nullptr ,
                                nullptr, 0, &uav, 1, num_groups_x, num_groups_y, 1);
     }
 
     return true;
 }
 
+void JumpFloodDispatch::dispatch_minmax_combine_shader() {
+    uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    uint32_t num_groups_y = num_groups(resources->get_resolution().height);
+
+    auto uav = resources->create_reduction_uav(num_groups_x, num_groups_y, false);
+
+    assert(get_shader(SHADERS::MINMAXREDUCE));
+    //same recursion as dispatch_minmax_reduce_shader, starting from the per-group minmax of the distance pass.
+    while (num_groups_x > 1u || num_groups_y > 1u)
+    {
+        num_groups_x = num_groups(num_groups_x);
+        num_groups_y = num_groups(num_groups_y);
+
+        dxinit::run_compute_shader(context, get_shader(SHADERS::MINMAXREDUCE), 0, nullptr, nullptr,
+                                   nullptr, 0, &uav, 1, num_groups_x, num_groups_y, 1);
+    }
+}
+
+float2 JumpFloodDispatch::read_minmax_range() {
+    ID3D11Texture2D* reduce_texture = resources->get_texture(RESOURCE_TYPE::REDUCE_UAV);
+
+    D3D11_TEXTURE2D_DESC desc;
+    reduce_texture->GetDesc(&desc);
+    desc.Width = 1;
+    desc.Height = 1;
+    desc.BindFlags = 0;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+
+    ComPtr<ID3D11Texture2D> staging;
+    HRESULT hr = device->CreateTexture2D(&desc, nullptr, staging.GetAddressOf());
+    if (FAILED(hr))
+    {
+        throw jumpflood_error(hr, "Could not create staging texture for the minmax range.");
+    }
+
+    const D3D11_BOX texel = {0, 0, 0, 1, 1, 1};
+    context->CopySubresourceRegion(staging.Get(), 0, 0, 0, 0, reduce_texture, 0, &texel);
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr))
+    {
+        throw jumpflood_error(hr, "Could not map the minmax range for reading.");
+    }
+    const float2 range = *static_cast<const float2*>(mapped.pData);
+    context->Unmap(staging.Get(), 0);
+
+    return range;
+}
+
+void JumpFloodDispatch::dispatch_reduced_normalise_shader(bool is_signed_field) {
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
+
+    auto cbuffer = resources->get_local_cbuffer();
+    cbuffer.Signed = is_signed_field ? -1 : 0;
+    auto const_buffer_resource = resources->update_const_buffer(context, cbuffer);
+
+    ID3D11UnorderedAccessView* uavs[] = {resources->create_distance_uav(false),
+                                         resources->create_reduction_uav(num_groups_x, num_groups_y, false)};
+
+    assert(get_shader(SHADERS::NORMALISE_REDUCED));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::NORMALISE_REDUCED), 0, nullptr, const_buffer_resource,
+                               nullptr, 0, uavs, 2, num_groups_x, num_groups_y, 1);
+}
+
 void JumpFloodDispatch::dispatch_distance_normalise_shader(float minimum, float maximum, bool is_signed_field) {
 
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
 
     auto uav = resources->create_distance_uav(false);
@@ -318,27 +377,93 @@ void JumpFloodDispatch::dispatch_distance_normalise_shader(float minimum, float
     auto const_buffer_resource = resources->update_const_buffer(context, cbuffer);
 
 
-   assert(this->distance_normalise_shader);
-   dxinit::run_compute_shader(context, this->distance_normalise_shader.Get(), 0, nullptr, const_buffer_resource, nullptr, 0,
+   assert(get_shader(SHADERS::DISTANCE_NORMALISE));
+   dxinit::run_compute_shader(context, get_shader(SHADERS::DISTANCE_NORMALISE), 0, nullptr, const_buffer_resource, nullptr, 0,
                                &uav, 1, num_groups_x, num_groups_y, 1);
 
 }
 
+void JumpFloodDispatch::dispatch_quantise_shader(const output_encoding& encoding, bool normalise, bool is_signed_field,
+                                                 const float2* fixed_range) {
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
+
+    //matches the ENCODE_* bits of quantise.hlsl.
+    constexpr int32_t encode_normalise = 1;
+    constexpr int32_t encode_reduced_range = 2;
+
+    auto cbuffer = resources->get_local_cbuffer();
+    cbuffer.Signed = is_signed_field ? -1 : 0;
+    cbuffer.Scale = encoding.scale;
+    cbuffer.Bias = encoding.bias;
+    cbuffer.EncodeFlags = normalise ? encode_normalise : 0;
+    if (fixed_range)
+    {
+        cbuffer.Minimum = fixed_range->x;
+        cbuffer.Maximum = fixed_range->y;
+    }
+    else
+    {
+        cbuffer.EncodeFlags |= encode_reduced_range;
+    }
+    auto const_buffer_resource = resources->update_const_buffer(context, cbuffer);
+
+    ID3D11UnorderedAccessView* uavs[] = {resources->create_distance_uav(false),
+                                         resources->create_reduction_uav(num_groups_x, num_groups_y, false),
+                                         resources->create_encoded_uav(encoding.format, false)};
+
+    assert(get_shader(SHADERS::QUANTISE));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::QUANTISE), 0, nullptr, const_buffer_resource,
+                               nullptr, 0, uavs, 3, num_groups_x, num_groups_y, 1);
+}
+
 void JumpFloodDispatch::dispatch_composite_shader(ID3D11UnorderedAccessView *outer_uav) {
 
 
-    const uint32_t num_groups_x = resources->get_resolution().width / threads_per_group_width;
-    const uint32_t num_groups_y = resources->get_resolution().height / threads_per_group_width;
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
 
     auto inner_uav = resources->create_distance_uav(false);
 
     ID3D11UnorderedAccessView* uavs[2] = {outer_uav, inner_uav};
 
-    assert(this->composite_shader);
-    dxinit::run_compute_shader(context, this->composite_shader.Get(), 0, nullptr, nullptr, nullptr,
+    assert(get_shader(SHADERS::COMPOSITE));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::COMPOSITE), 0, nullptr, nullptr, nullptr,
                                0, uavs, 2, num_groups_x, num_groups_y, 1);
 
 }
 
+void JumpFloodDispatch::dispatch_boundary_shader() {
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
 
+    auto srv = resources->get_input_srv();
+    auto cbuffer = resources->create_const_buffer(false);
+    auto uav = resources->create_voronoi_uav(false);
+
+    assert(get_shader(SHADERS::BOUNDARY));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::BOUNDARY), 1, &srv,
+                               cbuffer, nullptr, 0, &uav, 1, num_groups_x, num_groups_y, 1);
+}
+
+void JumpFloodDispatch::dispatch_signed_distance_transform_shader(float max_distance, const float2* normalise_range) {
+    const uint32_t num_groups_x = num_groups(resources->get_resolution().width);
+    const uint32_t num_groups_y = num_groups(resources->get_resolution().height);
+
+    resources->create_const_buffer(false);
+    auto local_buf = resources->get_local_cbuffer();
+    local_buf.MaxDistance = max_distance;
+    set_distance_normalise(local_buf, normalise_range, true);
+    auto cbuffer = resources->update_const_buffer(context, local_buf);
+    auto srv = resources->get_input_srv();
+    auto voronoi_uav = resources->create_voronoi_uav(false);
+    auto distance_uav = resources->create_distance_uav(false);
+    auto reduce_uav = resources->create_reduction_uav(num_groups_x, num_groups_y);
+
+    ID3D11UnorderedAccessView* UAVs[] = {voronoi_uav, distance_uav, reduce_uav};
+
+    assert(get_shader(SHADERS::SIGNED_DISTANCE));
+    dxinit::run_compute_shader(context, get_shader(SHADERS::SIGNED_DISTANCE), 1, &srv,
+                               cbuffer, nullptr, 0, UAVs, 3, num_groups_x, num_groups_y, 1);
+}
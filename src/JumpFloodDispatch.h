@@ -6,72 +6,50 @@
 #define IMG2SDF_JUMPFLOODDISPATCH_H
 
 #include <cstdint>
+#include <memory>
 #include <wrl.h>
 #include <d3d11.h>
 #include "jumpflooderror.h"
+#include "shader_globals.h"
+#include "output_format.h"
+#include "ComputePipeline.h"
 
 
 
 using namespace Microsoft::WRL;
 
-struct jump_flood_shaders
+///ComputePipeline device over an ID3D11Device.
+struct D3D11ComputeDevice
 {
-    ///pointer to the preprocess shader bytecode
-    const uint8_t* preprocess;
-    size_t preprocess_size;
+    using kernel_type = ComPtr<ID3D11ComputeShader>;
 
-    ///pointer to a preprocess shader that also inverts the input mask.
-    const uint8_t* preprocess_invert;
-    size_t preprocess_invert_size;
-
-    ///pointer to the voronoi diagram shader bytecode (jumpflood.hlsl)
-    const uint8_t* voronoi;
-    size_t voronoi_size;
-
-    ///pointer to the voronoi_normalisation shader bytecode, for debugging generated voronoi diagrams.
-    const uint8_t* voronoi_normalise;
-    size_t voronoi_normalise_size;
-
-    ///pointer to the distance transform shader bytecode
-    const uint8_t* distance_transform;
-    size_t distance_transform_size;
-
-    const uint8_t* min_max_reduce_firstpass;
-    size_t min_max_reduce_firstpass_size;
-
-    ///pointer to the min_max reduction shader bytecode
-    const uint8_t* min_max_reduce;
-    size_t min_max_reduce_size;
-
-    ///pointer to the distance normalisation shader bytecode.
-    const uint8_t* distance_normalise;
-    size_t distance_normalise_size;
-
-    const uint8_t* composite;
-    size_t composite_size;
-
-};
+    ///non-owning.
+    ID3D11Device* device = nullptr;
 
-enum class SHADERS
-{
-    PREPROCESS,
-    PREPROCESS_INVERT,
-    VORONOI,
-    VORONOI_NORMALISE,
-    DISTANCE,
-    MINMAXREDUCE_FIRST,
-    MINMAXREDUCE,
-    DISTANCE_NORMALISE,
-    COMPOSITE
+    ///throws a jumpflood_error if the shader cannot be created.
+    [[nodiscard]] kernel_type create_kernel(SHADERS shader, const uint8_t* byte_code, size_t size) const;
 };
 
+using JumpFloodPipeline = ComputePipeline<D3D11ComputeDevice>;
 
+///Records the passes of a single run of the pipeline on `context`, using the shaders of a JumpFloodPipeline. Cheap to
+///construct: the shaders are created once per device by create_pipeline, not per dispatch.
 class JumpFloodDispatch {
 public:
-    ///Creates shaders from compiled bytecode. Note that any of byte_code's fields may be nullptr,
-    ///and the constructor will simply skip this shader.
+    ///@param context the context commands are recorded on, of the device `pipeline` was created on.
+    ///@param pipeline the shaders to dispatch, shared with other dispatches.
+    JumpFloodDispatch(ID3D11DeviceContext* context, class JumpFloodResources* resources,
+                      std::shared_ptr<const JumpFloodPipeline> pipeline);
+
+    ///Creates shaders from compiled bytecode, in a pipeline of this dispatch's own. Note that any of byte_code's fields
+    ///may be nullptr, and the constructor will simply skip this shader. Prefer sharing one create_pipeline between
+    ///dispatches, as creating the shaders costs far more than recording a run.
     JumpFloodDispatch(ID3D11Device* device, ID3D11DeviceContext* context, class JumpFloodResources* resources,  jump_flood_shaders byte_code = JUMPFLOOD_SHADERS);
 
+    ///Creates the shaders of `byte_code` on `device` once, for any number of dispatches.
+    [[nodiscard]] static std::shared_ptr<const JumpFloodPipeline> create_pipeline(ID3D11Device* device,
+                                                                                  const jump_flood_shaders& byte_code = JUMPFLOOD_SHADERS);
+
     ///Gets the D3D shader interface for the specified shader.
     [[nodiscard]] ID3D11ComputeShader* get_shader(SHADERS shader) const;
 
@@ -80,9 +58,17 @@ public:
 
     ///dispatches the voronoi jumpflood shader.
     /// Note that this will generate a new UAV if the one in `resources` is not yet created.
-    void dispatch_voronoi_shader();
-
-    void dispatch_distance_transform_shader();
+    ///@param max_distance if greater than 0, only seeds within this spread are needed, so the flood starts at the
+    ///smallest power of two >= max_distance rather than at 2^(num_steps - 1), skipping the long-range passes.
+    void dispatch_voronoi_shader(float max_distance = 0);
+
+    ///dispatches the distance transform shader. The minmax of each thread group is written to the reduction UAV as it
+    ///goes, so dispatch_minmax_combine_shader can finish the range without reading the field again.
+    ///@param max_distance if greater than 0, distances are clamped to this spread, and texels without a seed are set to it.
+    ///@param normalise_range if not null, each distance is normalised from this fixed range (x = minimum, y = maximum)
+    ///to [0, 1] as it is written, and no minmax is gathered, so neither dispatch_minmax_combine_shader nor a normalise
+    ///pass has to follow.
+    void dispatch_distance_transform_shader(float max_distance = 0, const float2* normalise_range = nullptr);
 
     ///dispatches the voronoi normalisation shader.
     void dispatch_voronoi_normalise_shader();
@@ -95,11 +81,46 @@ public:
     ///if the routine returns early, you must iterate on the returned resource to find the final minmax value.
     [[nodiscard]] bool dispatch_minmax_reduce_shader(ID3D11ShaderResourceView* explicit_srv = nullptr);
 
+    ///Combines the per-group minmax left in the reduction UAV by the distance transform shaders down to index 0.
+    ///Unlike dispatch_minmax_reduce_shader, it always runs to completion, so the range never needs finishing on the CPU.
+    void dispatch_minmax_combine_shader();
+
+    ///Reads back the range in index 0 of the reduction UAV (x = minimum, y = maximum). Copies a single texel.
+    [[nodiscard]] float2 read_minmax_range();
+
     void dispatch_distance_normalise_shader(float minimum, float maximum, bool is_signed_field);
 
+    ///Normalises the distance field against the range in index 0 of the reduction UAV, left by
+    ///dispatch_minmax_combine_shader, without a readback.
+    void dispatch_reduced_normalise_shader(bool is_signed_field);
+
+    ///Normalises the distance field and stores it in the encoded UAV as `encoding` in the same pass, so the normalised
+    ///float field is never written. The UAV format does the conversion on store.
+    ///@param normalise whether to normalise before encoding; if not, raw distances are scaled, biased and stored.
+    ///@param fixed_range the range to normalise from (x = minimum, y = maximum). If null, the range is read from index 0
+    ///of the reduction UAV, as in dispatch_reduced_normalise_shader.
+    void dispatch_quantise_shader(const output_encoding& encoding, bool normalise, bool is_signed_field,
+                                  const float2* fixed_range = nullptr);
+
     void dispatch_composite_shader(ID3D11UnorderedAccessView* outer_uav);
 
+    ///Dispatches the boundary shader, seeding only the inside boundary of the input mask.
+    ///Used in place of the preprocess shader for single flood signed fields.
+    void dispatch_boundary_shader();
+
+    ///Dispatches the signed distance transform shader over a flood of the boundary seeds, taking the sign from the
+    ///input mask. Replaces a second flood of the inverted mask and the composite pass. Like the distance transform
+    ///shader, it writes the minmax of each thread group to the reduction UAV.
+    ///@param max_distance if greater than 0, distances are clamped to this spread, and texels without a seed are set to it.
+    ///@param normalise_range if not null, distances are normalised from this fixed range to [-1, 1] as they are
+    ///written, as in dispatch_distance_transform_shader.
+    void dispatch_signed_distance_transform_shader(float max_distance = 0, const float2* normalise_range = nullptr);
+
     constexpr static size_t threads_per_group_width = 8;
+
+    ///Number of thread groups needed to cover `texels` along one axis. Rounds up, so textures need not be a multiple
+    ///of the group width; the shaders discard threads past the edge.
+    [[nodiscard]] static uint32_t num_groups(size_t texels);
 private:
 
 
@@ -109,15 +130,7 @@ private:
     ID3D11DeviceContext* context = nullptr;
     class JumpFloodResources* resources = nullptr;
 
-    ComPtr<ID3D11ComputeShader> preprocess_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> preprocess_invert_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> voronoi_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> voronoi_normalise_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> distance_transform_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> min_max_reduce_firstpass_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> min_max_reduce_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> distance_normalise_shader = nullptr;
-    ComPtr<ID3D11ComputeShader> composite_shader = nullptr;
+    std::shared_ptr<const JumpFloodPipeline> pipeline = nullptr;
 
 
 };
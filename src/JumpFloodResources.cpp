@@ -4,19 +4,23 @@
 
 #include "JumpFloodResources.h"
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 #include <format>
 #include <limits>
 #include <vector>
 #include <array>
+#include <utility>
 #include "jumpflooderror.h"
 
-JumpFloodResources::JumpFloodResources(ID3D11Device *device, const std::wstring& file_path) :
+JumpFloodResources::JumpFloodResources(ID3D11Device *device, const std::wstring& file_path, D3D11ResourcePool* resource_pool) :
         device(device)
         {
             if (device == nullptr)
             {
                 throw std::runtime_error("ID3D11Device is NULL");
             }
+            use_resource_pool(resource_pool);
             try {
                 create_input_srv(file_path);
             }
@@ -30,16 +34,30 @@ JumpFloodResources::JumpFloodResources(ID3D11Device *device, const std::wstring&
 
 
 JumpFloodResources::JumpFloodResources(ID3D11Device *device, const std::vector<float> data, int32_t width,
-                                       int32_t height) : device(device) {
+                                       int32_t height, D3D11ResourcePool* resource_pool) : device(device) {
     if (device == nullptr)
     {
         throw std::runtime_error("ID3D11Device is NULL");
     }
+    use_resource_pool(resource_pool);
 
-    auto tex_and_desc = load_seeds_to_texture(device, data, width, height);
+    create_input_srv(load_seeds_to_texture(device, data, width, height));
+}
+
+JumpFloodResources::JumpFloodResources(ID3D11Device *device, const cpu_bitmask& mask,
+                                       D3D11ResourcePool* resource_pool) : device(device) {
+    if (device == nullptr)
+    {
+        throw std::runtime_error("ID3D11Device is NULL");
+    }
+    use_resource_pool(resource_pool);
 
+    create_input_srv(load_seeds_to_texture(device, mask));
+}
+
+void JumpFloodResources::create_input_srv(const std::pair<ComPtr<ID3D11Texture2D>, D3D11_TEXTURE2D_DESC>& tex_and_desc) {
     auto srv_texture = tex_and_desc.first;
-    auto srv_description =tex_and_desc.second;
+    auto srv_description = tex_and_desc.second;
 
     ComPtr<ID3D11ShaderResourceView> srv = nullptr;
 
@@ -54,7 +72,6 @@ JumpFloodResources::JumpFloodResources(ID3D11Device *device, const std::vector<f
     this->input_description = srv_description;
     this->res.height = srv_description.Height;
     this->res.width = srv_description.Width;
-
 }
 
 
@@ -95,22 +112,65 @@ JumpFloodResources::load_seeds_to_texture(ID3D11Device *device, const std::vecto
 
 }
 
+std::pair<ComPtr<ID3D11Texture2D>, D3D11_TEXTURE2D_DESC>
+JumpFloodResources::load_seeds_to_texture(ID3D11Device *device, const cpu_bitmask& mask) {
+    if (device == nullptr)
+    {
+        throw std::runtime_error("ID3D11Device is NULL");
+    }
+
+    D3D11_TEXTURE2D_DESC srv_description = {0};
+    srv_description.Width = static_cast<UINT>(mask.width);
+    srv_description.Height = static_cast<UINT>(mask.height);
+    srv_description.Usage = D3D11_USAGE_DEFAULT;
+    srv_description.Format = DXGI_FORMAT_R8_UNORM;
+    srv_description.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    srv_description.MiscFlags = 0;
+    srv_description.ArraySize = 1;
+    srv_description.MipLevels = 1;
+    srv_description.SampleDesc = {1,0};
+
+    //texture initial data has no 1 bit format, so the mask is expanded to bytes for the upload only.
+    std::vector<uint8_t> texels (mask.width * mask.height, 0);
+    for (size_t y = 0; y < mask.height; y++)
+    {
+        mask.for_each_set(y, [&](size_t x) { texels[y * mask.width + x] = 255; });
+    }
+
+    ComPtr<ID3D11Texture2D> srv_texture {};
+
+    D3D11_SUBRESOURCE_DATA subresource = {0};
+    subresource.pSysMem = texels.data();
+    subresource.SysMemPitch = static_cast<UINT>(mask.width);
+    subresource.SysMemSlicePitch = 0;
+
+    HRESULT out_tex = device->CreateTexture2D(&srv_description, &subresource, srv_texture.GetAddressOf());
+    if (FAILED(out_tex))
+    {
+        throw jumpflood_error(out_tex, "Could not create SRV texture from input mask.");
+    }
+
+    return {srv_texture, srv_description};
+}
+
 
 
-JumpFloodResources::JumpFloodResources(ID3D11Device *device, ComPtr<ID3D11Texture2D> input_texture)
+JumpFloodResources::JumpFloodResources(ID3D11Device *device, ComPtr<ID3D11Texture2D> input_texture,
+                                       D3D11ResourcePool* resource_pool)
     : device(device) {
 
     if (device == nullptr)
     {
         throw std::runtime_error("ID3D11Device is NULL");
     }
+    use_resource_pool(resource_pool);
 
     D3D11_TEXTURE2D_DESC in_desc = {0};
     input_texture->GetDesc(&in_desc);
 
-    if (in_desc.Format != DXGI_FORMAT_R32_FLOAT)
+    if (in_desc.Format != DXGI_FORMAT_R32_FLOAT && in_desc.Format != DXGI_FORMAT_R8_UNORM)
     {
-        throw std::runtime_error("Format must be DXGI_FORMAT_R32_FLOAT");
+        throw std::runtime_error("Format must be DXGI_FORMAT_R32_FLOAT or DXGI_FORMAT_R8_UNORM");
     }
     else if (in_desc.Usage != D3D11_USAGE_DEFAULT)
     {
@@ -121,10 +181,6 @@ JumpFloodResources::JumpFloodResources(ID3D11Device *device, ComPtr<ID3D11Textur
         throw std::runtime_error("Must be bindable as an SRV!");
     }
 
-    else if (!dxutils::is_power_of_two(in_desc.Width) || !dxutils::is_power_of_two(in_desc.Height))
-    {
-        throw std::runtime_error("Texture must be a power of two size!");
-    }
 
     HRESULT out_srv = device->CreateShaderResourceView(input_texture.Get(), nullptr, preprocess_srv.GetAddressOf());
     if (FAILED(out_srv))
@@ -138,6 +194,35 @@ JumpFloodResources::JumpFloodResources(ID3D11Device *device, ComPtr<ID3D11Textur
     this->res.width = in_desc.Width;
 }
 
+void JumpFloodResources::use_resource_pool(D3D11ResourcePool* pool) {
+    device->GetImmediateContext(this->immediate_context.GetAddressOf());
+    if (pool == nullptr)
+    {
+        this->unpooled = std::make_unique<D3D11ResourcePool>(D3D11TextureBackend {device}, 0);
+        pool = this->unpooled.get();
+    }
+    this->resource_pool = pool;
+}
+
+ID3D11UnorderedAccessView* JumpFloodResources::acquire_uav(D3D11ResourcePool::lease& uav, size_t width, size_t height,
+                                                           DXGI_FORMAT format, UINT optional_bind_flags,
+                                                           const FLOAT* clear_value) {
+    const d3d11_texture_format texture_format {format, D3D11_USAGE_DEFAULT,
+                                               D3D11_BIND_UNORDERED_ACCESS | optional_bind_flags, 0};
+    if (!uav.has_value() || uav.get_key().width != width || uav.get_key().height != height ||
+        uav.get_key().format != texture_format)
+    {
+        //return the old texture first, so it can be reused rather than held alongside the new one.
+        uav.reset();
+        uav = resource_pool->acquire(width, height, texture_format);
+    }
+
+    //cleared on the device rather than uploaded from a host array, and new or recycled alike.
+    constexpr FLOAT zero[4] = {0, 0, 0, 0};
+    immediate_context->ClearUnorderedAccessViewFloat(uav->uav.Get(), clear_value ? clear_value : zero);
+    return uav->uav.Get();
+}
+
 ID3D11ShaderResourceView *JumpFloodResources::create_input_srv(std::wstring filepath) {
     auto input = dxutils::load_texture_to_srv(filepath, device);
 
@@ -170,70 +255,82 @@ ID3D11ShaderResourceView *JumpFloodResources::create_input_srv(std::wstring file
 }
 
 ID3D11UnorderedAccessView *JumpFloodResources::create_voronoi_uav(bool regenerate) {
-    if (this->voronoi_uav != nullptr && !regenerate)
+    if (this->voronoi.has_value() && !regenerate)
     {
-        return this->voronoi_uav.Get();
+        return this->voronoi->uav.Get();
     }
 
-    try {
-        auto voronoi = create_uav<float4>(DXGI_FORMAT_R32G32B32A32_FLOAT);
-        this->voronoi_texture = voronoi.first;
-        this->voronoi_uav = voronoi.second;
+    auto uav = acquire_uav(this->voronoi, res.width, res.height, DXGI_FORMAT_R32G32B32A32_FLOAT);
 
 #ifdef DEBUG
-        D3D_SET_OBJECT_NAME_A(this->voronoi_uav, "JumpFloodResources:voronoi_uav");
-        D3D_SET_OBJECT_NAME_A(this->voronoi_texture, "JumpFloodResources::voronoi_texture");
+    D3D_SET_OBJECT_NAME_A(this->voronoi->uav, "JumpFloodResources:voronoi_uav");
+    D3D_SET_OBJECT_NAME_A(this->voronoi->texture, "JumpFloodResources::voronoi_texture");
 #endif
 
-        return this->voronoi_uav.Get();
-    }
-    catch (...)
-    {
-        auto eptr = std::current_exception();
-        std::rethrow_exception(eptr);
-        return nullptr;
-    }
-
+    return uav;
 }
 
 ID3D11UnorderedAccessView *JumpFloodResources::create_distance_uav(bool regenerate) {
-    if (this->distance_uav != nullptr && !regenerate)
+    if (this->distance.has_value() && !regenerate)
     {
-        return this->distance_uav.Get();
+        return this->distance->uav.Get();
     }
 #if DEBUG
-    else if (this->distance_uav == nullptr && !regenerate)
+    else if (!this->distance.has_value() && !regenerate)
     {
       printf("WARNING: JumpFloodResources::create_distance_uav: distance_uav is null, but regenerate == false! Regenerating anyway.\n");
     }
 #endif
 
-    try {
-        auto distance = create_uav<float>(DXGI_FORMAT_R32_FLOAT, D3D11_BIND_SHADER_RESOURCE);
-        this->distance_texture = distance.first;
-        this->distance_uav = distance.second;
+    auto uav = acquire_uav(this->distance, res.width, res.height, DXGI_FORMAT_R32_FLOAT, D3D11_BIND_SHADER_RESOURCE);
+    //a view of the previous distance texture would read the wrong one.
+    this->reduce_input_srv = nullptr;
 
 #ifdef DEBUG
-        D3D_SET_OBJECT_NAME_A(this->distance_uav, "JumpFloodResources::distance_uav");
-        D3D_SET_OBJECT_NAME_A(this->distance_texture, "JumpFloodResources::distance_texture");
+    D3D_SET_OBJECT_NAME_A(this->distance->uav, "JumpFloodResources::distance_uav");
+    D3D_SET_OBJECT_NAME_A(this->distance->texture, "JumpFloodResources::distance_texture");
 #endif
 
-        return this->distance_uav.Get();
+    return uav;
+}
+
+ID3D11UnorderedAccessView *JumpFloodResources::create_encoded_uav(OUTPUT_FORMAT format, bool regenerate) {
+    if (this->encoded.has_value() && !regenerate && this->encoded.get_key().format.format == dxgi_format(format))
+    {
+        return this->encoded->uav.Get();
     }
-    catch (...)
+
+    //a texture of another format is swapped for one of the right format, cleared to 0 either way.
+    auto uav = acquire_uav(this->encoded, res.width, res.height, dxgi_format(format), D3D11_BIND_SHADER_RESOURCE);
+
+#ifdef DEBUG
+    D3D_SET_OBJECT_NAME_A(this->encoded->uav, "JumpFloodResources::encoded_uav");
+    D3D_SET_OBJECT_NAME_A(this->encoded->texture, "JumpFloodResources::encoded_texture");
+#endif
+
+    return uav;
+}
+
+DXGI_FORMAT JumpFloodResources::dxgi_format(OUTPUT_FORMAT format) {
+    switch (format)
     {
-        auto eptr = std::current_exception();
-        std::rethrow_exception(eptr);
-        return nullptr;
+        case OUTPUT_FORMAT::FLOAT16: return DXGI_FORMAT_R16_FLOAT;
+        case OUTPUT_FORMAT::UNORM16: return DXGI_FORMAT_R16_UNORM;
+        case OUTPUT_FORMAT::UNORM8: return DXGI_FORMAT_R8_UNORM;
+        case OUTPUT_FORMAT::FLOAT32:
+        default: return DXGI_FORMAT_R32_FLOAT;
     }
 }
 
 ID3D11Texture2D* JumpFloodResources::create_owned_staging_texture(ID3D11Texture2D* mimic_texture)
 {
-    ComPtr<ID3D11Texture2D> CPU_read_texture = dxutils::create_staging_texture(this->device, mimic_texture);
+    D3D11_TEXTURE2D_DESC mimic_desc;
+    mimic_texture->GetDesc(&mimic_desc);
 
-    this->staging_texture = CPU_read_texture;
-    return this->staging_texture.Get();
+    const d3d11_texture_format staging_format {mimic_desc.Format, D3D11_USAGE_STAGING, 0, D3D11_CPU_ACCESS_READ};
+    this->staging.reset();
+    this->staging = resource_pool->acquire(mimic_desc.Width, mimic_desc.Height, staging_format);
+    return this->staging->texture.Get();
 }
 
 
@@ -281,17 +378,38 @@ ID3D11Buffer *JumpFloodResources::create_const_buffer(bool regenerate) {
 ID3D11Texture2D *JumpFloodResources::get_texture(RESOURCE_TYPE desired_texture) const {
     switch(desired_texture)
     {
-        case RESOURCE_TYPE::DISTANCE_UAV: {return this->distance_texture.Get();};
+        case RESOURCE_TYPE::DISTANCE_UAV: {return this->distance.has_value() ? this->distance->texture.Get() : nullptr;};
         case RESOURCE_TYPE::INPUT_SRV: {return this->preprocess_texture.Get();};
-        case RESOURCE_TYPE::STAGING_TEXTURE: {return this->staging_texture.Get();};
-        case RESOURCE_TYPE::VORONOI_UAV: {return this->voronoi_texture.Get();};
-        case RESOURCE_TYPE::REDUCE_UAV: {return this->reduce_texture.Get();};
+        case RESOURCE_TYPE::STAGING_TEXTURE: {return this->staging.has_value() ? this->staging->texture.Get() : nullptr;};
+        case RESOURCE_TYPE::VORONOI_UAV: {return this->voronoi.has_value() ? this->voronoi->texture.Get() : nullptr;};
+        case RESOURCE_TYPE::REDUCE_UAV: {return this->reduce.has_value() ? this->reduce->texture.Get() : nullptr;};
+        case RESOURCE_TYPE::ENCODED_UAV: {return this->encoded.has_value() ? this->encoded->texture.Get() : nullptr;};
+        default: return nullptr;
+    }
+}
+
+ComPtr<ID3D11Texture2D> JumpFloodResources::release_texture(RESOURCE_TYPE desired_texture) {
+    D3D11ResourcePool::lease* lease = nullptr;
+    switch(desired_texture)
+    {
+        case RESOURCE_TYPE::DISTANCE_UAV: {lease = &this->distance; this->reduce_input_srv = nullptr; break;};
+        case RESOURCE_TYPE::STAGING_TEXTURE: {lease = &this->staging; break;};
+        case RESOURCE_TYPE::VORONOI_UAV: {lease = &this->voronoi; break;};
+        case RESOURCE_TYPE::REDUCE_UAV: {lease = &this->reduce; break;};
+        case RESOURCE_TYPE::ENCODED_UAV: {lease = &this->encoded; break;};
+        case RESOURCE_TYPE::INPUT_SRV: {return std::exchange(this->preprocess_texture, nullptr);};
         default: return nullptr;
     }
+
+    if (!lease->has_value())
+    {
+        return nullptr;
+    }
+    return lease->release().texture;
 }
 
 int32_t JumpFloodResources::num_steps() const {
-    return floor(log2(static_cast<double>(res.width)));
+    return ceil(log2(static_cast<double>(std::max(res.width, res.height))));
 }
 
 ID3D11Buffer *JumpFloodResources::update_const_buffer(ID3D11DeviceContext* context, JFA_cbuffer buffer) {
@@ -317,47 +435,21 @@ JFA_cbuffer JumpFloodResources::get_local_cbuffer() const {
 }
 
 ID3D11UnorderedAccessView *JumpFloodResources::create_reduction_uav(size_t num_groups_x, size_t num_groups_y, bool regenerate) {
-    if (this->reduce_uav != nullptr && !regenerate)
+    if (this->reduce.has_value() && !regenerate)
     {
-        return this->reduce_uav.Get();
+        return this->reduce->uav.Get();
     }
-    D3D11_TEXTURE2D_DESC desc = input_description;
-    desc.Width = num_groups_x;
-    desc.Height = num_groups_y;
-    desc.Format = DXGI_FORMAT_R32G32_FLOAT;
-    desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
-    desc.Usage = D3D11_USAGE_DEFAULT;
-    desc.ArraySize = 1;
-    desc.MipLevels = 1;
-    desc.CPUAccessFlags = 0;
-
 
     constexpr float inf = std::numeric_limits<float>::infinity();
-    const std::vector<float2> init_minmax (num_groups_x * num_groups_y, float2{inf, -inf});
-    D3D11_SUBRESOURCE_DATA data = {nullptr};
-    data.pSysMem = init_minmax.data();
-    data.SysMemPitch = sizeof(float2) * desc.Width;
-    data.SysMemSlicePitch = 0;
-
-
-    HRESULT out_reduction = device->CreateTexture2D(&desc, &data, this->reduce_texture.GetAddressOf());
-    if (FAILED(out_reduction))
-    {
-        throw jumpflood_error(out_reduction, "Could not create output buffer for minmax reduction.");
-    }
-
-    HRESULT out_uav = device->CreateUnorderedAccessView(this->reduce_texture.Get(), nullptr, this->reduce_uav.GetAddressOf());
-    if (FAILED(out_uav))
-    {
-        throw jumpflood_error(out_uav, "Could not create output UAV for minmax reduction.");
-    }
+    constexpr FLOAT init_minmax[4] = {inf, -inf, 0, 0};
+    auto uav = acquire_uav(this->reduce, num_groups_x, num_groups_y, DXGI_FORMAT_R32G32_FLOAT, 0, init_minmax);
 
 #ifdef DEBUG
-    D3D_SET_OBJECT_NAME_A(this->reduce_texture, "JumpFloodResources::reduce_texture");
-    D3D_SET_OBJECT_NAME_A(this->reduce_uav, "JumpFloodResources::reduce_uav");
+    D3D_SET_OBJECT_NAME_A(this->reduce->texture, "JumpFloodResources::reduce_texture");
+    D3D_SET_OBJECT_NAME_A(this->reduce->uav, "JumpFloodResources::reduce_uav");
 #endif
 
-    return this->reduce_uav.Get();
+    return uav;
 
 }
 
@@ -368,7 +460,7 @@ ID3D11ShaderResourceView *JumpFloodResources::create_reduction_view(bool regener
     }
 
 
-    HRESULT srv = device->CreateShaderResourceView(this->distance_texture.Get(), nullptr, this->reduce_input_srv.GetAddressOf());
+    HRESULT srv = device->CreateShaderResourceView(get_texture(RESOURCE_TYPE::DISTANCE_UAV), nullptr, this->reduce_input_srv.GetAddressOf());
     if (FAILED(srv))
     {
         throw jumpflood_error(srv, "Could not create input SRV for minmax reduction.");
@@ -7,9 +7,13 @@
 #include "dxinit.h"
 #include "dxutils.h"
 #include "shader_globals.h"
+#include "output_format.h"
+#include "cpu_bitmask.h"
+#include "D3D11ResourcePool.h"
 #include <wrl.h>
 #include <stdexcept>
 #include <format>
+#include <memory>
 
 using namespace Microsoft::WRL;
 
@@ -19,26 +23,40 @@ enum class RESOURCE_TYPE
     VORONOI_UAV,
     DISTANCE_UAV,
     REDUCE_UAV,
+    ENCODED_UAV,
     STAGING_TEXTURE,
 };
 
+///Owns the textures of a single run of the D3D11 pipeline. Every texture but the input is leased from a
+///D3D11ResourcePool, returned to it on destruction, and cleared in place on the device's immediate context.
 class JumpFloodResources {
 public:
     ///Initialises the input SRV and texture from the given file path.
     ///`device` is a non-owning pointer.
     ///@param device a non-owning pointer to the device.
     ///@param file_path path to the input texture to initialise to an SRV.
-    JumpFloodResources(ID3D11Device* device, const std::wstring& file_path);
+    ///@param resource_pool if not null, the pool textures are leased from, e.g. to reuse them across a batch of
+    ///same-sized inputs. It is not owned. Otherwise every texture is created afresh.
+    JumpFloodResources(ID3D11Device* device, const std::wstring& file_path, D3D11ResourcePool* resource_pool = nullptr);
 
-    JumpFloodResources(ID3D11Device* device, const std::vector<float> data, int32_t width, int32_t height);
+    JumpFloodResources(ID3D11Device* device, const std::vector<float> data, int32_t width, int32_t height,
+                       D3D11ResourcePool* resource_pool = nullptr);
+
+    ///Uploads a bit-packed mask as an R8_UNORM texture, a quarter of the size of an R32_FLOAT one, which the shaders
+    ///sample as 1 and 0 like a float mask.
+    JumpFloodResources(ID3D11Device* device, const cpu_bitmask& mask, D3D11ResourcePool* resource_pool = nullptr);
 
     ///Initialise an SRV from an existing ID3D11Texture2D.
-    ///@param input_texture a texture with a width and height power of 2 size. Must have D3D11_USAGE_DEFAULT, DXGI_FORMAT_R32_FLOAT,
-    ///and D3D11_BIND_SHADER_RESOURCE.
-    JumpFloodResources(ID3D11Device* device, ComPtr<ID3D11Texture2D> input_texture);
+    ///@param input_texture a texture of any width and height. Must have D3D11_USAGE_DEFAULT, DXGI_FORMAT_R32_FLOAT
+    ///or DXGI_FORMAT_R8_UNORM, and D3D11_BIND_SHADER_RESOURCE.
+    JumpFloodResources(ID3D11Device* device, ComPtr<ID3D11Texture2D> input_texture,
+                       D3D11ResourcePool* resource_pool = nullptr);
 
     static std::pair<ComPtr<ID3D11Texture2D>, D3D11_TEXTURE2D_DESC> load_seeds_to_texture(ID3D11Device* device, const std::vector<float>& data, int32_t width, int32_t height);
 
+    ///As above, expanding the mask to an R8_UNORM texture of 255s and 0s.
+    static std::pair<ComPtr<ID3D11Texture2D>, D3D11_TEXTURE2D_DESC> load_seeds_to_texture(ID3D11Device* device, const cpu_bitmask& mask);
+
     ///Returns a weak pointer to the input SRV.
     ///The SRV is into an R32_Float Texture2D.
     ID3D11ShaderResourceView* get_input_srv();
@@ -46,18 +64,32 @@ public:
     ///Creates the UAV for the output voronoi diagram. This is a Texture2D of same width and height as the input SRV,
     ///with R32G32B32A32_Float format.
     ///Returns a weak pointer to the UAV. Ownership is ultimately managed by this object.
-    ///@param regenerate whether or not to regenerate (and replace) the current voronoi UAV.
+    ///@param regenerate whether or not to clear the current voronoi UAV again, in place.
     ID3D11UnorderedAccessView *create_voronoi_uav(bool regenerate = true);
 
     ///Creates the UAV for the output distance transform. This is a Texture2D of same width and height as the input SRV,
     ///with R32_Float format.
     ///Returns a weak pointer to the UAV. Ownership is ultimately managed by this object.
-    ///@param regenerate whether or not to regenerate (and replace) the current distance UAV.
+    ///@param regenerate whether or not to clear the current distance UAV again, in place.
     ID3D11UnorderedAccessView *create_distance_uav(bool regenerate = true);
 
+    ///Creates the UAV the quantise shader writes the final field to: a Texture2D of same width and height as the input
+    ///SRV, in the DXGI format matching `format` (R32_FLOAT, R16_FLOAT, R16_UNORM or R8_UNORM).
+    ///Returns a weak pointer to the UAV. Ownership is ultimately managed by this object.
+    ///@param regenerate whether or not to clear the current encoded UAV again, in place. It is always replaced if its
+    ///format differs from `format`.
+    ID3D11UnorderedAccessView *create_encoded_uav(OUTPUT_FORMAT format, bool regenerate = true);
+
+    ///DXGI format a field stored as `format` is written in.
+    [[nodiscard]] static DXGI_FORMAT dxgi_format(OUTPUT_FORMAT format);
+
     ///Returns a non-owning pointer to the resource associated with the specified SRV/UAV.
     [[nodiscard]] ID3D11Texture2D* get_texture(RESOURCE_TYPE desired_texture) const;
 
+    ///Takes a texture out of the resources, and out of the resource pool, e.g. to hand a result to the caller without
+    ///a later run overwriting it. The resources no longer hold it.
+    ComPtr<ID3D11Texture2D> release_texture(RESOURCE_TYPE desired_texture);
+
     ///Initialises a staging texture for CPU readback, using the input `mimic_texture` as a template.
     ///Note that the staging texture subresource is *not* initialised, so it must be copied to before reading!
     ///Returns a weak pointer to the texture. Ownership is ultimately managed by this object.
@@ -74,6 +106,10 @@ public:
 
     ID3D11ShaderResourceView* create_reduction_view(bool regenerate = true);
 
+    ///Creates the UAV the distance and reduction passes write the minmax of each thread group to, with every texel
+    ///set to {inf, -inf}.
+    ///@param regenerate whether or not to clear the current reduction UAV again, in place. It is always replaced if
+    ///its size differs.
     ID3D11UnorderedAccessView* create_reduction_uav(size_t num_groups_x, size_t num_groups_y, bool regenerate = true);
 
 
@@ -81,53 +117,32 @@ public:
     ///returns {0,0} if the input SRV has not been loaded.
     [[nodiscard]] resolution get_resolution() const;
 
-    ///Returns the number of passes the JFA kernel needs to make for a square texture.
+    ///Returns the number of passes the JFA kernel needs to make, log2 of the larger dimension rounded up.
     [[nodiscard]] int32_t num_steps() const;
 
 private:
 
-    ///Creates a UAV of format `format` and zero initialises it with Width*Height elements of `format_type`.
-    ///Requires that `input_description` has been set, i.e. that the input SRV has been loaded.
+    ///Leases a `width` x `height` texture of format `format` bindable as a UAV and `optional_bind_flags` into
+    ///`uav` if it is empty or has a different key, then sets every texel to `clear_value` in place.
     ///may throw a std::runtime_error if UAV or texture creation fails.
-    template <typename format_type>
-    std::pair<ComPtr<ID3D11Texture2D>, ComPtr<ID3D11UnorderedAccessView>> create_uav(DXGI_FORMAT format, D3D11_BIND_FLAG optional_bind_flags = D3D11_BIND_FLAG::D3D11_BIND_UNORDERED_ACCESS)
-    {
-
-        D3D11_TEXTURE2D_DESC desc = input_description;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.Format = format;
-        desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | optional_bind_flags;
-        desc.MiscFlags = 0;
+    ID3D11UnorderedAccessView* acquire_uav(D3D11ResourcePool::lease& uav, size_t width, size_t height, DXGI_FORMAT format,
+                                           UINT optional_bind_flags = 0, const FLOAT* clear_value = nullptr);
 
-        ComPtr<ID3D11Texture2D> uav_texture = nullptr;
-
-        D3D11_SUBRESOURCE_DATA data;
-        std::vector<format_type> init_data (desc.Width * desc.Height, format_type {0});
-        data.pSysMem = init_data.data();
-        data.SysMemPitch = sizeof(format_type) * desc.Width;
-
-        HRESULT out_tex = device->CreateTexture2D(&desc, &data, &uav_texture);
-        if (FAILED(out_tex))
-        {
-            throw std::runtime_error {std::format("Failed to Instantiate Texture for UAV. HRESULT {:x}\n", out_tex)};
-        }
-
-        ComPtr<ID3D11UnorderedAccessView> buffer;
-
-        HRESULT buffer_result = device->CreateUnorderedAccessView(uav_texture.Get(), nullptr, buffer.GetAddressOf());
-        if (FAILED(buffer_result))
-        {
-            throw std::runtime_error {std::format("Failed to Instantiate UAV. HRESULT {:x}\n", buffer_result)};
-        }
-
-        return {uav_texture, buffer};
-    }
+    ///Leases from `pool`, or from a private pool with a cap of 0 if it is null, and clears on the immediate context.
+    void use_resource_pool(D3D11ResourcePool* pool);
 
     ///Loads an SRV and texture from a filepath. This will be an R32_Float Texture2D. Conversion is done if necessary,
     ///according to WIC rules.
     ID3D11ShaderResourceView* create_input_srv(std::wstring filepath);
 
+    ///Creates the input SRV over an uploaded seed texture, as returned by load_seeds_to_texture.
+    void create_input_srv(const std::pair<ComPtr<ID3D11Texture2D>, D3D11_TEXTURE2D_DESC>& tex_and_desc);
+
     ID3D11Device* device = nullptr;
+    ComPtr<ID3D11DeviceContext> immediate_context = nullptr;
+    D3D11ResourcePool* resource_pool = nullptr;
+    ///stands in for `resource_pool` when none is given. Its cap of 0 frees every texture as it is returned.
+    std::unique_ptr<D3D11ResourcePool> unpooled = nullptr;
 
     resolution res = {0};
 
@@ -136,17 +151,14 @@ private:
 
     D3D11_TEXTURE2D_DESC input_description = {0};
 
-    ComPtr<ID3D11UnorderedAccessView> voronoi_uav = nullptr;
-    ComPtr<ID3D11Texture2D> voronoi_texture = nullptr;
-
-    ComPtr<ID3D11UnorderedAccessView> distance_uav = nullptr;
-    ComPtr<ID3D11Texture2D> distance_texture = nullptr;
+    D3D11ResourcePool::lease voronoi;
+    D3D11ResourcePool::lease distance;
+    D3D11ResourcePool::lease encoded;
 
     ComPtr<ID3D11ShaderResourceView> reduce_input_srv = nullptr;
-    ComPtr<ID3D11UnorderedAccessView> reduce_uav = nullptr;
-    ComPtr<ID3D11Texture2D> reduce_texture = nullptr;
+    D3D11ResourcePool::lease reduce;
 
-    ComPtr<ID3D11Texture2D> staging_texture = nullptr;
+    D3D11ResourcePool::lease staging;
 
     ComPtr<ID3D11Buffer> const_buffer = nullptr;
     JFA_cbuffer local_buffer = {0};
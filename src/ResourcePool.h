@@ -0,0 +1,276 @@
+#ifndef IMG2SDF_RESOURCEPOOL_H
+#define IMG2SDF_RESOURCEPOOL_H
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+///Idle resources above this total are evicted, unless a pool is given a cap of its own.
+constexpr size_t default_pool_memory_cap = size_t {256} << 20;
+
+///Counters of a ResourcePool, e.g. to check that a cap holds the working set of a batch.
+struct resource_pool_statistics
+{
+    ///acquires served by an idle resource.
+    size_t hits = 0;
+    ///acquires that created a resource.
+    size_t misses = 0;
+    ///idle resources destroyed to stay under the memory cap, or by trim.
+    size_t evictions = 0;
+    size_t idle_resources = 0;
+    size_t idle_bytes = 0;
+};
+
+///Recycles the intermediate buffers of a pipeline across calls, keyed by (width, height, format), so a batch of
+///same-sized images allocates its buffers once. Resources are leased out by `acquire` and come back to the pool when
+///the lease is destroyed. Idle resources are kept until their total size would exceed the memory cap, when the least
+///recently returned are destroyed first. Resources in use do not count against the cap.
+///
+///`backend_type` creates the resources:
+///    using resource_type = ...;  //movable.
+///    using format_type = ...;    //ordered by operator<.
+///    resource_type create(size_t width, size_t height, format_type format);
+///    size_t size_in_bytes(size_t width, size_t height, format_type format) const;
+///
+///A recycled resource holds whatever was last written to it, so callers clear it in place, as they would a new one.
+///The pool is thread safe, and leases may outlive it.
+template <typename backend_type>
+class ResourcePool
+{
+public:
+    using resource_type = typename backend_type::resource_type;
+    using format_type = typename backend_type::format_type;
+
+    struct resource_key
+    {
+        size_t width = 0;
+        size_t height = 0;
+        format_type format {};
+
+        bool operator<(const resource_key& other) const
+        {
+            return std::tie(width, height, format) < std::tie(other.width, other.height, other.format);
+        }
+    };
+
+private:
+    struct idle_resource
+    {
+        resource_key key;
+        size_t bytes = 0;
+        resource_type resource;
+    };
+
+    ///Shared with every lease, so a lease returned after the pool is gone just destroys its resource.
+    struct pool_state
+    {
+        explicit pool_state(backend_type backend, size_t memory_cap) : backend(std::move(backend)), memory_cap(memory_cap) {}
+
+        std::mutex mutex;
+        backend_type backend;
+        size_t memory_cap;
+        bool open = true;
+        ///most recently returned first.
+        std::list<idle_resource> idle;
+        std::multimap<resource_key, typename std::list<idle_resource>::iterator> index;
+        resource_pool_statistics statistics;
+
+        ///destroys the least recently returned resources until the idle total is at most `cap`.
+        void evict_to(size_t cap)
+        {
+            while (statistics.idle_bytes > cap && !idle.empty())
+            {
+                auto oldest = std::prev(idle.end());
+                auto [first, last] = index.equal_range(oldest->key);
+                for (auto entry = first; entry != last; ++entry)
+                {
+                    if (entry->second == oldest)
+                    {
+                        index.erase(entry);
+                        break;
+                    }
+                }
+                statistics.idle_bytes -= oldest->bytes;
+                statistics.idle_resources--;
+                statistics.evictions++;
+                idle.erase(oldest);
+            }
+        }
+
+        void give_back(const resource_key& key, resource_type&& resource)
+        {
+            std::lock_guard lock (mutex);
+            const size_t bytes = backend.size_in_bytes(key.width, key.height, key.format);
+            if (!open || bytes > memory_cap)
+            {
+                return;
+            }
+
+            evict_to(memory_cap - bytes);
+            idle.push_front({key, bytes, std::move(resource)});
+            index.emplace(key, idle.begin());
+            statistics.idle_bytes += bytes;
+            statistics.idle_resources++;
+        }
+    };
+
+public:
+    ///A resource on loan from the pool, returned to it on destruction.
+    class lease
+    {
+    public:
+        lease() = default;
+
+        lease(lease&& other) noexcept :
+        state(std::move(other.state)), key(other.key), resource(std::move(other.resource))
+        {
+            //a moved-from optional still holds a (moved-from) value.
+            other.resource.reset();
+        }
+
+        lease& operator=(lease&& other) noexcept
+        {
+            if (this != &other)
+            {
+                give_back();
+                state = std::move(other.state);
+                key = other.key;
+                resource = std::move(other.resource);
+                other.resource.reset();
+            }
+            return *this;
+        }
+
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+
+        ~lease() { give_back(); }
+
+        [[nodiscard]] bool has_value() const { return resource.has_value(); }
+
+        resource_type& operator*() { return *resource; }
+        const resource_type& operator*() const { return *resource; }
+        resource_type* operator->() { return &*resource; }
+        const resource_type* operator->() const { return &*resource; }
+
+        [[nodiscard]] const resource_key& get_key() const { return key; }
+
+        ///Takes the resource out of the pool for good, e.g. to hand a result to the caller, leaving the lease empty.
+        resource_type release()
+        {
+            if (!resource)
+            {
+                throw std::runtime_error("Cannot release an empty lease.");
+            }
+            resource_type released = std::move(*resource);
+            resource.reset();
+            state.reset();
+            return released;
+        }
+
+        ///Returns the resource to the pool now, leaving the lease empty.
+        void reset() { give_back(); }
+
+    private:
+        friend class ResourcePool;
+
+        lease(std::shared_ptr<pool_state> state, const resource_key& key, resource_type&& resource) :
+        state(std::move(state)), key(key), resource(std::move(resource)) {}
+
+        void give_back()
+        {
+            if (resource && state)
+            {
+                state->give_back(key, std::move(*resource));
+            }
+            resource.reset();
+            state.reset();
+        }
+
+        std::shared_ptr<pool_state> state;
+        resource_key key {};
+        std::optional<resource_type> resource;
+    };
+
+    explicit ResourcePool(backend_type backend = {}, size_t memory_cap = default_pool_memory_cap) :
+    state(std::make_shared<pool_state>(std::move(backend), memory_cap)) {}
+
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    ~ResourcePool()
+    {
+        //leases still out destroy their resources when returned.
+        std::lock_guard lock (state->mutex);
+        state->open = false;
+        state->evict_to(0);
+    }
+
+    ///Leases the most recently returned idle resource with this key, or creates one if there is none.
+    ///Its contents are unspecified.
+    lease acquire(size_t width, size_t height, format_type format)
+    {
+        const resource_key key {width, height, format};
+        {
+            std::lock_guard lock (state->mutex);
+            //entries with equal keys are kept in insertion order, so the last one was returned most recently.
+            auto [first, last] = state->index.equal_range(key);
+            if (first != last)
+            {
+                auto entry = std::prev(last);
+                auto idle = entry->second;
+                state->index.erase(entry);
+                lease leased {state, key, std::move(idle->resource)};
+                state->statistics.idle_bytes -= idle->bytes;
+                state->statistics.idle_resources--;
+                state->statistics.hits++;
+                state->idle.erase(idle);
+                return leased;
+            }
+            state->statistics.misses++;
+        }
+
+        //created outside the lock, so instances sharing the pool allocate in parallel.
+        return {state, key, state->backend.create(width, height, format)};
+    }
+
+    ///Sets the most idle resources may take up, evicting the least recently returned right away to fit.
+    ///A cap of 0 disables recycling.
+    void set_memory_cap(size_t bytes)
+    {
+        std::lock_guard lock (state->mutex);
+        state->memory_cap = bytes;
+        state->evict_to(bytes);
+    }
+
+    [[nodiscard]] size_t get_memory_cap() const
+    {
+        std::lock_guard lock (state->mutex);
+        return state->memory_cap;
+    }
+
+    ///Destroys every idle resource.
+    void trim()
+    {
+        std::lock_guard lock (state->mutex);
+        state->evict_to(0);
+    }
+
+    [[nodiscard]] resource_pool_statistics get_statistics() const
+    {
+        std::lock_guard lock (state->mutex);
+        return state->statistics;
+    }
+
+private:
+    std::shared_ptr<pool_state> state;
+};
+
+#endif //IMG2SDF_RESOURCEPOOL_H
@@ -0,0 +1,84 @@
+#include "cpu_bitmask.h"
+
+cpu_bitmask::cpu_bitmask(const cpu_texture<float>& mask, float threshold) : cpu_bitmask(mask.width, mask.height, uninitialised) {
+    for (size_t y = 0; y < height; y++)
+    {
+        pack_row(y, mask.row(y), [threshold](float value) { return value > threshold; });
+    }
+}
+
+size_t cpu_bitmask::count_rows(size_t begin, size_t end) const {
+    size_t count = 0;
+    for (auto word = data.begin() + static_cast<std::ptrdiff_t>(begin * words_per_row),
+              last = data.begin() + static_cast<std::ptrdiff_t>(end * words_per_row); word != last; ++word)
+    {
+        count += static_cast<size_t>(std::popcount(*word));
+    }
+    return count;
+}
+
+void cpu_bitmask::invert_rows(size_t begin, size_t end) {
+    if (words_per_row == 0)
+    {
+        return;
+    }
+
+    const word_type last_word = last_word_mask();
+    for (size_t y = begin; y < end; y++)
+    {
+        word_type* words = row(y);
+        for (size_t word = 0; word < words_per_row; word++)
+        {
+            words[word] = ~words[word];
+        }
+        words[words_per_row - 1] &= last_word;
+    }
+}
+
+cpu_bitmask cpu_bitmask::inverted() const {
+    cpu_bitmask complement = *this;
+    complement.invert_rows(0, height);
+    return complement;
+}
+
+void cpu_bitmask::boundary_row(size_t y, word_type* out) const {
+    const word_type* inside = row(y);
+    const word_type* above = y > 0 ? row(y - 1) : nullptr;
+    const word_type* below = y + 1 < height ? row(y + 1) : nullptr;
+    const word_type last_word = last_word_mask();
+
+    //clear texels of a row, with the padding (past the right edge) kept clear of them.
+    const auto outside = [&](const word_type* words, size_t word) -> word_type {
+        return ~words[word] & (word + 1 == words_per_row ? last_word : ~word_type {0});
+    };
+
+    for (size_t word = 0; word < words_per_row; word++)
+    {
+        const word_type here = outside(inside, word);
+        //texel x sees x - 1 by shifting towards the top bit, carrying in the top bit of the word before, and x + 1 the
+        //other way round. Nothing is carried in past the left or right edge.
+        const word_type left = (here << 1u) | (word > 0 ? outside(inside, word - 1) >> (word_bits - 1) : 0);
+        const word_type right = (here >> 1u) | (word + 1 < words_per_row ? outside(inside, word + 1) << (word_bits - 1) : 0);
+        const word_type up = above ? outside(above, word) : 0;
+        const word_type down = below ? outside(below, word) : 0;
+        out[word] = inside[word] & (left | right | up | down);
+    }
+}
+
+cpu_bitmask cpu_bitmask::boundary() const {
+    cpu_bitmask edge (width, height, uninitialised);
+    for (size_t y = 0; y < height; y++)
+    {
+        boundary_row(y, edge.row(y));
+    }
+    return edge;
+}
+
+cpu_texture<float> cpu_bitmask::to_texture() const {
+    cpu_texture<float> texture (width, height);
+    for (size_t y = 0; y < height; y++)
+    {
+        for_each_set(y, [&](size_t x) { texture.at(x, y) = 1.0f; });
+    }
+    return texture;
+}
@@ -0,0 +1,127 @@
+#ifndef IMG2SDF_CPU_BITMASK_H
+#define IMG2SDF_CPU_BITMASK_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "cpu_texture.h"
+#include "shader_globals.h"
+
+///A binary mask packed at one bit per texel, a 32nd of the size of a cpu_texture<float> mask: 512 MiB rather than
+///16 GiB at 65536x65536. Rows are padded to whole 64 bit words, with texel x in bit x % 64 of word x / 64, and the
+///padding bits are always clear, so rows can be counted, inverted and shifted a word at a time without minding the
+///width.
+struct cpu_bitmask
+{
+    using word_type = uint64_t;
+    static constexpr size_t word_bits = 64;
+
+    size_t width = 0;
+    size_t height = 0;
+    size_t words_per_row = 0;
+    std::vector<word_type, default_init_allocator<word_type>> data;
+
+    cpu_bitmask() = default;
+
+    ///A mask of `width` x `height` texels, all clear.
+    cpu_bitmask(size_t width, size_t height) :
+    width(width), height(height), words_per_row((width + word_bits - 1) / word_bits), data(words_per_row * height, 0) {}
+
+    ///Allocates without writing any word, so the mask can be first touched band by band. Every row must then be
+    ///written in full, padding included.
+    cpu_bitmask(size_t width, size_t height, uninitialised_t) :
+    width(width), height(height), words_per_row((width + word_bits - 1) / word_bits), data(words_per_row * height) {}
+
+    ///Packs the texels of `mask` greater than `threshold`, as the cpu_texture<float> overloads of Img2SDF read a mask.
+    explicit cpu_bitmask(const cpu_texture<float>& mask, float threshold = 0.0f);
+
+    word_type* row(size_t y) { return data.data() + y * words_per_row; }
+    const word_type* row(size_t y) const { return data.data() + y * words_per_row; }
+
+    [[nodiscard]] static bool test(const word_type* row, size_t x) { return (row[x / word_bits] >> (x % word_bits)) & 1u; }
+
+    [[nodiscard]] bool at(size_t x, size_t y) const { return test(row(y), x); }
+
+    void set(size_t x, size_t y, bool value)
+    {
+        const word_type bit = word_type {1} << (x % word_bits);
+        word_type& word = row(y)[x / word_bits];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    ///The bits of the last word of each row that hold texels rather than padding.
+    [[nodiscard]] word_type last_word_mask() const
+    {
+        const size_t used = width % word_bits;
+        return used == 0 ? ~word_type {0} : (word_type {1} << used) - 1;
+    }
+
+    [[nodiscard]] resolution get_resolution() const { return {width, height}; }
+
+    ///Writes row `y` from `texels`, setting the texels for which `is_set` holds.
+    template <typename texel_type, typename predicate_type>
+    void pack_row(size_t y, const texel_type* texels, predicate_type&& is_set)
+    {
+        word_type* words = row(y);
+        for (size_t word = 0; word < words_per_row; word++)
+        {
+            const size_t first = word * word_bits;
+            const size_t count = std::min(word_bits, width - first);
+            word_type bits = 0;
+            for (size_t bit = 0; bit < count; bit++)
+            {
+                bits |= static_cast<word_type>(is_set(texels[first + bit]) ? 1u : 0u) << bit;
+            }
+            words[word] = bits;
+        }
+    }
+
+    ///Calls `visit(x)` for each set bit of `words`, in order, skipping from one to the next by counting trailing
+    ///zeros, so sparse rows cost a step per word rather than per texel.
+    template <typename visitor_type>
+    static void for_each_set(const word_type* words, size_t num_words, visitor_type&& visit)
+    {
+        for (size_t word = 0; word < num_words; word++)
+        {
+            for (word_type bits = words[word]; bits != 0; bits &= bits - 1)
+            {
+                visit(word * word_bits + static_cast<size_t>(std::countr_zero(bits)));
+            }
+        }
+    }
+
+    ///Calls `visit(x)` for each set texel of row `y`, left to right.
+    template <typename visitor_type>
+    void for_each_set(size_t y, visitor_type&& visit) const
+    {
+        for_each_set(row(y), words_per_row, std::forward<visitor_type>(visit));
+    }
+
+    ///The number of set texels of rows [begin, end), by population count of whole words.
+    [[nodiscard]] size_t count_rows(size_t begin, size_t end) const;
+
+    ///The number of set texels.
+    [[nodiscard]] size_t count() const { return count_rows(0, height); }
+
+    ///Inverts rows [begin, end) in place, a word at a time, leaving the padding clear.
+    void invert_rows(size_t begin, size_t end);
+
+    ///The complement of this mask, e.g. the outside of a signed field.
+    [[nodiscard]] cpu_bitmask inverted() const;
+
+    ///Writes the set texels of row `y` with a clear 4-neighbour to `out`, `words_per_row` words: the inside boundary a
+    ///signed field is flooded from (boundary.hlsl). Texels past the edge are neither set nor clear. Each neighbour is
+    ///a shifted copy of a row, so the boundary costs a few word operations per 64 texels.
+    void boundary_row(size_t y, word_type* out) const;
+
+    ///The inside boundary of the whole mask; see boundary_row.
+    [[nodiscard]] cpu_bitmask boundary() const;
+
+    ///Expands the mask to 1s and 0s.
+    [[nodiscard]] cpu_texture<float> to_texture() const;
+};
+
+#endif //IMG2SDF_CPU_BITMASK_H
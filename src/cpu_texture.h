@@ -0,0 +1,76 @@
+#ifndef IMG2SDF_CPU_TEXTURE_H
+#define IMG2SDF_CPU_TEXTURE_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "shader_globals.h"
+
+///Allocator that default- rather than value-initialises, so sizing a vector of trivial texels leaves the memory
+///untouched. The OS then places each page on the NUMA node of the thread that first writes it, rather than the one
+///that allocated it.
+template <typename value_type>
+struct default_init_allocator : std::allocator<value_type>
+{
+    template <typename other_type>
+    struct rebind
+    {
+        using other = default_init_allocator<other_type>;
+    };
+
+    default_init_allocator() = default;
+
+    template <typename other_type>
+    default_init_allocator(const default_init_allocator<other_type>&) noexcept {}
+
+    template <typename element_type>
+    void construct(element_type* element)
+    {
+        ::new (static_cast<void*>(element)) element_type;
+    }
+
+    template <typename element_type, typename... args_type>
+    void construct(element_type* element, args_type&&... args)
+    {
+        std::allocator_traits<std::allocator<value_type>>::construct(*this, element, std::forward<args_type>(args)...);
+    }
+};
+
+///Tag for the cpu_texture constructor that leaves texels uninitialised.
+struct uninitialised_t {};
+constexpr uninitialised_t uninitialised {};
+
+///Host-side stand-in for an ID3D11Texture2D, used by the CPU pipeline.
+///Data is row-major and tightly packed, i.e. the row pitch is always `width` elements.
+template <typename format_type>
+struct cpu_texture
+{
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<format_type, default_init_allocator<format_type>> data;
+
+    cpu_texture() = default;
+
+    cpu_texture(size_t width, size_t height, format_type init = format_type {}) :
+    width(width), height(height), data(width * height, init) {}
+
+    ///Allocates without writing any texel (for trivial formats), so the texture can be first touched band by band on
+    ///the threads that will work on it.
+    cpu_texture(size_t width, size_t height, uninitialised_t) :
+    width(width), height(height), data(width * height) {}
+
+    cpu_texture(const std::vector<format_type>& data, size_t width, size_t height) :
+    width(width), height(height), data(data.begin(), data.end()) {}
+
+    format_type& at(size_t x, size_t y) { return data[y * width + x]; }
+    const format_type& at(size_t x, size_t y) const { return data[y * width + x]; }
+
+    format_type* row(size_t y) { return data.data() + y * width; }
+    const format_type* row(size_t y) const { return data.data() + y * width; }
+
+    [[nodiscard]] resolution get_resolution() const { return {width, height}; }
+};
+
+#endif //IMG2SDF_CPU_TEXTURE_H
@@ -0,0 +1,924 @@
+#include "cpuimage.h"
+#include "cpupng.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#ifdef IMG2SDF_HAS_PNG
+#include <csetjmp>
+#include <png.h>
+#endif
+
+#ifdef IMG2SDF_HAS_TIFF
+#include <tiffio.h>
+#endif
+
+#ifdef IMG2SDF_HAS_EXR
+#include <ImathBox.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfInputFile.h>
+#endif
+
+namespace cpuimage
+{
+    enum class SAMPLE_TYPE
+    {
+        ///1 bit samples, packed most significant bit first.
+        BIT,
+        UINT8,
+        UINT16,
+        UINT32,
+        FLOAT32,
+    };
+
+    ///Decodes the rows of one image in order. Rows are returned in the decoder's own buffer, as `samples_per_texel`
+    ///interleaved samples of `sample_type` in native byte order, and the mask is the first sample of each texel.
+    class image_decoder
+    {
+    public:
+        virtual ~image_decoder() = default;
+
+        ///Decodes row `y`, which is always the row after the last one decoded.
+        virtual const uint8_t* decode_row(size_t y) = 0;
+
+        size_t width = 0;
+        size_t height = 0;
+        SAMPLE_TYPE sample_type = SAMPLE_TYPE::UINT8;
+        size_t samples_per_texel = 1;
+        ///samples count down from white, as in TIFFs with PHOTOMETRIC_MINISWHITE.
+        bool min_is_white = false;
+    };
+
+    ///Encodes the rows of one image in order, each `width` texels in host byte order with no padding.
+    class image_encoder
+    {
+    public:
+        virtual ~image_encoder() = default;
+
+        ///Encodes the next `count` rows. The rows may be modified in place, e.g. by a predictor.
+        virtual void encode_rows(uint8_t* rows, size_t count) = 0;
+
+        ///Completes the file, once every row has been encoded.
+        virtual void finish() = 0;
+    };
+}
+
+namespace {
+    using cpuimage::IMAGE_FORMAT;
+    using cpuimage::SAMPLE_TYPE;
+
+#ifdef IMG2SDF_HAS_PNG
+    class png_decoder final : public cpuimage::image_decoder
+    {
+    public:
+        explicit png_decoder(const std::string& path) : path(path)
+        {
+            file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr)
+            {
+                throw std::runtime_error("Could not open " + path + " for reading.");
+            }
+
+            png = png_create_read_struct(PNG_LIBPNG_VER_STRING, this, on_error, on_warning);
+            info = png ? png_create_info_struct(png) : nullptr;
+            if (info == nullptr)
+            {
+                close();
+                throw std::runtime_error("Could not create a PNG decoder for " + path);
+            }
+
+            if (!read_header())
+            {
+                const std::string message = error;
+                close();
+                throw std::runtime_error("Could not decode " + path + ": " + message);
+            }
+
+            if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE)
+            {
+                close();
+                throw std::runtime_error(path + " is interlaced, so cannot be decoded a row at a time.");
+            }
+
+            width = png_get_image_width(png, info);
+            height = png_get_image_height(png, info);
+            sample_type = png_get_bit_depth(png, info) == 16 ? SAMPLE_TYPE::UINT16 : SAMPLE_TYPE::UINT8;
+            samples_per_texel = png_get_channels(png, info);
+            row.resize(png_get_rowbytes(png, info));
+        }
+
+        ~png_decoder() override { close(); }
+
+        png_decoder(const png_decoder&) = delete;
+        png_decoder& operator=(const png_decoder&) = delete;
+
+        const uint8_t* decode_row(size_t) override
+        {
+            if (!read_row())
+            {
+                throw std::runtime_error("Could not decode " + path + ": " + error);
+            }
+            return row.data();
+        }
+
+    private:
+        //libpng reports errors by longjmp-ing back to the setjmp of the call that failed, so each call into it goes
+        //through one of these, whose frames hold nothing that needs destroying.
+        bool read_header()
+        {
+            if (setjmp(png_jmpbuf(png)))
+            {
+                return false;
+            }
+
+            png_init_io(png, file);
+            png_read_info(png, info);
+
+            //palette and low bit depth images are expanded to 8 bits per sample, and 16 bit samples read in native
+            //byte order, so every PNG reaches the threshold as plain 8 or 16 bit samples.
+            png_set_expand(png);
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                png_set_swap(png);
+            }
+            png_read_update_info(png, info);
+            return true;
+        }
+
+        bool read_row()
+        {
+            if (setjmp(png_jmpbuf(png)))
+            {
+                return false;
+            }
+
+            png_read_row(png, row.data(), nullptr);
+            return true;
+        }
+
+        void close()
+        {
+            if (png != nullptr)
+            {
+                png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+            }
+            if (file != nullptr)
+            {
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+
+        static void on_error(png_structp png, png_const_charp message)
+        {
+            auto* decoder = static_cast<png_decoder*>(png_get_error_ptr(png));
+            std::snprintf(decoder->error, sizeof(decoder->error), "%s", message);
+            png_longjmp(png, 1);
+        }
+
+        static void on_warning(png_structp, png_const_charp) {}
+
+        std::string path;
+        std::FILE* file = nullptr;
+        png_structp png = nullptr;
+        png_infop info = nullptr;
+        std::vector<uint8_t> row;
+        //a plain array, as it is written right before a longjmp.
+        char error[256] = {};
+    };
+#endif
+
+#ifdef IMG2SDF_HAS_TIFF
+    class tiff_decoder final : public cpuimage::image_decoder
+    {
+    public:
+        explicit tiff_decoder(const std::string& path) : path(path)
+        {
+            tiff = TIFFOpen(path.c_str(), "r");
+            if (tiff == nullptr)
+            {
+                throw std::runtime_error("Could not open " + path + " for reading.");
+            }
+
+            try
+            {
+                read_header();
+            }
+            catch (...)
+            {
+                TIFFClose(tiff);
+                throw;
+            }
+        }
+
+        ~tiff_decoder() override { TIFFClose(tiff); }
+
+        tiff_decoder(const tiff_decoder&) = delete;
+        tiff_decoder& operator=(const tiff_decoder&) = delete;
+
+        const uint8_t* decode_row(size_t y) override
+        {
+            //with separate planes, sample 0 is the mask channel.
+            if (TIFFReadScanline(tiff, row.data(), static_cast<uint32_t>(y), 0) < 0)
+            {
+                throw std::runtime_error("Could not decode row " + std::to_string(y) + " of " + path);
+            }
+            return row.data();
+        }
+
+    private:
+        void read_header()
+        {
+            if (TIFFIsTiled(tiff))
+            {
+                throw std::runtime_error(path + " is tiled, so cannot be decoded a row at a time.");
+            }
+
+            uint32_t image_width = 0;
+            uint32_t image_height = 0;
+            uint16_t bits_per_sample = 1;
+            uint16_t sample_format = SAMPLEFORMAT_UINT;
+            uint16_t samples = 1;
+            uint16_t planar_config = PLANARCONFIG_CONTIG;
+            uint16_t photometric = PHOTOMETRIC_MINISBLACK;
+            TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &image_width);
+            TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &image_height);
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sample_format);
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar_config);
+            TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric);
+
+            if (photometric == PHOTOMETRIC_PALETTE)
+            {
+                throw std::runtime_error(path + " is a palette TIFF, which is not supported.");
+            }
+
+            if (sample_format == SAMPLEFORMAT_IEEEFP && bits_per_sample == 32)
+            {
+                sample_type = SAMPLE_TYPE::FLOAT32;
+            }
+            else if (sample_format == SAMPLEFORMAT_UINT && bits_per_sample == 1)
+            {
+                sample_type = SAMPLE_TYPE::BIT;
+            }
+            else if (sample_format == SAMPLEFORMAT_UINT && bits_per_sample == 8)
+            {
+                sample_type = SAMPLE_TYPE::UINT8;
+            }
+            else if (sample_format == SAMPLEFORMAT_UINT && bits_per_sample == 16)
+            {
+                sample_type = SAMPLE_TYPE::UINT16;
+            }
+            else if (sample_format == SAMPLEFORMAT_UINT && bits_per_sample == 32)
+            {
+                sample_type = SAMPLE_TYPE::UINT32;
+            }
+            else
+            {
+                throw std::runtime_error(path + " has " + std::to_string(bits_per_sample) + " bit samples of a format "
+                                                "that is not supported.");
+            }
+
+            width = image_width;
+            height = image_height;
+            samples_per_texel = planar_config == PLANARCONFIG_SEPARATE ? 1 : samples;
+            min_is_white = photometric == PHOTOMETRIC_MINISWHITE;
+            row.resize(static_cast<size_t>(TIFFScanlineSize64(tiff)));
+        }
+
+        std::string path;
+        TIFF* tiff = nullptr;
+        std::vector<uint8_t> row;
+    };
+#endif
+
+#ifdef IMG2SDF_HAS_EXR
+    class exr_decoder final : public cpuimage::image_decoder
+    {
+    public:
+        explicit exr_decoder(const std::string& path) : path(path)
+        {
+            try
+            {
+                file = std::make_unique<Imf::InputFile>(path.c_str());
+
+                const Imath::Box2i window = file->header().dataWindow();
+                width = static_cast<size_t>(window.max.x - window.min.x + 1);
+                height = static_cast<size_t>(window.max.y - window.min.y + 1);
+                first_y = window.min.y;
+                sample_type = SAMPLE_TYPE::FLOAT32;
+
+                const Imf::ChannelList& channels = file->header().channels();
+                const char* name = channels.findChannel("Y") ? "Y" : channels.findChannel("R") ? "R" : nullptr;
+                if (name == nullptr)
+                {
+                    if (channels.begin() == channels.end())
+                    {
+                        throw std::runtime_error("it has no channels");
+                    }
+                    name = channels.begin().name();
+                }
+                if (channels[name].xSampling != 1 || channels[name].ySampling != 1)
+                {
+                    throw std::runtime_error(std::string {"channel "} + name + " is subsampled");
+                }
+
+                //a y stride of 0 maps every row of the data window onto the one row buffer.
+                row.resize(width);
+                Imf::FrameBuffer frame_buffer;
+                frame_buffer.insert(name, Imf::Slice(Imf::FLOAT, reinterpret_cast<char*>(row.data()) -
+                                                     static_cast<ptrdiff_t>(window.min.x) * static_cast<ptrdiff_t>(sizeof(float)),
+                                                     sizeof(float), 0));
+                file->setFrameBuffer(frame_buffer);
+            }
+            catch (const std::exception& exception)
+            {
+                throw std::runtime_error("Could not decode " + path + ": " + exception.what());
+            }
+        }
+
+        const uint8_t* decode_row(size_t y) override
+        {
+            try
+            {
+                file->readPixels(first_y + static_cast<int>(y));
+            }
+            catch (const std::exception& exception)
+            {
+                throw std::runtime_error("Could not decode " + path + ": " + exception.what());
+            }
+            return reinterpret_cast<const uint8_t*>(row.data());
+        }
+
+    private:
+        std::string path;
+        std::unique_ptr<Imf::InputFile> file;
+        int first_y = 0;
+        std::vector<float> row;
+    };
+#endif
+
+    ///Writes whether each texel of a decoded row is inside the mask.
+    template <typename sample_type, typename out_type>
+    void threshold_samples(const uint8_t* row, size_t width, size_t stride, bool min_is_white, float threshold,
+                           out_type* inside)
+    {
+        if constexpr (std::is_floating_point_v<sample_type>)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                sample_type sample;
+                std::memcpy(&sample, row + x * stride * sizeof(sample_type), sizeof(sample_type));
+                inside[x] = static_cast<out_type>(sample > threshold);
+            }
+        }
+        else
+        {
+            //an integer v is above threshold * max exactly when it is above its floor, so the row compares integers.
+            constexpr auto max_sample = static_cast<double>(std::numeric_limits<sample_type>::max());
+            const auto limit = static_cast<int64_t>(std::floor(std::clamp<double>(threshold, -1.0, 2.0) * max_sample));
+            for (size_t x = 0; x < width; x++)
+            {
+                sample_type sample;
+                std::memcpy(&sample, row + x * stride * sizeof(sample_type), sizeof(sample_type));
+                const auto value = static_cast<int64_t>(min_is_white ? std::numeric_limits<sample_type>::max() - sample : sample);
+                inside[x] = static_cast<out_type>(value > limit);
+            }
+        }
+    }
+
+    template <typename out_type>
+    void threshold_row(const cpuimage::image_decoder& decoder, const uint8_t* row, float threshold, out_type* inside)
+    {
+        const size_t width = decoder.width;
+        const size_t stride = decoder.samples_per_texel;
+        switch (decoder.sample_type)
+        {
+            case SAMPLE_TYPE::BIT:
+                for (size_t x = 0; x < width; x++)
+                {
+                    const size_t bit = x * stride;
+                    const bool set = ((row[bit >> 3u] >> (7u - (bit & 7u))) & 1u) != 0;
+                    inside[x] = static_cast<out_type>(static_cast<float>(set != decoder.min_is_white) > threshold);
+                }
+                break;
+            case SAMPLE_TYPE::UINT8:
+                threshold_samples<uint8_t>(row, width, stride, decoder.min_is_white, threshold, inside);
+                break;
+            case SAMPLE_TYPE::UINT16:
+                threshold_samples<uint16_t>(row, width, stride, decoder.min_is_white, threshold, inside);
+                break;
+            case SAMPLE_TYPE::UINT32:
+                threshold_samples<uint32_t>(row, width, stride, decoder.min_is_white, threshold, inside);
+                break;
+            case SAMPLE_TYPE::FLOAT32:
+                threshold_samples<float>(row, width, stride, decoder.min_is_white, threshold, inside);
+                break;
+        }
+    }
+
+    std::unique_ptr<cpuimage::image_decoder> open_decoder(const std::string& path, IMAGE_FORMAT format)
+    {
+        switch (format)
+        {
+#ifdef IMG2SDF_HAS_PNG
+            case IMAGE_FORMAT::PNG:
+                return std::make_unique<png_decoder>(path);
+#endif
+#ifdef IMG2SDF_HAS_TIFF
+            case IMAGE_FORMAT::TIFF:
+                return std::make_unique<tiff_decoder>(path);
+#endif
+#ifdef IMG2SDF_HAS_EXR
+            case IMAGE_FORMAT::EXR:
+                return std::make_unique<exr_decoder>(path);
+#endif
+            default:
+                throw std::runtime_error(path + " is a " + cpuimage::format_name(format) +
+                                         ", which img2sdf was built without support for.");
+        }
+    }
+
+    ///Headerless rows in host byte order.
+    class raw_encoder final : public cpuimage::image_encoder
+    {
+    public:
+        explicit raw_encoder(const std::string& path, size_t row_bytes) : path(path), row_bytes(row_bytes)
+        {
+            stream.open(path, std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                throw std::runtime_error("Could not open " + path + " for writing.");
+            }
+        }
+
+        void encode_rows(uint8_t* rows, size_t count) override
+        {
+            stream.write(reinterpret_cast<const char*>(rows), static_cast<std::streamsize>(count * row_bytes));
+            if (!stream)
+            {
+                throw std::runtime_error("Could not write to " + path);
+            }
+        }
+
+        void finish() override
+        {
+            stream.close();
+            if (!stream)
+            {
+                throw std::runtime_error("Could not write to " + path);
+            }
+        }
+
+    private:
+        std::string path;
+        size_t row_bytes = 0;
+        std::ofstream stream;
+    };
+
+#ifdef IMG2SDF_HAS_ZLIB
+    ///Single channel grey, 8 or 16 bit, deflated a batch of chunks at a time across the pool by cpupng.
+    class png_encoder final : public cpuimage::image_encoder
+    {
+    public:
+        png_encoder(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format, CPUThreadPool* pool) :
+        writer(path, width, height, format, options_for(pool)) {}
+
+        void encode_rows(uint8_t* rows, size_t count) override { writer.write_rows(rows, count); }
+
+        void finish() override { writer.finish(); }
+
+    private:
+        static cpupng::encoder_options options_for(CPUThreadPool* pool)
+        {
+            cpupng::encoder_options options;
+            options.pool = pool;
+            if (pool != nullptr)
+            {
+                options.num_threads = pool->get_num_threads();
+            }
+            return options;
+        }
+
+        cpupng::parallel_writer writer;
+    };
+#endif
+
+#ifdef IMG2SDF_HAS_TIFF
+    ///Single channel, stripped and deflated. Unorm fields are stored as unsigned integers and float fields as IEEE
+    ///floats, each with the predictor that differences neighbouring texels first, so smooth fields compress well.
+    class tiff_encoder final : public cpuimage::image_encoder
+    {
+    public:
+        tiff_encoder(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format) :
+        path(path), row_bytes(width * bytes_per_texel(format))
+        {
+            //classic TIFF offsets are 32 bit, so larger fields are written as BigTIFF.
+            const bool big = row_bytes * height > (uint64_t {1} << 31u);
+            tiff = TIFFOpen(path.c_str(), big ? "w8" : "w");
+            if (tiff == nullptr)
+            {
+                throw std::runtime_error("Could not open " + path + " for writing.");
+            }
+
+            const bool is_float = format == OUTPUT_FORMAT::FLOAT32 || format == OUTPUT_FORMAT::FLOAT16;
+            TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(width));
+            TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(height));
+            TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+            TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, static_cast<int>(bytes_per_texel(format) * 8));
+            TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, is_float ? SAMPLEFORMAT_IEEEFP : SAMPLEFORMAT_UINT);
+            TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+            TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+            TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+            TIFFSetField(tiff, TIFFTAG_PREDICTOR, is_float ? PREDICTOR_FLOATINGPOINT : PREDICTOR_HORIZONTAL);
+            TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tiff, 0));
+        }
+
+        ~tiff_encoder() override
+        {
+            if (tiff != nullptr)
+            {
+                TIFFClose(tiff);
+            }
+        }
+
+        tiff_encoder(const tiff_encoder&) = delete;
+        tiff_encoder& operator=(const tiff_encoder&) = delete;
+
+        void encode_rows(uint8_t* rows, size_t count) override
+        {
+            //the predictor differences rows in place, which the queued copy allows.
+            for (size_t row = 0; row < count; row++, next_row++)
+            {
+                if (TIFFWriteScanline(tiff, rows + row * row_bytes, static_cast<uint32_t>(next_row), 0) < 0)
+                {
+                    throw std::runtime_error("Could not encode row " + std::to_string(next_row) + " of " + path);
+                }
+            }
+        }
+
+        void finish() override
+        {
+            const bool flushed = TIFFFlush(tiff) == 1;
+            TIFFClose(tiff);
+            tiff = nullptr;
+            if (!flushed)
+            {
+                throw std::runtime_error("Could not write to " + path);
+            }
+        }
+
+    private:
+        std::string path;
+        size_t row_bytes = 0;
+        size_t next_row = 0;
+        TIFF* tiff = nullptr;
+    };
+#endif
+
+    std::unique_ptr<cpuimage::image_encoder> open_encoder(const std::string& path, size_t width, size_t height,
+                                                          OUTPUT_FORMAT format, CPUThreadPool* pool)
+    {
+        const auto image_format = cpuimage::format_from_extension(path);
+        if (!image_format)
+        {
+            return std::make_unique<raw_encoder>(path, width * bytes_per_texel(format));
+        }
+        if (!cpuimage::can_write(*image_format, format))
+        {
+            if (*image_format == IMAGE_FORMAT::PNG && cpupng::is_available())
+            {
+                throw std::runtime_error(path + ": PNG outputs hold unorm8 or unorm16 fields only.");
+            }
+            throw std::runtime_error(path + ": img2sdf cannot write a " + cpuimage::format_name(*image_format) +
+                                     ", as it only reads them or was built without them.");
+        }
+
+        switch (*image_format)
+        {
+#ifdef IMG2SDF_HAS_ZLIB
+            case IMAGE_FORMAT::PNG:
+                return std::make_unique<png_encoder>(path, width, height, format, pool);
+#endif
+#ifdef IMG2SDF_HAS_TIFF
+            case IMAGE_FORMAT::TIFF:
+                return std::make_unique<tiff_encoder>(path, width, height, format);
+#endif
+            default:
+                throw std::runtime_error(path + ": img2sdf cannot write a " + cpuimage::format_name(*image_format) + ".");
+        }
+    }
+}
+
+bool cpuimage::is_supported(IMAGE_FORMAT format) {
+    switch (format)
+    {
+#ifdef IMG2SDF_HAS_PNG
+        case IMAGE_FORMAT::PNG: return true;
+#endif
+#ifdef IMG2SDF_HAS_TIFF
+        case IMAGE_FORMAT::TIFF: return true;
+#endif
+#ifdef IMG2SDF_HAS_EXR
+        case IMAGE_FORMAT::EXR: return true;
+#endif
+        default: return false;
+    }
+}
+
+const char* cpuimage::format_name(IMAGE_FORMAT format) {
+    switch (format)
+    {
+        case IMAGE_FORMAT::PNG: return "PNG";
+        case IMAGE_FORMAT::TIFF: return "TIFF";
+        case IMAGE_FORMAT::EXR: return "EXR";
+        default: return "unknown format";
+    }
+}
+
+std::optional<cpuimage::IMAGE_FORMAT> cpuimage::format_from_extension(const std::string& path) {
+    auto extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".png") { return IMAGE_FORMAT::PNG; }
+    if (extension == ".tif" || extension == ".tiff") { return IMAGE_FORMAT::TIFF; }
+    if (extension == ".exr") { return IMAGE_FORMAT::EXR; }
+    return std::nullopt;
+}
+
+bool cpuimage::can_write(IMAGE_FORMAT format, OUTPUT_FORMAT texel_format) {
+    switch (format)
+    {
+        case IMAGE_FORMAT::PNG:
+            return cpupng::is_available() &&
+                   (texel_format == OUTPUT_FORMAT::UNORM8 || texel_format == OUTPUT_FORMAT::UNORM16);
+        case IMAGE_FORMAT::TIFF:
+            return is_supported(format);
+        default:
+            return false;
+    }
+}
+
+cpuimage::IMAGE_FORMAT cpuimage::detect_format(const std::string& path) {
+    std::ifstream stream (path, std::ios::binary);
+    if (!stream)
+    {
+        throw std::runtime_error("Could not open " + path + " for reading.");
+    }
+
+    std::array<uint8_t, 8> signature {};
+    stream.read(reinterpret_cast<char*>(signature.data()), signature.size());
+    const auto starts_with = [&](std::initializer_list<uint8_t> bytes) {
+        return static_cast<size_t>(stream.gcount()) >= bytes.size() && std::equal(bytes.begin(), bytes.end(), signature.begin());
+    };
+
+    if (starts_with({0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'}))
+    {
+        return IMAGE_FORMAT::PNG;
+    }
+    //little and big endian, classic and BigTIFF.
+    if (starts_with({'I', 'I', 42, 0}) || starts_with({'M', 'M', 0, 42}) ||
+        starts_with({'I', 'I', 43, 0}) || starts_with({'M', 'M', 0, 43}))
+    {
+        return IMAGE_FORMAT::TIFF;
+    }
+    if (starts_with({0x76, 0x2f, 0x31, 0x01}))
+    {
+        return IMAGE_FORMAT::EXR;
+    }
+    throw std::runtime_error(path + " is not a PNG, TIFF or EXR image.");
+}
+
+cpuimage::mask_reader::mask_reader(const std::string& path, float threshold) :
+format(detect_format(path)), threshold(threshold) {
+    decoder = open_decoder(path, format);
+}
+
+cpuimage::mask_reader::~mask_reader() = default;
+cpuimage::mask_reader::mask_reader(mask_reader&& other) noexcept = default;
+cpuimage::mask_reader& cpuimage::mask_reader::operator=(mask_reader&& other) noexcept = default;
+
+size_t cpuimage::mask_reader::get_width() const {
+    return decoder->width;
+}
+
+size_t cpuimage::mask_reader::get_height() const {
+    return decoder->height;
+}
+
+cpuimage::IMAGE_FORMAT cpuimage::mask_reader::get_format() const {
+    return format;
+}
+
+size_t cpuimage::mask_reader::get_next_row() const {
+    return next_row;
+}
+
+void cpuimage::mask_reader::read_row(uint8_t* inside) {
+    if (next_row >= decoder->height)
+    {
+        throw std::runtime_error("Every row of the mask has already been read.");
+    }
+    threshold_row(*decoder, decoder->decode_row(next_row), threshold, inside);
+    next_row++;
+}
+
+void cpuimage::mask_reader::read_row(float* inside) {
+    if (next_row >= decoder->height)
+    {
+        throw std::runtime_error("Every row of the mask has already been read.");
+    }
+    threshold_row(*decoder, decoder->decode_row(next_row), threshold, inside);
+    next_row++;
+}
+
+void cpuimage::mask_reader::read_row(cpu_bitmask::word_type* inside) {
+    packing_row.resize(decoder->width);
+    read_row(packing_row.data());
+
+    cpu_bitmask::word_type word = 0;
+    for (size_t x = 0; x < packing_row.size(); x++)
+    {
+        word |= static_cast<cpu_bitmask::word_type>(packing_row[x]) << (x % cpu_bitmask::word_bits);
+        if ((x + 1) % cpu_bitmask::word_bits == 0 || x + 1 == packing_row.size())
+        {
+            inside[x / cpu_bitmask::word_bits] = word;
+            word = 0;
+        }
+    }
+}
+
+cpuio::row_reader cpuimage::mask_reader::row_reader() {
+    return [this](size_t y, float* row) {
+        if (y != next_row)
+        {
+            throw std::runtime_error("Mask rows can only be read in order, expected row " + std::to_string(next_row) +
+                                     " but was asked for " + std::to_string(y) + ".");
+        }
+        read_row(row);
+    };
+}
+
+cpu_texture<float> cpuimage::load_mask(const std::string& path, float threshold) {
+    mask_reader reader {path, threshold};
+    cpu_texture<float> mask (reader.get_width(), reader.get_height());
+    for (size_t y = 0; y < mask.height; y++)
+    {
+        reader.read_row(mask.row(y));
+    }
+    return mask;
+}
+
+cpu_bitmask cpuimage::load_bitmask(const std::string& path, float threshold) {
+    mask_reader reader {path, threshold};
+    cpu_bitmask mask (reader.get_width(), reader.get_height(), uninitialised);
+    for (size_t y = 0; y < mask.height; y++)
+    {
+        reader.read_row(mask.row(y));
+    }
+    return mask;
+}
+
+cpuimage::image_writer::image_writer(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format,
+                                     size_t queue_depth, CPUThreadPool* pool) :
+path(path), width(width), height(height), format(format), row_bytes(width * bytes_per_texel(format)),
+queue_depth(std::max<size_t>(1, queue_depth)) {
+    encoder = open_encoder(path, width, height, format, pool);
+    thread = std::thread(&image_writer::encode_queued, this);
+}
+
+cpuimage::image_writer::~image_writer() {
+    {
+        std::lock_guard lock (queue_mutex);
+        queue.clear();
+        closing = true;
+    }
+    queue_changed.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void cpuimage::image_writer::write_band(size_t y, const encoded_view& band) {
+    if (y != next_row || band.height > height - next_row)
+    {
+        throw std::runtime_error("Bands of " + path + " must be written in order, expected row " +
+                                 std::to_string(next_row) + " but was given row " + std::to_string(y) + ".");
+    }
+    if (band.width != width || band.format != format || band.big_endian)
+    {
+        throw std::runtime_error("Bands of " + path + " must match its width and format, in host byte order.");
+    }
+
+    queued_band queued;
+    {
+        std::unique_lock lock (queue_mutex);
+        queue_changed.wait(lock, [this] { return queue.size() < queue_depth || error || closing; });
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if (closing)
+        {
+            throw std::runtime_error(path + " has already been finished.");
+        }
+        if (!spare.empty())
+        {
+            queued = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    //copied outside the lock, so the encoder keeps going meanwhile.
+    queued.rows.resize(band.height * row_bytes);
+    queued.count = band.height;
+    for (size_t row = 0; row < band.height; row++)
+    {
+        std::memcpy(queued.rows.data() + row * row_bytes, band.row(row), row_bytes);
+    }
+
+    {
+        std::lock_guard lock (queue_mutex);
+        queue.push_back(std::move(queued));
+    }
+    queue_changed.notify_all();
+    next_row += band.height;
+}
+
+cpuio::band_writer cpuimage::image_writer::band_writer() {
+    return [this](size_t y, const encoded_view& band) { write_band(y, band); };
+}
+
+void cpuimage::image_writer::finish() {
+    {
+        std::lock_guard lock (queue_mutex);
+        closing = true;
+    }
+    queue_changed.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (next_row != height)
+    {
+        throw std::runtime_error("Only " + std::to_string(next_row) + " of the " + std::to_string(height) +
+                                 " rows of " + path + " were written.");
+    }
+    if (encoder)
+    {
+        encoder->finish();
+        encoder.reset();
+    }
+}
+
+void cpuimage::image_writer::encode_queued() {
+    std::unique_lock lock (queue_mutex);
+    while (true)
+    {
+        queue_changed.wait(lock, [this] { return !queue.empty() || closing; });
+        if (queue.empty())
+        {
+            return;
+        }
+
+        queued_band band = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        try
+        {
+            encoder->encode_rows(band.rows.data(), band.count);
+        }
+        catch (...)
+        {
+            //the producer sees the error at its next band, and nothing more is encoded.
+            lock.lock();
+            error = std::current_exception();
+            queue.clear();
+            queue_changed.notify_all();
+            return;
+        }
+        lock.lock();
+        spare.push_back(std::move(band));
+        queue_changed.notify_all();
+    }
+}
@@ -0,0 +1,177 @@
+#ifndef IMG2SDF_CPUIMAGE_H
+#define IMG2SDF_CPUIMAGE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cpu_bitmask.h"
+#include "cpu_texture.h"
+#include "cpuio.h"
+#include "CPUThreadPool.h"
+#include "output_format.h"
+
+///Portable image I/O for the CPU pipeline. Masks are decoded a row at a time and each row is thresholded as it
+///arrives, so no full-size decoded or float copy of the image is ever held, and fields are encoded a band of rows at a
+///time as the final pass produces them. Each codec is only available if its
+///library was found at build time (IMG2SDF_HAS_PNG, IMG2SDF_HAS_TIFF, IMG2SDF_HAS_EXR).
+namespace cpuimage
+{
+    enum class IMAGE_FORMAT
+    {
+        ///8 or 16 bit grey, grey-alpha, RGB(A) or palette PNGs, through libpng. Interlaced PNGs are not supported.
+        PNG,
+        ///1, 8, 16 or 32 bit unsigned, or 32 bit float, stripped TIFFs through libtiff. Tiled TIFFs are not supported.
+        TIFF,
+        ///Scanline or tiled OpenEXR files, any pixel type.
+        EXR,
+    };
+
+    ///Whether `format` was compiled in.
+    [[nodiscard]] bool is_supported(IMAGE_FORMAT format);
+
+    [[nodiscard]] const char* format_name(IMAGE_FORMAT format);
+
+    ///The format the extension of `path` names (.png, .tif or .tiff, .exr), if any.
+    [[nodiscard]] std::optional<IMAGE_FORMAT> format_from_extension(const std::string& path);
+
+    ///Whether image_writer can store `texel_format` as `format`: PNG takes UNORM8 and UNORM16 (written by cpupng, so
+    ///with zlib rather than libpng), TIFF takes every OUTPUT_FORMAT, and EXR is only read. False if the codec was not
+    ///compiled in.
+    [[nodiscard]] bool can_write(IMAGE_FORMAT format, OUTPUT_FORMAT texel_format);
+
+    ///Identifies the image at `path` from its signature. Throws a std::runtime_error if it cannot be read, or is none
+    ///of the formats above.
+    [[nodiscard]] IMAGE_FORMAT detect_format(const std::string& path);
+
+    ///Decodes a single row of an image at a time; see mask_reader.
+    class image_decoder;
+
+    ///Reads an image as a mask, top to bottom. The mask is the first channel: grey, red, or the Y (else R) channel of
+    ///an EXR. Integer samples are normalised to 0 - 1, and texels greater than `threshold` are inside the mask, so the
+    ///default matches the texels greater than 0 of the cpu_texture<float> overloads of Img2SDF.
+    ///Only one decoded row is held at a time.
+    class mask_reader
+    {
+    public:
+        ///Opens the image at `path`. Throws a std::runtime_error if it cannot be read or its format is not supported.
+        explicit mask_reader(const std::string& path, float threshold = 0.0f);
+        ~mask_reader();
+
+        mask_reader(mask_reader&& other) noexcept;
+        mask_reader& operator=(mask_reader&& other) noexcept;
+
+        [[nodiscard]] size_t get_width() const;
+        [[nodiscard]] size_t get_height() const;
+        [[nodiscard]] IMAGE_FORMAT get_format() const;
+
+        ///The row the next read_row call decodes.
+        [[nodiscard]] size_t get_next_row() const;
+
+        ///Decodes the next row, writing 1 for each texel inside the mask and 0 for the others.
+        ///Throws a std::runtime_error past the last row, or if the image turns out to be corrupt.
+        void read_row(uint8_t* inside);
+
+        ///As above, writing 1.0f and 0.0f.
+        void read_row(float* inside);
+
+        ///As above, packing the row into the `words_per_row` words of a cpu_bitmask row.
+        void read_row(cpu_bitmask::word_type* inside);
+
+        ///Adapts the reader for Img2SDF::compute_streaming_distance_field, which then decodes rows on its reader
+        ///thread, overlapping decoding with the transform. Rows must be requested in order from the next one.
+        ///The returned reader must not outlive this object.
+        [[nodiscard]] cpuio::row_reader row_reader();
+
+    private:
+        std::unique_ptr<image_decoder> decoder;
+        IMAGE_FORMAT format;
+        float threshold = 0.0f;
+        size_t next_row = 0;
+        ///a thresholded row, for packing into a bitmask.
+        std::vector<uint8_t> packing_row;
+    };
+
+    ///Encodes a band of rows at a time; see image_writer.
+    class image_encoder;
+
+    ///Writes a field to a grey image as it is produced, a band of rows at a time, e.g. from the Img2SDF overloads
+    ///taking a cpuio::band_writer. Bands are copied into a short queue and compressed on a thread of the writer's own,
+    ///so encoding overlaps the quantising of the bands after them. Once `queue_depth` bands are waiting, write_band
+    ///blocks until the encoder catches up, so at most `queue_depth` + 1 bands of the output are ever held.
+    ///The container follows the extension of the path: PNG (8 or 16 bit grey, whose chunks of rows are also deflated
+    ///in parallel; see cpupng), TIFF (deflated, with a horizontal or floating point predictor, which suits smooth
+    ///fields), or anything else as headerless texels in host byte order, as the CLI writes its fields.
+    class image_writer
+    {
+    public:
+        ///Creates the file at `path` for `width` x `height` texels of `format`. Throws a std::runtime_error if it
+        ///cannot be created, or its container cannot hold `format` (see can_write).
+        ///@param pool the pool PNG chunks are deflated on, e.g. Img2SDF::get_thread_pool. CPUThreadPool::shared() if
+        ///null.
+        image_writer(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format, size_t queue_depth = 4,
+                     CPUThreadPool* pool = nullptr);
+
+        ///Stops the encoder, dropping any bands still queued. Without a call to finish the file is left incomplete.
+        ~image_writer();
+
+        image_writer(const image_writer&) = delete;
+        image_writer& operator=(const image_writer&) = delete;
+
+        ///Queues rows [y, y + band.height) for encoding. The rows are copied, so `band` may be reused as soon as this
+        ///returns. Bands must arrive in order, top to bottom, from one thread, in host byte order. Rethrows the error
+        ///of an encoder that has failed.
+        void write_band(size_t y, const encoded_view& band);
+
+        ///Adapts write_band for the Img2SDF overloads taking a cpuio::band_writer. Must not outlive this object.
+        [[nodiscard]] cpuio::band_writer band_writer();
+
+        ///Waits for the queued bands to be encoded, then completes the file. Throws a std::runtime_error if encoding
+        ///failed or not every row was written.
+        void finish();
+
+    private:
+        struct queued_band
+        {
+            std::vector<uint8_t, default_init_allocator<uint8_t>> rows;
+            size_t count = 0;
+        };
+
+        ///The encoder thread: encodes bands as they are queued until the writer closes and the queue is empty.
+        void encode_queued();
+
+        std::string path;
+        std::unique_ptr<image_encoder> encoder;
+        size_t width = 0;
+        size_t height = 0;
+        OUTPUT_FORMAT format = OUTPUT_FORMAT::FLOAT32;
+        size_t row_bytes = 0;
+        size_t queue_depth = 1;
+        size_t next_row = 0;
+
+        std::mutex queue_mutex;
+        std::condition_variable queue_changed;
+        std::deque<queued_band> queue;
+        ///buffers of bands already encoded, reused for the next ones.
+        std::vector<queued_band> spare;
+        bool closing = false;
+        std::exception_ptr error = nullptr;
+        std::thread thread;
+    };
+
+    ///Loads the mask at `path` as 1s and 0s for the in-memory overloads of Img2SDF, decoding straight into the
+    ///texture a row at a time. Throws as mask_reader does.
+    [[nodiscard]] cpu_texture<float> load_mask(const std::string& path, float threshold = 0.0f);
+
+    ///As above, packed at one bit per texel, for masks too large to hold as floats.
+    [[nodiscard]] cpu_bitmask load_bitmask(const std::string& path, float threshold = 0.0f);
+}
+
+#endif //IMG2SDF_CPUIMAGE_H
@@ -0,0 +1,114 @@
+#include "cpuio.h"
+#include <stdexcept>
+
+cpuio::region_reader cpuio::raw_region_reader(const std::string& path, size_t width, size_t height) {
+    std::ifstream probe (path, std::ios::binary | std::ios::ate);
+    if (!probe)
+    {
+        throw std::runtime_error("Could not open " + path + " for reading.");
+    }
+    if (static_cast<size_t>(probe.tellg()) < width * height * sizeof(float))
+    {
+        throw std::runtime_error(path + " is smaller than its width and height.");
+    }
+
+    return [path, width, height](size_t x, size_t y, cpu_texture<float>& region) {
+        if (x + region.width > width || y + region.height > height)
+        {
+            throw std::runtime_error("Region lies outside of " + path);
+        }
+
+        std::ifstream stream (path, std::ios::binary);
+        for (size_t row = 0; row < region.height; row++)
+        {
+            stream.seekg(static_cast<std::streamoff>(((y + row) * width + x) * sizeof(float)));
+            stream.read(reinterpret_cast<char*>(region.row(row)), static_cast<std::streamsize>(region.width * sizeof(float)));
+        }
+
+        if (!stream)
+        {
+            throw std::runtime_error("Could not read region from " + path);
+        }
+    };
+}
+
+cpuio::row_reader cpuio::raw_row_reader(const std::string& path, size_t width, size_t height) {
+    auto stream = std::make_shared<std::ifstream>(path, std::ios::binary | std::ios::ate);
+    if (!*stream)
+    {
+        throw std::runtime_error("Could not open " + path + " for reading.");
+    }
+    if (static_cast<size_t>(stream->tellg()) < width * height * sizeof(float))
+    {
+        throw std::runtime_error(path + " is smaller than its width and height.");
+    }
+    stream->seekg(0);
+
+    return [stream, path, width](size_t y, float* row) {
+        const auto offset = static_cast<std::streamoff>(y * width * sizeof(float));
+        if (stream->tellg() != offset)
+        {
+            stream->seekg(offset);
+        }
+
+        stream->read(reinterpret_cast<char*>(row), static_cast<std::streamsize>(width * sizeof(float)));
+        if (!*stream)
+        {
+            throw std::runtime_error("Could not read row " + std::to_string(y) + " from " + path);
+        }
+    };
+}
+
+cpuio::row_writer cpuio::raw_row_writer(const std::string& path, size_t width) {
+    auto stream = std::make_shared<std::ofstream>(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!*stream)
+    {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+
+    return [stream, path, width](size_t, const float* row) {
+        stream->write(reinterpret_cast<const char*>(row), static_cast<std::streamsize>(width * sizeof(float)));
+        if (!*stream)
+        {
+            throw std::runtime_error("Could not write to " + path);
+        }
+    };
+}
+
+cpuio::raw_region_file::raw_region_file(const std::string& path, size_t width, size_t height) :
+stream(path, std::ios::binary | std::ios::out | std::ios::trunc), width(width), height(height) {
+    if (!stream)
+    {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+
+    //size the file up front, so regions can be written in any order.
+    if (width * height > 0)
+    {
+        stream.seekp(static_cast<std::streamoff>(width * height * sizeof(float) - 1));
+        stream.put('\0');
+    }
+}
+
+void cpuio::raw_region_file::write(size_t x, size_t y, const cpu_texture<float>& region) {
+    if (x + region.width > width || y + region.height > height)
+    {
+        throw std::runtime_error("Region lies outside of the output file.");
+    }
+
+    std::lock_guard lock (stream_mutex);
+    for (size_t row = 0; row < region.height; row++)
+    {
+        stream.seekp(static_cast<std::streamoff>(((y + row) * width + x) * sizeof(float)));
+        stream.write(reinterpret_cast<const char*>(region.row(row)), static_cast<std::streamsize>(region.width * sizeof(float)));
+    }
+
+    if (!stream)
+    {
+        throw std::runtime_error("Could not write region to the output file.");
+    }
+}
+
+cpuio::region_writer cpuio::raw_region_file::writer() {
+    return [this](size_t x, size_t y, const cpu_texture<float>& region) { write(x, y, region); };
+}
@@ -0,0 +1,67 @@
+#ifndef IMG2SDF_CPUIO_H
+#define IMG2SDF_CPUIO_H
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "cpu_texture.h"
+#include "output_format.h"
+
+///File access for the CPU pipeline that never holds a whole image in memory, so masks larger than RAM can be
+///processed a region at a time.
+namespace cpuio
+{
+    ///Fills `region` with the texels of the source image starting at (x, y). `region` is already sized, and the
+    ///region always lies within the image. May be called from several threads at once.
+    using region_reader = std::function<void(size_t x, size_t y, cpu_texture<float>& region)>;
+
+    ///Receives a finished region of the output, whose top left texel sits at (x, y) in the full image.
+    ///May be called from several threads at once, with regions in any order.
+    using region_writer = std::function<void(size_t x, size_t y, const cpu_texture<float>& region)>;
+
+    ///Reads row `y` of the source image into `row`, which holds one row of texels. Rows are requested in order,
+    ///top to bottom, from a single thread.
+    using row_reader = std::function<void(size_t y, float* row)>;
+
+    ///Receives finished rows of the output in order, top to bottom, from a single thread.
+    using row_writer = std::function<void(size_t y, const float* row)>;
+
+    ///Receives the encoded output a band of rows at a time, in order, top to bottom, from a single thread: `band`
+    ///holds rows [y, y + band.height). The band is only valid for the call, so its rows must be consumed or copied.
+    using band_writer = std::function<void(size_t y, const encoded_view& band)>;
+
+    ///Reads rows of a headerless, row-major R32 float file of `width` x `height` texels, front to back.
+    row_reader raw_row_reader(const std::string& path, size_t width, size_t height);
+
+    ///Writes rows of `width` texels to a headerless, row-major R32 float file, front to back.
+    row_writer raw_row_writer(const std::string& path, size_t width);
+
+    ///Reads regions of a headerless, row-major R32 float file of `width` x `height` texels.
+    ///Each call opens its own stream, so concurrent reads need no locking.
+    region_reader raw_region_reader(const std::string& path, size_t width, size_t height);
+
+    ///Writes regions into a headerless, row-major R32 float file of `width` x `height` texels.
+    ///The file is created (or truncated) and sized up front, and regions are written into place as they arrive.
+    class raw_region_file
+    {
+    public:
+        raw_region_file(const std::string& path, size_t width, size_t height);
+
+        ///Writes `region` with its top left texel at (x, y). Thread safe.
+        void write(size_t x, size_t y, const cpu_texture<float>& region);
+
+        ///Returns a region_writer forwarding to `write`. Must not outlive this object.
+        region_writer writer();
+
+    private:
+        std::ofstream stream;
+        std::mutex stream_mutex;
+        size_t width = 0;
+        size_t height = 0;
+    };
+}
+
+#endif //IMG2SDF_CPUIO_H
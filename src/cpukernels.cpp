@@ -0,0 +1,491 @@
+#include "cpukernels.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMG2SDF_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMG2SDF_NEON 1
+#include <arm_neon.h>
+#endif
+
+//MSVC exposes every intrinsic everywhere; GCC and Clang need the target enabled per function.
+#if defined(__GNUC__) || defined(__clang__)
+#define IMG2SDF_TARGET(isa) __attribute__((target(isa)))
+#else
+#define IMG2SDF_TARGET(isa)
+#endif
+
+namespace {
+    using cpuutils::packed_seed;
+    using cpukernels::float_statistics;
+
+    ///jumpflood.hlsl: minimum_distance, over packed seeds. The squared distance is recomputed from the coordinates
+    ///rather than carried in the buffer, and is exact in integers.
+    inline void minimum_distance(int64_t x, int64_t y, packed_seed target_seed, packed_seed& min_distance_seed,
+                                 int64_t& min_distance)
+    {
+        if (target_seed != cpuutils::no_seed)
+        {
+            const int64_t dx = x - static_cast<int64_t>(cpuutils::seed_x(target_seed));
+            const int64_t dy = y - static_cast<int64_t>(cpuutils::seed_y(target_seed));
+            const int64_t distance = dx * dx + dy * dy;
+            if (distance < min_distance)
+            {
+                min_distance_seed = target_seed;
+                min_distance = distance;
+            }
+        }
+    }
+
+    ///texels [begin, end) of a span, one at a time. Also finishes the tail of the vector kernels.
+    inline void scalar_texels(const packed_seed* const candidates[9], packed_seed* out, const packed_seed* offsets,
+                              packed_seed origin, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const packed_seed texel = offsets[i] + origin;
+            const auto x = static_cast<int64_t>(cpuutils::seed_x(texel));
+            const auto y = static_cast<int64_t>(cpuutils::seed_y(texel));
+            packed_seed min_distance_seed = cpuutils::no_seed;
+            int64_t min_distance = std::numeric_limits<int64_t>::max();
+
+            for (int32_t candidate = 0; candidate < 9; candidate++)
+            {
+                //out of bounds reads of a UAV return 0, which jumpflood.hlsl treats as "no seed".
+                if (candidates[candidate] != nullptr)
+                {
+                    minimum_distance(x, y, candidates[candidate][i], min_distance_seed, min_distance);
+                }
+            }
+
+            //the centre sample is this texel's own seed, so no_seed here means no seed was in reach at all.
+            out[i] = min_distance_seed;
+        }
+    }
+
+    void jump_flood_span_scalar(const packed_seed* const candidates[9], packed_seed* out, const packed_seed* offsets,
+                                packed_seed origin, size_t count)
+    {
+        scalar_texels(candidates, out, offsets, origin, 0, count);
+    }
+
+    ///values [begin, end), one at a time. Also finishes the tail of the vector kernels.
+    inline void scalar_statistics(const float* values, size_t begin, size_t end, float& minimum, float& maximum,
+                                  double& sum)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const float value = values[i];
+            minimum = value < minimum ? value : minimum;
+            maximum = value > maximum ? value : maximum;
+            sum += value;
+        }
+    }
+
+    void statistics_span_scalar(const float* values, size_t count, float_statistics& statistics)
+    {
+        scalar_statistics(values, 0, count, statistics.minimum, statistics.maximum, statistics.sum);
+        statistics.count += count;
+    }
+
+#ifdef IMG2SDF_X86
+    IMG2SDF_TARGET("avx2")
+    void jump_flood_span_avx2(const packed_seed* const candidates[9], packed_seed* out, const packed_seed* offsets,
+                              packed_seed origin, size_t count)
+    {
+        constexpr size_t lanes = 8;
+        const __m256i coordinate_mask = _mm256_set1_epi32(0xFFFF);
+        const __m256i none = _mm256_set1_epi32(static_cast<int32_t>(cpuutils::no_seed));
+        const __m256i far = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+        const __m256i origin_lanes = _mm256_set1_epi32(static_cast<int32_t>(origin));
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const __m256i texel = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i)),
+                                                   origin_lanes);
+            const __m256i x_lanes = _mm256_and_si256(texel, coordinate_mask);
+            const __m256i y_lanes = _mm256_srli_epi32(texel, 16);
+            __m256i best_seed = none;
+            __m256i best_distance = far;
+
+            for (int32_t candidate = 0; candidate < 9; candidate++)
+            {
+                if (candidates[candidate] == nullptr)
+                {
+                    continue;
+                }
+
+                const __m256i seed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(candidates[candidate] + i));
+                const __m256i seed_dx = _mm256_sub_epi32(_mm256_and_si256(seed, coordinate_mask), x_lanes);
+                const __m256i seed_dy = _mm256_sub_epi32(_mm256_srli_epi32(seed, 16), y_lanes);
+                __m256i distance = _mm256_add_epi32(_mm256_mullo_epi32(seed_dx, seed_dx),
+                                                    _mm256_mullo_epi32(seed_dy, seed_dy));
+                //no_seed lanes overflow above, but are replaced before they are compared.
+                distance = _mm256_blendv_epi8(distance, far, _mm256_cmpeq_epi32(seed, none));
+
+                const __m256i nearer = _mm256_cmpgt_epi32(best_distance, distance);
+                best_distance = _mm256_blendv_epi8(best_distance, distance, nearer);
+                best_seed = _mm256_blendv_epi8(best_seed, seed, nearer);
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), best_seed);
+        }
+
+        scalar_texels(candidates, out, offsets, origin, i, count);
+    }
+
+    IMG2SDF_TARGET("avx512f")
+    void jump_flood_span_avx512(const packed_seed* const candidates[9], packed_seed* out, const packed_seed* offsets,
+                                packed_seed origin, size_t count)
+    {
+        constexpr size_t lanes = 16;
+        const __m512i coordinate_mask = _mm512_set1_epi32(0xFFFF);
+        const __m512i none = _mm512_set1_epi32(static_cast<int32_t>(cpuutils::no_seed));
+        const __m512i far = _mm512_set1_epi32(std::numeric_limits<int32_t>::max());
+        const __m512i origin_lanes = _mm512_set1_epi32(static_cast<int32_t>(origin));
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const __m512i texel = _mm512_add_epi32(_mm512_loadu_si512(offsets + i), origin_lanes);
+            const __m512i x_lanes = _mm512_and_si512(texel, coordinate_mask);
+            //the zero-masked shift over all lanes is the plain shift, without GCC's uninitialised operand.
+            const __m512i y_lanes = _mm512_maskz_srli_epi32(0xFFFF, texel, 16);
+            __m512i best_seed = none;
+            __m512i best_distance = far;
+
+            for (int32_t candidate = 0; candidate < 9; candidate++)
+            {
+                if (candidates[candidate] == nullptr)
+                {
+                    continue;
+                }
+
+                const __m512i seed = _mm512_loadu_si512(candidates[candidate] + i);
+                const __m512i seed_dx = _mm512_sub_epi32(_mm512_and_si512(seed, coordinate_mask), x_lanes);
+                const __m512i seed_dy = _mm512_sub_epi32(_mm512_maskz_srli_epi32(0xFFFF, seed, 16), y_lanes);
+                const __m512i distance = _mm512_add_epi32(_mm512_mullo_epi32(seed_dx, seed_dx),
+                                                          _mm512_mullo_epi32(seed_dy, seed_dy));
+
+                //only lanes holding a seed may win.
+                const __mmask16 valid = _mm512_cmpneq_epi32_mask(seed, none);
+                const __mmask16 nearer = _mm512_mask_cmplt_epi32_mask(valid, distance, best_distance);
+                best_distance = _mm512_mask_blend_epi32(nearer, best_distance, distance);
+                best_seed = _mm512_mask_blend_epi32(nearer, best_seed, seed);
+            }
+
+            _mm512_storeu_si512(out + i, best_seed);
+        }
+
+        scalar_texels(candidates, out, offsets, origin, i, count);
+    }
+
+    ///The min and max instructions return their second operand unless the first is strictly lower (or higher), so with
+    ///the value first and the accumulator second they skip NaNs exactly as scalar_statistics does. Two accumulators of
+    ///each kind hide the latency of the double adds.
+    IMG2SDF_TARGET("avx2")
+    void statistics_span_avx2(const float* values, size_t count, float_statistics& statistics)
+    {
+        constexpr size_t lanes = 8;
+        __m256 minimum[2] = {_mm256_set1_ps(statistics.minimum), _mm256_set1_ps(statistics.minimum)};
+        __m256 maximum[2] = {_mm256_set1_ps(statistics.maximum), _mm256_set1_ps(statistics.maximum)};
+        __m256d sum[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+
+        size_t i = 0;
+        for (; i + 2 * lanes <= count; i += 2 * lanes)
+        {
+            for (size_t half = 0; half < 2; half++)
+            {
+                const __m256 value = _mm256_loadu_ps(values + i + half * lanes);
+                minimum[half] = _mm256_min_ps(value, minimum[half]);
+                maximum[half] = _mm256_max_ps(value, maximum[half]);
+                sum[2 * half] = _mm256_add_pd(sum[2 * half], _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+                sum[2 * half + 1] = _mm256_add_pd(sum[2 * half + 1], _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+            }
+        }
+
+        alignas(32) float minimum_lanes[lanes];
+        alignas(32) float maximum_lanes[lanes];
+        alignas(32) double sum_lanes[lanes / 2];
+        _mm256_store_ps(minimum_lanes, _mm256_min_ps(minimum[0], minimum[1]));
+        _mm256_store_ps(maximum_lanes, _mm256_max_ps(maximum[0], maximum[1]));
+        _mm256_store_pd(sum_lanes, _mm256_add_pd(_mm256_add_pd(sum[0], sum[1]), _mm256_add_pd(sum[2], sum[3])));
+
+        double total = 0.0;
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            statistics.minimum = std::min(statistics.minimum, minimum_lanes[lane]);
+            statistics.maximum = std::max(statistics.maximum, maximum_lanes[lane]);
+        }
+        for (const double lane_sum : sum_lanes)
+        {
+            total += lane_sum;
+        }
+
+        scalar_statistics(values, i, count, statistics.minimum, statistics.maximum, total);
+        statistics.sum += total;
+        statistics.count += count;
+    }
+
+    IMG2SDF_TARGET("avx512f")
+    void statistics_span_avx512(const float* values, size_t count, float_statistics& statistics)
+    {
+        constexpr size_t lanes = 16;
+        __m512 minimum[2] = {_mm512_set1_ps(statistics.minimum), _mm512_set1_ps(statistics.minimum)};
+        __m512 maximum[2] = {_mm512_set1_ps(statistics.maximum), _mm512_set1_ps(statistics.maximum)};
+        __m512d sum[4] = {_mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd()};
+
+        size_t i = 0;
+        for (; i + 2 * lanes <= count; i += 2 * lanes)
+        {
+            for (size_t half = 0; half < 2; half++)
+            {
+                //the zero-masked forms over all lanes are the plain ones, without GCC's uninitialised operand; each
+                //half is converted to double straight from memory for the same reason.
+                const float* half_values = values + i + half * lanes;
+                const __m512 value = _mm512_loadu_ps(half_values);
+                minimum[half] = _mm512_maskz_min_ps(0xFFFF, value, minimum[half]);
+                maximum[half] = _mm512_maskz_max_ps(0xFFFF, value, maximum[half]);
+                sum[2 * half] = _mm512_add_pd(sum[2 * half], _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(half_values)));
+                sum[2 * half + 1] = _mm512_add_pd(sum[2 * half + 1],
+                                                  _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(half_values + lanes / 2)));
+            }
+        }
+
+        alignas(64) float minimum_lanes[lanes];
+        alignas(64) float maximum_lanes[lanes];
+        alignas(64) double sum_lanes[lanes / 2];
+        _mm512_store_ps(minimum_lanes, _mm512_maskz_min_ps(0xFFFF, minimum[0], minimum[1]));
+        _mm512_store_ps(maximum_lanes, _mm512_maskz_max_ps(0xFFFF, maximum[0], maximum[1]));
+        _mm512_store_pd(sum_lanes, _mm512_add_pd(_mm512_add_pd(sum[0], sum[1]), _mm512_add_pd(sum[2], sum[3])));
+
+        double total = 0.0;
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            statistics.minimum = std::min(statistics.minimum, minimum_lanes[lane]);
+            statistics.maximum = std::max(statistics.maximum, maximum_lanes[lane]);
+        }
+        for (const double lane_sum : sum_lanes)
+        {
+            total += lane_sum;
+        }
+
+        scalar_statistics(values, i, count, statistics.minimum, statistics.maximum, total);
+        statistics.sum += total;
+        statistics.count += count;
+    }
+
+    bool cpu_has_avx2()
+    {
+#ifdef _MSC_VER
+        int32_t info[4] = {};
+        __cpuid(info, 1);
+        //OSXSAVE and AVX, and the OS saves the YMM state.
+        const bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return avx && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    bool cpu_has_avx512()
+    {
+#ifdef _MSC_VER
+        int32_t info[4] = {};
+        __cpuid(info, 1);
+        //OSXSAVE, and the OS saves the opmask and ZMM state as well as YMM.
+        const bool os_support = (info[2] & (1 << 27)) && (_xgetbv(0) & 0xE6) == 0xE6;
+        __cpuidex(info, 7, 0);
+        return os_support && (info[1] & (1 << 16));
+#else
+        return __builtin_cpu_supports("avx512f");
+#endif
+    }
+#endif
+
+#ifdef IMG2SDF_NEON
+    void jump_flood_span_neon(const packed_seed* const candidates[9], packed_seed* out, const packed_seed* offsets,
+                              packed_seed origin, size_t count)
+    {
+        constexpr size_t lanes = 4;
+        const uint32x4_t coordinate_mask = vdupq_n_u32(0xFFFF);
+        const uint32x4_t none = vdupq_n_u32(cpuutils::no_seed);
+        const int32x4_t far = vdupq_n_s32(std::numeric_limits<int32_t>::max());
+        const uint32x4_t origin_lanes = vdupq_n_u32(origin);
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const uint32x4_t texel = vaddq_u32(vld1q_u32(offsets + i), origin_lanes);
+            const int32x4_t x_lanes = vreinterpretq_s32_u32(vandq_u32(texel, coordinate_mask));
+            const int32x4_t y_lanes = vreinterpretq_s32_u32(vshrq_n_u32(texel, 16));
+            uint32x4_t best_seed = none;
+            int32x4_t best_distance = far;
+
+            for (int32_t candidate = 0; candidate < 9; candidate++)
+            {
+                if (candidates[candidate] == nullptr)
+                {
+                    continue;
+                }
+
+                const uint32x4_t seed = vld1q_u32(candidates[candidate] + i);
+                const int32x4_t seed_dx = vsubq_s32(vreinterpretq_s32_u32(vandq_u32(seed, coordinate_mask)), x_lanes);
+                const int32x4_t seed_dy = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(seed, 16)), y_lanes);
+                const int32x4_t distance = vmlaq_s32(vmulq_s32(seed_dx, seed_dx), seed_dy, seed_dy);
+
+                //only lanes holding a seed may win.
+                const uint32x4_t valid = vmvnq_u32(vceqq_u32(seed, none));
+                const uint32x4_t nearer = vandq_u32(valid, vcltq_s32(distance, best_distance));
+                best_distance = vbslq_s32(nearer, distance, best_distance);
+                best_seed = vbslq_u32(nearer, seed, best_seed);
+            }
+
+            vst1q_u32(out + i, best_seed);
+        }
+
+        scalar_texels(candidates, out, offsets, origin, i, count);
+    }
+
+    ///vminnmq / vmaxnmq return the number when one operand is NaN, so NaNs are skipped as in scalar_statistics.
+    void statistics_span_neon(const float* values, size_t count, float_statistics& statistics)
+    {
+        constexpr size_t lanes = 4;
+        float32x4_t minimum[2] = {vdupq_n_f32(statistics.minimum), vdupq_n_f32(statistics.minimum)};
+        float32x4_t maximum[2] = {vdupq_n_f32(statistics.maximum), vdupq_n_f32(statistics.maximum)};
+        float64x2_t sum[4] = {vdupq_n_f64(0.0), vdupq_n_f64(0.0), vdupq_n_f64(0.0), vdupq_n_f64(0.0)};
+
+        size_t i = 0;
+        for (; i + 2 * lanes <= count; i += 2 * lanes)
+        {
+            for (size_t half = 0; half < 2; half++)
+            {
+                const float32x4_t value = vld1q_f32(values + i + half * lanes);
+                minimum[half] = vminnmq_f32(value, minimum[half]);
+                maximum[half] = vmaxnmq_f32(value, maximum[half]);
+                sum[2 * half] = vaddq_f64(sum[2 * half], vcvt_f64_f32(vget_low_f32(value)));
+                sum[2 * half + 1] = vaddq_f64(sum[2 * half + 1], vcvt_high_f64_f32(value));
+            }
+        }
+
+        statistics.minimum = std::min(statistics.minimum, vminnmvq_f32(vminnmq_f32(minimum[0], minimum[1])));
+        statistics.maximum = std::max(statistics.maximum, vmaxnmvq_f32(vmaxnmq_f32(maximum[0], maximum[1])));
+        double total = vaddvq_f64(vaddq_f64(vaddq_f64(sum[0], sum[1]), vaddq_f64(sum[2], sum[3])));
+
+        scalar_statistics(values, i, count, statistics.minimum, statistics.maximum, total);
+        statistics.sum += total;
+        statistics.count += count;
+    }
+#endif
+}
+
+bool cpukernels::is_supported(SIMD_LEVEL level) {
+    switch (level)
+    {
+        case SIMD_LEVEL::SCALAR:
+            return true;
+#ifdef IMG2SDF_X86
+        case SIMD_LEVEL::AVX2:
+        {
+            static const bool supported = cpu_has_avx2();
+            return supported;
+        }
+        case SIMD_LEVEL::AVX512:
+        {
+            static const bool supported = cpu_has_avx512();
+            return supported;
+        }
+#endif
+#ifdef IMG2SDF_NEON
+        //Advanced SIMD is mandatory on AArch64.
+        case SIMD_LEVEL::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+cpukernels::SIMD_LEVEL cpukernels::best_simd_level() {
+    static const SIMD_LEVEL best = supported_simd_levels().back();
+    return best;
+}
+
+std::vector<cpukernels::SIMD_LEVEL> cpukernels::supported_simd_levels() {
+    std::vector<SIMD_LEVEL> levels;
+    for (const auto level : {SIMD_LEVEL::SCALAR, SIMD_LEVEL::NEON, SIMD_LEVEL::AVX2, SIMD_LEVEL::AVX512})
+    {
+        if (is_supported(level))
+        {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+const char* cpukernels::simd_level_name(SIMD_LEVEL level) {
+    switch (level)
+    {
+        case SIMD_LEVEL::AVX2: return "AVX2";
+        case SIMD_LEVEL::AVX512: return "AVX-512";
+        case SIMD_LEVEL::NEON: return "NEON";
+        case SIMD_LEVEL::SCALAR:
+        default: return "scalar";
+    }
+}
+
+cpukernels::jump_flood_span cpukernels::jump_flood_kernel(SIMD_LEVEL level) {
+    if (!is_supported(level))
+    {
+        throw std::runtime_error(std::string {simd_level_name(level)} + " is not supported on this CPU.");
+    }
+
+    switch (level)
+    {
+#ifdef IMG2SDF_X86
+        case SIMD_LEVEL::AVX2: return jump_flood_span_avx2;
+        case SIMD_LEVEL::AVX512: return jump_flood_span_avx512;
+#endif
+#ifdef IMG2SDF_NEON
+        case SIMD_LEVEL::NEON: return jump_flood_span_neon;
+#endif
+        case SIMD_LEVEL::SCALAR:
+        default: return jump_flood_span_scalar;
+    }
+}
+
+cpukernels::statistics_span cpukernels::statistics_kernel(SIMD_LEVEL level) {
+    if (!is_supported(level))
+    {
+        throw std::runtime_error(std::string {simd_level_name(level)} + " is not supported on this CPU.");
+    }
+
+    switch (level)
+    {
+#ifdef IMG2SDF_X86
+        case SIMD_LEVEL::AVX2: return statistics_span_avx2;
+        case SIMD_LEVEL::AVX512: return statistics_span_avx512;
+#endif
+#ifdef IMG2SDF_NEON
+        case SIMD_LEVEL::NEON: return statistics_span_neon;
+#endif
+        case SIMD_LEVEL::SCALAR:
+        default: return statistics_span_scalar;
+    }
+}
+
+void cpukernels::float_statistics::merge(const float_statistics& other) {
+    minimum = other.minimum < minimum ? other.minimum : minimum;
+    maximum = other.maximum > maximum ? other.maximum : maximum;
+    sum += other.sum;
+    count += other.count;
+}
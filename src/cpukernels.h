@@ -0,0 +1,91 @@
+#ifndef IMG2SDF_CPUKERNELS_H
+#define IMG2SDF_CPUKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "cpuutils.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+///Hand vectorised inner loops of the CPU pipeline, with a scalar fallback. Every variant is compiled into the same
+///binary (x86 variants through function target attributes, so no global -mavx flags are needed) and the widest one
+///the running CPU supports is picked once at runtime.
+namespace cpukernels
+{
+    enum class SIMD_LEVEL
+    {
+        SCALAR,
+        ///8 lanes of 32 bits.
+        AVX2,
+        ///16 lanes of 32 bits (AVX-512F).
+        AVX512,
+        ///4 lanes of 32 bits (AArch64 Advanced SIMD).
+        NEON,
+    };
+
+    ///A span of `count` texels of a jump flood pass (jumpflood.hlsl: minimum_distance over the centre and 8 neighbours
+    ///`delta` texels away). The layout of the seed buffer is up to the caller: it passes one pointer per neighbour,
+    ///each lined up with `out`, so the kernel only ever reads contiguous memory.
+    ///Candidates are visited in order and only a strictly nearer seed replaces the current one, so every variant picks
+    ///exactly the same seeds.
+    ///@param candidates the seeds of the neighbours at (-delta, -delta), (0, -delta), (delta, -delta), (-delta, 0), ...
+    ///(delta, delta) of each texel in the span, or null where that neighbour lies outside the texture for the whole span.
+    ///@param offsets, origin the packed coordinates of texel i are offsets[i] + origin.
+    using jump_flood_span = void (*)(const cpuutils::packed_seed* const candidates[9], cpuutils::packed_seed* out,
+                                     const cpuutils::packed_seed* offsets, cpuutils::packed_seed origin, size_t count);
+
+    ///The vectorised kernels compute squared distances in 32 bit lanes, which is exact for textures up to this
+    ///width and height. Larger textures use the scalar kernel.
+    constexpr size_t max_simd_dimension = 32768;
+
+    ///Running minimum, maximum, sum and count of a set of floats. NaNs are skipped by the minimum and maximum, as
+    ///std::min(minimum, value) skips them, but carry through the sum.
+    struct float_statistics
+    {
+        float minimum = std::numeric_limits<float>::infinity();
+        float maximum = -std::numeric_limits<float>::infinity();
+        double sum = 0.0;
+        size_t count = 0;
+
+        void merge(const float_statistics& other);
+
+        [[nodiscard]] double mean() const { return count == 0 ? 0.0 : sum / static_cast<double>(count); }
+    };
+
+    ///Folds `count` contiguous floats into `statistics`. Every variant finds the same minimum and maximum; the sum is
+    ///kept in several double lanes, so it can differ from the scalar one in the last few bits.
+    using statistics_span = void (*)(const float* values, size_t count, float_statistics& statistics);
+
+    ///True if the running CPU (and OS) supports `level`. SCALAR is always supported.
+    [[nodiscard]] bool is_supported(SIMD_LEVEL level);
+
+    ///The widest supported level, detected once by CPUID (or by target on AArch64) and cached.
+    [[nodiscard]] SIMD_LEVEL best_simd_level();
+
+    ///Every supported level, narrowest first.
+    [[nodiscard]] std::vector<SIMD_LEVEL> supported_simd_levels();
+
+    [[nodiscard]] const char* simd_level_name(SIMD_LEVEL level);
+
+    ///The jump flood span kernel for `level`. Throws a std::runtime_error if `level` is not supported.
+    [[nodiscard]] jump_flood_span jump_flood_kernel(SIMD_LEVEL level);
+
+    ///The statistics span kernel for `level`. Throws a std::runtime_error if `level` is not supported.
+    [[nodiscard]] statistics_span statistics_kernel(SIMD_LEVEL level);
+
+    ///Hints that the cache line holding `address` will be read soon. Never faults.
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 0, 3);
+#elif defined(_M_X64) || defined(_M_IX86)
+        _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+    }
+}
+
+#endif //IMG2SDF_CPUKERNELS_H
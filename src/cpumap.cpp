@@ -0,0 +1,686 @@
+#include "cpumap.h"
+#include "cpuutils.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    ///TILED files start with this, then the fields of tiled_header.
+    constexpr char tiled_magic[8] = {'I', 'M', 'G', '2', 'S', 'D', 'F', 'T'};
+    constexpr uint32_t tiled_version = 1;
+    ///tiles start a page in, so each tile of a multiple of 1024 texels is page aligned.
+    constexpr size_t tiled_data_offset = 4096;
+
+    struct tiled_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t texel_format;
+        uint64_t width;
+        uint64_t height;
+        uint64_t tile_size;
+    };
+
+    ///rows released behind a row_reader at a time.
+    constexpr size_t release_rows = 64;
+
+    constexpr bool host_is_big_endian = std::endian::native == std::endian::big;
+
+    ///Splits the header of a PGM or PFM into its whitespace separated fields, skipping comments.
+    struct netpbm_header
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+
+        std::string next()
+        {
+            while (position < size && (std::isspace(data[position]) || data[position] == '#'))
+            {
+                if (data[position] == '#')
+                {
+                    while (position < size && data[position] != '\n')
+                    {
+                        position++;
+                    }
+                }
+                else
+                {
+                    position++;
+                }
+            }
+
+            std::string field;
+            while (position < size && !std::isspace(data[position]))
+            {
+                field += static_cast<char>(data[position++]);
+            }
+            if (field.empty())
+            {
+                throw std::runtime_error("Truncated image header.");
+            }
+            return field;
+        }
+
+        ///the texels start after the single whitespace character ending the last field.
+        size_t data_offset() const { return position + 1; }
+    };
+
+    ///Parses a header field of decimal digits only: no sign, no space, and no value past size_t.
+    size_t parse_number(const std::string& field)
+    {
+        size_t value = 0;
+        const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (error != std::errc {} || end != field.data() + field.size())
+        {
+            throw std::runtime_error("Invalid image header field \"" + field + "\".");
+        }
+        return value;
+    }
+
+    size_t parse_dimension(const std::string& field)
+    {
+        const auto value = parse_number(field);
+        if (value == 0)
+        {
+            throw std::runtime_error("Image must not be empty!");
+        }
+        return value;
+    }
+
+    ///`value` rounded up to whole tiles of `tile_size`, without the overflow of adding tile_size - 1 first.
+    size_t tile_count(size_t value, size_t tile_size)
+    {
+        return value / tile_size + (value % tile_size != 0 ? 1 : 0);
+    }
+
+    ///Whether the product of `factors` is at most `available`, checked by division so a header cannot wrap it.
+    bool fits(size_t available, std::initializer_list<size_t> factors)
+    {
+        size_t product = 1;
+        for (const size_t factor : factors)
+        {
+            if (factor != 0 && product > available / factor)
+            {
+                return false;
+            }
+            product *= factor;
+        }
+        return true;
+    }
+}
+
+cpumap::mapped_file::~mapped_file() {
+    unmap();
+}
+
+cpumap::mapped_file::mapped_file(mapped_file&& other) noexcept {
+    *this = std::move(other);
+}
+
+cpumap::mapped_file& cpumap::mapped_file::operator=(mapped_file&& other) noexcept {
+    if (this != &other)
+    {
+        unmap();
+        address = std::exchange(other.address, nullptr);
+        length = std::exchange(other.length, 0);
+        writable = std::exchange(other.writable, false);
+#ifdef _WIN32
+        file_handle = std::exchange(other.file_handle, nullptr);
+        mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+cpumap::mapped_file cpumap::mapped_file::open(const std::string& path) {
+    mapped_file file;
+    file.file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file.file_handle == INVALID_HANDLE_VALUE)
+    {
+        file.file_handle = nullptr;
+        throw std::runtime_error("Could not open " + path + " for reading.");
+    }
+
+    LARGE_INTEGER size {};
+    GetFileSizeEx(file.file_handle, &size);
+    file.length = static_cast<size_t>(size.QuadPart);
+    if (file.length == 0)
+    {
+        return file;
+    }
+
+    file.mapping_handle = CreateFileMappingA(file.file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = file.mapping_handle ? MapViewOfFile(file.mapping_handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        throw std::runtime_error("Could not map " + path);
+    }
+    file.address = static_cast<uint8_t*>(view);
+    return file;
+}
+
+cpumap::mapped_file cpumap::mapped_file::create(const std::string& path, size_t size) {
+    mapped_file file;
+    file.file_handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file.file_handle == INVALID_HANDLE_VALUE)
+    {
+        file.file_handle = nullptr;
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+    file.length = size;
+    file.writable = true;
+    if (size == 0)
+    {
+        return file;
+    }
+
+    //mapping past the end of the file grows it to the size of the mapping.
+    const auto size64 = static_cast<uint64_t>(size);
+    file.mapping_handle = CreateFileMappingA(file.file_handle, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                             static_cast<DWORD>(size64 & 0xffffffffu), nullptr);
+    void* view = file.mapping_handle ? MapViewOfFile(file.mapping_handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        throw std::runtime_error("Could not map " + path);
+    }
+    file.address = static_cast<uint8_t*>(view);
+    return file;
+}
+
+void cpumap::mapped_file::advise(ACCESS_PATTERN pattern, size_t offset, size_t size) const {
+    //only prefetching has a Windows equivalent; read ahead and release are left to the memory manager.
+    if (pattern != ACCESS_PATTERN::WILL_NEED || address == nullptr || offset >= length)
+    {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range {address + offset, std::min(size, length - offset)};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void cpumap::mapped_file::flush() const {
+    if (!writable || address == nullptr)
+    {
+        return;
+    }
+    if (!FlushViewOfFile(address, 0) || !FlushFileBuffers(file_handle))
+    {
+        throw std::runtime_error("Could not flush mapped file.");
+    }
+}
+
+void cpumap::mapped_file::unmap() {
+    if (address != nullptr)
+    {
+        UnmapViewOfFile(address);
+    }
+    if (mapping_handle != nullptr)
+    {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != nullptr)
+    {
+        CloseHandle(file_handle);
+    }
+    address = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    length = 0;
+}
+#else
+cpumap::mapped_file cpumap::mapped_file::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open " + path + " for reading.");
+    }
+
+    struct stat info {};
+    mapped_file file;
+    if (fstat(fd, &info) == 0)
+    {
+        file.length = static_cast<size_t>(info.st_size);
+    }
+
+    //the mapping keeps the file open, so the descriptor can go straight away.
+    void* view = file.length > 0 ? mmap(nullptr, file.length, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + path);
+    }
+    file.address = static_cast<uint8_t*>(view);
+    return file;
+}
+
+cpumap::mapped_file cpumap::mapped_file::create(const std::string& path, size_t size) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+
+    //a sparse file: blocks are only allocated as pages are written back.
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Could not size " + path);
+    }
+
+    void* view = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : nullptr;
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + path);
+    }
+
+    mapped_file file;
+    file.address = static_cast<uint8_t*>(view);
+    file.length = size;
+    file.writable = true;
+    return file;
+}
+
+void cpumap::mapped_file::advise(ACCESS_PATTERN pattern, size_t offset, size_t size) const {
+    if (address == nullptr || offset >= length)
+    {
+        return;
+    }
+
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / page_size * page_size;
+    const size_t end = offset + std::min(size, length - offset);
+
+    int advice = MADV_NORMAL;
+    switch (pattern)
+    {
+        case ACCESS_PATTERN::SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case ACCESS_PATTERN::RANDOM: advice = MADV_RANDOM; break;
+        case ACCESS_PATTERN::WILL_NEED: advice = MADV_WILLNEED; break;
+        case ACCESS_PATTERN::DONT_NEED: advice = MADV_DONTNEED; break;
+    }
+    //only a hint, so a kernel that ignores or rejects it changes nothing.
+    madvise(address + begin, end - begin, advice);
+}
+
+void cpumap::mapped_file::flush() const {
+    if (!writable || address == nullptr)
+    {
+        return;
+    }
+    if (msync(address, length, MS_SYNC) != 0)
+    {
+        throw std::runtime_error("Could not flush mapped file.");
+    }
+}
+
+void cpumap::mapped_file::unmap() {
+    if (address != nullptr)
+    {
+        munmap(address, length);
+    }
+    address = nullptr;
+    length = 0;
+}
+#endif
+
+cpumap::FILE_FORMAT cpumap::format_from_extension(const std::string& path) {
+    auto extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".pgm") { return FILE_FORMAT::PGM; }
+    if (extension == ".pfm") { return FILE_FORMAT::PFM; }
+    if (extension == ".tiles") { return FILE_FORMAT::TILED; }
+    return FILE_FORMAT::RAW;
+}
+
+cpumap::mapped_image cpumap::mapped_image::open(const std::string& path, size_t raw_width, size_t raw_height,
+                                                OUTPUT_FORMAT raw_format) {
+    mapped_image image;
+    image.file = mapped_file::open(path);
+    const uint8_t* data = image.file.data();
+    const size_t size = image.file.size();
+
+    const bool is_raw = raw_width > 0 && raw_height > 0;
+    if (is_raw)
+    {
+        image.format = FILE_FORMAT::RAW;
+        image.texel_format = raw_format;
+        image.width = raw_width;
+        image.height = raw_height;
+        image.texel_stride = bytes_per_texel(raw_format);
+        image.sample_scale = raw_format == OUTPUT_FORMAT::UNORM8 ? 1.0f / 255.0f
+                           : raw_format == OUTPUT_FORMAT::UNORM16 ? 1.0f / 65535.0f : 1.0f;
+    }
+    else if (size >= sizeof(tiled_header) && std::memcmp(data, tiled_magic, sizeof(tiled_magic)) == 0)
+    {
+        tiled_header header {};
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != tiled_version || header.texel_format != static_cast<uint32_t>(OUTPUT_FORMAT::FLOAT32) ||
+            header.tile_size == 0 || header.width == 0 || header.height == 0)
+        {
+            throw std::runtime_error(path + " is not a supported tiled image.");
+        }
+        image.format = FILE_FORMAT::TILED;
+        image.width = static_cast<size_t>(header.width);
+        image.height = static_cast<size_t>(header.height);
+        image.tile_size = static_cast<size_t>(header.tile_size);
+        image.data_offset = tiled_data_offset;
+    }
+    else if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == 'f' || data[1] == 'F'))
+    {
+        netpbm_header header {data, size};
+        const auto magic = header.next();
+        image.width = parse_dimension(header.next());
+        image.height = parse_dimension(header.next());
+
+        if (magic == "P5")
+        {
+            const auto max_value = parse_number(header.next());
+            if (max_value == 0 || max_value > 65535)
+            {
+                throw std::runtime_error(path + " has an invalid maximum value.");
+            }
+            image.format = FILE_FORMAT::PGM;
+            image.texel_format = max_value > 255 ? OUTPUT_FORMAT::UNORM16 : OUTPUT_FORMAT::UNORM8;
+            image.texel_stride = bytes_per_texel(image.texel_format);
+            image.sample_scale = 1.0f / static_cast<float>(max_value);
+            image.byte_swapped = image.texel_format == OUTPUT_FORMAT::UNORM16 && !host_is_big_endian;
+        }
+        else
+        {
+            //a negative scale means little-endian samples.
+            const auto scale = std::stof(header.next());
+            image.format = FILE_FORMAT::PFM;
+            image.texel_stride = magic == "PF" ? 3 * sizeof(float) : sizeof(float);
+            image.byte_swapped = (scale < 0) == host_is_big_endian;
+            image.bottom_up = true;
+        }
+        image.data_offset = header.data_offset();
+    }
+    else
+    {
+        throw std::runtime_error(path + " is not a PGM, PFM or tiled image, and no raw width and height were given.");
+    }
+
+    //the dimensions come from the file, so the texels they need are checked against what it holds without wrapping.
+    const size_t available = size >= image.data_offset ? size - image.data_offset : 0;
+    const bool holds_texels = size >= image.data_offset &&
+            (image.format == FILE_FORMAT::TILED
+             ? fits(available, {tile_count(image.width, image.tile_size), tile_count(image.height, image.tile_size),
+                                image.tile_size, image.tile_size, sizeof(float)})
+             : fits(available, {image.width, image.height, image.texel_stride}));
+    if (!holds_texels)
+    {
+        throw std::runtime_error(path + " is smaller than its width and height.");
+    }
+    return image;
+}
+
+cpumap::mapped_image cpumap::mapped_image::create(const std::string& path, FILE_FORMAT format, size_t width,
+                                                  size_t height, OUTPUT_FORMAT texel_format, size_t tile_size) {
+    if (width == 0 || height == 0)
+    {
+        throw std::runtime_error("Image must not be empty!");
+    }
+    if ((format == FILE_FORMAT::PGM && texel_format != OUTPUT_FORMAT::UNORM8 && texel_format != OUTPUT_FORMAT::UNORM16) ||
+        ((format == FILE_FORMAT::PFM || format == FILE_FORMAT::TILED) && texel_format != OUTPUT_FORMAT::FLOAT32))
+    {
+        throw std::runtime_error("PGM images store unorm8 or unorm16 texels, and PFM and tiled images float32.");
+    }
+    if (format == FILE_FORMAT::TILED && tile_size == 0)
+    {
+        throw std::runtime_error("Tile size must be greater than 0.");
+    }
+
+    mapped_image image;
+    image.format = format;
+    image.texel_format = texel_format;
+    image.width = width;
+    image.height = height;
+    image.texel_stride = bytes_per_texel(texel_format);
+    image.sample_scale = texel_format == OUTPUT_FORMAT::UNORM8 ? 1.0f / 255.0f
+                       : texel_format == OUTPUT_FORMAT::UNORM16 ? 1.0f / 65535.0f : 1.0f;
+
+    std::string header;
+    size_t data_size = width * height * image.texel_stride;
+    if (format == FILE_FORMAT::PGM)
+    {
+        header = "P5\n" + std::to_string(width) + " " + std::to_string(height) + "\n" +
+                 (texel_format == OUTPUT_FORMAT::UNORM16 ? "65535" : "255") + "\n";
+        image.byte_swapped = texel_format == OUTPUT_FORMAT::UNORM16 && !host_is_big_endian;
+    }
+    else if (format == FILE_FORMAT::PFM)
+    {
+        //written in host byte order, which the sign of the scale records.
+        header = "Pf\n" + std::to_string(width) + " " + std::to_string(height) + "\n" +
+                 (host_is_big_endian ? "1.0" : "-1.0") + "\n";
+        image.bottom_up = true;
+    }
+    else if (format == FILE_FORMAT::TILED)
+    {
+        image.tile_size = tile_size;
+        const size_t tiles = (width + tile_size - 1) / tile_size * ((height + tile_size - 1) / tile_size);
+        data_size = tiles * tile_size * tile_size * sizeof(float);
+    }
+    image.data_offset = format == FILE_FORMAT::TILED ? tiled_data_offset : header.size();
+
+    image.file = mapped_file::create(path, image.data_offset + data_size);
+    if (format == FILE_FORMAT::TILED)
+    {
+        tiled_header tiled {};
+        std::memcpy(tiled.magic, tiled_magic, sizeof(tiled_magic));
+        tiled.version = tiled_version;
+        tiled.texel_format = static_cast<uint32_t>(texel_format);
+        tiled.width = width;
+        tiled.height = height;
+        tiled.tile_size = tile_size;
+        std::memcpy(image.file.data(), &tiled, sizeof(tiled));
+    }
+    else
+    {
+        std::memcpy(image.file.data(), header.data(), header.size());
+    }
+    return image;
+}
+
+size_t cpumap::mapped_image::texel_offset(size_t x, size_t y) const {
+    if (format == FILE_FORMAT::TILED)
+    {
+        const size_t tiles_x = (width + tile_size - 1) / tile_size;
+        const size_t tile = (y / tile_size) * tiles_x + x / tile_size;
+        return data_offset + ((tile * tile_size + y % tile_size) * tile_size + x % tile_size) * sizeof(float);
+    }
+
+    const size_t row = bottom_up ? height - 1 - y : y;
+    return data_offset + (row * width + x) * texel_stride;
+}
+
+template <typename span_type>
+void cpumap::mapped_image::for_each_span(size_t x, size_t y, size_t count, span_type&& span) const {
+    if (format != FILE_FORMAT::TILED)
+    {
+        span(x, count, texel_offset(x, y));
+        return;
+    }
+
+    for (size_t end = x + count; x < end;)
+    {
+        const size_t run = std::min(end, (x / tile_size + 1) * tile_size) - x;
+        span(x, run, texel_offset(x, y));
+        x += run;
+    }
+}
+
+void cpumap::mapped_image::read_texels(size_t offset, size_t count, float* out) const {
+    const uint8_t* in = file.data() + offset;
+    if (texel_format == OUTPUT_FORMAT::FLOAT32 && texel_stride == sizeof(float) && !byte_swapped)
+    {
+        std::memcpy(out, in, count * sizeof(float));
+        return;
+    }
+
+    for (size_t texel = 0; texel < count; texel++, in += texel_stride)
+    {
+        uint8_t bytes[4] = {};
+        std::memcpy(bytes, in, bytes_per_texel(texel_format));
+        if (byte_swapped)
+        {
+            std::reverse(bytes, bytes + bytes_per_texel(texel_format));
+        }
+
+        switch (texel_format)
+        {
+            case OUTPUT_FORMAT::UNORM8:
+                out[texel] = static_cast<float>(bytes[0]) * sample_scale;
+                break;
+            case OUTPUT_FORMAT::UNORM16:
+            case OUTPUT_FORMAT::FLOAT16:
+            {
+                uint16_t sample = 0;
+                std::memcpy(&sample, bytes, sizeof(sample));
+                out[texel] = texel_format == OUTPUT_FORMAT::FLOAT16 ? cpuutils::half_to_float(sample)
+                                                                    : static_cast<float>(sample) * sample_scale;
+                break;
+            }
+            case OUTPUT_FORMAT::FLOAT32:
+            default:
+                std::memcpy(&out[texel], bytes, sizeof(float));
+                break;
+        }
+    }
+}
+
+void cpumap::mapped_image::write_texels(size_t offset, size_t count, const float* in) {
+    std::memcpy(file.data() + offset, in, count * sizeof(float));
+}
+
+void cpumap::mapped_image::check_float_writable() const {
+    if (!file.is_writable() || texel_format != OUTPUT_FORMAT::FLOAT32 || byte_swapped)
+    {
+        throw std::runtime_error("Float rows and regions can only be written to a float32 image created for writing.");
+    }
+}
+
+encoded_view cpumap::mapped_image::view() {
+    if (!file.is_writable() || format == FILE_FORMAT::TILED)
+    {
+        throw std::runtime_error("Only untiled images created for writing can be encoded into.");
+    }
+
+    const auto row_bytes = static_cast<std::ptrdiff_t>(width * texel_stride);
+    return {width, height, texel_format, file.data() + texel_offset(0, 0), bottom_up ? -row_bytes : row_bytes,
+            byte_swapped != host_is_big_endian};
+}
+
+void cpumap::mapped_image::read_row(size_t y, float* row) const {
+    if (y >= height)
+    {
+        throw std::runtime_error("Row " + std::to_string(y) + " lies outside of the image.");
+    }
+    for_each_span(0, y, width, [&](size_t x, size_t count, size_t offset) { read_texels(offset, count, row + x); });
+}
+
+cpu_bitmask cpumap::mapped_image::load_bitmask(float threshold) const {
+    file.advise(ACCESS_PATTERN::SEQUENTIAL);
+    cpu_bitmask mask (width, height, uninitialised);
+    std::vector<float> row (width);
+    for (size_t y = 0; y < height; y++)
+    {
+        read_row(y, row.data());
+        mask.pack_row(y, row.data(), [threshold](float value) { return value > threshold; });
+    }
+    return mask;
+}
+
+cpuio::row_reader cpumap::mapped_image::row_reader() const {
+    file.advise(ACCESS_PATTERN::SEQUENTIAL);
+    //rows of untiled, top down images are contiguous, so the rows already read can be handed back in one range.
+    const bool can_release = format != FILE_FORMAT::TILED && !bottom_up;
+
+    return [this, can_release](size_t y, float* row) {
+        read_row(y, row);
+        if (can_release && y > 0 && y % release_rows == 0)
+        {
+            const size_t begin = texel_offset(0, y - release_rows);
+            file.advise(ACCESS_PATTERN::DONT_NEED, begin, texel_offset(0, y) - begin);
+        }
+    };
+}
+
+cpuio::region_reader cpumap::mapped_image::region_reader() const {
+    //the rows of a region with its halo are far apart in an untiled file, so read ahead only wastes I/O.
+    if (format != FILE_FORMAT::TILED)
+    {
+        file.advise(ACCESS_PATTERN::RANDOM);
+    }
+
+    return [this](size_t x, size_t y, cpu_texture<float>& region) {
+        if (x + region.width > width || y + region.height > height)
+        {
+            throw std::runtime_error("Region lies outside of the image.");
+        }
+
+        for (size_t row = 0; row < region.height; row++)
+        {
+            for_each_span(x, y + row, region.width, [&](size_t span_x, size_t count, size_t offset) {
+                read_texels(offset, count, region.row(row) + (span_x - x));
+            });
+        }
+    };
+}
+
+cpuio::row_writer cpumap::mapped_image::row_writer() {
+    check_float_writable();
+    file.advise(ACCESS_PATTERN::SEQUENTIAL);
+
+    return [this](size_t y, const float* row) {
+        if (y >= height)
+        {
+            throw std::runtime_error("Row " + std::to_string(y) + " lies outside of the image.");
+        }
+        for_each_span(0, y, width, [&](size_t x, size_t count, size_t offset) { write_texels(offset, count, row + x); });
+    };
+}
+
+cpuio::region_writer cpumap::mapped_image::region_writer() {
+    check_float_writable();
+
+    return [this](size_t x, size_t y, const cpu_texture<float>& region) {
+        if (x + region.width > width || y + region.height > height)
+        {
+            throw std::runtime_error("Region lies outside of the image.");
+        }
+
+        for (size_t row = 0; row < region.height; row++)
+        {
+            for_each_span(x, y + row, region.width, [&](size_t span_x, size_t count, size_t offset) {
+                write_texels(offset, count, region.row(row) + (span_x - x));
+            });
+        }
+    };
+}
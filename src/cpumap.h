@@ -0,0 +1,183 @@
+#ifndef IMG2SDF_CPUMAP_H
+#define IMG2SDF_CPUMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "cpu_bitmask.h"
+#include "cpu_texture.h"
+#include "cpuio.h"
+#include "output_format.h"
+
+///Memory-mapped images for handing masks and fields between tools without an encode or decode. Inputs are read in
+///place from the page cache, and outputs are encoded straight into the pages of the file, so a field another process
+///has just written costs nothing to read beyond the page faults. Each access path tells the kernel how it will walk
+///the mapping (madvise on POSIX).
+namespace cpumap
+{
+    ///How a range of a mapping is about to be used.
+    enum class ACCESS_PATTERN
+    {
+        ///front to back, once: read ahead aggressively and drop pages soon after.
+        SEQUENTIAL,
+        ///in no particular order, e.g. regions with halos: no read ahead.
+        RANDOM,
+        ///soon: start reading it in now.
+        WILL_NEED,
+        ///no longer: the pages may be dropped from this mapping. The file and page cache are unaffected.
+        DONT_NEED,
+    };
+
+    ///A whole file mapped into memory, read only or shared read-write. Move only; unmapped on destruction.
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+        ~mapped_file();
+
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        ///Maps the file at `path` read only. Throws a std::runtime_error if it cannot be opened or mapped.
+        [[nodiscard]] static mapped_file open(const std::string& path);
+
+        ///Creates (or truncates) the file at `path`, sizes it to `size` bytes and maps it read-write. Pages the caller
+        ///never writes read as zero and take no space on most file systems.
+        [[nodiscard]] static mapped_file create(const std::string& path, size_t size);
+
+        [[nodiscard]] uint8_t* data() const { return address; }
+        [[nodiscard]] size_t size() const { return length; }
+        [[nodiscard]] bool is_writable() const { return writable; }
+
+        ///Hints how bytes [offset, offset + size) are about to be used. Widened to whole pages; a no-op where the
+        ///platform has no equivalent.
+        void advise(ACCESS_PATTERN pattern, size_t offset = 0, size_t size = std::numeric_limits<size_t>::max()) const;
+
+        ///Writes dirty pages back to the file and waits for them. Not needed for another process to see the data,
+        ///which shares the page cache, only for it to survive a crash.
+        void flush() const;
+
+    private:
+        void unmap();
+
+        uint8_t* address = nullptr;
+        size_t length = 0;
+        bool writable = false;
+#ifdef _WIN32
+        void* file_handle = nullptr;
+        void* mapping_handle = nullptr;
+#endif
+    };
+
+    enum class FILE_FORMAT
+    {
+        ///headerless and row-major, in any OUTPUT_FORMAT in host byte order, as the CLI writes its fields. The width
+        ///and height are given by the caller.
+        RAW,
+        ///binary greymap (P5): 8 bit, or 16 bit big-endian if its maximum value is over 255. Read normalised to 0 - 1,
+        ///written as UNORM8 or UNORM16.
+        PGM,
+        ///portable float map: R32 float, one channel (Pf) or the first of three (PF), stored bottom row first.
+        PFM,
+        ///the tiled container: a one page header, then square tiles of `tile_size` texels in row-major tile order,
+        ///each contiguous and padded to full size at the edges. Regions with halos then touch a few runs of pages
+        ///rather than a slice of every row. R32 float, in host byte order.
+        TILED,
+    };
+
+    ///The format the extension of `path` names: .pgm, .pfm or .tiles, and RAW for anything else.
+    [[nodiscard]] FILE_FORMAT format_from_extension(const std::string& path);
+
+    ///An image in one of the formats above, mapped whole.
+    class mapped_image
+    {
+    public:
+        ///Maps an existing image read only. PGM, PFM and tiled files are recognised by their header; anything else
+        ///is RAW, which needs `raw_width`, `raw_height` and `raw_format`. Throws a std::runtime_error if the file is
+        ///malformed or smaller than its header says.
+        [[nodiscard]] static mapped_image open(const std::string& path, size_t raw_width = 0, size_t raw_height = 0,
+                                               OUTPUT_FORMAT raw_format = OUTPUT_FORMAT::FLOAT32);
+
+        ///Creates an image of `width` x `height` texels of `texel_format`, sized and mapped read-write. PGM takes
+        ///UNORM8 or UNORM16, PFM and TILED take FLOAT32; other combinations throw a std::runtime_error.
+        ///@param tile_size the side of a tile of a TILED image.
+        [[nodiscard]] static mapped_image create(const std::string& path, FILE_FORMAT format, size_t width, size_t height,
+                                                 OUTPUT_FORMAT texel_format = OUTPUT_FORMAT::FLOAT32, size_t tile_size = 256);
+
+        [[nodiscard]] size_t get_width() const { return width; }
+        [[nodiscard]] size_t get_height() const { return height; }
+        [[nodiscard]] FILE_FORMAT get_format() const { return format; }
+        [[nodiscard]] OUTPUT_FORMAT get_texel_format() const { return texel_format; }
+        [[nodiscard]] size_t get_tile_size() const { return tile_size; }
+        [[nodiscard]] const mapped_file& get_file() const { return file; }
+
+        ///The texels of a writable, untiled image as an encode destination, for the Img2SDF overloads taking an
+        ///encoded_view: the field is then encoded straight into the file.
+        [[nodiscard]] encoded_view view();
+
+        ///Converts row `y` to float, reading it in place.
+        void read_row(size_t y, float* row) const;
+
+        ///Packs the texels greater than `threshold` straight from the mapping, with no float copy of the image.
+        [[nodiscard]] cpu_bitmask load_bitmask(float threshold = 0.0f) const;
+
+        ///Reads the image in order, for Img2SDF::compute_streaming_distance_field. The mapping is read ahead and
+        ///released behind. Must not outlive this object.
+        [[nodiscard]] cpuio::row_reader row_reader() const;
+
+        ///Reads regions, for Img2SDF::compute_tiled_distance_field. Thread safe. Must not outlive this object.
+        [[nodiscard]] cpuio::region_reader region_reader() const;
+
+        ///Writes float rows of a FLOAT32 image in order, for Img2SDF::compute_streaming_distance_field.
+        ///Must not outlive this object.
+        [[nodiscard]] cpuio::row_writer row_writer();
+
+        ///Writes float regions of a FLOAT32 image into place. Regions must not overlap, so concurrent writes need no
+        ///lock. With a TILED image and regions on tile boundaries, each tile is a single copy.
+        ///Must not outlive this object.
+        [[nodiscard]] cpuio::region_writer region_writer();
+
+        ///See mapped_file::flush.
+        void flush() const { file.flush(); }
+
+    private:
+        ///The byte offset of texel (x, y), wherever the layout puts it.
+        [[nodiscard]] size_t texel_offset(size_t x, size_t y) const;
+
+        ///Calls `span(x, count, offset)` for each run of texels [x, x + count) of row `y` stored contiguously from
+        ///byte `offset`: the whole range, unless it crosses tiles.
+        template <typename span_type>
+        void for_each_span(size_t x, size_t y, size_t count, span_type&& span) const;
+
+        ///Converts `count` contiguous texels from byte `offset` to float.
+        void read_texels(size_t offset, size_t count, float* out) const;
+
+        ///Stores `count` contiguous float texels at byte `offset` of a FLOAT32 image.
+        void write_texels(size_t offset, size_t count, const float* in);
+
+        ///Throws unless the image is writable, FLOAT32 and in host byte order, as the float writers need.
+        void check_float_writable() const;
+
+        mapped_file file;
+        FILE_FORMAT format = FILE_FORMAT::RAW;
+        OUTPUT_FORMAT texel_format = OUTPUT_FORMAT::FLOAT32;
+        size_t width = 0;
+        size_t height = 0;
+        size_t tile_size = 0;
+        ///offset of the first texel.
+        size_t data_offset = 0;
+        ///bytes from one texel to the next, e.g. 12 for the first channel of an RGB PFM.
+        size_t texel_stride = 4;
+        ///integer samples are scaled by this to read them normalised, e.g. 1 / 255, or 1 / the maximum of a PGM.
+        float sample_scale = 1.0f;
+        ///samples are stored in the opposite of host byte order.
+        bool byte_swapped = false;
+        ///rows are stored bottom first.
+        bool bottom_up = false;
+    };
+}
+
+#endif //IMG2SDF_CPUMAP_H
@@ -0,0 +1,438 @@
+#include "cpupng.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef IMG2SDF_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+    using cpupng::ROW_FILTER;
+
+    ///the most a deflate stream looks back, and so the most a dictionary can hold.
+    constexpr size_t deflate_window = 32 * 1024;
+
+    constexpr std::array<uint8_t, 8> png_signature {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    void store_big_endian(uint32_t value, uint8_t* out)
+    {
+        out[0] = static_cast<uint8_t>(value >> 24u);
+        out[1] = static_cast<uint8_t>(value >> 16u);
+        out[2] = static_cast<uint8_t>(value >> 8u);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    uint8_t paeth_predictor(uint8_t left, uint8_t up, uint8_t up_left)
+    {
+        const int estimate = left + up - up_left;
+        const int to_left = std::abs(estimate - left);
+        const int to_up = std::abs(estimate - up);
+        const int to_up_left = std::abs(estimate - up_left);
+        if (to_left <= to_up && to_left <= to_up_left)
+        {
+            return left;
+        }
+        return to_up <= to_up_left ? up : up_left;
+    }
+
+    ///The residual of byte x of `row` under `filter`, with the filter fixed at compile time so the loops over a row
+    ///do not branch on it.
+    template <ROW_FILTER filter>
+    uint8_t residual(const uint8_t* row, const uint8_t* previous, size_t x, size_t texel_bytes)
+    {
+        const uint8_t left = x >= texel_bytes ? row[x - texel_bytes] : 0;
+        const uint8_t up = previous[x];
+        const uint8_t up_left = x >= texel_bytes ? previous[x - texel_bytes] : 0;
+        if constexpr (filter == ROW_FILTER::SUB)
+        {
+            return static_cast<uint8_t>(row[x] - left);
+        }
+        else if constexpr (filter == ROW_FILTER::UP)
+        {
+            return static_cast<uint8_t>(row[x] - up);
+        }
+        else if constexpr (filter == ROW_FILTER::AVERAGE)
+        {
+            return static_cast<uint8_t>(row[x] - (left + up) / 2);
+        }
+        else if constexpr (filter == ROW_FILTER::PAETH)
+        {
+            return static_cast<uint8_t>(row[x] - paeth_predictor(left, up, up_left));
+        }
+        else
+        {
+            return row[x];
+        }
+    }
+
+    ///The sum of the absolute residuals of `row` as signed bytes, given up once it passes `limit`.
+    template <ROW_FILTER filter>
+    uint64_t filter_cost(const uint8_t* row, const uint8_t* previous, size_t row_bytes, size_t texel_bytes,
+                         uint64_t limit)
+    {
+        uint64_t cost = 0;
+        for (size_t x = 0; x < row_bytes; x++)
+        {
+            cost += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<int8_t>(
+                    residual<filter>(row, previous, x, texel_bytes)))));
+            //checked a few times per row rather than per byte.
+            if ((x & 255u) == 255u && cost > limit)
+            {
+                return cost;
+            }
+        }
+        return cost;
+    }
+
+    template <ROW_FILTER filter>
+    void apply_filter(const uint8_t* row, const uint8_t* previous, size_t row_bytes, size_t texel_bytes, uint8_t* out)
+    {
+        for (size_t x = 0; x < row_bytes; x++)
+        {
+            out[x] = residual<filter>(row, previous, x, texel_bytes);
+        }
+    }
+
+#ifdef IMG2SDF_HAS_ZLIB
+    ///Deflates `size` bytes of `data` as a raw stream primed with `dictionary`, the bytes that precede it. Unless
+    ///`finish`, the stream ends with a sync flush, on a byte boundary and with the final block bit clear, so the next
+    ///chunk's stream can follow it directly.
+    std::vector<uint8_t> deflate_chunk(const uint8_t* data, size_t size, const uint8_t* dictionary,
+                                       size_t dictionary_size, int level, bool finish)
+    {
+        z_stream stream {};
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK)
+        {
+            throw std::runtime_error("Could not start a deflate stream.");
+        }
+        if (dictionary_size > 0 &&
+            deflateSetDictionary(&stream, dictionary, static_cast<uInt>(dictionary_size)) != Z_OK)
+        {
+            deflateEnd(&stream);
+            throw std::runtime_error("Could not prime a deflate stream.");
+        }
+
+        //the bound covers a finished stream; a sync flush adds an empty stored block.
+        std::vector<uint8_t> out (deflateBound(&stream, static_cast<uLong>(size)) + 16);
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+
+        const int flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+        while (true)
+        {
+            const int result = deflate(&stream, flush);
+            if (result == Z_STREAM_ERROR)
+            {
+                deflateEnd(&stream);
+                throw std::runtime_error("Could not deflate a chunk of rows.");
+            }
+            if (finish ? result == Z_STREAM_END : stream.avail_in == 0 && stream.avail_out > 0)
+            {
+                break;
+            }
+
+            const size_t used = out.size() - stream.avail_out;
+            out.resize(out.size() * 2);
+            stream.next_out = out.data() + used;
+            stream.avail_out = static_cast<uInt>(out.size() - used);
+        }
+
+        out.resize(out.size() - stream.avail_out);
+        deflateEnd(&stream);
+        return out;
+    }
+
+    uint32_t adler_checksum(const uint8_t* data, size_t size)
+    {
+        return static_cast<uint32_t>(adler32_z(1, data, size));
+    }
+
+    ///The checksum of `first` followed by `size` bytes whose checksum is `second`.
+    uint32_t combine_adlers(uint32_t first, uint32_t second, size_t size)
+    {
+        return static_cast<uint32_t>(adler32_combine(first, second, static_cast<z_off_t>(size)));
+    }
+
+    uint32_t update_crc(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        return static_cast<uint32_t>(crc32_z(crc, data, size));
+    }
+#else
+    [[noreturn]] void missing_zlib()
+    {
+        throw std::runtime_error("img2sdf was built without zlib, which PNG output needs.");
+    }
+
+    std::vector<uint8_t> deflate_chunk(const uint8_t*, size_t, const uint8_t*, size_t, int, bool) { missing_zlib(); }
+    uint32_t adler_checksum(const uint8_t*, size_t) { missing_zlib(); }
+    uint32_t combine_adlers(uint32_t, uint32_t, size_t) { missing_zlib(); }
+    uint32_t update_crc(uint32_t, const uint8_t*, size_t) { missing_zlib(); }
+#endif
+}
+
+bool cpupng::is_available() {
+#ifdef IMG2SDF_HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+cpupng::ROW_FILTER cpupng::filter_row(const uint8_t* row, const uint8_t* previous, size_t row_bytes,
+                                      size_t texel_bytes, ROW_FILTER preferred, uint8_t* out) {
+    std::vector<uint8_t> zeros;
+    if (previous == nullptr)
+    {
+        zeros.assign(row_bytes, 0);
+        previous = zeros.data();
+    }
+
+    using cost_function = uint64_t (*)(const uint8_t*, const uint8_t*, size_t, size_t, uint64_t);
+    constexpr std::array<cost_function, 5> costs {filter_cost<ROW_FILTER::NONE>, filter_cost<ROW_FILTER::SUB>,
+                                                  filter_cost<ROW_FILTER::UP>, filter_cost<ROW_FILTER::AVERAGE>,
+                                                  filter_cost<ROW_FILTER::PAETH>};
+
+    //the preferred filter is scored first, so the others must beat it outright.
+    if (preferred == ROW_FILTER::NONE)
+    {
+        preferred = ROW_FILTER::SUB;
+    }
+    ROW_FILTER best = preferred;
+    uint64_t best_cost = costs[static_cast<size_t>(preferred)](row, previous, row_bytes, texel_bytes,
+                                                               std::numeric_limits<uint64_t>::max());
+    for (const auto filter : {ROW_FILTER::SUB, ROW_FILTER::UP, ROW_FILTER::AVERAGE, ROW_FILTER::PAETH})
+    {
+        if (filter == preferred || best_cost == 0)
+        {
+            continue;
+        }
+        const uint64_t cost = costs[static_cast<size_t>(filter)](row, previous, row_bytes, texel_bytes, best_cost);
+        if (cost < best_cost)
+        {
+            best = filter;
+            best_cost = cost;
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(best);
+    switch (best)
+    {
+        case ROW_FILTER::SUB:
+            apply_filter<ROW_FILTER::SUB>(row, previous, row_bytes, texel_bytes, out + 1);
+            break;
+        case ROW_FILTER::UP:
+            apply_filter<ROW_FILTER::UP>(row, previous, row_bytes, texel_bytes, out + 1);
+            break;
+        case ROW_FILTER::AVERAGE:
+            apply_filter<ROW_FILTER::AVERAGE>(row, previous, row_bytes, texel_bytes, out + 1);
+            break;
+        case ROW_FILTER::PAETH:
+        default:
+            apply_filter<ROW_FILTER::PAETH>(row, previous, row_bytes, texel_bytes, out + 1);
+            break;
+    }
+    return best;
+}
+
+cpupng::parallel_writer::parallel_writer(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format,
+                                         const encoder_options& options) :
+path(path), options(options), width(width), height(height) {
+    if (!is_available())
+    {
+        throw std::runtime_error("img2sdf was built without zlib, which PNG output needs.");
+    }
+    if (format != OUTPUT_FORMAT::UNORM8 && format != OUTPUT_FORMAT::UNORM16)
+    {
+        throw std::runtime_error(path + ": PNG outputs hold unorm8 or unorm16 fields only.");
+    }
+    constexpr size_t max_dimension = std::numeric_limits<int32_t>::max();
+    if (width == 0 || height == 0 || width > max_dimension || height > max_dimension)
+    {
+        throw std::runtime_error(path + ": a PNG must be between 1 and 2^31 - 1 texels on each side.");
+    }
+
+    this->options.level = std::clamp(options.level, 0, 9);
+    this->options.num_threads = std::max<size_t>(1, options.num_threads);
+    if (this->options.pool == nullptr)
+    {
+        this->options.pool = CPUThreadPool::shared().get();
+    }
+    texel_bytes = bytes_per_texel(format);
+    row_bytes = width * texel_bytes;
+    chunk_rows = std::max<size_t>(1, (options.chunk_bytes + row_bytes - 1) / row_bytes);
+    batch_rows = std::min(chunk_rows * this->options.num_threads, height);
+    pending.resize(batch_rows * row_bytes);
+    previous_row.assign(row_bytes, 0);
+
+    stream.open(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+    stream.write(reinterpret_cast<const char*>(png_signature.data()), png_signature.size());
+
+    //8 or 16 bit grey, deflated, filter method 0, not interlaced.
+    std::array<uint8_t, 13> header {};
+    store_big_endian(static_cast<uint32_t>(width), header.data());
+    store_big_endian(static_cast<uint32_t>(height), header.data() + 4);
+    header[8] = static_cast<uint8_t>(texel_bytes * 8);
+    write_chunk("IHDR", {{header.data(), header.size()}});
+}
+
+void cpupng::parallel_writer::write_rows(const uint8_t* rows, size_t count) {
+    if (count > height - rows_written)
+    {
+        throw std::runtime_error("More rows were written to " + path + " than it holds.");
+    }
+
+    while (count > 0)
+    {
+        const size_t gathered = rows_written - rows_compressed;
+        const size_t taken = std::min(count, batch_rows - gathered);
+        uint8_t* out = pending.data() + gathered * row_bytes;
+        //PNG samples are big-endian.
+        if (texel_bytes == 2 && std::endian::native == std::endian::little)
+        {
+            for (size_t byte = 0; byte < taken * row_bytes; byte += 2)
+            {
+                out[byte] = rows[byte + 1];
+                out[byte + 1] = rows[byte];
+            }
+        }
+        else
+        {
+            std::memcpy(out, rows, taken * row_bytes);
+        }
+
+        rows += taken * row_bytes;
+        count -= taken;
+        rows_written += taken;
+        if (rows_written - rows_compressed == batch_rows || rows_written == height)
+        {
+            compress_batch(rows_written - rows_compressed);
+        }
+    }
+}
+
+void cpupng::parallel_writer::finish() {
+    if (rows_written != height)
+    {
+        throw std::runtime_error("Only " + std::to_string(rows_written) + " of the " + std::to_string(height) +
+                                 " rows of " + path + " were written.");
+    }
+
+    write_chunk("IEND", {});
+    stream.close();
+    if (!stream)
+    {
+        throw std::runtime_error("Could not write to " + path);
+    }
+}
+
+void cpupng::parallel_writer::compress_batch(size_t count) {
+    const bool is_last = rows_compressed + count == height;
+    const size_t num_chunks = (count + chunk_rows - 1) / chunk_rows;
+    const size_t filtered_pitch = row_bytes + 1;
+    filtered.resize(window + count * filtered_pitch);
+    compressed.resize(num_chunks);
+    chunk_adlers.resize(num_chunks);
+
+    //each chunk filters, checksums and deflates its own rows. Its dictionary is the filtered bytes before it, so every
+    //chunk is filtered before any is deflated.
+    CPUThreadPool& pool = *options.pool;
+    pool.parallel_for(num_chunks, num_chunks, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++)
+        {
+            auto preferred = ROW_FILTER::SUB;
+            for (size_t row = chunk * chunk_rows; row < std::min(count, (chunk + 1) * chunk_rows); row++)
+            {
+                const uint8_t* previous = row == 0 ? previous_row.data() : pending.data() + (row - 1) * row_bytes;
+                preferred = filter_row(pending.data() + row * row_bytes, previous, row_bytes, texel_bytes, preferred,
+                                       filtered.data() + window + row * filtered_pitch);
+            }
+        }
+    });
+    pool.parallel_for(num_chunks, num_chunks, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++)
+        {
+            const size_t first = window + chunk * chunk_rows * filtered_pitch;
+            const size_t size = (std::min(count, (chunk + 1) * chunk_rows) - chunk * chunk_rows) * filtered_pitch;
+            const size_t dictionary = std::min(deflate_window, first);
+            chunk_adlers[chunk] = adler_checksum(filtered.data() + first, size);
+            compressed[chunk] = deflate_chunk(filtered.data() + first, size, filtered.data() + first - dictionary,
+                                              dictionary, options.level, is_last && chunk + 1 == num_chunks);
+        }
+    });
+
+    //the zlib header opens the stream in the first IDAT, and the combined checksum closes it in the last.
+    std::vector<std::pair<const uint8_t*, size_t>> pieces;
+    //a 32 KiB window, the level class deflate itself would record, and a check making the pair a multiple of 31.
+    const int level_class = options.level < 2 ? 0 : options.level < 6 ? 1 : options.level == 6 ? 2 : 3;
+    std::array<uint8_t, 2> zlib_header {0x78, static_cast<uint8_t>(level_class << 6)};
+    zlib_header[1] = static_cast<uint8_t>(zlib_header[1] + (31 - (zlib_header[0] * 256 + zlib_header[1]) % 31) % 31);
+    if (rows_compressed == 0)
+    {
+        pieces.emplace_back(zlib_header.data(), zlib_header.size());
+    }
+    for (size_t chunk = 0; chunk < num_chunks; chunk++)
+    {
+        const size_t size = (std::min(count, (chunk + 1) * chunk_rows) - chunk * chunk_rows) * filtered_pitch;
+        adler = combine_adlers(adler, chunk_adlers[chunk], size);
+        pieces.emplace_back(compressed[chunk].data(), compressed[chunk].size());
+    }
+    std::array<uint8_t, 4> zlib_trailer {};
+    if (is_last)
+    {
+        store_big_endian(adler, zlib_trailer.data());
+        pieces.emplace_back(zlib_trailer.data(), zlib_trailer.size());
+    }
+    write_chunk("IDAT", pieces);
+
+    //carry the window and the last row over to the next batch.
+    const size_t carried = std::min(deflate_window, filtered.size());
+    std::memmove(filtered.data(), filtered.data() + filtered.size() - carried, carried);
+    window = carried;
+    std::memcpy(previous_row.data(), pending.data() + (count - 1) * row_bytes, row_bytes);
+    rows_compressed += count;
+}
+
+void cpupng::parallel_writer::write_chunk(const char* type,
+                                          const std::vector<std::pair<const uint8_t*, size_t>>& pieces) {
+    size_t size = 0;
+    for (const auto& piece : pieces)
+    {
+        size += piece.second;
+    }
+    if (size > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+    {
+        throw std::runtime_error("A chunk of " + path + " is too large for a PNG.");
+    }
+
+    std::array<uint8_t, 8> header {};
+    store_big_endian(static_cast<uint32_t>(size), header.data());
+    std::memcpy(header.data() + 4, type, 4);
+    stream.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    //the CRC covers the type and the data.
+    uint32_t crc = update_crc(0, header.data() + 4, 4);
+    for (const auto& piece : pieces)
+    {
+        stream.write(reinterpret_cast<const char*>(piece.first), static_cast<std::streamsize>(piece.second));
+        crc = update_crc(crc, piece.first, piece.second);
+    }
+
+    std::array<uint8_t, 4> trailer {};
+    store_big_endian(crc, trailer.data());
+    stream.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    if (!stream)
+    {
+        throw std::runtime_error("Could not write to " + path);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef IMG2SDF_CPUPNG_H
+#define IMG2SDF_CPUPNG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "cpu_texture.h"
+#include "CPUThreadPool.h"
+#include "output_format.h"
+
+///A PNG encoder for large grey fields that deflates independent chunks of rows in parallel, as pigz does for gzip.
+///Each chunk is a raw deflate stream primed with the last 32 KiB of the chunk before it as its dictionary, so it
+///compresses almost as well as one serial stream, and every chunk but the last ends on a byte boundary with a sync
+///flush, so the chunks concatenate into the single zlib stream of a standard PNG. Adler-32 checksums are taken per
+///chunk and combined. Only available if zlib was found at build time (IMG2SDF_HAS_ZLIB).
+namespace cpupng
+{
+    ///The PNG row filters (filter method 0).
+    enum class ROW_FILTER : uint8_t
+    {
+        NONE = 0,
+        SUB = 1,
+        UP = 2,
+        AVERAGE = 3,
+        PAETH = 4,
+    };
+
+    ///Whether zlib was compiled in.
+    [[nodiscard]] bool is_available();
+
+    ///Filters `row` (`row_bytes` bytes of big-endian samples, `texel_bytes` per texel) against `previous`, the row
+    ///above or null for the first row, and writes the filter byte followed by the filtered row to `out`. The filter is
+    ///the one whose residuals have the least sum of absolute values, as libpng's adaptive filtering picks, but only
+    ///the predicting filters are tried: a distance field changes by about a texel per texel, so its rows are never
+    ///better left unfiltered, and without a row above UP leaves the row as it is anyway. Ties go to `preferred`, the
+    ///filter of the row above, so runs of rows share a filter byte. Returns the filter chosen.
+    ROW_FILTER filter_row(const uint8_t* row, const uint8_t* previous, size_t row_bytes, size_t texel_bytes,
+                          ROW_FILTER preferred, uint8_t* out);
+
+    struct encoder_options
+    {
+        ///the zlib level, 0 - 9.
+        int level = 6;
+        ///raw bytes deflated per chunk, rounded up to whole rows. Smaller chunks spread across more threads, at a few
+        ///bytes of sync flush each and a little ratio at each boundary.
+        size_t chunk_bytes = 128 * 1024;
+        ///chunks compressed at once, each as a band of `pool`.
+        size_t num_threads = cpuutils::default_thread_count();
+        ///the pool chunks are compressed on, e.g. Img2SDF::get_thread_pool, so compression shares the threads of the
+        ///passes it overlaps. CPUThreadPool::shared() if null.
+        CPUThreadPool* pool = nullptr;
+    };
+
+    ///Writes a single channel 8 or 16 bit grey PNG a few rows at a time. Rows are buffered until `num_threads` chunks
+    ///are ready, then filtered and compressed together, so only that batch of rows is held, and each batch is written
+    ///as an IDAT. Each chunk picks its filters from its own first row, so the compressed stream depends on `level`
+    ///and `chunk_bytes` but not on the number of threads, which only moves the IDAT boundaries.
+    class parallel_writer
+    {
+    public:
+        ///Creates the file at `path` for `width` x `height` texels of UNORM8 or UNORM16, written as 8 or 16 bit grey.
+        ///Throws a std::runtime_error for other formats, if the file cannot be created, or without zlib.
+        parallel_writer(const std::string& path, size_t width, size_t height, OUTPUT_FORMAT format,
+                        const encoder_options& options = {});
+
+        parallel_writer(const parallel_writer&) = delete;
+        parallel_writer& operator=(const parallel_writer&) = delete;
+
+        ///Appends the next `count` rows, each `width` texels in host byte order with no padding.
+        void write_rows(const uint8_t* rows, size_t count);
+
+        ///Writes the end of the image once every row has been written. Throws a std::runtime_error if rows are
+        ///missing or the file could not be written.
+        void finish();
+
+    private:
+        ///Filters and compresses the `count` buffered rows as one batch of chunks, and writes them as an IDAT.
+        ///The last chunk of the image finishes the zlib stream.
+        void compress_batch(size_t count);
+
+        ///Writes a PNG chunk of `type` whose data is `pieces` back to back.
+        void write_chunk(const char* type, const std::vector<std::pair<const uint8_t*, size_t>>& pieces);
+
+        std::string path;
+        std::ofstream stream;
+        encoder_options options;
+        size_t width = 0;
+        size_t height = 0;
+        size_t texel_bytes = 1;
+        size_t row_bytes = 0;
+        size_t chunk_rows = 1;
+        size_t batch_rows = 1;
+        ///rows written so far, and rows compressed so far.
+        size_t rows_written = 0;
+        size_t rows_compressed = 0;
+
+        ///the rows of the batch being gathered, big-endian.
+        std::vector<uint8_t, default_init_allocator<uint8_t>> pending;
+        ///the last row of the previous batch, which the first row of the next is filtered against.
+        std::vector<uint8_t> previous_row;
+        ///up to 32 KiB of filtered bytes from the end of the previous batch, followed by the filtered rows of this one,
+        ///so each chunk's dictionary is the window before it.
+        std::vector<uint8_t, default_init_allocator<uint8_t>> filtered;
+        size_t window = 0;
+        std::vector<std::vector<uint8_t>> compressed;
+        std::vector<uint32_t> chunk_adlers;
+        uint32_t adler = 1;
+    };
+}
+
+#endif //IMG2SDF_CPUPNG_H
@@ -0,0 +1,135 @@
+#include "cpureduce.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    ///reads one value of a strided row, which need not be aligned to a float.
+    inline float value_at(const std::byte* row, size_t x, size_t pixel_stride)
+    {
+        float value;
+        std::memcpy(&value, row + x * pixel_stride, sizeof(float));
+        return value;
+    }
+
+    ///rows [begin, end) of `view` into `statistics`.
+    void fold_rows(const cpureduce::float_view& view, size_t begin, size_t end, cpukernels::statistics_span kernel,
+                   cpukernels::float_statistics& statistics)
+    {
+        for (size_t y = begin; y < end; y++)
+        {
+            const std::byte* row = view.row(y);
+            if (view.is_packed() && reinterpret_cast<uintptr_t>(row) % alignof(float) == 0)
+            {
+                kernel(reinterpret_cast<const float*>(row), view.width, statistics);
+                continue;
+            }
+
+            for (size_t x = 0; x < view.width; x++)
+            {
+                const float value = value_at(row, x, view.pixel_stride);
+                statistics.minimum = value < statistics.minimum ? value : statistics.minimum;
+                statistics.maximum = value > statistics.maximum ? value : statistics.maximum;
+                statistics.sum += value;
+            }
+            statistics.count += view.width;
+        }
+    }
+
+    ///the number of bands a reduction of `view` is split into, and the rows in each.
+    std::pair<size_t, size_t> band_layout(const cpureduce::float_view& view, size_t num_bands)
+    {
+        const size_t max_bands = std::max<size_t>(1, view.width * view.height / cpureduce::min_band_values);
+        const size_t bands = std::clamp<size_t>(std::min(num_bands, max_bands), 1, std::max<size_t>(1, view.height));
+        const size_t band_size = std::max<size_t>(1, (view.height + bands - 1) / bands);
+        return {(view.height + band_size - 1) / band_size, band_size};
+    }
+}
+
+cpukernels::float_statistics cpureduce::statistics(const float_view& view, size_t num_bands, CPUThreadPool* pool,
+                                                   cpukernels::SIMD_LEVEL simd_level) {
+    const auto kernel = cpukernels::statistics_kernel(simd_level);
+    pool = pool ? pool : CPUThreadPool::shared().get();
+
+    const auto [bands, band_size] = band_layout(view, num_bands);
+    std::vector<cpukernels::float_statistics> partials (bands);
+    pool->parallel_for(bands, bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; band++)
+        {
+            fold_rows(view, band * band_size, std::min(view.height, (band + 1) * band_size), kernel, partials[band]);
+        }
+    });
+
+    cpukernels::float_statistics total {};
+    for (const auto& partial : partials)
+    {
+        total.merge(partial);
+    }
+    return total;
+}
+
+std::pair<float, float> cpureduce::min_max(const float_view& view, size_t num_bands, CPUThreadPool* pool,
+                                           cpukernels::SIMD_LEVEL simd_level) {
+    const auto total = statistics(view, num_bands, pool, simd_level);
+    return {total.minimum, total.maximum};
+}
+
+std::pair<float, float> cpureduce::min_max(const std::vector<float>& values, size_t num_bands, CPUThreadPool* pool,
+                                           cpukernels::SIMD_LEVEL simd_level) {
+    //a single row would be a single band, so the array is folded as rows of min_band_values instead.
+    const size_t rows = values.size() / min_band_values;
+    const size_t remainder = values.size() - rows * min_band_values;
+    const float_view full_rows {values.data(), min_band_values, rows, min_band_values * sizeof(float)};
+    const float_view last_row {values.data() + rows * min_band_values, remainder, 1, remainder * sizeof(float)};
+
+    auto total = statistics(full_rows, num_bands, pool, simd_level);
+    total.merge(statistics(last_row, 1, pool, simd_level));
+    return {total.minimum, total.maximum};
+}
+
+std::vector<size_t> cpureduce::histogram(const float_view& view, size_t num_bins, float low, float high,
+                                         size_t num_bands, CPUThreadPool* pool) {
+    if (num_bins == 0 || !(low < high))
+    {
+        throw std::runtime_error("A histogram needs at least one bin and a range with low < high.");
+    }
+    pool = pool ? pool : CPUThreadPool::shared().get();
+
+    const double scale = static_cast<double>(num_bins) / (static_cast<double>(high) - static_cast<double>(low));
+    const auto last_bin = static_cast<double>(num_bins - 1);
+
+    const auto [bands, band_size] = band_layout(view, num_bands);
+    std::vector<std::vector<size_t>> partials (bands, std::vector<size_t>(num_bins, 0));
+    pool->parallel_for(bands, bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; band++)
+        {
+            auto& counts = partials[band];
+            const size_t row_end = std::min(view.height, (band + 1) * band_size);
+            for (size_t y = band * band_size; y < row_end; y++)
+            {
+                const std::byte* row = view.row(y);
+                for (size_t x = 0; x < view.width; x++)
+                {
+                    const float value = value_at(row, x, view.pixel_stride);
+                    if (!std::isnan(value))
+                    {
+                        const double bin = std::clamp(std::floor((value - static_cast<double>(low)) * scale), 0.0, last_bin);
+                        counts[static_cast<size_t>(bin)]++;
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<size_t> counts (num_bins, 0);
+    for (const auto& partial : partials)
+    {
+        for (size_t bin = 0; bin < num_bins; bin++)
+        {
+            counts[bin] += partial[bin];
+        }
+    }
+    return counts;
+}
@@ -0,0 +1,85 @@
+#ifndef IMG2SDF_CPUREDUCE_H
+#define IMG2SDF_CPUREDUCE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "cpu_texture.h"
+#include "cpukernels.h"
+#include "cpuutils.h"
+#include "CPUThreadPool.h"
+
+///Reductions over float images on the CPU: row bands on a CPUThreadPool, each row folded by the vectorised
+///cpukernels::statistics_span. This is the CPU counterpart of minmax_reduce.hlsl, and takes over wherever the GPU
+///reduction would leave a UAV too small to reduce further.
+namespace cpureduce
+{
+    ///Read only view of a float image, or of one channel of an image of float vectors. Pitches are in bytes, as in a
+    ///D3D11_MAPPED_SUBRESOURCE, so a view can also cover a padded staging texture.
+    struct float_view
+    {
+        const std::byte* data = nullptr;
+        size_t width = 0;
+        size_t height = 0;
+        ///bytes from the start of one row to the start of the next.
+        size_t row_pitch = 0;
+        ///bytes from one value to the next within a row. Rows of tightly packed floats are read with vector loads.
+        size_t pixel_stride = sizeof(float);
+
+        float_view() = default;
+
+        float_view(const void* data, size_t width, size_t height, size_t row_pitch, size_t pixel_stride = sizeof(float)) :
+        data(static_cast<const std::byte*>(data)), width(width), height(height), row_pitch(row_pitch),
+        pixel_stride(pixel_stride) {}
+
+        [[nodiscard]] const std::byte* row(size_t y) const { return data + y * row_pitch; }
+
+        [[nodiscard]] bool is_packed() const { return pixel_stride == sizeof(float); }
+    };
+
+    ///Views smaller than this are reduced by a single band, as waking the pool costs more than it saves.
+    constexpr size_t min_band_values = 1 << 16;
+
+    [[nodiscard]] inline float_view view(const cpu_texture<float>& texture)
+    {
+        return {texture.data.data(), texture.width, texture.height, texture.width * sizeof(float)};
+    }
+
+    ///Channel `channel` (0 for x, 1 for y, ...) of a texture of float2 or float4.
+    template <typename vector_type>
+    [[nodiscard]] float_view channel_view(const cpu_texture<vector_type>& texture, size_t channel)
+    {
+        static_assert(sizeof(vector_type) % sizeof(float) == 0, "channel_view takes textures of float vectors.");
+        return {reinterpret_cast<const std::byte*>(texture.data.data()) + channel * sizeof(float), texture.width,
+                texture.height, texture.width * sizeof(vector_type), sizeof(vector_type)};
+    }
+
+    ///Minimum, maximum, sum and count of every value in `view`, split into at most `num_bands` row bands.
+    ///NaNs are skipped by the minimum and maximum. An empty view gives {inf, -inf}.
+    ///@param pool the pool the bands run on, or null for CPUThreadPool::shared().
+    [[nodiscard]] cpukernels::float_statistics statistics(const float_view& view,
+                                                          size_t num_bands = cpuutils::default_thread_count(),
+                                                          CPUThreadPool* pool = nullptr,
+                                                          cpukernels::SIMD_LEVEL simd_level = cpukernels::best_simd_level());
+
+    ///{minimum, maximum} of `view`; see statistics.
+    [[nodiscard]] std::pair<float, float> min_max(const float_view& view,
+                                                  size_t num_bands = cpuutils::default_thread_count(),
+                                                  CPUThreadPool* pool = nullptr,
+                                                  cpukernels::SIMD_LEVEL simd_level = cpukernels::best_simd_level());
+
+    ///{minimum, maximum} of an array, such as a field read back from the GPU. The array is reduced as rows of
+    ///min_band_values, so a large one splits into bands as an image does, and the remainder as a row of its own.
+    [[nodiscard]] std::pair<float, float> min_max(const std::vector<float>& values,
+                                                  size_t num_bands = cpuutils::default_thread_count(),
+                                                  CPUThreadPool* pool = nullptr,
+                                                  cpukernels::SIMD_LEVEL simd_level = cpukernels::best_simd_level());
+
+    ///Counts the values of `view` in `num_bins` equal bins spanning [low, high]. Values outside the range are counted
+    ///in the first or last bin, and NaNs are not counted. Throws a std::runtime_error unless num_bins > 0 and low < high.
+    [[nodiscard]] std::vector<size_t> histogram(const float_view& view, size_t num_bins, float low, float high,
+                                                size_t num_bands = cpuutils::default_thread_count(),
+                                                CPUThreadPool* pool = nullptr);
+}
+
+#endif //IMG2SDF_CPUREDUCE_H
@@ -0,0 +1,99 @@
+#include "cpuutils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+size_t cpuutils::default_thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::pair<float, float> cpuutils::combine_min_max(const std::vector<float2>& partials) {
+    float minimum = std::numeric_limits<float>::infinity();
+    float maximum = -std::numeric_limits<float>::infinity();
+
+    for (const auto& partial : partials)
+    {
+        minimum = std::min(minimum, partial.x);
+        maximum = std::max(maximum, partial.y);
+    }
+
+    return {minimum, maximum};
+}
+
+void cpuutils::min_max_accumulator::merge(const float2& partial) {
+    std::lock_guard lock (range_mutex);
+    range.x = std::min(range.x, partial.x);
+    range.y = std::max(range.y, partial.y);
+}
+
+std::pair<float, float> cpuutils::min_max_accumulator::get() const {
+    std::lock_guard lock (range_mutex);
+    return {range.x, range.y};
+}
+
+uint16_t cpuutils::float_to_half(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const auto sign = static_cast<uint16_t>((bits >> 16u) & 0x8000u);
+    const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u)
+    {
+        //infinity, or a quiet NaN.
+        return sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x0200u : 0u);
+    }
+    if (magnitude >= 0x477FF000u)
+    {
+        //at least 65520, which rounds past the largest half.
+        return sign | 0x7C00u;
+    }
+    if (magnitude < 0x38800000u)
+    {
+        //below the smallest normal half (2^-14): a denormal, or zero under half of the smallest denormal (2^-25).
+        if (magnitude <= 0x33000000u)
+        {
+            return sign;
+        }
+        const uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126u - (magnitude >> 23u);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    //rebias the exponent from 127 to 15 and drop 13 mantissa bits. A carry out of the mantissa correctly bumps the exponent.
+    uint32_t half = (magnitude - 0x38000000u) >> 13u;
+    const uint32_t remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+float cpuutils::half_to_float(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16u;
+    const uint32_t exponent = (value >> 10u) & 0x1Fu;
+    const uint32_t mantissa = value & 0x3FFu;
+
+    if (exponent == 0)
+    {
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    const uint32_t bits = exponent == 0x1Fu
+            ? sign | 0x7F800000u | (mantissa << 13u)
+            : sign | ((exponent + 112u) << 23u) | (mantissa << 13u);
+    float result = 0;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
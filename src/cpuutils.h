@@ -0,0 +1,150 @@
+#ifndef IMG2SDF_CPUUTILS_H
+#define IMG2SDF_CPUUTILS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "shader_globals.h"
+
+namespace cpuutils
+{
+    ///Number of threads the CPU pipeline splits each pass across by default. Never returns 0.
+    size_t default_thread_count();
+
+    ///Combines per-band minmax pairs (x = minimum, y = maximum) into a single {minimum, maximum}.
+    std::pair<float, float> combine_min_max(const std::vector<float2>& partials);
+
+    ///Nearest seed of a texel on the CPU, packed into 32 bits: seed x in the low 16 bits, seed y in the high 16.
+    ///A quarter of the size of the float4 {x, y, id, squared distance} texel of the voronoi UAV, whose id and distance
+    ///can both be recomputed from the coordinates; see unpack_seed.
+    using packed_seed = uint32_t;
+
+    ///Texel with no seed (yet). Never a valid seed, as coordinates stop at max_packed_dimension - 1.
+    constexpr packed_seed no_seed = 0xFFFFFFFFu;
+
+    ///Largest width or height a packed voronoi buffer can address.
+    constexpr size_t max_packed_dimension = 0xFFFF;
+
+    inline packed_seed pack_seed(size_t x, size_t y)
+    {
+        return static_cast<packed_seed>(x) | (static_cast<packed_seed>(y) << 16u);
+    }
+
+    inline uint32_t seed_x(packed_seed seed) { return seed & 0xFFFFu; }
+    inline uint32_t seed_y(packed_seed seed) { return seed >> 16u; }
+
+    ///Expands the seed of texel (x, y) to the float4 {seed x, seed y, id, squared distance} layout of the voronoi UAV,
+    ///with id = seed_y * width + seed_x + 1. A texel without a seed expands to all zeroes, as in a cleared UAV.
+    inline float4 unpack_seed(packed_seed seed, size_t x, size_t y, size_t width)
+    {
+        if (seed == no_seed)
+        {
+            return {};
+        }
+
+        const auto sx = static_cast<int64_t>(seed_x(seed));
+        const auto sy = static_cast<int64_t>(seed_y(seed));
+        const int64_t dx = sx - static_cast<int64_t>(x);
+        const int64_t dy = sy - static_cast<int64_t>(y);
+        return {static_cast<float>(sx), static_cast<float>(sy),
+                static_cast<float>(static_cast<size_t>(sy) * width + static_cast<size_t>(sx) + 1),
+                static_cast<float>(dx * dx + dy * dy)};
+    }
+
+    ///Spreads the low 16 bits of `value` over the even bits of the result.
+    inline uint32_t spread_bits(uint32_t value)
+    {
+        value &= 0x0000FFFFu;
+        value = (value | (value << 8u)) & 0x00FF00FFu;
+        value = (value | (value << 4u)) & 0x0F0F0F0Fu;
+        value = (value | (value << 2u)) & 0x33333333u;
+        value = (value | (value << 1u)) & 0x55555555u;
+        return value;
+    }
+
+    ///Inverse of spread_bits: gathers the even bits of `value` into the low 16 bits.
+    inline uint32_t compact_bits(uint32_t value)
+    {
+        value &= 0x55555555u;
+        value = (value | (value >> 1u)) & 0x33333333u;
+        value = (value | (value >> 2u)) & 0x0F0F0F0Fu;
+        value = (value | (value >> 4u)) & 0x00FF00FFu;
+        value = (value | (value >> 8u)) & 0x0000FFFFu;
+        return value;
+    }
+
+    ///Z-order (Morton) index of (x, y): the bits of x and y interleaved, x in the even bits. Any aligned square of side
+    ///2^k is a contiguous run of 4^k indices, starting at the index of its top left texel.
+    inline uint32_t morton_encode(uint32_t x, uint32_t y)
+    {
+        return spread_bits(x) | (spread_bits(y) << 1u);
+    }
+
+    inline uint32_t morton_x(uint32_t index) { return compact_bits(index); }
+    inline uint32_t morton_y(uint32_t index) { return compact_bits(index >> 1u); }
+
+    ///Running minimum and maximum of the values a pass writes, merged from each of its bands. Lets the final stage of a
+    ///pipeline gather the range of the field as it writes it, rather than reading the whole field again afterwards.
+    class min_max_accumulator
+    {
+    public:
+        ///Merges the range of one band (x = minimum, y = maximum). Thread safe, and meant to be called once per band.
+        void merge(const float2& partial);
+
+        [[nodiscard]] std::pair<float, float> get() const;
+
+    private:
+        mutable std::mutex range_mutex;
+        float2 range = {std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+    };
+
+    ///Widens `range` (x = minimum, y = maximum) to include `value`.
+    inline void expand_min_max(float2& range, float value)
+    {
+        range.x = value < range.x ? value : range.x;
+        range.y = value > range.y ? value : range.y;
+    }
+
+    ///Linearly remaps `value` from [in_low, in_high] to [out_low, out_high]. Matches `remap` in utils.hlsi.
+    inline float remap(float value, float in_low, float in_high, float out_low, float out_high)
+    {
+        return out_low + (value - in_low) * (out_high - out_low) / (in_high - in_low);
+    }
+
+    ///Remaps distances from [minimum, maximum] to [out_low, 1], clamped, as normalise.hlsl does, with the divide of
+    ///`remap` folded into a scale once per pass. A pass that knows the range ahead of time (a fixed spread, like
+    ///msdfgen's pxrange) applies this as it writes each distance, rather than leaving it to a pass of its own.
+    class distance_normaliser
+    {
+    public:
+        ///A mask with no seeds has an infinite range, every distance the same infinity. It is mapped with a unit scale
+        ///from 0 instead, so each infinity clamps to its own end of the output range: 1, or `out_low` inside.
+        distance_normaliser(float minimum, float maximum, float out_low) :
+        minimum(std::isfinite(minimum) ? minimum : 0.0f), out_low(out_low),
+        scale(std::isfinite(maximum - minimum) ? (1.0f - out_low) / (maximum - minimum) : 1.0f) {}
+
+        float operator()(float value) const
+        {
+            const float normalised = out_low + (value - minimum) * scale;
+            return normalised < out_low ? out_low : (normalised > 1.0f ? 1.0f : normalised);
+        }
+
+    private:
+        float minimum;
+        float out_low;
+        float scale;
+    };
+
+    ///Converts to IEEE 754 half precision, rounding to nearest even as a store to a DXGI_FORMAT_R16_FLOAT UAV does.
+    ///Overflow becomes infinity, NaN stays NaN, and values too small for a half denormal flush to signed zero.
+    uint16_t float_to_half(float value);
+
+    ///Expands an IEEE 754 half to float. Exact, as every half is representable as a float.
+    float half_to_float(uint16_t value);
+}
+
+#endif //IMG2SDF_CPUUTILS_H
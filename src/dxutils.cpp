@@ -70,33 +70,6 @@ std::pair<dxutils::ComPtr<ID3D11Resource>, dxutils::ComPtr<ID3D11ShaderResourceV
 
 }
 
-std::pair<float, float> dxutils::serial_min_max(const std::vector<float>& array) {
-    float minimum = std::numeric_limits<float>::infinity();
-    float maximum = -std::numeric_limits<float>::infinity();
-
-    for (const auto value : array)
-    {
-        minimum = std::min(minimum, value);
-        maximum = std::max(maximum, value);
-    }
-
-    return {minimum, maximum};
-}
-
-std::pair<float, float> dxutils::serial_min_max(const std::vector<float2>& array) {
-    float minimum = std::numeric_limits<float>::infinity();
-    float maximum = -std::numeric_limits<float>::infinity();
-
-    for (const auto value : array)
-    {
-        minimum = std::min(minimum, value.x);
-        maximum = std::max(maximum, value.y);
-    }
-
-    return {minimum, maximum};
-
-}
-
 bool dxutils::is_power_of_two(uint32_t n) {
     return !(n & (n - 1));
 }
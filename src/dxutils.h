@@ -27,11 +27,6 @@ namespace dxutils
 
     ComPtr<ID3D11Texture2D> create_staging_texture(ID3D11Device* device, ID3D11Texture2D *mimic_texture);
 
-    ///Serial (pixel-by-pixel) implementation of min/max statistic calculator for an array.
-    ///Used as a ground-truth reference for the parallel reduce minmax.
-    std::pair<float, float> serial_min_max(const std::vector<float>& array);
-    std::pair<float, float> serial_min_max(const std::vector<float2>& array);
-
     D3D11_MAPPED_SUBRESOURCE
     copy_to_staging(ID3D11DeviceContext *context, ID3D11Texture2D *staging_texture, ID3D11Texture2D *texture, D3D11_TEXTURE2D_DESC* out_desc = nullptr);
 
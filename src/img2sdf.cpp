@@ -4,6 +4,23 @@
 
 #include "img2sdf.h"
 
+#include "CPUJumpFloodResources.h"
+#include "CPUJumpFloodDispatch.h"
+#include "CPUExactDistanceDispatch.h"
+#include "CPUFeatureTransformDispatch.h"
+#include "CPUSparseSeedDispatch.h"
+#include "CPUStreamingDistanceTransform.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
 #include "JumpFloodResources.h"
 #include "jumpflooderror.h"
 #include "JumpFloodDispatch.h"
@@ -20,189 +37,707 @@
 #include "shaders/normalise.hcs"
 #include "shaders/invert.hcs"
 #include "shaders/composite.hcs"
+#endif
+
+Img2SDF::Img2SDF(size_t num_threads, std::vector<size_t> cpu_affinity) :
+thread_pool(std::make_shared<CPUThreadPool>(num_threads, std::move(cpu_affinity))),
+num_threads(std::max<size_t>(1, num_threads)) { }
 
+Img2SDF::Img2SDF(std::shared_ptr<CPUThreadPool> thread_pool) : thread_pool(std::move(thread_pool)) {
+    if (!this->thread_pool)
+    {
+        throw std::runtime_error("Thread pool cannot be null.");
+    }
+    num_threads = this->thread_pool->get_num_threads();
+}
+
+const std::shared_ptr<CPUThreadPool>& Img2SDF::get_thread_pool() const {
+    return this->thread_pool;
+}
+
+void Img2SDF::set_resource_pool(std::shared_ptr<CPUResourcePool> pool) {
+    if (!pool)
+    {
+        throw std::runtime_error("Resource pool cannot be null.");
+    }
+    this->resource_pool = std::move(pool);
+}
+
+const std::shared_ptr<CPUResourcePool>& Img2SDF::get_resource_pool() const {
+    return this->resource_pool;
+}
 
+void Img2SDF::set_cpu_engine(CPU_ENGINE engine) {
+    this->cpu_engine = engine;
+}
+
+CPU_ENGINE Img2SDF::get_cpu_engine() const {
+    return this->cpu_engine;
+}
+
+void Img2SDF::set_flood_schedule(FLOOD_SCHEDULE schedule) {
+    this->flood_schedule = schedule;
+}
+
+FLOOD_SCHEDULE Img2SDF::get_flood_schedule() const {
+    return this->flood_schedule;
+}
+
+CPUJumpFloodDispatch Img2SDF::make_cpu_dispatch(CPUJumpFloodResources& resources) const {
+    CPUJumpFloodDispatch dispatch {&resources, num_threads, thread_pool.get(), cpu_pipeline};
+    dispatch.set_flood_schedule(flood_schedule);
+    return dispatch;
+}
+
+#ifdef _WIN32
 Img2SDF::Img2SDF(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context, ComPtr<ID3D11Debug> debug_layer)
-: device(std::move(device)), context(std::move(context)), debug_layer(std::move(debug_layer)) { }
+: device(std::move(device)), context(std::move(context)), debug_layer(std::move(debug_layer)),
+texture_pool(std::make_shared<D3D11ResourcePool>(D3D11TextureBackend {this->device.Get()})),
+pipeline(JumpFloodDispatch::create_pipeline(this->device.Get())) { }
 
 
 Img2SDF::Img2SDF(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context) : device(std::move(device)),
-                                                                                     context(std::move(context)), debug_layer(nullptr) {
+                                                                                     context(std::move(context)), debug_layer(nullptr),
+texture_pool(std::make_shared<D3D11ResourcePool>(D3D11TextureBackend {this->device.Get()})),
+pipeline(JumpFloodDispatch::create_pipeline(this->device.Get())) {
+
+}
 
+const std::shared_ptr<D3D11ResourcePool>& Img2SDF::get_texture_pool() const {
+    return this->texture_pool;
 }
 
 Microsoft::WRL::ComPtr<ID3D11Texture2D>
-Img2SDF::compute_signed_distance_field(Microsoft::WRL::ComPtr<ID3D11Texture2D> input_texture, bool normalise)
+Img2SDF::compute_signed_distance_field(Microsoft::WRL::ComPtr<ID3D11Texture2D> input_texture, bool normalise, float max_distance,
+                                       float2* out_range)
 {
-    //TODO: make signed.
-    auto outer_jfa_resources = JumpFloodResources(device.Get(), input_texture);
-    auto inner_jfa_resources = JumpFloodResources(device.Get(), input_texture);
+    return compute_signed_distance_field(std::move(input_texture), output_encoding {}, normalise, max_distance, out_range);
+}
+
+Microsoft::WRL::ComPtr<ID3D11Texture2D>
+Img2SDF::compute_signed_distance_field(Microsoft::WRL::ComPtr<ID3D11Texture2D> input_texture, const output_encoding& encoding,
+                                       bool normalise, float max_distance, float2* out_range)
+{
+    //one flood from the inside boundary serves both sides, the sign comes from the mask.
+    auto jfa_resources = JumpFloodResources(device.Get(), std::move(input_texture), texture_pool.get());
+
+    jfa_resources.create_voronoi_uav(true);
+    jfa_resources.create_distance_uav(true);
+    jfa_resources.create_const_buffer();
+
+    JumpFloodDispatch dispatch {this->context.Get(), &jfa_resources, pipeline};
+
+    dispatch.dispatch_boundary_shader();
+    dispatch.dispatch_voronoi_shader(max_distance);
+
+    //a known spread is normalised by the distance pass itself: no minmax is gathered, and no pass waits on one.
+    const float2 spread = {-max_distance, max_distance};
+    if (fuses_normalise(encoding, normalise, max_distance, out_range))
+    {
+        dispatch.dispatch_signed_distance_transform_shader(max_distance, &spread);
+        return jfa_resources.release_texture(RESOURCE_TYPE::DISTANCE_UAV);
+    }
+    dispatch.dispatch_signed_distance_transform_shader(max_distance);
+
+    return finish_distance_field(jfa_resources, dispatch, true, encoding, normalise, max_distance, out_range);
+}
 
-    const size_t Width = outer_jfa_resources.get_resolution().width;
-    const size_t Height = outer_jfa_resources.get_resolution().height;
+ComPtr<ID3D11Texture2D>
+Img2SDF::compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise, float max_distance,
+                                         float2* out_range) {
+    return compute_unsigned_distance_field(std::move(input_texture), output_encoding {}, normalise, max_distance, out_range);
+}
+
+ComPtr<ID3D11Texture2D>
+Img2SDF::compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, const output_encoding& encoding,
+                                         bool normalise, float max_distance, float2* out_range) {
+    auto jfa_resources = JumpFloodResources(device.Get(), std::move(input_texture), texture_pool.get());
+
+    jfa_resources.create_voronoi_uav(true);
+    jfa_resources.create_distance_uav(true);
+    jfa_resources.create_const_buffer();
 
-    ID3D11UnorderedAccessView* outer_voronoi_uav = outer_jfa_resources.create_voronoi_uav(false);
-    ID3D11UnorderedAccessView* inner_voronoi_uav = inner_jfa_resources.create_voronoi_uav(false);
+    JumpFloodDispatch dispatch {this->context.Get(), &jfa_resources, pipeline};
 
-    ID3D11UnorderedAccessView* outer_distance_uav = outer_jfa_resources.create_distance_uav(false);
-    ID3D11UnorderedAccessView* inner_distance_uav = inner_jfa_resources.create_distance_uav(false);
+    dispatch.dispatch_preprocess_shader();
+    dispatch.dispatch_voronoi_shader(max_distance);
 
-    ComPtr<ID3D11Texture2D> inner_distance_texture = nullptr;
-    //inner scope to release temporary distance_resource after ownership is transferred.
+    const float2 spread = {0, max_distance};
+    if (fuses_normalise(encoding, normalise, max_distance, out_range))
     {
-        ComPtr<ID3D11Resource> inner_distance_resource;
-        inner_distance_uav->GetResource(inner_distance_resource.GetAddressOf());
-        HRESULT out = inner_distance_resource.As<ID3D11Texture2D>(&inner_distance_texture);
-        if (FAILED(out)) {
-            throw jumpflood_error(out, "Returned Resource from Distance UAV was not a Texture2D\n");
-            return nullptr;
+        dispatch.dispatch_distance_transform_shader(max_distance, &spread);
+        return jfa_resources.release_texture(RESOURCE_TYPE::DISTANCE_UAV);
+    }
+    dispatch.dispatch_distance_transform_shader(max_distance);
+
+#if DEBUG
+    auto distance_texture = jfa_resources.get_texture(RESOURCE_TYPE::DISTANCE_UAV);
+    auto distance_transform_staging = dxutils::create_staging_texture(this->device.Get(), distance_texture);
+
+    auto distance_transform_data = dxutils::copy_to_vector<float>(this->context.Get(), distance_transform_staging.Get(),
+                                                                  distance_texture);
+
+#endif
+
+    return finish_distance_field(jfa_resources, dispatch, false, encoding, normalise, max_distance, out_range);
+}
+
+bool Img2SDF::fuses_normalise(const output_encoding& encoding, bool normalise, float max_distance,
+                              const float2* out_range) {
+    //the range of the raw field, if asked for, still needs the minmax the distance pass gathers when not normalising.
+    return normalise && max_distance > 0 && encoding.is_identity() && out_range == nullptr;
+}
+
+ComPtr<ID3D11Texture2D> Img2SDF::finish_distance_field(JumpFloodResources& resources, JumpFloodDispatch& dispatch,
+                                                       bool is_signed, const output_encoding& encoding, bool normalise,
+                                                       float max_distance, float2* out_range) {
+    const bool known_range = max_distance > 0;
+
+    //the distance pass left the minmax of each thread group in the reduction UAV, so the range only needs combining.
+    if ((normalise && !known_range) || out_range)
+    {
+        dispatch.dispatch_minmax_combine_shader();
+    }
+    if (out_range)
+    {
+        *out_range = dispatch.read_minmax_range();
+    }
+
+    //a known spread needs no reduction; otherwise the range is read on the GPU, without a readback.
+    const float2 spread = {is_signed ? -max_distance : 0, max_distance};
+
+    if (encoding.is_identity())
+    {
+        //float output is normalised in place.
+        if (normalise && known_range)
+        {
+            dispatch.dispatch_distance_normalise_shader(spread.x, spread.y, is_signed);
         }
+        else if (normalise)
+        {
+            dispatch.dispatch_reduced_normalise_shader(is_signed);
+        }
+        return resources.release_texture(RESOURCE_TYPE::DISTANCE_UAV);
     }
 
-    ID3D11Buffer* outer_const_buffer = outer_jfa_resources.create_const_buffer();
-    ID3D11Buffer* inner_const_buffer = inner_jfa_resources.create_const_buffer();
+    //narrow output is normalised and stored in one pass; the float field stays an intermediate.
+    dispatch.dispatch_quantise_shader(encoding, normalise, is_signed, known_range ? &spread : nullptr);
+    return resources.release_texture(RESOURCE_TYPE::ENCODED_UAV);
+}
+
+
+ComPtr<ID3D11Texture2D> Img2SDF::compute_voronoi_transform(ComPtr<ID3D11Texture2D> input_texture, bool normalise) {
+   auto jfa_resources = JumpFloodResources(device.Get(), input_texture, texture_pool.get());
 
-    //dispatcher probably shouldn't also be compiling.
-    JumpFloodDispatch outer_dispatch {this->device.Get(), this->context.Get(), &outer_jfa_resources};
-    JumpFloodDispatch inner_dispatch {this->device.Get(), this->context.Get(), &inner_jfa_resources};
+    ID3D11UnorderedAccessView* voronoi_uav = jfa_resources.create_voronoi_uav(true);
 
-    outer_dispatch.dispatch_preprocess_shader();
-    outer_dispatch.dispatch_voronoi_shader();
 
-    outer_dispatch.dispatch_distance_transform_shader();
+    ID3D11Buffer* const_buffer = jfa_resources.create_const_buffer();
 
-    inner_dispatch.dispatch_preprocess_shader(true);
-    inner_dispatch.dispatch_voronoi_shader();
-    inner_dispatch.dispatch_distance_transform_shader();
 
+    JumpFloodDispatch dispatch {this->context.Get(), &jfa_resources, pipeline};
 
-    inner_dispatch.dispatch_composite_shader(outer_distance_uav);
+    dispatch.dispatch_preprocess_shader();
+    dispatch.dispatch_voronoi_shader();
 
     if (normalise)
     {
-        bool minmax_reduce_completed = inner_dispatch.dispatch_minmax_reduce_shader();
+        dispatch.dispatch_voronoi_normalise_shader();
+    }
+
+    return jfa_resources.release_texture(RESOURCE_TYPE::VORONOI_UAV);
+
+}
+#endif
+
+CPU_ENGINE Img2SDF::resolve_cpu_engine(CPUJumpFloodResources& resources, bool invert) const {
+    if (cpu_engine != CPU_ENGINE::AUTO)
+    {
+        return cpu_engine;
+    }
+
+    //the seed tracking engines pack coordinates into 16 bits each; the exact transform has no such limit.
+    const auto res = resources.get_resolution();
+    if (res.width > cpuutils::max_packed_dimension || res.height > cpuutils::max_packed_dimension)
+    {
+        return CPU_ENGINE::EXACT_EDT;
+    }
 
-        ID3D11Texture2D* reduce_texture = inner_jfa_resources.get_texture(RESOURCE_TYPE::REDUCE_UAV);
-        ID3D11Texture2D* reduce_staging = inner_jfa_resources.create_owned_staging_texture(reduce_texture);
+    const auto& mask = resources.get_mask(invert);
+    const size_t num_seeds = CPUSparseSeedDispatch::count_seeds(mask, num_threads, thread_pool.get());
+    const double density = static_cast<double>(num_seeds) / static_cast<double>(std::max<size_t>(1, mask.width * mask.height));
+    return density < CPUSparseSeedDispatch::sparse_density_threshold ? CPU_ENGINE::SPARSE_SEED : CPU_ENGINE::FEATURE_TRANSFORM;
+}
 
+std::pair<float, float> Img2SDF::dispatch_cpu_distance_transform(CPUJumpFloodResources& resources, CPUJumpFloodDispatch& dispatch,
+                                                                 bool invert, float max_distance,
+                                                                 const float2* normalise_range) {
+    resources.create_distance_buffer();
 
-        float minimum = 0;
-        float maximum = 0;
-        auto out_minmax = dxutils::copy_to_vector<float2>(this->context.Get(), reduce_staging, reduce_texture);
-        if (!minmax_reduce_completed)
+    switch (resolve_cpu_engine(resources, invert))
+    {
+        case CPU_ENGINE::EXACT_EDT:
         {
-            auto computed = dxutils::serial_min_max(out_minmax);
-            minimum = computed.first;
-            maximum = computed.second;
+            return CPUExactDistanceDispatch {&resources, num_threads, thread_pool.get()}.dispatch_distance_transform(invert, max_distance, normalise_range);
         }
-        else {
-            minimum = out_minmax[0].x;
-            maximum = out_minmax[0].y;
+        case CPU_ENGINE::FEATURE_TRANSFORM:
+        {
+            resources.create_voronoi_buffer();
+            CPUFeatureTransformDispatch {&resources, num_threads, thread_pool.get()}.dispatch_feature_transform(invert);
+            return dispatch.dispatch_distance_transform(max_distance, normalise_range);
         }
+        case CPU_ENGINE::SPARSE_SEED:
+        {
+            resources.create_voronoi_buffer();
+            CPUSparseSeedDispatch {&resources, num_threads, thread_pool.get()}.dispatch_nearest_seed(invert, max_distance);
+            return dispatch.dispatch_distance_transform(max_distance, normalise_range);
+        }
+        case CPU_ENGINE::JUMP_FLOOD:
+        default:
+        {
+            resources.create_voronoi_buffer();
+            dispatch.dispatch_preprocess(invert);
+            dispatch.dispatch_voronoi(max_distance);
+            return dispatch.dispatch_distance_transform(max_distance, normalise_range);
+        }
+    }
+}
 
-        inner_dispatch.dispatch_distance_normalise_shader(minimum, maximum, true);
-
+std::pair<float, float> Img2SDF::dispatch_cpu_signed_distance_transform(CPUJumpFloodResources& resources,
+                                                                        CPUJumpFloodDispatch& dispatch, float max_distance,
+                                                                        const float2* normalise_range) {
+    if (resolve_cpu_engine(resources, false) == CPU_ENGINE::JUMP_FLOOD)
+    {
+        //one flood from the inside boundary serves both sides, as on the GPU.
+        resources.create_voronoi_buffer();
+        resources.create_distance_buffer();
+        dispatch.dispatch_boundary();
+        dispatch.dispatch_voronoi(max_distance);
+        return dispatch.dispatch_signed_distance_transform(max_distance, normalise_range);
     }
 
+    //the exact engines are cheap enough to run once per side, and stay exact inside the mask.
+    auto outer_jfa_resources = CPUJumpFloodResources(&resources.get_mask(), num_threads, thread_pool.get(),
+                                                     resource_pool.get());
+    auto outer_dispatch = make_cpu_dispatch(outer_jfa_resources);
 
+    dispatch_cpu_distance_transform(outer_jfa_resources, outer_dispatch, false, max_distance);
+    dispatch_cpu_distance_transform(resources, dispatch, true, max_distance);
 
-    return inner_jfa_resources.get_texture(RESOURCE_TYPE::DISTANCE_UAV);
+    //the composite is the last pass to write the field, so it gathers the range.
+    return dispatch.dispatch_composite(outer_jfa_resources.create_distance_buffer(false), normalise_range);
 }
 
-ComPtr<ID3D11Texture2D>
-Img2SDF::compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise) {
-    auto jfa_resources = JumpFloodResources(device.Get(), std::move(input_texture));
+cpu_texture<float> Img2SDF::compute_signed_distance_field(const cpu_texture<float>& input_texture, bool normalise,
+                                                          float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_signed_distance_field(jfa_resources, normalise, max_distance, out_range);
+}
 
-    const size_t Width = jfa_resources.get_resolution().width;
-    const size_t Height = jfa_resources.get_resolution().height;
+cpu_texture<float> Img2SDF::compute_signed_distance_field(const cpu_bitmask& input_mask, bool normalise,
+                                                          float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_signed_distance_field(jfa_resources, normalise, max_distance, out_range);
+}
 
-    ID3D11UnorderedAccessView* voronoi_uav = jfa_resources.create_voronoi_uav(true);
+cpu_texture<float> Img2SDF::compute_signed_distance_field(CPUJumpFloodResources& jfa_resources, bool normalise,
+                                                          float max_distance, float2* out_range) {
+    auto dispatch = make_cpu_dispatch(jfa_resources);
 
-    ID3D11UnorderedAccessView* distance_uav = jfa_resources.create_distance_uav(true);
+    //a known spread is normalised by the distance pass itself, with no reduction or second pass over the field.
+    const float2 spread = {-max_distance, max_distance};
+    const bool fixed_range = normalise && max_distance > 0;
+    const auto [minimum, maximum] = dispatch_cpu_signed_distance_transform(jfa_resources, dispatch, max_distance,
+                                                                           fixed_range ? &spread : nullptr);
+    if (out_range)
+    {
+        *out_range = {minimum, maximum};
+    }
 
-    ComPtr<ID3D11Texture2D> distance_texture = nullptr;
-    //inner scope to release temporary distance_resource after ownership is transferred.
+    if (normalise && !fixed_range)
     {
-        ComPtr<ID3D11Resource> distance_resource;
-        distance_uav->GetResource(distance_resource.GetAddressOf());
-        HRESULT out = distance_resource.As<ID3D11Texture2D>(&distance_texture);
-        if (FAILED(out)) {
-            throw jumpflood_error(out, "Returned Resource from Distance UAV was not a Texture2D\n");
-            return nullptr;
-        }
+        dispatch.dispatch_distance_normalise(minimum, maximum, true);
     }
 
-    ID3D11Buffer* const_buffer = jfa_resources.create_const_buffer();
+    return jfa_resources.release_distance_buffer();
+}
 
-    //dispatcher probably shouldn't also be compiling.
-    JumpFloodDispatch dispatch {this->device.Get(), this->context.Get(), &jfa_resources};
+encoded_texture Img2SDF::compute_signed_distance_field(const cpu_texture<float>& input_texture,
+                                                       const output_encoding& encoding, bool normalise,
+                                                       float max_distance, float2* out_range) {
+    encoded_texture encoded (input_texture.width, input_texture.height, encoding.format);
+    compute_signed_distance_field(input_texture, encoding, encoded_view {encoded}, normalise, max_distance, out_range);
+    return encoded;
+}
 
-    dispatch.dispatch_preprocess_shader();
-    dispatch.dispatch_voronoi_shader();
+void Img2SDF::compute_signed_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                            const encoded_view& output, bool normalise,
+                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    compute_signed_distance_field(jfa_resources, encoding, output, normalise, max_distance, out_range);
+}
 
-    dispatch.dispatch_distance_transform_shader();
+encoded_texture Img2SDF::compute_signed_distance_field(const cpu_bitmask& input_mask,
+                                                       const output_encoding& encoding, bool normalise,
+                                                       float max_distance, float2* out_range) {
+    encoded_texture encoded (input_mask.width, input_mask.height, encoding.format);
+    compute_signed_distance_field(input_mask, encoding, encoded_view {encoded}, normalise, max_distance, out_range);
+    return encoded;
+}
 
-#if DEBUG
-    auto distance_transform_staging = dxutils::create_staging_texture(this->device.Get(), distance_texture.Get());
+void Img2SDF::compute_signed_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                            const encoded_view& output, bool normalise,
+                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    compute_signed_distance_field(jfa_resources, encoding, output, normalise, max_distance, out_range);
+}
 
-    auto distance_transform_data = dxutils::copy_to_vector<float>(this->context.Get(), distance_transform_staging.Get(),
-                                                                  distance_texture.Get());
+void Img2SDF::compute_signed_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                            const cpuio::band_writer& writer, bool normalise,
+                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    compute_signed_distance_field(jfa_resources, encoding, writer, normalise, max_distance, out_range);
+}
 
-#endif
+void Img2SDF::compute_signed_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                            const cpuio::band_writer& writer, bool normalise,
+                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    compute_signed_distance_field(jfa_resources, encoding, writer, normalise, max_distance, out_range);
+}
 
-    if (normalise)
+template <typename output_type>
+void Img2SDF::compute_signed_distance_field(CPUJumpFloodResources& jfa_resources, const output_encoding& encoding,
+                                            const output_type& output, bool normalise,
+                                            float max_distance, float2* out_range) {
+    auto dispatch = make_cpu_dispatch(jfa_resources);
+
+    const auto [minimum, maximum] = dispatch_cpu_signed_distance_transform(jfa_resources, dispatch, max_distance);
+    if (out_range)
     {
-        bool minmax_reduce_completed = dispatch.dispatch_minmax_reduce_shader();
+        *out_range = {minimum, maximum};
+    }
 
-        ID3D11Texture2D* reduce_texture = jfa_resources.get_texture(RESOURCE_TYPE::REDUCE_UAV);
-        ID3D11Texture2D* reduce_staging = jfa_resources.create_owned_staging_texture(reduce_texture);
+    //normalise and encode in one pass; the float distance buffer is released with the resources.
+    if (max_distance > 0)
+    {
+        dispatch.dispatch_encode(encoding, output, normalise, -max_distance, max_distance, true);
+    }
+    else
+    {
+        dispatch.dispatch_encode(encoding, output, normalise, minimum, maximum, true);
+    }
+}
 
+cpu_texture<float> Img2SDF::compute_unsigned_distance_field(const cpu_texture<float>& input_texture, bool normalise,
+                                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_unsigned_distance_field(jfa_resources, normalise, max_distance, out_range);
+}
 
-        float minimum = 0;
-        float maximum = 0;
-        auto out_minmax = dxutils::copy_to_vector<float2>(this->context.Get(), reduce_staging, reduce_texture);
-        if (!minmax_reduce_completed)
-        {
-            auto computed = dxutils::serial_min_max(out_minmax);
-            minimum = computed.first;
-            maximum = computed.second;
-        }
-        else {
-            minimum = out_minmax[0].x;
-            maximum = out_minmax[0].y;
-        }
+cpu_texture<float> Img2SDF::compute_unsigned_distance_field(const cpu_bitmask& input_mask, bool normalise,
+                                                            float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_unsigned_distance_field(jfa_resources, normalise, max_distance, out_range);
+}
 
-        dispatch.dispatch_distance_normalise_shader(minimum, maximum, false);
+cpu_texture<float> Img2SDF::compute_unsigned_distance_field(CPUJumpFloodResources& jfa_resources, bool normalise,
+                                                            float max_distance, float2* out_range) {
+    auto dispatch = make_cpu_dispatch(jfa_resources);
 
+    const float2 spread = {0, max_distance};
+    const bool fixed_range = normalise && max_distance > 0;
+    const auto [minimum, maximum] = dispatch_cpu_distance_transform(jfa_resources, dispatch, false, max_distance,
+                                                                    fixed_range ? &spread : nullptr);
+    if (out_range)
+    {
+        *out_range = {minimum, maximum};
     }
 
+    if (normalise && !fixed_range)
+    {
+        dispatch.dispatch_distance_normalise(minimum, maximum, false);
+    }
 
+    return jfa_resources.release_distance_buffer();
+}
 
-    return jfa_resources.get_texture(RESOURCE_TYPE::DISTANCE_UAV);
+encoded_texture Img2SDF::compute_unsigned_distance_field(const cpu_texture<float>& input_texture,
+                                                         const output_encoding& encoding, bool normalise,
+                                                         float max_distance, float2* out_range) {
+    encoded_texture encoded (input_texture.width, input_texture.height, encoding.format);
+    compute_unsigned_distance_field(input_texture, encoding, encoded_view {encoded}, normalise, max_distance, out_range);
+    return encoded;
 }
 
+void Img2SDF::compute_unsigned_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                              const encoded_view& output, bool normalise,
+                                              float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    compute_unsigned_distance_field(jfa_resources, encoding, output, normalise, max_distance, out_range);
+}
 
-ComPtr<ID3D11Texture2D> Img2SDF::compute_voronoi_transform(ComPtr<ID3D11Texture2D> input_texture, bool normalise) {
-   auto jfa_resources = JumpFloodResources(device.Get(), input_texture);
+encoded_texture Img2SDF::compute_unsigned_distance_field(const cpu_bitmask& input_mask,
+                                                         const output_encoding& encoding, bool normalise,
+                                                         float max_distance, float2* out_range) {
+    encoded_texture encoded (input_mask.width, input_mask.height, encoding.format);
+    compute_unsigned_distance_field(input_mask, encoding, encoded_view {encoded}, normalise, max_distance, out_range);
+    return encoded;
+}
 
-    ID3D11UnorderedAccessView* voronoi_uav = jfa_resources.create_voronoi_uav(true);
+void Img2SDF::compute_unsigned_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                              const encoded_view& output, bool normalise,
+                                              float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    compute_unsigned_distance_field(jfa_resources, encoding, output, normalise, max_distance, out_range);
+}
 
+void Img2SDF::compute_unsigned_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                              const cpuio::band_writer& writer, bool normalise,
+                                              float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    compute_unsigned_distance_field(jfa_resources, encoding, writer, normalise, max_distance, out_range);
+}
 
-    ID3D11Buffer* const_buffer = jfa_resources.create_const_buffer();
+void Img2SDF::compute_unsigned_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                              const cpuio::band_writer& writer, bool normalise,
+                                              float max_distance, float2* out_range) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    compute_unsigned_distance_field(jfa_resources, encoding, writer, normalise, max_distance, out_range);
+}
 
+template <typename output_type>
+void Img2SDF::compute_unsigned_distance_field(CPUJumpFloodResources& jfa_resources, const output_encoding& encoding,
+                                              const output_type& output, bool normalise,
+                                              float max_distance, float2* out_range) {
+    auto dispatch = make_cpu_dispatch(jfa_resources);
 
-    //dispatcher probably shouldn't also be compiling.
-    JumpFloodDispatch dispatch {this->device.Get(), this->context.Get(), &jfa_resources};
+    const auto [minimum, maximum] = dispatch_cpu_distance_transform(jfa_resources, dispatch, false, max_distance);
+    if (out_range)
+    {
+        *out_range = {minimum, maximum};
+    }
 
-    dispatch.dispatch_preprocess_shader();
-    dispatch.dispatch_voronoi_shader();
+    if (max_distance > 0)
+    {
+        dispatch.dispatch_encode(encoding, output, normalise, 0, max_distance, false);
+    }
+    else
+    {
+        dispatch.dispatch_encode(encoding, output, normalise, minimum, maximum, false);
+    }
+}
 
-    if (normalise)
+cpu_texture<float4> Img2SDF::compute_voronoi_transform(const cpu_texture<float>& input_texture, bool normalise) {
+    auto jfa_resources = CPUJumpFloodResources(&input_texture, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_voronoi_transform(jfa_resources, normalise);
+}
+
+cpu_texture<float4> Img2SDF::compute_voronoi_transform(const cpu_bitmask& input_mask, bool normalise) {
+    auto jfa_resources = CPUJumpFloodResources(&input_mask, num_threads, thread_pool.get(), resource_pool.get());
+    return compute_voronoi_transform(jfa_resources, normalise);
+}
+
+cpu_texture<float4> Img2SDF::compute_voronoi_transform(CPUJumpFloodResources& jfa_resources, bool normalise) {
+    jfa_resources.create_voronoi_buffer();
+
+    auto dispatch = make_cpu_dispatch(jfa_resources);
+
+    switch (resolve_cpu_engine(jfa_resources, false))
     {
-        dispatch.dispatch_voronoi_normalise_shader();
+        case CPU_ENGINE::JUMP_FLOOD:
+        {
+            dispatch.dispatch_preprocess();
+            dispatch.dispatch_voronoi();
+            break;
+        }
+        case CPU_ENGINE::SPARSE_SEED:
+        {
+            CPUSparseSeedDispatch {&jfa_resources, num_threads, thread_pool.get()}.dispatch_nearest_seed();
+            break;
+        }
+        default:
+        {
+            CPUFeatureTransformDispatch {&jfa_resources, num_threads, thread_pool.get()}.dispatch_feature_transform();
+            break;
+        }
+    }
+
+    //the engines work on packed seeds; only the result is expanded to float4.
+    return normalise ? dispatch.dispatch_voronoi_normalise() : dispatch.dispatch_voronoi_unpack();
+}
+
+void Img2SDF::compute_tiled_distance_field(size_t width, size_t height, const cpuio::region_reader& reader,
+                                           const cpuio::region_writer& writer, float max_distance, bool is_signed,
+                                           bool normalise, size_t tile_size) {
+    if (max_distance <= 0)
+    {
+        throw std::runtime_error("Tiled distance fields need a max_distance greater than 0, which sets the halo.");
+    }
+    if (tile_size == 0)
+    {
+        throw std::runtime_error("Tile size must be greater than 0.");
     }
 
-    return jfa_resources.get_texture(RESOURCE_TYPE::VORONOI_UAV);
+    const auto halo = static_cast<size_t>(std::ceil(max_distance));
+    const size_t tiles_x = (width + tile_size - 1) / tile_size;
+    const size_t tiles_y = (height + tile_size - 1) / tile_size;
+    const size_t num_tiles = tiles_x * tiles_y;
+
+    //each worker pulls the next tile as it finishes the last, so only num_threads tiles are ever resident.
+    std::atomic<size_t> next_tile = 0;
+    std::exception_ptr first_error = nullptr;
+    std::mutex error_mutex;
+
+    thread_pool->parallel_for(num_threads, num_threads, [&](size_t, size_t) {
+        //tile passes run on the same pool: each worker mostly runs its own tile's bands, and workers that run out of
+        //tiles steal bands from the ones still going, rather than starting threads of their own.
+        Img2SDF tile_img2sdf {thread_pool};
+        //tiles are mostly the same size, so after the first few their buffers come from the pool.
+        tile_img2sdf.set_resource_pool(resource_pool);
+        tile_img2sdf.set_cpu_engine(cpu_engine);
+        tile_img2sdf.set_flood_schedule(flood_schedule);
+
+        for (size_t tile = next_tile++; tile < num_tiles; tile = next_tile++)
+        {
+            try
+            {
+                const size_t tile_x = (tile % tiles_x) * tile_size;
+                const size_t tile_y = (tile / tiles_x) * tile_size;
+                const size_t tile_width = std::min(tile_size, width - tile_x);
+                const size_t tile_height = std::min(tile_size, height - tile_y);
+
+                //the halo is clipped to the image rather than padded, so the image border is not mistaken for an edge.
+                const size_t region_x = tile_x - std::min(tile_x, halo);
+                const size_t region_y = tile_y - std::min(tile_y, halo);
+                const size_t region_width = std::min(width, tile_x + tile_width + halo) - region_x;
+                const size_t region_height = std::min(height, tile_y + tile_height + halo) - region_y;
+
+                cpu_texture<float> region (region_width, region_height);
+                reader(region_x, region_y, region);
+
+                const auto field = is_signed
+                        ? tile_img2sdf.compute_signed_distance_field(region, normalise, max_distance)
+                        : tile_img2sdf.compute_unsigned_distance_field(region, normalise, max_distance);
+
+                cpu_texture<float> out_tile (tile_width, tile_height);
+                for (size_t y = 0; y < tile_height; y++)
+                {
+                    const float* field_row = field.row(tile_y - region_y + y) + (tile_x - region_x);
+                    std::copy(field_row, field_row + tile_width, out_tile.row(y));
+                }
+
+                writer(tile_x, tile_y, out_tile);
+            }
+            catch (...)
+            {
+                std::lock_guard lock (error_mutex);
+                if (!first_error)
+                {
+                    first_error = std::current_exception();
+                }
+                next_tile = num_tiles;
+            }
+        }
+    });
 
+    if (first_error)
+    {
+        std::rethrow_exception(first_error);
+    }
 }
 
+void Img2SDF::compute_streaming_distance_field(size_t width, size_t height, const cpuio::row_reader& reader,
+                                               const cpuio::row_writer& writer, bool is_signed, float max_distance,
+                                               bool normalise, size_t band_rows) {
+    CPUStreamingDistanceTransform transform {width, height, writer, is_signed, max_distance, normalise};
+    band_rows = std::clamp<size_t>(band_rows, 1, height);
+
+    //double buffered: the reader fills one band while the transform consumes the other.
+    std::mutex band_mutex;
+    std::condition_variable band_ready;
+    std::deque<std::vector<float>> free_bands (2, std::vector<float>(band_rows * width));
+    std::deque<std::vector<float>> full_bands;
+    std::exception_ptr reader_error = nullptr;
+    bool stop = false;
+
+    std::thread reader_thread ([&]() {
+        try
+        {
+            for (size_t band_start = 0; band_start < height; band_start += band_rows)
+            {
+                std::vector<float> band;
+                {
+                    std::unique_lock lock (band_mutex);
+                    band_ready.wait(lock, [&]() { return stop || !free_bands.empty(); });
+                    if (stop)
+                    {
+                        return;
+                    }
+                    band = std::move(free_bands.front());
+                    free_bands.pop_front();
+                }
+
+                const size_t band_end = std::min(height, band_start + band_rows);
+                for (size_t y = band_start; y < band_end; y++)
+                {
+                    reader(y, band.data() + (y - band_start) * width);
+                }
+
+                std::lock_guard lock (band_mutex);
+                full_bands.push_back(std::move(band));
+                band_ready.notify_all();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock (band_mutex);
+            reader_error = std::current_exception();
+            band_ready.notify_all();
+        }
+    });
+
+    try
+    {
+        for (size_t band_start = 0; band_start < height; band_start += band_rows)
+        {
+            std::vector<float> band;
+            {
+                std::unique_lock lock (band_mutex);
+                band_ready.wait(lock, [&]() { return reader_error || !full_bands.empty(); });
+                if (full_bands.empty())
+                {
+                    break;
+                }
+                band = std::move(full_bands.front());
+                full_bands.pop_front();
+            }
+
+            const size_t band_end = std::min(height, band_start + band_rows);
+            for (size_t y = band_start; y < band_end; y++)
+            {
+                transform.push_row(band.data() + (y - band_start) * width);
+            }
+
+            std::lock_guard lock (band_mutex);
+            free_bands.push_back(std::move(band));
+            band_ready.notify_all();
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard lock (band_mutex);
+            stop = true;
+            band_ready.notify_all();
+        }
+        reader_thread.join();
+        throw;
+    }
+
+    reader_thread.join();
+    if (reader_error)
+    {
+        std::rethrow_exception(reader_error);
+    }
+}
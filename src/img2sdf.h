@@ -5,41 +5,300 @@
 #ifndef IMG2SDF_IMG2SDF_H
 #define IMG2SDF_IMG2SDF_H
 
+#include "cpu_bitmask.h"
+#include "cpu_texture.h"
+#include "cpuutils.h"
+#include "cpuio.h"
+#include "output_format.h"
+#include "CPUJumpFloodDispatch.h"
+#include "CPUThreadPool.h"
+#include "CPUResourcePool.h"
+#include <memory>
+
+#ifdef _WIN32
 #include <d3d11.h>
 #include <wrl.h>
 #include "JumpFloodResources.h"
 #include "JumpFloodDispatch.h"
+#include "D3D11ResourcePool.h"
 
 using namespace Microsoft::WRL;
+#endif
 
+///Algorithm used by the cpu_texture overloads of Img2SDF.
+enum class CPU_ENGINE
+{
+    ///Jump flood, the same passes as the D3D11 pipeline. Approximate.
+    JUMP_FLOOD,
+    ///Separable exact euclidean distance transform (Felzenszwalb & Huttenlocher). Linear time.
+    ///Does not track seeds, so voronoi transforms use FEATURE_TRANSFORM instead.
+    EXACT_EDT,
+    ///Exact feature transform (Meijster et al.). Linear time, and yields the exact nearest seed for voronoi transforms.
+    FEATURE_TRANSFORM,
+    ///Uniform grid search over the seed list (CPUSparseSeedDispatch). Exact, and much faster than a full image pass
+    ///when there are only a handful of seeds, but degrades as the mask fills up.
+    SPARSE_SEED,
+    ///Counts the seeds of each mask and uses SPARSE_SEED below CPUSparseSeedDispatch::sparse_density_threshold,
+    ///FEATURE_TRANSFORM otherwise. The inside of a signed field is chosen separately from the outside.
+    ///Distance fields wider or taller than cpuutils::max_packed_dimension use EXACT_EDT, which tracks no seeds.
+    AUTO,
+};
 
 class Img2SDF
 {
 public:
+    ///Creates a CPU-only instance. Only the cpu_texture overloads may be used.
+    ///@param num_threads the number of threads in the instance's pool, and of row bands each CPU pass is split across.
+    ///@param cpu_affinity if not empty, the logical CPUs the pool's workers are pinned to; see CPUThreadPool.
+    explicit Img2SDF(size_t num_threads = cpuutils::default_thread_count(), std::vector<size_t> cpu_affinity = {});
+
+    ///Creates a CPU-only instance running on `thread_pool`, e.g. to share one pool between instances processing a
+    ///batch in parallel. CPU passes are split into as many bands as the pool has threads.
+    explicit Img2SDF(std::shared_ptr<CPUThreadPool> thread_pool);
+
+    ///The pool the CPU passes run on. Instances created for a device use CPUThreadPool::shared().
+    [[nodiscard]] const std::shared_ptr<CPUThreadPool>& get_thread_pool() const;
+
+    ///Replaces the pool the CPU overloads lease their intermediate buffers from, e.g. to share one between instances.
+    ///Each instance starts with a pool of its own, capped at default_pool_memory_cap; its cap is set through
+    ///get_resource_pool()->set_memory_cap. Throws a std::runtime_error if `pool` is null.
+    void set_resource_pool(std::shared_ptr<CPUResourcePool> pool);
+    [[nodiscard]] const std::shared_ptr<CPUResourcePool>& get_resource_pool() const;
+
+    ///Selects the algorithm used by the cpu_texture overloads. Defaults to CPU_ENGINE::JUMP_FLOOD.
+    void set_cpu_engine(CPU_ENGINE engine);
+    [[nodiscard]] CPU_ENGINE get_cpu_engine() const;
+
+    ///Selects the texel order of the CPU jump flood passes. Defaults to FLOOD_SCHEDULE::ROWS.
+    void set_flood_schedule(FLOOD_SCHEDULE schedule);
+    [[nodiscard]] FLOOD_SCHEDULE get_flood_schedule() const;
+
+#ifdef _WIN32
     Img2SDF(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context, ComPtr<ID3D11Debug> debug_layer);
     Img2SDF(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context);
 
+    ///The pool the D3D11 overloads lease their intermediate textures from. The textures returned to the caller are
+    ///taken out of it. Its cap is set through get_texture_pool()->set_memory_cap.
+    [[nodiscard]] const std::shared_ptr<D3D11ResourcePool>& get_texture_pool() const;
+
     ///Computes a signed distance field from the provided input texture.
-    ///@param input_texture a seed mask of size 2^n * 2^n, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAULT.
+    ///@param input_texture a seed mask of any size, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAULT.
     ///@param normalise whether to normalise the result to -1, 1.
-    ComPtr<ID3D11Texture2D> compute_signed_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise = true);
+    ///@param max_distance if greater than 0, the spread of the field. Distances are clamped to it, the jump flood skips
+    ///passes longer than it needs, and normalisation maps [-max_distance, max_distance] without a min/max reduction.
+    ///Otherwise the range is gathered by the distance pass itself and normalised against on the GPU, with no readback.
+    ///@param out_range if not null, receives the range of the field before normalisation (x = minimum, y = maximum).
+    ///This costs a single texel readback.
+    ComPtr<ID3D11Texture2D> compute_signed_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise = true,
+                                                          float max_distance = 0, float2* out_range = nullptr);
+
+    ///As above, but the final pass normalises and stores the field as `encoding` in one go (quantise.hlsl), so a
+    ///narrow output is the only full-size texture written after the distance pass.
+    ///@returns a texture in the DXGI format of `encoding.format` (see JumpFloodResources::dxgi_format).
+    ComPtr<ID3D11Texture2D> compute_signed_distance_field(ComPtr<ID3D11Texture2D> input_texture, const output_encoding& encoding,
+                                                          bool normalise = true, float max_distance = 0,
+                                                          float2* out_range = nullptr);
 
     ///Computes a signed distance field from the provided input texture.
-    ///@param input_texture a seed mask of size 2^n * 2^n, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAULT.
+    ///@param input_texture a seed mask of any size, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAULT.
     ///@param normalise whether to normalise the result to 0, 1.
-    ComPtr<ID3D11Texture2D> compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise = true);
+    ///@param max_distance if greater than 0, the spread of the field. Distances are clamped to it, the jump flood skips
+    ///passes longer than it needs, and normalisation maps [0, max_distance] without a min/max reduction.
+    ///Otherwise the range is gathered by the distance pass itself and normalised against on the GPU, with no readback.
+    ///@param out_range if not null, receives the range of the field before normalisation (x = minimum, y = maximum).
+    ///This costs a single texel readback.
+    ComPtr<ID3D11Texture2D> compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, bool normalise = true,
+                                                            float max_distance = 0, float2* out_range = nullptr);
+
+    ///As above, but the final pass normalises and stores the field as `encoding` in one go (quantise.hlsl).
+    ///@returns a texture in the DXGI format of `encoding.format` (see JumpFloodResources::dxgi_format).
+    ComPtr<ID3D11Texture2D> compute_unsigned_distance_field(ComPtr<ID3D11Texture2D> input_texture, const output_encoding& encoding,
+                                                            bool normalise = true, float max_distance = 0,
+                                                            float2* out_range = nullptr);
 
     ///Computes a voronoi transform from the provided seed texture.
-    ///@param input_texture a seed mask of size 2^n * 2^n, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAUT.
+    ///@param input_texture a seed mask of any size, with D3D11_BIND_SHADER_RESOURCE, DXGI_FORMAT_R32_FLOAT, and D3D11_USAGE_DEFAUT.
     ///@param normalise whether to normalise the result to normalised texel coordinates (0-1 along width and height).
     ComPtr<ID3D11Texture2D> compute_voronoi_transform(ComPtr<ID3D11Texture2D> input_texture, bool normalise = false);
+#endif
+
+    ///Computes a signed distance field from the provided input mask on the CPU.
+    ///Every engine puts a mask with nothing inside (or nothing outside) infinitely far from its boundary: distances
+    ///are infinite (negative inside), or +-max_distance with a spread, and normalise to 1 (-1 inside).
+    ///@param input_texture a seed mask of any size. Texels greater than 0 are inside the mask.
+    ///@param normalise whether to normalise the result to -1, 1.
+    ///@param max_distance if greater than 0, the spread of the field. Distances are clamped to it, the jump flood skips
+    ///passes longer than it needs, and normalisation maps [-max_distance, max_distance] without a min/max reduction.
+    ///Otherwise the range is gathered by the last pass to write the field, so the field is not read again to find it.
+    ///@param out_range if not null, receives the range of the field before normalisation (x = minimum, y = maximum).
+    cpu_texture<float> compute_signed_distance_field(const cpu_texture<float>& input_texture, bool normalise = true,
+                                                     float max_distance = 0, float2* out_range = nullptr);
+
+    ///As above, but the final pass normalises and stores the field as `encoding` in one go, so a narrow output never
+    ///goes through a normalised float copy. e.g. output_encoding::full_range(OUTPUT_FORMAT::UNORM8, true) maps [-1, 1]
+    ///onto 0 - 255.
+    encoded_texture compute_signed_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                                  bool normalise = true, float max_distance = 0, float2* out_range = nullptr);
+
+    ///Computes an unsigned distance field from the provided input mask on the CPU.
+    ///Every engine puts a mask with no seeds infinitely far from one: distances are infinite, or max_distance with a
+    ///spread, and normalise to 1.
+    ///@param input_texture a seed mask of any size. Texels greater than 0 are seeds.
+    ///@param normalise whether to normalise the result to 0, 1.
+    ///@param max_distance if greater than 0, the spread of the field. Distances are clamped to it, the jump flood skips
+    ///passes longer than it needs, and normalisation maps [0, max_distance] without a min/max reduction.
+    ///Otherwise the range is gathered by the last pass to write the field, so the field is not read again to find it.
+    ///@param out_range if not null, receives the range of the field before normalisation (x = minimum, y = maximum).
+    cpu_texture<float> compute_unsigned_distance_field(const cpu_texture<float>& input_texture, bool normalise = true,
+                                                       float max_distance = 0, float2* out_range = nullptr);
+
+    ///As above, but the final pass normalises and stores the field as `encoding` in one go.
+    encoded_texture compute_unsigned_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                                    bool normalise = true, float max_distance = 0, float2* out_range = nullptr);
+
+    ///Computes a voronoi transform from the provided seed mask on the CPU.
+    ///CPU_ENGINE::EXACT_EDT does not track seeds, so uses the feature transform.
+    ///With CPU_ENGINE::AUTO, sparse seed masks use the grid search.
+    ///@param input_texture a seed mask of any size. Texels greater than 0 are seeds.
+    ///@param normalise whether to normalise the result to normalised texel coordinates (0-1 along width and height).
+    cpu_texture<float4> compute_voronoi_transform(const cpu_texture<float>& input_texture, bool normalise = false);
+
+    ///The overloads above for a bit-packed mask, a 32nd of the size of a float one, which the CPU engines read
+    ///directly. Set texels are inside the mask (seeds, for the unsigned field and the voronoi transform).
+    cpu_texture<float> compute_signed_distance_field(const cpu_bitmask& input_mask, bool normalise = true,
+                                                     float max_distance = 0, float2* out_range = nullptr);
+    encoded_texture compute_signed_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                                  bool normalise = true, float max_distance = 0, float2* out_range = nullptr);
+    cpu_texture<float> compute_unsigned_distance_field(const cpu_bitmask& input_mask, bool normalise = true,
+                                                       float max_distance = 0, float2* out_range = nullptr);
+    encoded_texture compute_unsigned_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                                    bool normalise = true, float max_distance = 0, float2* out_range = nullptr);
+    cpu_texture<float4> compute_voronoi_transform(const cpu_bitmask& input_mask, bool normalise = false);
+
+    ///As the encoded overloads above, but the final pass stores the field in `output` rather than a new
+    ///encoded_texture, e.g. straight into the pages of a cpumap::mapped_image. `output` must match the size of the
+    ///mask and the format of `encoding`.
+    void compute_signed_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                       const encoded_view& output, bool normalise = true, float max_distance = 0,
+                                       float2* out_range = nullptr);
+    void compute_signed_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                       const encoded_view& output, bool normalise = true, float max_distance = 0,
+                                       float2* out_range = nullptr);
+    void compute_unsigned_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                         const encoded_view& output, bool normalise = true, float max_distance = 0,
+                                         float2* out_range = nullptr);
+    void compute_unsigned_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                         const encoded_view& output, bool normalise = true, float max_distance = 0,
+                                         float2* out_range = nullptr);
+
+    ///As the encoded overloads above, but the final pass hands the field to `writer` a band of rows at a time as it
+    ///is quantised, e.g. cpuimage::image_writer::band_writer, which compresses each band on a thread of its own while
+    ///the next is computed. Only a band of the encoded field is ever held, rather than an encoded copy of the image.
+    void compute_signed_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                       const cpuio::band_writer& writer, bool normalise = true, float max_distance = 0,
+                                       float2* out_range = nullptr);
+    void compute_signed_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                       const cpuio::band_writer& writer, bool normalise = true, float max_distance = 0,
+                                       float2* out_range = nullptr);
+    void compute_unsigned_distance_field(const cpu_texture<float>& input_texture, const output_encoding& encoding,
+                                         const cpuio::band_writer& writer, bool normalise = true,
+                                         float max_distance = 0, float2* out_range = nullptr);
+    void compute_unsigned_distance_field(const cpu_bitmask& input_mask, const output_encoding& encoding,
+                                         const cpuio::band_writer& writer, bool normalise = true,
+                                         float max_distance = 0, float2* out_range = nullptr);
+
+    ///Computes a band limited distance field tile by tile on the CPU, for masks too large to hold in memory.
+    ///Each tile is read with a halo of `max_distance` texels, which holds every seed within the spread of the tile,
+    ///so the stitched result matches the untiled field with the same `max_distance`. Tiles are processed by up to
+    ///`num_threads` workers on the instance's pool and handed to `writer` as they finish, so at most `num_threads` tiles are resident at once
+    ///and peak memory depends on `tile_size` and `max_distance` rather than the image size.
+    ///@param width, height size of the full mask.
+    ///@param reader reads regions of the mask. Texels greater than 0 are inside the mask.
+    ///@param writer receives each finished tile, e.g. cpuio::raw_region_file::writer.
+    ///@param max_distance the spread, in texels. Must be greater than 0.
+    ///@param is_signed whether to compute a signed field (negative inside the mask) or an unsigned one.
+    ///@param normalise whether to normalise against the spread, as in compute_signed/unsigned_distance_field.
+    ///@param tile_size width and height of each tile, excluding the halo.
+    void compute_tiled_distance_field(size_t width, size_t height, const cpuio::region_reader& reader,
+                                      const cpuio::region_writer& writer, float max_distance, bool is_signed = true,
+                                      bool normalise = true, size_t tile_size = 1024);
+
+    ///Computes an exact distance field from a mask read one row at a time, top to bottom, emitting each output row as
+    ///soon as it is final (see CPUStreamingDistanceTransform). Only O(width) column state and a band of rows stay in
+    ///memory, and rows are read on a separate thread, `band_rows` at a time, so I/O overlaps the transform.
+    ///Always exact, regardless of the selected CPU engine.
+    ///@param reader reads rows of the mask in order. Texels greater than 0 are inside the mask.
+    ///@param writer receives output rows in order, e.g. cpuio::raw_row_writer.
+    ///@param max_distance if greater than 0, distances are clamped to this spread, which also bounds the rows held back.
+    ///@param normalise whether to normalise against max_distance. Requires a max_distance.
+    void compute_streaming_distance_field(size_t width, size_t height, const cpuio::row_reader& reader,
+                                          const cpuio::row_writer& writer, bool is_signed = true,
+                                          float max_distance = 0, bool normalise = false, size_t band_rows = 64);
 
 private:
+    ///A CPU dispatch for `resources` with this instance's thread count and flood schedule.
+    [[nodiscard]] CPUJumpFloodDispatch make_cpu_dispatch(class CPUJumpFloodResources& resources) const;
+
+    ///Resolves CPU_ENGINE::AUTO to a concrete engine for the seeds of `resources` (inverted if `invert`).
+    [[nodiscard]] CPU_ENGINE resolve_cpu_engine(class CPUJumpFloodResources& resources, bool invert) const;
+
+    ///The public CPU overloads, on resources wrapping either kind of mask.
+    cpu_texture<float> compute_signed_distance_field(class CPUJumpFloodResources& jfa_resources, bool normalise,
+                                                     float max_distance, float2* out_range);
+    ///`output_type` is either destination CPUJumpFloodDispatch::dispatch_encode takes: an encoded_view or a
+    ///cpuio::band_writer.
+    template <typename output_type>
+    void compute_signed_distance_field(class CPUJumpFloodResources& jfa_resources, const output_encoding& encoding,
+                                       const output_type& output, bool normalise, float max_distance, float2* out_range);
+    cpu_texture<float> compute_unsigned_distance_field(class CPUJumpFloodResources& jfa_resources, bool normalise,
+                                                       float max_distance, float2* out_range);
+    template <typename output_type>
+    void compute_unsigned_distance_field(class CPUJumpFloodResources& jfa_resources, const output_encoding& encoding,
+                                         const output_type& output, bool normalise, float max_distance, float2* out_range);
+    cpu_texture<float4> compute_voronoi_transform(class CPUJumpFloodResources& jfa_resources, bool normalise);
+
+    ///Runs the selected CPU engine to fill the distance buffer of `resources`, returning its {minimum, maximum}.
+    ///@param normalise_range if not null, the last pass normalises the field from this fixed range as it writes it.
+    std::pair<float, float> dispatch_cpu_distance_transform(class CPUJumpFloodResources& resources,
+                                                            class CPUJumpFloodDispatch& dispatch, bool invert,
+                                                            float max_distance, const float2* normalise_range = nullptr);
+
+    ///Runs the selected CPU engine to fill the distance buffer of `resources` with a signed field, returning its
+    ///{minimum, maximum}. Jump flood uses a single flood from the inside boundary; the exact engines run each side.
+    ///@param normalise_range if not null, the last pass normalises the field from this fixed range as it writes it.
+    std::pair<float, float> dispatch_cpu_signed_distance_transform(class CPUJumpFloodResources& resources,
+                                                                   class CPUJumpFloodDispatch& dispatch, float max_distance,
+                                                                   const float2* normalise_range = nullptr);
+
+#ifdef _WIN32
+    ///True if the distance pass can normalise against the fixed spread `max_distance` as it writes, which it can for
+    ///float output when the range of the raw field is not asked for.
+    static bool fuses_normalise(const output_encoding& encoding, bool normalise, float max_distance, const float2* out_range);
+
+    ///Gathers the range the distance pass left in the reduction UAV if it is needed, then normalises the field in
+    ///place, or normalises and encodes it into the encoded UAV if `encoding` is not plain float.
+    ///@returns the texture holding the final field.
+    ComPtr<ID3D11Texture2D> finish_distance_field(JumpFloodResources& resources, JumpFloodDispatch& dispatch, bool is_signed,
+                                                  const output_encoding& encoding, bool normalise, float max_distance,
+                                                  float2* out_range);
+
     ComPtr<ID3D11Device> device;
     ComPtr<ID3D11DeviceContext> context;
 
     ComPtr<ID3D11Debug> debug_layer;
 
+    std::shared_ptr<D3D11ResourcePool> texture_pool;
+    ///the shaders, created once with the instance rather than by each call's dispatch.
+    std::shared_ptr<const JumpFloodPipeline> pipeline;
+#endif
+
+    std::shared_ptr<CPUThreadPool> thread_pool = CPUThreadPool::shared();
+    std::shared_ptr<CPUResourcePool> resource_pool = std::make_shared<CPUResourcePool>();
+    std::shared_ptr<const CPUJumpFloodPipeline> cpu_pipeline = CPUJumpFloodPipeline::shared();
+    size_t num_threads = cpuutils::default_thread_count();
+    CPU_ENGINE cpu_engine = CPU_ENGINE::JUMP_FLOOD;
+    FLOOD_SCHEDULE flood_schedule = FLOOD_SCHEDULE::ROWS;
+
 
 };
 #endif //IMG2SDF_IMG2SDF_H
@@ -0,0 +1,104 @@
+#ifndef IMG2SDF_OUTPUT_FORMAT_H
+#define IMG2SDF_OUTPUT_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+///Storage format of the final stage of a distance field.
+enum class OUTPUT_FORMAT
+{
+    ///32 bit float, the format every pass computes in.
+    FLOAT32,
+    ///16 bit (half) float, DXGI_FORMAT_R16_FLOAT.
+    FLOAT16,
+    ///16 bit unsigned normalised, DXGI_FORMAT_R16_UNORM: [0, 1] stored as 0 - 65535.
+    UNORM16,
+    ///8 bit unsigned normalised, DXGI_FORMAT_R8_UNORM: [0, 1] stored as 0 - 255.
+    UNORM8,
+};
+
+///How the final stage stores a field: each (optionally normalised) distance d is stored as d * scale + bias,
+///converted to `format`. Unorm formats clamp to [0, 1], so a signed field normalised to [-1, 1] wants a scale and bias
+///of 0.5, putting the edge of the mask at mid grey. The spread is the max_distance the field is normalised against.
+struct output_encoding
+{
+    OUTPUT_FORMAT format = OUTPUT_FORMAT::FLOAT32;
+    float scale = 1.0f;
+    float bias = 0.0f;
+
+    ///Maps a normalised field onto the full [0, 1] range of `format`: [-1, 1] if `is_signed`, [0, 1] otherwise.
+    static output_encoding full_range(OUTPUT_FORMAT format, bool is_signed)
+    {
+        return is_signed ? output_encoding {format, 0.5f, 0.5f} : output_encoding {format, 1.0f, 0.0f};
+    }
+
+    ///True if the field is stored exactly as computed, so the final stage can write in place.
+    [[nodiscard]] bool is_identity() const
+    {
+        return format == OUTPUT_FORMAT::FLOAT32 && scale == 1.0f && bias == 0.0f;
+    }
+};
+
+constexpr size_t bytes_per_texel(OUTPUT_FORMAT format)
+{
+    switch (format)
+    {
+        case OUTPUT_FORMAT::FLOAT16:
+        case OUTPUT_FORMAT::UNORM16:
+            return 2;
+        case OUTPUT_FORMAT::UNORM8:
+            return 1;
+        case OUTPUT_FORMAT::FLOAT32:
+        default:
+            return 4;
+    }
+}
+
+///A field in the storage format of an output_encoding, row-major and tightly packed.
+///Texels are stored in host byte order, as they would be in the matching DXGI format.
+struct encoded_texture
+{
+    size_t width = 0;
+    size_t height = 0;
+    OUTPUT_FORMAT format = OUTPUT_FORMAT::FLOAT32;
+    std::vector<uint8_t> data;
+
+    encoded_texture() = default;
+
+    encoded_texture(size_t width, size_t height, OUTPUT_FORMAT format) :
+    width(width), height(height), format(format), data(width * height * bytes_per_texel(format)) {}
+
+    [[nodiscard]] size_t row_pitch() const { return width * bytes_per_texel(format); }
+
+    uint8_t* row(size_t y) { return data.data() + y * row_pitch(); }
+    const uint8_t* row(size_t y) const { return data.data() + y * row_pitch(); }
+};
+
+///Where the final stage stores a field without owning the memory: an encoded_texture, or e.g. the pages of a mapped
+///file (cpumap::mapped_image), so the field is encoded straight into its destination.
+struct encoded_view
+{
+    size_t width = 0;
+    size_t height = 0;
+    OUTPUT_FORMAT format = OUTPUT_FORMAT::FLOAT32;
+    uint8_t* data = nullptr;
+    ///bytes from one row to the next. Negative for files stored bottom to top, with `data` at row 0.
+    std::ptrdiff_t row_pitch = 0;
+    ///16 bit texels are stored most significant byte first, as PGM wants, rather than in host byte order.
+    bool big_endian = false;
+
+    encoded_view() = default;
+
+    encoded_view(size_t width, size_t height, OUTPUT_FORMAT format, uint8_t* data, std::ptrdiff_t row_pitch,
+                 bool big_endian = false) :
+    width(width), height(height), format(format), data(data), row_pitch(row_pitch), big_endian(big_endian) {}
+
+    explicit encoded_view(encoded_texture& texture) :
+    width(texture.width), height(texture.height), format(texture.format), data(texture.data.data()),
+    row_pitch(static_cast<std::ptrdiff_t>(texture.row_pitch())) {}
+
+    [[nodiscard]] uint8_t* row(size_t y) const { return data + static_cast<std::ptrdiff_t>(y) * row_pitch; }
+};
+
+#endif //IMG2SDF_OUTPUT_FORMAT_H
@@ -6,9 +6,13 @@
 #define IMG2SDF_SHADER_GLOBALS_H
 
 
+#ifdef _WIN32
 #include <d3d11.h>
 #include <d3dcommon.h>
 #include <d3dcompiler.h>
+#endif
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -51,6 +55,15 @@ struct alignas(16) JFA_cbuffer
     float Minimum;
     float Maximum;
     float Signed; //0 for unsigned field, -1 for signed field.
+
+    //distance dispatch
+    float MaxDistance; //0 for unbounded, otherwise distances are clamped to this spread.
+
+    //quantise dispatch
+    float Scale;
+    float Bias;
+    int32_t EncodeFlags; //ENCODE_* bits of quantise.hlsl.
+    int32_t DistanceFlags; //DISTANCE_* bits of utils.hlsi.
 };
 
 #pragma pack(16)
@@ -0,0 +1,31 @@
+#include "mask.hlsi"
+
+RWTexture2D<float4> Seeds : register(u0);
+
+///Seeds only the inside boundary of the mask: texels inside it with an outside 4-neighbour.
+///The nearest inside texel to any outside texel is always on this boundary, so one flood from it serves both
+///sides of a signed field (see signed_distance.hlsl).
+[numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
+void boundary(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    if (out_of_bounds(dispatchThreadId.xy))
+    {
+        return;
+    }
+
+    int2 index = dispatchThreadId.xy;
+    if (!(MaskIn[index] > 0.0))
+    {
+        return;
+    }
+
+    [unroll]
+    for (int i = 0; i < 4; i++)
+    {
+        if (is_outside(index + neighbour_offsets[i]))
+        {
+            Seeds[dispatchThreadId.xy] = float4(dispatchThreadId.x, dispatchThreadId.y, index_2D_to_1D(dispatchThreadId.yx, Width) + 1, 1.#INF);
+            return;
+        }
+    }
+}
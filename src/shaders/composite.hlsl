@@ -7,6 +7,11 @@ RWTexture2D<float> Inner : register(u1);
 [numthreads(GROUP_THREAD_DIM, GROUP_THREAD_DIM, 1)]
 void composite(uint3 dispatchThreadId : SV_DispatchThreadID)
 {
+    if (out_of_bounds(dispatchThreadId.xy))
+    {
+        return;
+    }
+
     if (Outer[dispatchThreadId.xy] == 0 && Inner[dispatchThreadId.xy] > 0)
     {
         Inner[dispatchThreadId.xy] = -Inner[dispatchThreadId.xy];
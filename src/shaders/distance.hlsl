@@ -1,12 +1,49 @@
 #include "utils.hlsi"
+#include "threadgroup_reduce.hlsi"
 RWTexture2D<float4> Seeds : register(u0);
 RWTexture2D<float> Distance : register(u1);
+RWTexture2D<float2> Reduce : register(u2);
 
 
-[numthreads(8,8,1)]
-void distance(uint3 dispatchThreadId: SV_DispatchThreadID)
+///Writes the distance to each texel's seed, and the minmax of its thread group into Reduce, so normalising needs only
+///the small combine in minmax_reduce.hlsl rather than a second read of the whole field.
+///With DISTANCE_NORMALISE the range is fixed ahead of time: each distance is normalised as it is written and no
+///minmax is gathered, so nothing after this pass waits on the whole field.
+[numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
+void distance(uint3 dispatchThreadId: SV_DispatchThreadID, uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID)
 {
-        float d = distance(Seeds[dispatchThreadId.xy].xy, dispatchThreadId.xy);
-        Distance[dispatchThreadId.xy] = d;
+        uint mem_index = index_2D_to_1D(threadID.xy, GROUP_THREAD_DIM);
 
-}
\ No newline at end of file
+        //no early out: every thread has to reach the group barriers. Threads past the edge read as an empty range.
+        minmax[mem_index] = float2(1.#INF, -1.#INF);
+        if (!out_of_bounds(dispatchThreadId.xy))
+        {
+            //a texel with no seed (a cleared, zero id) is infinitely far from one, not measured from the origin.
+            float4 seed = Seeds[dispatchThreadId.xy];
+            float d = seed.z > 0 ? distance(seed.xy, dispatchThreadId.xy) : 1.#INF;
+
+            //band limited: texels the flood never reached are at least max_distance away.
+            if (max_distance > 0)
+            {
+                d = min(d, max_distance);
+            }
+            Distance[dispatchThreadId.xy] = (distance_flags & DISTANCE_NORMALISE) ? normalise_distance(d) : d;
+            minmax[mem_index] = float2(d, d);
+        }
+
+        //distance_flags comes from the constant buffer, so the whole group leaves before the barriers together.
+        if (distance_flags & DISTANCE_NORMALISE)
+        {
+            return;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        thread_group_minmax(mem_index);
+        GroupMemoryBarrierWithGroupSync();
+
+        if (mem_index == 0)
+        {
+            Reduce[groupID.xy] = minmax[mem_index];
+        }
+
+}
@@ -3,15 +3,15 @@
 RWTexture2D<float4> Seeds : register(u0);
 
 
-float offset(float width, int pass_index)
+///Returns the number of passes the JFA kernel needs to make: log2 of the larger dimension, rounded up.
+int num_steps(float width, float height)
 {
-    return floor(pow(2, (log2(width) - pass_index - 1)));
+    return ceil(log2(max(width, height)));
 }
 
-///Returns the number of passes the JFA kernel needs to make for a square texture.
-int num_steps(float width)
+float offset(int pass_index)
 {
-    return floor(log2(width));
+    return floor(pow(2, (num_steps(Width, Height) - pass_index - 1)));
 }
 
 void minimum_distance(float2 position, float4 target_point, inout float4 mindistancepoint)
@@ -32,10 +32,15 @@ void minimum_distance(float2 position, float4 target_point, inout float4 mindist
 void main(uint3 groupId : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID, uint3 dispatchThreadId : SV_DispatchThreadID,
             uint groupIndex : SV_GroupIndex)
 {
+    if (out_of_bounds(dispatchThreadId.xy))
+    {
+        return;
+    }
+
     //compute voronoi diagram.
 
     float4 mindistance = float4(0,0,0,1.#INF);
-    float delta = offset(Width, iteration);
+    float delta = offset(iteration);
 
     float2 north_offset = {0, delta};
     float2 northeast_offset = {delta, delta};
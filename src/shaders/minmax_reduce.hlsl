@@ -13,7 +13,10 @@ void reduce(uint3 dispatchThreadId: SV_DispatchThreadID, uint3 groupID : SV_Grou
 
     uint mem_index = index_2D_to_1D(threadID.xy, GROUP_THREAD_DIM);
 
-    minmax[mem_index] = Reduce[dispatchThreadId.xy];
+    //threads past the edge of the Reduce texture read as an empty range.
+    uint reduce_width, reduce_height;
+    Reduce.GetDimensions(reduce_width, reduce_height);
+    minmax[mem_index] = all(dispatchThreadId.xy < uint2(reduce_width, reduce_height)) ? Reduce[dispatchThreadId.xy] : float2(1.#INF, -1.#INF);
     GroupMemoryBarrierWithGroupSync();
 
     thread_group_minmax(mem_index);
@@ -12,7 +12,11 @@ void reduce_firstpass(uint3 dispatchThreadId: SV_DispatchThreadID, uint3 groupID
 {
 
     uint mem_index = index_2D_to_1D(threadID.xy, GROUP_THREAD_DIM);
-    minmax[mem_index] = float2(Input[dispatchThreadId.xy], Input[dispatchThreadId.xy]);
+    //threads past the edge of a partial group must not contribute, so read as an empty range.
+    uint input_width, input_height;
+    Input.GetDimensions(input_width, input_height);
+    float value = Input[dispatchThreadId.xy];
+    minmax[mem_index] = all(dispatchThreadId.xy < uint2(input_width, input_height)) ? float2(value, value) : float2(1.#INF, -1.#INF);
     //can't start until the data is full!
     GroupMemoryBarrierWithGroupSync();
 
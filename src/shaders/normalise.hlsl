@@ -1,9 +1,16 @@
 #include "utils.hlsi"
 RWTexture2D<float> Distance : register(u0);
 
-///Remaps input linearly. Used to normalise distance based on computed minmax.
+///Remaps input linearly. Used to normalise distance based on computed minmax, or a fixed spread.
+///Clamped, as a fixed spread need not cover every distance in the field. A fixed spread is usually normalised by the
+///distance shaders themselves (DISTANCE_NORMALISE), leaving this pass to ranges gathered on the CPU.
 [numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
 void normalise(uint3 DispatchThreadId : SV_DispatchThreadID)
 {
-    Distance[DispatchThreadId.xy] = remap(Distance[DispatchThreadId.xy], minimum, maximum, is_signed, 1);
+    if (out_of_bounds(DispatchThreadId.xy))
+    {
+        return;
+    }
+
+    Distance[DispatchThreadId.xy] = normalise_distance(Distance[DispatchThreadId.xy]);
 }
\ No newline at end of file
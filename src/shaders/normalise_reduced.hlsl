@@ -0,0 +1,17 @@
+#include "utils.hlsi"
+RWTexture2D<float> Distance : register(u0);
+RWTexture2D<float2> Reduce : register(u1);
+
+///normalise.hlsl against the range left in Reduce[0, 0] by the fused distance pass and minmax_reduce.hlsl, so the
+///range never has to be read back to the CPU.
+[numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
+void normalise_reduced(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (out_of_bounds(DispatchThreadId.xy))
+    {
+        return;
+    }
+
+    float2 range = Reduce[uint2(0, 0)];
+    Distance[DispatchThreadId.xy] = normalise_from(Distance[DispatchThreadId.xy], range.x, range.y);
+}
\ No newline at end of file
@@ -8,9 +8,14 @@ RWTexture2D<float4> Seeds : register(u0);
 [numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
 void preprocess(uint3 dispatchThreadId : SV_DispatchThreadID)
 {
+    if (out_of_bounds(dispatchThreadId.xy))
+    {
+        return;
+    }
+
     if (MaskIn[dispatchThreadId.xy] > 0.0)
     {
-        Seeds[dispatchThreadId.xy] = float4(dispatchThreadId.x, dispatchThreadId.y, index_2D_to_1D(dispatchThreadId.xy, Width) + 1, 1.#INF);
+        Seeds[dispatchThreadId.xy] = float4(dispatchThreadId.x, dispatchThreadId.y, index_2D_to_1D(dispatchThreadId.yx, Width) + 1, 1.#INF);
     }
 
 
@@ -0,0 +1,29 @@
+#include "utils.hlsi"
+RWTexture2D<float> Distance : register(u0);
+RWTexture2D<float2> Reduce : register(u1);
+//R32_FLOAT, R16_FLOAT, R16_UNORM or R8_UNORM; the conversion happens on store.
+RWTexture2D<float> Encoded : register(u2);
+
+//encode_flags, matching JumpFloodDispatch::dispatch_quantise_shader.
+#define ENCODE_NORMALISE 1
+#define ENCODE_REDUCED_RANGE 2
+
+///normalise.hlsl (or normalise_reduced.hlsl) fused with the store to the output format: writes value * scale + bias
+///straight into Encoded, so the normalised field is never written at full precision.
+[numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
+void quantise(uint3 DispatchThreadId : SV_DispatchThreadID)
+{
+    if (out_of_bounds(DispatchThreadId.xy))
+    {
+        return;
+    }
+
+    float value = Distance[DispatchThreadId.xy];
+    if (encode_flags & ENCODE_NORMALISE)
+    {
+        float2 range = (encode_flags & ENCODE_REDUCED_RANGE) ? Reduce[uint2(0, 0)] : float2(minimum, maximum);
+        value = normalise_from(value, range.x, range.y);
+    }
+
+    Encoded[DispatchThreadId.xy] = value * scale + bias;
+}
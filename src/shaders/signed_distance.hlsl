@@ -0,0 +1,73 @@
+#include "mask.hlsi"
+#include "threadgroup_reduce.hlsi"
+
+RWTexture2D<float4> Seeds : register(u0);
+RWTexture2D<float> Distance : register(u1);
+RWTexture2D<float2> Reduce : register(u2);
+
+//signed distance of the texel at `index`, which is also written to Distance (normalised, with DISTANCE_NORMALISE).
+float signed_texel_distance(uint2 index)
+{
+    float4 seed = Seeds[index];
+    float2 position = index;
+    bool inside = MaskIn[index] > 0.0;
+
+    //a mask with no boundary leaves every texel without a seed, infinitely far from the other side.
+    float d = seed.z > 0 ? distance(seed.xy, position) : 1.#INF;
+    if (inside && seed.z > 0)
+    {
+        d = 1.#INF;
+        [unroll]
+        for (int i = 0; i < 4; i++)
+        {
+            int2 neighbour = int2(seed.xy) + neighbour_offsets[i];
+            if (is_outside(neighbour))
+            {
+                d = min(d, distance(float2(neighbour), position));
+            }
+        }
+    }
+
+    //band limited: texels the flood never reached are at least max_distance away.
+    if (max_distance > 0)
+    {
+        d = min(d, max_distance);
+    }
+
+    d = inside ? -d : d;
+    Distance[index] = (distance_flags & DISTANCE_NORMALISE) ? normalise_distance(d) : d;
+    return d;
+}
+
+///Signed distance from a flood of the inside boundary (boundary.hlsl), negative inside the mask.
+///Outside texels take the distance to their boundary seed, which is the nearest inside texel.
+///Inside texels take the distance to the nearest outside neighbour of their boundary seed, so a boundary texel is -1,
+///as it would be with a separate flood of the inverted mask. This can be up to a texel long at sharp concave corners.
+///Also writes the minmax of each thread group into Reduce, or normalises from a fixed range, as in distance.hlsl.
+[numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
+void signed_distance(uint3 dispatchThreadId : SV_DispatchThreadID, uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID)
+{
+    uint mem_index = index_2D_to_1D(threadID.xy, GROUP_THREAD_DIM);
+
+    //no early out: every thread has to reach the group barriers. Threads past the edge read as an empty range.
+    minmax[mem_index] = float2(1.#INF, -1.#INF);
+    if (!out_of_bounds(dispatchThreadId.xy))
+    {
+        minmax[mem_index] = signed_texel_distance(dispatchThreadId.xy).xx;
+    }
+
+    //distance_flags comes from the constant buffer, so the whole group leaves before the barriers together.
+    if (distance_flags & DISTANCE_NORMALISE)
+    {
+        return;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    thread_group_minmax(mem_index);
+    GroupMemoryBarrierWithGroupSync();
+
+    if (mem_index == 0)
+    {
+        Reduce[groupID.xy] = minmax[mem_index];
+    }
+}
\ No newline at end of file
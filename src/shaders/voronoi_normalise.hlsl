@@ -6,6 +6,11 @@ RWTexture2D<float4> Seeds : register(u0);
 [numthreads(GROUP_THREAD_DIM,GROUP_THREAD_DIM,1)]
 void voronoi_normalise(uint3 dispatchThreadId: SV_DispatchThreadID)
 {
+    if (out_of_bounds(dispatchThreadId.xy))
+    {
+        return;
+    }
+
     float4 seed = Seeds[dispatchThreadId.xy].rgba;
 
     seed.r = remap(seed.r, 0, Width, 0, 1);
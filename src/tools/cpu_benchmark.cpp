@@ -0,0 +1,257 @@
+//
+// Benchmarks the CPU jump flood schedules, with cache and TLB miss counts where the platform exposes them, and the
+// throughput of the min/max reduction at each SIMD level.
+//
+#include "../CPUJumpFloodResources.h"
+#include "../CPUJumpFloodDispatch.h"
+#include "../cpukernels.h"
+#include "../cpureduce.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static constexpr int64_t dims[] = {1024, 2048, 4096, 8192};
+
+static constexpr int32_t NUM_RUNS = 5;
+
+static constexpr double seed_density = 0.0001;
+
+static constexpr int64_t reduce_dim = 4096;
+
+namespace {
+
+    ///hardware counters of the calling thread and the threads it spawns. Reads 0 where they cannot be opened.
+    class miss_counters
+    {
+    public:
+        static constexpr size_t num_counters = 3;
+        static constexpr const char* names[num_counters] = {"L1D read misses", "LLC misses", "dTLB read misses"};
+
+        miss_counters()
+        {
+#ifdef __linux__
+            const uint64_t configs[num_counters] = {
+                    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+
+            for (size_t i = 0; i < num_counters; i++)
+            {
+                perf_event_attr attr {};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = configs[i];
+                attr.disabled = 1;
+                attr.inherit = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+#endif
+        }
+
+        ~miss_counters()
+        {
+#ifdef __linux__
+            for (const int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+#endif
+        }
+
+        miss_counters(const miss_counters&) = delete;
+        miss_counters& operator=(const miss_counters&) = delete;
+
+        [[nodiscard]] bool available() const
+        {
+            for (const int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void start()
+        {
+#ifdef __linux__
+            for (const int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        void stop(uint64_t (&out)[num_counters])
+        {
+            for (size_t i = 0; i < num_counters; i++)
+            {
+                out[i] = 0;
+#ifdef __linux__
+                if (fds[i] >= 0)
+                {
+                    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                    uint64_t value = 0;
+                    if (read(fds[i], &value, sizeof(value)) == sizeof(value))
+                    {
+                        out[i] = value;
+                    }
+                }
+#endif
+            }
+        }
+
+    private:
+        int fds[num_counters] = {-1, -1, -1};
+    };
+
+    const char* schedule_name(FLOOD_SCHEDULE schedule)
+    {
+        switch (schedule)
+        {
+            case FLOOD_SCHEDULE::ROWS:
+                return "rows";
+            case FLOOD_SCHEDULE::BLOCKED:
+                return "blocked";
+            case FLOOD_SCHEDULE::MORTON:
+                return "morton";
+        }
+        return "unknown";
+    }
+}
+
+int main()
+{
+    const size_t num_threads = cpuutils::default_thread_count();
+    std::cout << "SIMD level: " << cpukernels::simd_level_name(cpukernels::best_simd_level()) << ", threads: "
+              << num_threads << std::endl;
+
+    miss_counters counters {};
+    if (!counters.available())
+    {
+        std::cout << "Hardware counters unavailable, reporting timings only." << std::endl;
+    }
+
+    std::ofstream out_csv {};
+    out_csv.open("cpu_perf.csv");
+    out_csv << "Schedule,Size,Milliseconds";
+    for (const auto* name : miss_counters::names)
+    {
+        out_csv << "," << name;
+    }
+    out_csv << std::endl;
+
+    std::default_random_engine random_gen {};
+    std::bernoulli_distribution distribution (seed_density);
+
+    for (const auto dim : dims)
+    {
+        std::cout << "Generating seed texture of size " << dim << "x" << dim << "...";
+        cpu_texture<float> mask (dim, dim);
+        for (auto& texel : mask.data)
+        {
+            texel = distribution(random_gen) ? 1.0f : 0.0f;
+        }
+        std::cout << "Done." << std::endl;
+
+        for (const auto schedule : {FLOOD_SCHEDULE::ROWS, FLOOD_SCHEDULE::BLOCKED, FLOOD_SCHEDULE::MORTON})
+        {
+            double min_time = std::numeric_limits<double>::infinity();
+            uint64_t min_misses[miss_counters::num_counters] {};
+            std::fill(std::begin(min_misses), std::end(min_misses), std::numeric_limits<uint64_t>::max());
+
+            for (int32_t i = 0; i < NUM_RUNS; i++)
+            {
+                CPUJumpFloodResources resources {&mask};
+                CPUJumpFloodDispatch dispatch {&resources, num_threads};
+                dispatch.set_flood_schedule(schedule);
+                resources.create_voronoi_buffer();
+                dispatch.dispatch_preprocess();
+
+                uint64_t misses[miss_counters::num_counters] {};
+                counters.start();
+                const auto start = std::chrono::steady_clock::now();
+                dispatch.dispatch_voronoi();
+                const auto end = std::chrono::steady_clock::now();
+                counters.stop(misses);
+
+                min_time = std::min(min_time, std::chrono::duration<double, std::milli>(end - start).count());
+                for (size_t c = 0; c < miss_counters::num_counters; c++)
+                {
+                    min_misses[c] = std::min(min_misses[c], misses[c]);
+                }
+            }
+
+            std::cout << std::setw(8) << schedule_name(schedule) << " " << dim << "x" << dim << ": " << std::fixed
+                      << std::setprecision(2) << min_time << " ms";
+            out_csv << schedule_name(schedule) << "," << dim << "," << min_time;
+            for (size_t c = 0; c < miss_counters::num_counters; c++)
+            {
+                if (counters.available())
+                {
+                    std::cout << ", " << miss_counters::names[c] << " " << min_misses[c];
+                }
+                out_csv << "," << (counters.available() ? min_misses[c] : 0);
+            }
+            std::cout << std::endl;
+            out_csv << std::endl;
+        }
+    }
+
+    std::cout << "Reducing a " << reduce_dim << "x" << reduce_dim << " field..." << std::endl;
+    std::uniform_real_distribution<float> field_distribution (-100.0f, 100.0f);
+    cpu_texture<float> field (reduce_dim, reduce_dim);
+    for (auto& value : field.data)
+    {
+        value = field_distribution(random_gen);
+    }
+
+    const double field_bytes = static_cast<double>(field.data.size() * sizeof(float));
+    for (const auto level : cpukernels::supported_simd_levels())
+    {
+        for (const size_t threads : {size_t {1}, num_threads})
+        {
+            double min_time = std::numeric_limits<double>::infinity();
+            for (int32_t i = 0; i < NUM_RUNS; i++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const auto range = cpureduce::min_max(cpureduce::view(field), threads, nullptr, level);
+                const auto end = std::chrono::steady_clock::now();
+                min_time = std::min(min_time, std::chrono::duration<double>(end - start).count());
+                if (range.first > range.second)
+                {
+                    return 1;
+                }
+            }
+
+            std::cout << std::setw(8) << cpukernels::simd_level_name(level) << " " << threads << " thread(s): "
+                      << std::fixed << std::setprecision(2) << min_time * 1000.0 << " ms, "
+                      << field_bytes / min_time / 1e9 << " GB/s" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -2,12 +2,21 @@
 
 #include "program.h"
 
+#include <algorithm>
 #include <iostream>
-#include <d3d11.h>
-#include <wrl.h>
 #include <vector>
 #include <filesystem>
+#include <fstream>
+#include <optional>
 #include <argparse/argparse.hpp>
+#include "../img2sdf.h"
+#include "../cpuio.h"
+#include "../cpuimage.h"
+#include "../cpumap.h"
+
+#ifdef _WIN32
+#include <d3d11.h>
+#include <wrl.h>
 #include "../dxinit.h"
 #include "../dxutils.h"
 #include "../WICTextureWriter.h"
@@ -22,36 +31,202 @@
 #include "../shaders/minmax_reduce.hcs"
 #include "../shaders/minmaxreduce_firstpass.hcs"
 #include "../shaders/normalise.hcs"
-#include "../img2sdf.h"
 #include "../WICTextureLoader.h"
 
 using namespace Microsoft::WRL;
+#endif
 
+///Parses the --format argument: float32, float16, unorm16 or unorm8.
+OUTPUT_FORMAT parse_output_format(const std::string& name)
+{
+    if (name == "float32") { return OUTPUT_FORMAT::FLOAT32; }
+    if (name == "float16") { return OUTPUT_FORMAT::FLOAT16; }
+    if (name == "unorm16") { return OUTPUT_FORMAT::UNORM16; }
+    if (name == "unorm8") { return OUTPUT_FORMAT::UNORM8; }
+    throw std::runtime_error("Unknown output format " + name + ", expected float32, float16, unorm16 or unorm8.");
+}
 
+///Float formats store the normalised field as is; unorm formats map it onto their full range, so a signed field has
+///its edge at mid grey.
+output_encoding cli_encoding(OUTPUT_FORMAT format, bool is_signed)
+{
+    if (format == OUTPUT_FORMAT::UNORM16 || format == OUTPUT_FORMAT::UNORM8)
+    {
+        return output_encoding::full_range(format, is_signed);
+    }
+    return output_encoding {format};
+}
 
-int main(int32_t argc, const char** argv)
+///Runs the CPU pipeline over a headerless R32 float mask, a PGM, PFM or tiled image, or a PNG, TIFF or EXR decoded by
+///cpuimage. Headerless, PGM, PFM and tiled files are mapped (see cpumap): the mask is read in place, and the field is
+///encoded straight into the output file, whose format follows its extension (.pgm, .pfm, .tiles, else headerless).
+///PNG and TIFF outputs are compressed by a cpuimage::image_writer as the final pass finishes each band of rows.
+///With `stream`, the mask is never fully loaded: rows are read, transformed and written top to bottom.
+int run_cpu(const argparse::ArgumentParser& program_parser, bool is_raw)
 {
-    Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
+    const auto max_distance = program_parser.get<float>(parsing::MAX_DISTANCE);
+    const auto input_file = program_parser.get(parsing::INPUT_ARGUMENT);
+    const auto output_file = program_parser.get(parsing::OUTPUT_ARGUMENT);
+    const bool is_signed = program_parser.is_used(parsing::SIGNED);
+    const auto output_format = cpumap::format_from_extension(output_file);
+    const auto image_format = cpuimage::format_from_extension(output_file);
 
-    HRESULT hr = dxinit::create_compute_device(&dxinit::device, &dxinit::context, false);
+    //PGM and PNG store unorm texels only, so their float32 default becomes unorm16.
+    auto texel_format = parse_output_format(program_parser.get(parsing::FORMAT));
+    if ((output_format == cpumap::FILE_FORMAT::PGM || image_format == cpuimage::IMAGE_FORMAT::PNG) &&
+        !program_parser.is_used(parsing::FORMAT))
+    {
+        texel_format = OUTPUT_FORMAT::UNORM16;
+    }
+    const auto encoding = cli_encoding(texel_format, is_signed);
 
-    if (FAILED(hr))
+    Img2SDF img2sdf {};
+    img2sdf.set_cpu_engine(CPU_ENGINE::AUTO);
+
+    //mapped inputs are read in place; images are decoded and thresholded a row at a time, with no full-size
+    //decoded copy.
+    std::optional<cpumap::mapped_image> mapped;
+    std::optional<cpuimage::mask_reader> image;
+    if (is_raw)
     {
-        printf("Failed to create compute device.");
-        return -1;
+        mapped = cpumap::mapped_image::open(input_file, program_parser.get<size_t>(parsing::RAW_WIDTH),
+                                            program_parser.get<size_t>(parsing::RAW_HEIGHT));
     }
+    else if (cpumap::format_from_extension(input_file) != cpumap::FILE_FORMAT::RAW)
+    {
+        mapped = cpumap::mapped_image::open(input_file);
+    }
+    else
+    {
+        image.emplace(input_file);
+    }
+    const size_t width = mapped ? mapped->get_width() : image->get_width();
+    const size_t height = mapped ? mapped->get_height() : image->get_height();
+
+    if (program_parser.is_used(parsing::VORONOI))
+    {
+        if (program_parser.is_used(parsing::STREAM) || output_format != cpumap::FILE_FORMAT::RAW || image_format)
+        {
+            std::cerr << "Voronoi diagrams are only written whole, as headerless float4." << std::endl;
+            return 1;
+        }
+
+        const auto mask = mapped ? mapped->load_bitmask() : cpuimage::load_bitmask(input_file);
+        const auto voronoi = img2sdf.compute_voronoi_transform(mask, true);
+        std::ofstream out_stream (output_file, std::ios::binary);
+        out_stream.write(reinterpret_cast<const char*>(voronoi.data.data()), static_cast<std::streamsize>(voronoi.data.size() * sizeof(float4)));
+        if (!out_stream)
+        {
+            std::cerr << "Could not write output file." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (program_parser.is_used(parsing::STREAM))
+    {
+        if (!encoding.is_identity() || image_format)
+        {
+            std::cerr << "Streamed output is always float32, written through a mapping." << std::endl;
+            return 1;
+        }
+
+        auto output = cpumap::mapped_image::create(output_file, output_format, width, height);
+        img2sdf.compute_streaming_distance_field(width, height, mapped ? mapped->row_reader() : image->row_reader(),
+                                                 output.row_writer(), is_signed, max_distance, max_distance > 0);
+        return 0;
+    }
+
+    if (output_format == cpumap::FILE_FORMAT::TILED)
+    {
+        if (!encoding.is_identity())
+        {
+            std::cerr << "Tiled output is always float32." << std::endl;
+            return 1;
+        }
+
+        //with a spread, a mapped mask is transformed tile by tile, each tile read from and written to the mappings.
+        auto output = cpumap::mapped_image::create(output_file, output_format, width, height);
+        if (mapped && max_distance > 0)
+        {
+            img2sdf.compute_tiled_distance_field(width, height, mapped->region_reader(), output.region_writer(),
+                                                 max_distance, is_signed, true, output.get_tile_size());
+            return 0;
+        }
+
+        const auto mask = mapped ? mapped->load_bitmask() : cpuimage::load_bitmask(input_file);
+        const auto field = is_signed ? img2sdf.compute_signed_distance_field(mask, true, max_distance)
+                                     : img2sdf.compute_unsigned_distance_field(mask, true, max_distance);
+        output.region_writer()(0, 0, field);
+        return 0;
+    }
+
+    //packed at a bit per texel, and normalised and encoded in the final pass, which hands each band of rows to the
+    //writer's thread to compress while it quantises the next.
+    const auto mask = mapped ? mapped->load_bitmask() : cpuimage::load_bitmask(input_file);
+    if (image_format)
+    {
+        cpuimage::image_writer writer {output_file, width, height, encoding.format, 4,
+                                       img2sdf.get_thread_pool().get()};
+        if (is_signed)
+        {
+            img2sdf.compute_signed_distance_field(mask, encoding, writer.band_writer(), true, max_distance);
+        }
+        else
+        {
+            img2sdf.compute_unsigned_distance_field(mask, encoding, writer.band_writer(), true, max_distance);
+        }
+        writer.finish();
+        return 0;
+    }
+
+    //otherwise straight into the output's pages.
+    auto output = cpumap::mapped_image::create(output_file, output_format, width, height, encoding.format);
+    if (is_signed)
+    {
+        img2sdf.compute_signed_distance_field(mask, encoding, output.view(), true, max_distance);
+    }
+    else
+    {
+        img2sdf.compute_unsigned_distance_field(mask, encoding, output.view(), true, max_distance);
+    }
+    return 0;
+}
+
+
 
+int main(int32_t argc, const char** argv)
+{
     //parse arguments
     argparse::ArgumentParser program_parser {parsing::PROGRAM_NAME};
     program_parser.add_argument(parsing::INPUT_ARGUMENT).help("Input image to jumpflood. Must be either"
-                                                              "a PNG, EXR, BMP, TIFF or DDS. Must have width & height a power of 2.");
+                                                              "a PNG, EXR, BMP, TIFF or DDS.");
 
-    program_parser.add_argument(parsing::OUTPUT_ARGUMENT).help("Output image.");
+    program_parser.add_argument(parsing::OUTPUT_ARGUMENT).help("Output image. .pgm, .pfm and .tiles outputs, and "
+                                                               "headerless ones on the CPU, are written through a "
+                                                               "memory mapping. .png and .tif outputs are compressed "
+                                                               "band by band as the field is produced.");
 
     auto& group = program_parser.add_mutually_exclusive_group(true);
     group.add_argument(parsing::UNSIGNED, parsing::UNSIGNED_LONG).help("Generate an unsigned distance field.").flag();
+    group.add_argument(parsing::SIGNED, parsing::SIGNED_LONG).help("Generate a signed distance field.").flag();
     group.add_argument(parsing::VORONOI, parsing::VORONOI_LONG).help("Generate a voronoi diagram.").flag();
 
+    program_parser.add_argument(parsing::MAX_DISTANCE, parsing::MAX_DISTANCE_LONG)
+            .help("Spread of the distance field in pixels. Distances are clamped to it and normalised against it. "
+                  "0 for unbounded.").default_value(0.0f).scan<'g', float>();
+
+    program_parser.add_argument(parsing::RAW_WIDTH).help("Treat the input as a headerless R32 float mask of this width, "
+                                                         "and write a headerless R32 float output.").scan<'u', size_t>();
+    program_parser.add_argument(parsing::RAW_HEIGHT).help("Height of a headerless R32 float input.").scan<'u', size_t>();
+    program_parser.add_argument(parsing::STREAM)
+            .help("Stream the input top to bottom with bounded memory, rather than loading it whole. Exact. "
+                  "Normalised only if a max distance is given.").flag();
+    program_parser.add_argument(parsing::FORMAT, parsing::FORMAT_LONG)
+            .help("Storage format of the distance field: float32, float16, unorm16 or unorm8. Unorm formats map the "
+                  "normalised field onto their full range, with the edge of a signed field at mid grey.")
+            .default_value(std::string {"float32"});
+
     try {
         program_parser.parse_args(argc, argv);
     }
@@ -62,6 +237,49 @@ int main(int32_t argc, const char** argv)
         return 1;
     }
 
+    const bool is_raw = program_parser.is_used(parsing::RAW_WIDTH) && program_parser.is_used(parsing::RAW_HEIGHT);
+    //intermediates in mapped formats skip the WIC encode and decode entirely.
+    const bool is_mapped = cpumap::format_from_extension(program_parser.get(parsing::INPUT_ARGUMENT)) != cpumap::FILE_FORMAT::RAW ||
+                           cpumap::format_from_extension(program_parser.get(parsing::OUTPUT_ARGUMENT)) != cpumap::FILE_FORMAT::RAW;
+    if (is_raw || is_mapped)
+    {
+        try {
+            return run_cpu(program_parser, is_raw);
+        }
+        catch (const std::exception& err)
+        {
+            std::cerr << err.what() << std::endl;
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    //no WIC here: images go through cpuimage and the CPU pipeline, and the field is written headerless.
+    try {
+        return run_cpu(program_parser, false);
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+#else
+    if (program_parser.is_used(parsing::STREAM))
+    {
+        std::cerr << parsing::STREAM << " requires a raw input (" << parsing::RAW_WIDTH << ", " << parsing::RAW_HEIGHT << ")." << std::endl;
+        return 1;
+    }
+
+    Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
+
+    HRESULT hr = dxinit::create_compute_device(&dxinit::device, &dxinit::context, false);
+
+    if (FAILED(hr))
+    {
+        printf("Failed to create compute device.");
+        return -1;
+    }
+
     //create input texture
     auto texture_name = program_parser.get(parsing::INPUT_ARGUMENT);
     auto absolute_texture_path = std::filesystem::absolute({texture_name});
@@ -89,14 +307,36 @@ int main(int32_t argc, const char** argv)
         return -1;
     }
 
+    OUTPUT_FORMAT format = OUTPUT_FORMAT::FLOAT32;
+    try {
+        format = parse_output_format(program_parser.get(parsing::FORMAT));
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+
+    //the field is read back in its encoded format, which WIC converts from.
+    const WICPixelFormatGUID field_formats[] = {GUID_WICPixelFormat32bppGrayFloat, GUID_WICPixelFormat16bppGrayHalf,
+                                                GUID_WICPixelFormat16bppGray, GUID_WICPixelFormat8bppGray};
+    WICPixelFormatGUID output_format = GUID_WICPixelFormat32bppRGBA;
+
     WICPixelFormatGUID resource_format;
     ComPtr<ID3D11Texture2D> out_texture = nullptr;
     if (program_parser.is_used(parsing::UNSIGNED))
     {
-        resource_format = GUID_WICPixelFormat32bppGrayFloat;
-        out_texture = img2sdf.compute_unsigned_distance_field(in_texture, true);
+        resource_format = field_formats[static_cast<size_t>(format)];
+        out_texture = img2sdf.compute_unsigned_distance_field(in_texture, cli_encoding(format, false), true,
+                                                              program_parser.get<float>(parsing::MAX_DISTANCE));
 
     }
+    else if (program_parser.is_used(parsing::SIGNED))
+    {
+        resource_format = field_formats[static_cast<size_t>(format)];
+        out_texture = img2sdf.compute_signed_distance_field(in_texture, cli_encoding(format, true), true,
+                                                            program_parser.get<float>(parsing::MAX_DISTANCE));
+    }
     else if (program_parser.is_used(parsing::VORONOI))
     {
         resource_format = GUID_WICPixelFormat128bppRGBAFloat;
@@ -117,8 +357,43 @@ int main(int32_t argc, const char** argv)
 
     printf("Finished shader. Writing Output File.\n");
 
-    const WICPixelFormatGUID output_format = GUID_WICPixelFormat32bppRGBA;
+    //unorm fields are written as single channel grey without conversion.
+    if (!program_parser.is_used(parsing::VORONOI) && format == OUTPUT_FORMAT::UNORM16)
+    {
+        output_format = GUID_WICPixelFormat16bppGray;
+    }
+    else if (!program_parser.is_used(parsing::VORONOI) && format == OUTPUT_FORMAT::UNORM8)
+    {
+        output_format = GUID_WICPixelFormat8bppGray;
+    }
+
     auto output_file = program_parser.get(parsing::OUTPUT_ARGUMENT);
+
+    //grey fields cpuimage can encode skip WIC, whose writer needs the whole image at once: bands of the mapped staging
+    //texture are queued to the image_writer's thread as they are copied out.
+    const auto image_format = cpuimage::format_from_extension(output_file);
+    if (!program_parser.is_used(parsing::VORONOI) && image_format && cpuimage::can_write(*image_format, format))
+    {
+        try {
+            cpuimage::image_writer field_writer {output_file, Width, Height, format};
+            constexpr size_t band_rows = 64;
+            for (size_t y = 0; y < Height; y += band_rows)
+            {
+                const encoded_view band {Width, std::min<size_t>(band_rows, Height - y), format,
+                                         static_cast<uint8_t*>(mapped_resource.pData) + y * mapped_resource.RowPitch,
+                                         static_cast<std::ptrdiff_t>(mapped_resource.RowPitch)};
+                field_writer.write_band(y, band);
+            }
+            field_writer.finish();
+        }
+        catch (const std::exception& err)
+        {
+            std::cerr << err.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     HRESULT out_result = writer.write_texture(output_file, Width, Height, mapped_resource.RowPitch,
                                               mapped_resource.RowPitch * Height, resource_format, output_format,
                                               mapped_resource.pData);
@@ -129,4 +404,5 @@ int main(int32_t argc, const char** argv)
         return -1;
 
     }
+#endif
 }
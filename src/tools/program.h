@@ -16,6 +16,13 @@ namespace parsing{
     constexpr const char* SIGNED_LONG = "--signed";
     constexpr const char* VORONOI = "-v";
     constexpr const char* VORONOI_LONG = "--voronoi";
+    constexpr const char* MAX_DISTANCE = "-m";
+    constexpr const char* MAX_DISTANCE_LONG = "--max-distance";
+    constexpr const char* STREAM = "--stream";
+    constexpr const char* RAW_WIDTH = "--width";
+    constexpr const char* RAW_HEIGHT = "--height";
+    constexpr const char* FORMAT = "-f";
+    constexpr const char* FORMAT_LONG = "--format";
 };
 
 
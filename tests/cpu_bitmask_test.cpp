@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/cpu_bitmask.h"
+#include "../src/CPUSparseSeedDispatch.h"
+#include "test_masks.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    using test_masks::random_mask;
+    using test_masks::values;
+
+    TEST(CPUBitmask, PacksCountsAndInverts)
+    {
+        //widths either side of a word, so the padding of the last word is exercised.
+        for (const size_t width : {1, 63, 64, 65, 130})
+        {
+            const auto mask = random_mask(width, 7, 0.3, static_cast<unsigned>(width));
+            const cpu_bitmask bits {mask};
+            EXPECT_EQ(bits.words_per_row, (width + 63) / 64);
+            EXPECT_EQ(values(bits.to_texture()), values(mask));
+            EXPECT_EQ(bits.count(), static_cast<size_t>(std::count(mask.data.begin(), mask.data.end(), 1.0f)));
+
+            const auto complement = bits.inverted();
+            EXPECT_EQ(complement.count(), width * 7 - bits.count());
+            EXPECT_EQ((complement.row(0)[complement.words_per_row - 1] & ~complement.last_word_mask()), 0u);
+
+            std::vector<size_t> set;
+            bits.for_each_set(3, [&](size_t x) { set.push_back(x); });
+            std::vector<size_t> expected;
+            for (size_t x = 0; x < width; x++)
+            {
+                if (mask.at(x, 3) > 0.0f)
+                {
+                    expected.push_back(x);
+                }
+            }
+            EXPECT_EQ(set, expected);
+        }
+
+        cpu_bitmask bits (70, 2);
+        bits.set(69, 1, true);
+        EXPECT_TRUE(bits.at(69, 1));
+        EXPECT_EQ(CPUSparseSeedDispatch::count_seeds(bits, 2), 1);
+        bits.set(69, 1, false);
+        EXPECT_EQ(bits.count(), 0);
+    }
+
+    TEST(CPUBitmask, BoundaryMatchesNeighbourTest)
+    {
+        for (const size_t width : {5, 64, 100})
+        {
+            const auto mask = random_mask(width, 9, 0.6, static_cast<unsigned>(width) + 1);
+            const auto boundary = cpu_bitmask {mask}.boundary();
+
+            for (size_t y = 0; y < mask.height; y++)
+            {
+                for (size_t x = 0; x < width; x++)
+                {
+                    //the edge of the image does not count as outside.
+                    const bool outside_neighbour = (x > 0 && mask.at(x - 1, y) == 0.0f) ||
+                                                   (x + 1 < width && mask.at(x + 1, y) == 0.0f) ||
+                                                   (y > 0 && mask.at(x, y - 1) == 0.0f) ||
+                                                   (y + 1 < mask.height && mask.at(x, y + 1) == 0.0f);
+                    EXPECT_EQ(boundary.at(x, y), mask.at(x, y) > 0.0f && outside_neighbour) << x << ", " << y;
+                }
+            }
+        }
+    }
+
+    TEST(CPUBitmask, MatchesFloatMasksForEveryEngine)
+    {
+        auto mask = random_mask(83, 41, 0.05, 22);
+        //a fractional texel is inside, and is also a seed of the inverted mask (1 - 0.5 > 0).
+        mask.at(10, 10) = 0.5f;
+        const cpu_bitmask bits {mask};
+
+        Img2SDF img2sdf {2};
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM,
+                                  CPU_ENGINE::SPARSE_SEED, CPU_ENGINE::AUTO})
+        {
+            img2sdf.set_cpu_engine(engine);
+            EXPECT_EQ(values(img2sdf.compute_unsigned_distance_field(bits, false)),
+                      values(img2sdf.compute_unsigned_distance_field(mask, false)));
+            EXPECT_EQ(values(img2sdf.compute_unsigned_distance_field(bits, true, 8.0f)),
+                      values(img2sdf.compute_unsigned_distance_field(mask, true, 8.0f)));
+
+            //the signed field of a binary mask matches its float mask; the fractional texel is the exception.
+            auto binary = mask;
+            binary.at(10, 10) = 1.0f;
+            EXPECT_EQ(values(img2sdf.compute_signed_distance_field(bits, false)),
+                      values(img2sdf.compute_signed_distance_field(binary, false)));
+
+            const auto voronoi = img2sdf.compute_voronoi_transform(bits);
+            const auto expected = img2sdf.compute_voronoi_transform(mask);
+            for (size_t texel = 0; texel < voronoi.data.size(); texel++)
+            {
+                EXPECT_EQ(voronoi.data[texel].x, expected.data[texel].x);
+                EXPECT_EQ(voronoi.data[texel].y, expected.data[texel].y);
+            }
+        }
+
+        const auto encoding = output_encoding::full_range(OUTPUT_FORMAT::UNORM8, true);
+        const auto encoded = img2sdf.compute_signed_distance_field(bits, encoding, true, 4.0f);
+        const auto expected = img2sdf.compute_signed_distance_field(cpu_bitmask {mask}.to_texture(), encoding, true, 4.0f);
+        EXPECT_EQ(encoded.data, expected.data);
+    }
+}
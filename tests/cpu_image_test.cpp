@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/cpuimage.h"
+#include "test_masks.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    //5x2, 8 bit grey: {0, 1, 127, 128, 255}, {255, 0, 64, 200, 0}.
+    const std::vector<uint8_t> grey8_png = {
+            0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+            0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x02, 0x08, 0x00, 0x00, 0x00, 0x00, 0xb5, 0x01, 0x49,
+            0x81, 0x00, 0x00, 0x00, 0x14, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0xac, 0x6f,
+            0xf8, 0xcf, 0xf0, 0x9f, 0xc1, 0xe1, 0x04, 0x03, 0x00, 0x16, 0xd1, 0x04, 0x07, 0x1c, 0x9b, 0xdd,
+            0x1a, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+    };
+
+    //3x2, 16 bit RGB with reds {0, 1, 40000}, {65535, 32767, 32768}, and noise in green and blue.
+    const std::vector<uint8_t> rgb16_png = {
+            0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+            0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02, 0x10, 0x02, 0x00, 0x00, 0x00, 0x42, 0x86, 0x2d,
+            0x0e, 0x00, 0x00, 0x00, 0x22, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0xf8, 0x0f,
+            0x04, 0x0c, 0x8c, 0x0c, 0x40, 0x30, 0xc7, 0x01, 0x44, 0x02, 0x05, 0x40, 0x64, 0xfd, 0x7f, 0x06,
+            0x4e, 0x06, 0xce, 0x06, 0xb0, 0x08, 0x00, 0xd2, 0x50, 0x08, 0xe8, 0x97, 0x5e, 0xc7, 0xd1, 0x00,
+            0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+    };
+
+    //10x2, 1 bit palette of cyan (red 0) and red, with rows 1011000001 and 0100111111.
+    const std::vector<uint8_t> palette1_png = {
+            0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+            0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x02, 0x01, 0x03, 0x00, 0x00, 0x00, 0x5b, 0xaf, 0xdf,
+            0x93, 0x00, 0x00, 0x00, 0x06, 0x50, 0x4c, 0x54, 0x45, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00, 0x0f,
+            0x9e, 0x4c, 0x5f, 0x00, 0x00, 0x00, 0x0e, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0xd8, 0xe0,
+            0xc0, 0xe0, 0x7f, 0x00, 0x00, 0x05, 0xd4, 0x02, 0x00, 0xb6, 0x4c, 0xe9, 0x32, 0x00, 0x00, 0x00,
+            0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+    };
+
+    using test_masks::ring_mask;
+    using test_masks::temp_path;
+
+    std::vector<uint8_t> read_mask(const std::string& path, float threshold)
+    {
+        cpuimage::mask_reader reader {path, threshold};
+        std::vector<uint8_t> mask (reader.get_width() * reader.get_height());
+        for (size_t y = 0; y < reader.get_height(); y++)
+        {
+            reader.read_row(mask.data() + y * reader.get_width());
+        }
+        EXPECT_THROW(reader.read_row(mask.data()), std::runtime_error);
+        return mask;
+    }
+
+    TEST(CPUImage, DetectsFormats)
+    {
+        const temp_path png {"img2sdf_detect.png", grey8_png};
+        EXPECT_EQ(cpuimage::detect_format(png.path), cpuimage::IMAGE_FORMAT::PNG);
+        const temp_path tiff {"img2sdf_detect.tif", {'I', 'I', 42, 0, 8, 0, 0, 0}};
+        EXPECT_EQ(cpuimage::detect_format(tiff.path), cpuimage::IMAGE_FORMAT::TIFF);
+        const temp_path exr {"img2sdf_detect.exr", {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0}};
+        EXPECT_EQ(cpuimage::detect_format(exr.path), cpuimage::IMAGE_FORMAT::EXR);
+
+        const temp_path other {"img2sdf_detect.bmp", {'B', 'M', 0, 0}};
+        EXPECT_THROW(static_cast<void>(cpuimage::detect_format(other.path)), std::runtime_error);
+        EXPECT_THROW(cpuimage::mask_reader {other.path}, std::runtime_error);
+    }
+
+    TEST(CPUImage, ThresholdsPNGRows)
+    {
+        if (!cpuimage::is_supported(cpuimage::IMAGE_FORMAT::PNG))
+        {
+            GTEST_SKIP() << "built without libpng";
+        }
+
+        const temp_path grey {"img2sdf_grey8.png", grey8_png};
+        EXPECT_EQ(read_mask(grey.path, 0.0f), (std::vector<uint8_t> {0, 1, 1, 1, 1, 1, 0, 1, 1, 0}));
+        EXPECT_EQ(read_mask(grey.path, 0.5f), (std::vector<uint8_t> {0, 0, 0, 1, 1, 1, 0, 0, 1, 0}));
+
+        //16 bit samples, of which only the first of each texel counts.
+        const temp_path rgb {"img2sdf_rgb16.png", rgb16_png};
+        EXPECT_EQ(read_mask(rgb.path, 0.0f), (std::vector<uint8_t> {0, 1, 1, 1, 1, 1}));
+        EXPECT_EQ(read_mask(rgb.path, 0.5f), (std::vector<uint8_t> {0, 0, 1, 1, 0, 1}));
+
+        const temp_path palette {"img2sdf_palette1.png", palette1_png};
+        EXPECT_EQ(read_mask(palette.path, 0.0f), (std::vector<uint8_t> {1, 0, 1, 1, 0, 0, 0, 0, 0, 1,
+                                                                        0, 1, 0, 0, 1, 1, 1, 1, 1, 1}));
+
+        const auto mask = cpuimage::load_mask(palette.path);
+        EXPECT_EQ(mask.width, 10);
+        EXPECT_EQ(std::vector<float>(mask.data.begin(), mask.data.end()),
+                  (std::vector<float> {1, 0, 1, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 1, 1, 1, 1, 1}));
+
+        const auto bits = cpuimage::load_bitmask(palette.path);
+        EXPECT_EQ(bits.count(), 11);
+        const auto unpacked = bits.to_texture();
+        EXPECT_EQ(std::vector<float>(unpacked.data.begin(), unpacked.data.end()),
+                  std::vector<float>(mask.data.begin(), mask.data.end()));
+
+        //a truncated image fails when the missing rows are reached.
+        const temp_path truncated {"img2sdf_truncated.png", {grey8_png.begin(), grey8_png.begin() + 50}};
+        EXPECT_THROW(static_cast<void>(cpuimage::load_mask(truncated.path)), std::runtime_error);
+    }
+
+    TEST(CPUImage, StreamsIntoTheDistanceTransform)
+    {
+        if (!cpuimage::is_supported(cpuimage::IMAGE_FORMAT::PNG))
+        {
+            GTEST_SKIP() << "built without libpng";
+        }
+
+        const temp_path palette {"img2sdf_stream.png", palette1_png};
+        const auto mask = cpuimage::load_mask(palette.path);
+
+        Img2SDF img2sdf {2};
+        std::vector<float> expected;
+        img2sdf.compute_streaming_distance_field(mask.width, mask.height,
+                [&](size_t y, float* row) { std::copy(mask.row(y), mask.row(y) + mask.width, row); },
+                [&](size_t, const float* row) { expected.insert(expected.end(), row, row + mask.width); });
+
+        cpuimage::mask_reader reader {palette.path};
+        std::vector<float> streamed;
+        img2sdf.compute_streaming_distance_field(reader.get_width(), reader.get_height(), reader.row_reader(),
+                [&](size_t, const float* row) { streamed.insert(streamed.end(), row, row + mask.width); });
+        EXPECT_EQ(streamed, expected);
+
+        //rows only come out in order.
+        cpuimage::mask_reader out_of_order {palette.path};
+        std::vector<float> row (out_of_order.get_width());
+        EXPECT_THROW(out_of_order.row_reader()(1, row.data()), std::runtime_error);
+    }
+
+    std::vector<uint8_t> read_file(const std::string& path)
+    {
+        std::ifstream stream (path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+    }
+
+    TEST(CPUImage, WritesBandsAsTheyFinish)
+    {
+        const auto mask = ring_mask(61, 150, 5.0f, 20.0f);
+        const auto encoding = output_encoding::full_range(OUTPUT_FORMAT::UNORM16, true);
+        Img2SDF img2sdf {2};
+        const auto expected = img2sdf.compute_signed_distance_field(mask, encoding, true, 12.0f);
+
+        //bands arrive in order and cover the field.
+        size_t next_row = 0;
+        std::vector<uint8_t> banded;
+        img2sdf.compute_signed_distance_field(mask, encoding, [&](size_t y, const encoded_view& band) {
+            EXPECT_EQ(y, next_row);
+            for (size_t row = 0; row < band.height; row++)
+            {
+                banded.insert(banded.end(), band.row(row), band.row(row) + band.width * 2);
+            }
+            next_row += band.height;
+        }, true, 12.0f);
+        EXPECT_EQ(banded, std::vector<uint8_t>(expected.data.begin(), expected.data.end()));
+
+        //with no image extension, the writer stores the texels headerless.
+        const temp_path raw {"img2sdf_bands.raw", {}};
+        {
+            cpuimage::image_writer writer {raw.path, mask.width, mask.height, encoding.format, 2};
+            img2sdf.compute_signed_distance_field(mask, encoding, writer.band_writer(), true, 12.0f);
+            writer.finish();
+        }
+        EXPECT_EQ(read_file(raw.path), banded);
+
+        cpuimage::image_writer partial {raw.path, 4, 4, OUTPUT_FORMAT::UNORM8};
+        encoded_texture band (4, 2, OUTPUT_FORMAT::UNORM8);
+        EXPECT_THROW(partial.write_band(2, encoded_view {band}), std::runtime_error);
+        partial.write_band(0, encoded_view {band});
+        EXPECT_THROW(partial.finish(), std::runtime_error);
+
+        EXPECT_EQ(cpuimage::format_from_extension("field.TIFF"), cpuimage::IMAGE_FORMAT::TIFF);
+        EXPECT_EQ(cpuimage::format_from_extension("field.bin"), std::nullopt);
+        EXPECT_FALSE(cpuimage::can_write(cpuimage::IMAGE_FORMAT::PNG, OUTPUT_FORMAT::FLOAT32));
+        EXPECT_FALSE(cpuimage::can_write(cpuimage::IMAGE_FORMAT::EXR, OUTPUT_FORMAT::FLOAT32));
+    }
+
+    TEST(CPUImage, WritesPNGFields)
+    {
+        if (!cpuimage::is_supported(cpuimage::IMAGE_FORMAT::PNG) ||
+            !cpuimage::can_write(cpuimage::IMAGE_FORMAT::PNG, OUTPUT_FORMAT::UNORM8))
+        {
+            GTEST_SKIP() << "built without libpng or zlib";
+        }
+
+        const auto mask = ring_mask(70, 90, 5.0f, 20.0f);
+        Img2SDF img2sdf {2};
+        for (const auto format : {OUTPUT_FORMAT::UNORM8, OUTPUT_FORMAT::UNORM16})
+        {
+            const auto encoding = output_encoding::full_range(format, true);
+            const auto expected = img2sdf.compute_signed_distance_field(mask, encoding, true, 10.0f);
+
+            const temp_path png {"img2sdf_field.png", {}};
+            {
+                cpuimage::image_writer writer {png.path, mask.width, mask.height, format};
+                img2sdf.compute_signed_distance_field(mask, encoding, writer.band_writer(), true, 10.0f);
+                writer.finish();
+            }
+
+            //read back through the decoder: texels above mid grey are outside the mask.
+            const auto outside = read_mask(png.path, 0.5f);
+            for (size_t texel = 0; texel < outside.size(); texel++)
+            {
+                uint32_t value = expected.data[texel];
+                if (format == OUTPUT_FORMAT::UNORM16)
+                {
+                    uint16_t sample = 0;
+                    std::memcpy(&sample, expected.data.data() + texel * 2, 2);
+                    value = sample;
+                }
+                const uint32_t mid = format == OUTPUT_FORMAT::UNORM16 ? 32767 : 127;
+                ASSERT_EQ(outside[texel], value > mid ? 1 : 0) << texel;
+            }
+        }
+
+        EXPECT_THROW(cpuimage::image_writer("img2sdf_float.png", 4, 4, OUTPUT_FORMAT::FLOAT32), std::runtime_error);
+    }
+}
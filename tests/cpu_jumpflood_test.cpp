@@ -0,0 +1,644 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "../src/img2sdf.h"
+#include "../src/CPUJumpFloodResources.h"
+#include "../src/CPUJumpFloodDispatch.h"
+#include "../src/CPUSparseSeedDispatch.h"
+#include "test_masks.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+    ///test_masks::random_mask, always with at least one seed, otherwise there is nothing to flood from.
+    cpu_texture<float> seeded_mask(size_t width, size_t height, double density)
+    {
+        auto mask = test_masks::random_mask(width, height, density);
+        mask.at(width / 2, height / 3) = 1.0f;
+        return mask;
+    }
+
+    ///brute force ground truth: distance from every texel to the nearest texel where `is_seed` holds.
+    template <typename predicate>
+    cpu_texture<float> brute_force_distance(const cpu_texture<float>& mask, predicate is_seed)
+    {
+        cpu_texture<float> out (mask.width, mask.height, std::numeric_limits<float>::infinity());
+        for (size_t y = 0; y < mask.height; y++)
+        {
+            for (size_t x = 0; x < mask.width; x++)
+            {
+                for (size_t sy = 0; sy < mask.height; sy++)
+                {
+                    for (size_t sx = 0; sx < mask.width; sx++)
+                    {
+                        if (is_seed(mask.at(sx, sy)))
+                        {
+                            const float dx = static_cast<float>(sx) - static_cast<float>(x);
+                            const float dy = static_cast<float>(sy) - static_cast<float>(y);
+                            out.at(x, y) = std::min(out.at(x, y), std::sqrt(dx * dx + dy * dy));
+                        }
+                    }
+                }
+            }
+        }
+        return out;
+    }
+
+    class CPUJumpFlood : public testing::TestWithParam<int32_t> {
+    protected:
+        void SetUp() override
+        {
+            width = GetParam();
+            height = GetParam();
+            mask = seeded_mask(width, height, 0.02);
+        }
+
+        size_t width = 8;
+        size_t height = 8;
+        cpu_texture<float> mask;
+    };
+
+    TEST_P(CPUJumpFlood, UnsignedGroundTruth)
+    {
+        Img2SDF img2sdf {};
+
+        auto field = img2sdf.compute_unsigned_distance_field(mask, false);
+        auto ground_truth = brute_force_distance(mask, [](float v) { return v > 0.0f; });
+
+        ASSERT_EQ(field.width, width);
+        ASSERT_EQ(field.height, height);
+
+        //JFA is approximate, but should never be more than a texel or so out on a random mask.
+        double total_error = 0;
+        for (size_t i = 0; i < field.data.size(); i++)
+        {
+            EXPECT_GE(field.data[i] + 1e-4f, ground_truth.data[i]) << "JFA found a closer seed than exists at " << i;
+            EXPECT_LE(field.data[i] - ground_truth.data[i], 1.5f) << "at index " << i;
+            total_error += field.data[i] - ground_truth.data[i];
+        }
+        EXPECT_LT(total_error / static_cast<double>(field.data.size()), 0.05);
+    }
+
+    TEST_P(CPUJumpFlood, ThreadCountInvariant)
+    {
+        Img2SDF serial {1};
+        Img2SDF parallel {7};
+
+        auto serial_field = serial.compute_unsigned_distance_field(mask, true);
+        auto parallel_field = parallel.compute_unsigned_distance_field(mask, true);
+
+        ASSERT_EQ(serial_field.data, parallel_field.data);
+    }
+
+    TEST_P(CPUJumpFlood, SignedSignAndRange)
+    {
+        Img2SDF img2sdf {};
+
+        auto mask_blob = cpu_texture<float>(width, height);
+        for (size_t y = height / 4; y < 3 * height / 4; y++)
+        {
+            for (size_t x = width / 4; x < 3 * width / 4; x++)
+            {
+                mask_blob.at(x, y) = 1.0f;
+            }
+        }
+
+        auto field = img2sdf.compute_signed_distance_field(mask_blob, false);
+        for (size_t i = 0; i < field.data.size(); i++)
+        {
+            if (mask_blob.data[i] > 0)
+            {
+                EXPECT_LT(field.data[i], 0.0f) << "inside texel was not negative at " << i;
+            }
+            else
+            {
+                EXPECT_GT(field.data[i], 0.0f) << "outside texel was not positive at " << i;
+            }
+        }
+
+        auto normalised = img2sdf.compute_signed_distance_field(mask_blob, true);
+        const auto [minimum, maximum] = std::minmax_element(normalised.data.begin(), normalised.data.end());
+        EXPECT_FLOAT_EQ(*minimum, -1.0f);
+        EXPECT_FLOAT_EQ(*maximum, 1.0f);
+    }
+
+    TEST_P(CPUJumpFlood, ExactEDTGroundTruth)
+    {
+        Img2SDF img2sdf {};
+        img2sdf.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+
+        auto field = img2sdf.compute_unsigned_distance_field(mask, false);
+        auto ground_truth = brute_force_distance(mask, [](float v) { return v > 0.0f; });
+
+        ASSERT_EQ(field.data.size(), ground_truth.data.size());
+        for (size_t i = 0; i < field.data.size(); i++)
+        {
+            EXPECT_NEAR(field.data[i], ground_truth.data[i], 1e-4f) << "at index " << i;
+        }
+    }
+
+    TEST_P(CPUJumpFlood, ExactSignedGroundTruth)
+    {
+        auto dense_mask = seeded_mask(width, height, 0.5);
+        auto outer = brute_force_distance(dense_mask, [](float v) { return v > 0.0f; });
+        auto inner = brute_force_distance(dense_mask, [](float v) { return v <= 0.0f; });
+
+        for (const auto engine : {CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM, CPU_ENGINE::SPARSE_SEED})
+        {
+            Img2SDF img2sdf {3};
+            img2sdf.set_cpu_engine(engine);
+
+            auto field = img2sdf.compute_signed_distance_field(dense_mask, false);
+            for (size_t i = 0; i < field.data.size(); i++)
+            {
+                const float expected = dense_mask.data[i] > 0 ? -inner.data[i] : outer.data[i];
+                EXPECT_NEAR(field.data[i], expected, 1e-4f) << "at index " << i;
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, SingleFloodSignedGroundTruth)
+    {
+        auto dense_mask = seeded_mask(width, height, 0.5);
+        auto outer = brute_force_distance(dense_mask, [](float v) { return v > 0.0f; });
+        auto inner = brute_force_distance(dense_mask, [](float v) { return v <= 0.0f; });
+
+        Img2SDF img2sdf {3};
+        img2sdf.set_cpu_engine(CPU_ENGINE::JUMP_FLOOD);
+
+        auto field = img2sdf.compute_signed_distance_field(dense_mask, false);
+        for (size_t i = 0; i < field.data.size(); i++)
+        {
+            if (dense_mask.data[i] > 0)
+            {
+                //texels on the boundary measure to their outside neighbour, as with a flood of the inverted mask.
+                if (inner.data[i] == 1.0f)
+                {
+                    EXPECT_FLOAT_EQ(field.data[i], -1.0f) << "at index " << i;
+                }
+                EXPECT_NEAR(field.data[i], -inner.data[i], 1.5f) << "at index " << i;
+            }
+            else
+            {
+                EXPECT_NEAR(field.data[i], outer.data[i], 1.0f) << "at index " << i;
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, FusedRangeMatchesField)
+    {
+        auto dense_mask = seeded_mask(width, height, 0.3);
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM})
+        {
+            Img2SDF img2sdf {3};
+            img2sdf.set_cpu_engine(engine);
+
+            for (const bool is_signed : {false, true})
+            {
+                float2 range = {0, 0};
+                auto field = is_signed ? img2sdf.compute_signed_distance_field(dense_mask, false, 0, &range)
+                                       : img2sdf.compute_unsigned_distance_field(dense_mask, false, 0, &range);
+                const auto [minimum, maximum] = std::minmax_element(field.data.begin(), field.data.end());
+                EXPECT_EQ(range.x, *minimum);
+                EXPECT_EQ(range.y, *maximum);
+
+                //normalising against the gathered range maps it onto the full output range.
+                float2 normalised_range = {0, 0};
+                auto normalised = is_signed ? img2sdf.compute_signed_distance_field(dense_mask, true, 0, &normalised_range)
+                                            : img2sdf.compute_unsigned_distance_field(dense_mask, true, 0, &normalised_range);
+                EXPECT_EQ(normalised_range.x, range.x);
+                EXPECT_EQ(normalised_range.y, range.y);
+                const auto [low, high] = std::minmax_element(normalised.data.begin(), normalised.data.end());
+                EXPECT_FLOAT_EQ(*low, is_signed ? -1.0f : 0.0f);
+                EXPECT_FLOAT_EQ(*high, 1.0f);
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, EncodedOutputMatchesFloat)
+    {
+        auto dense_mask = seeded_mask(width, height, 0.3);
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT})
+        {
+            Img2SDF img2sdf {3};
+            img2sdf.set_cpu_engine(engine);
+
+            for (const bool is_signed : {false, true})
+            {
+                for (const float max_distance : {0.0f, 3.0f})
+                {
+                    const auto expected = is_signed ? img2sdf.compute_signed_distance_field(dense_mask, true, max_distance)
+                                                    : img2sdf.compute_unsigned_distance_field(dense_mask, true, max_distance);
+
+                    for (const auto format : {OUTPUT_FORMAT::FLOAT32, OUTPUT_FORMAT::FLOAT16, OUTPUT_FORMAT::UNORM16,
+                                              OUTPUT_FORMAT::UNORM8})
+                    {
+                        const auto encoding = output_encoding::full_range(format, is_signed);
+                        float2 range = {0, 0};
+                        const auto encoded = is_signed
+                                ? img2sdf.compute_signed_distance_field(dense_mask, encoding, true, max_distance, &range)
+                                : img2sdf.compute_unsigned_distance_field(dense_mask, encoding, true, max_distance, &range);
+                        ASSERT_EQ(encoded.data.size(), expected.data.size() * bytes_per_texel(format));
+
+                        //half precision error, or half a unorm step (ties round up, plus float error).
+                        const float tolerance = format == OUTPUT_FORMAT::UNORM8 ? 0.501f / 255.0f
+                                              : format == OUTPUT_FORMAT::UNORM16 ? 0.501f / 65535.0f
+                                              : format == OUTPUT_FORMAT::FLOAT16 ? 1.0f / 2048.0f : 1e-6f;
+                        for (size_t i = 0; i < expected.data.size(); i++)
+                        {
+                            const uint8_t* texel = encoded.data.data() + i * bytes_per_texel(format);
+                            float stored = 0;
+                            if (format == OUTPUT_FORMAT::FLOAT32)
+                            {
+                                std::memcpy(&stored, texel, sizeof(float));
+                            }
+                            else if (format == OUTPUT_FORMAT::FLOAT16 || format == OUTPUT_FORMAT::UNORM16)
+                            {
+                                uint16_t value = 0;
+                                std::memcpy(&value, texel, sizeof(value));
+                                stored = format == OUTPUT_FORMAT::FLOAT16 ? cpuutils::half_to_float(value)
+                                                                          : static_cast<float>(value) / 65535.0f;
+                            }
+                            else
+                            {
+                                stored = static_cast<float>(*texel) / 255.0f;
+                            }
+
+                            EXPECT_NEAR(stored, expected.data[i] * encoding.scale + encoding.bias, tolerance)
+                                                << "at index " << i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(CPUJumpFloodDispatch, HalfConversion)
+    {
+        EXPECT_EQ(cpuutils::float_to_half(0.0f), 0x0000);
+        EXPECT_EQ(cpuutils::float_to_half(-0.0f), 0x8000);
+        EXPECT_EQ(cpuutils::float_to_half(1.0f), 0x3C00);
+        EXPECT_EQ(cpuutils::float_to_half(-2.0f), 0xC000);
+        EXPECT_EQ(cpuutils::float_to_half(65504.0f), 0x7BFF);
+        EXPECT_EQ(cpuutils::float_to_half(65520.0f), 0x7C00);
+        EXPECT_EQ(cpuutils::float_to_half(std::numeric_limits<float>::infinity()), 0x7C00);
+        EXPECT_TRUE(std::isnan(cpuutils::half_to_float(cpuutils::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+        //smallest denormal, and ties to even either side of it.
+        EXPECT_EQ(cpuutils::float_to_half(std::ldexp(1.0f, -24)), 0x0001);
+        EXPECT_EQ(cpuutils::float_to_half(std::ldexp(1.0f, -25)), 0x0000);
+        EXPECT_EQ(cpuutils::float_to_half(std::ldexp(3.0f, -25)), 0x0002);
+        //1 + 2^-11 is halfway between 1 and the next half, and rounds to the even 1.
+        EXPECT_EQ(cpuutils::float_to_half(1.0f + std::ldexp(1.0f, -11)), 0x3C00);
+        EXPECT_EQ(cpuutils::float_to_half(1.0f + std::ldexp(3.0f, -11)), 0x3C02);
+
+        //every finite half survives a round trip.
+        for (uint32_t half = 0; half <= 0xFFFF; half++)
+        {
+            if ((half & 0x7C00) == 0x7C00)
+            {
+                continue;
+            }
+            EXPECT_EQ(cpuutils::float_to_half(cpuutils::half_to_float(static_cast<uint16_t>(half))), half);
+        }
+    }
+
+    TEST_P(CPUJumpFlood, BandLimitedMatchesClampedGroundTruth)
+    {
+        constexpr float max_distance = 3.0f;
+        auto ground_truth = brute_force_distance(mask, [](float v) { return v > 0.0f; });
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM,
+                                  CPU_ENGINE::SPARSE_SEED})
+        {
+            Img2SDF img2sdf {};
+            img2sdf.set_cpu_engine(engine);
+
+            auto field = img2sdf.compute_unsigned_distance_field(mask, false, max_distance);
+            auto normalised = img2sdf.compute_unsigned_distance_field(mask, true, max_distance);
+            for (size_t i = 0; i < field.data.size(); i++)
+            {
+                const float expected = std::min(ground_truth.data[i], max_distance);
+                //the jump flood is still approximate inside the band.
+                EXPECT_NEAR(field.data[i], expected, engine == CPU_ENGINE::JUMP_FLOOD ? 1.0f : 1e-4f) << "at index " << i;
+                EXPECT_LE(field.data[i], max_distance);
+                EXPECT_FLOAT_EQ(normalised.data[i], field.data[i] / max_distance);
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, FixedRangeNormaliseMatchesSeparatePass)
+    {
+        constexpr float max_distance = 3.0f;
+        auto dense_mask = seeded_mask(width, height, 0.3);
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM,
+                                  CPU_ENGINE::SPARSE_SEED})
+        {
+            Img2SDF img2sdf {3};
+            img2sdf.set_cpu_engine(engine);
+
+            for (const bool is_signed : {false, true})
+            {
+                float2 range = {0, 0};
+                auto field = is_signed ? img2sdf.compute_signed_distance_field(dense_mask, false, max_distance, &range)
+                                       : img2sdf.compute_unsigned_distance_field(dense_mask, false, max_distance, &range);
+
+                //the distance pass normalises as it writes, but still reports the range of the raw distances.
+                float2 fused_range = {0, 0};
+                auto fused = is_signed ? img2sdf.compute_signed_distance_field(dense_mask, true, max_distance, &fused_range)
+                                       : img2sdf.compute_unsigned_distance_field(dense_mask, true, max_distance, &fused_range);
+                EXPECT_EQ(fused_range.x, range.x);
+                EXPECT_EQ(fused_range.y, range.y);
+
+                const cpuutils::distance_normaliser normaliser {is_signed ? -max_distance : 0.0f, max_distance,
+                                                                is_signed ? -1.0f : 0.0f};
+                for (size_t i = 0; i < field.data.size(); i++)
+                {
+                    EXPECT_EQ(fused.data[i], normaliser(field.data[i])) << "at index " << i;
+                }
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, VoronoiSeedsAreSeeds)
+    {
+        Img2SDF img2sdf {};
+
+        auto voronoi = img2sdf.compute_voronoi_transform(mask, false);
+        for (const auto& seed : voronoi.data)
+        {
+            ASSERT_GT(seed.z, 0.0f);
+            const auto sx = static_cast<size_t>(seed.x);
+            const auto sy = static_cast<size_t>(seed.y);
+            ASSERT_GT(mask.at(sx, sy), 0.0f);
+            EXPECT_FLOAT_EQ(seed.z, static_cast<float>(sy * width + sx + 1));
+        }
+    }
+
+    TEST_P(CPUJumpFlood, FeatureTransformNearestSeed)
+    {
+        auto dense_mask = seeded_mask(width, height, 0.3);
+        auto sparse_mask = seeded_mask(width, height, 0.0);
+        sparse_mask.at(0, height - 1) = 1.0f;
+
+        for (const auto engine : {CPU_ENGINE::FEATURE_TRANSFORM, CPU_ENGINE::SPARSE_SEED})
+        {
+            for (const auto& test_mask : {mask, dense_mask, sparse_mask})
+            {
+                Img2SDF img2sdf {};
+                img2sdf.set_cpu_engine(engine);
+
+                auto voronoi = img2sdf.compute_voronoi_transform(test_mask, false);
+                auto ground_truth = brute_force_distance(test_mask, [](float v) { return v > 0.0f; });
+
+                for (size_t y = 0; y < height; y++)
+                {
+                    for (size_t x = 0; x < width; x++)
+                    {
+                        const auto& seed = voronoi.at(x, y);
+                        const auto sx = static_cast<size_t>(seed.x);
+                        const auto sy = static_cast<size_t>(seed.y);
+                        ASSERT_GT(test_mask.at(sx, sy), 0.0f);
+                        EXPECT_FLOAT_EQ(seed.z, static_cast<float>(sy * width + sx + 1));
+
+                        //ties may pick either seed, but the distance to it must be the exact minimum.
+                        const float dx = static_cast<float>(x) - seed.x;
+                        const float dy = static_cast<float>(y) - seed.y;
+                        EXPECT_FLOAT_EQ(seed.w, dx * dx + dy * dy);
+                        EXPECT_NEAR(std::sqrt(seed.w), ground_truth.at(x, y), 1e-4f) << "at " << x << ", " << y;
+                    }
+                }
+            }
+        }
+    }
+
+    TEST_P(CPUJumpFlood, AutoEngineMatchesExact)
+    {
+        Img2SDF exact {};
+        exact.set_cpu_engine(CPU_ENGINE::FEATURE_TRANSFORM);
+        Img2SDF automatic {};
+        automatic.set_cpu_engine(CPU_ENGINE::AUTO);
+
+        auto sparse_mask = seeded_mask(width, height, 0.0);
+        EXPECT_EQ(CPUSparseSeedDispatch::count_seeds(sparse_mask), 1);
+        EXPECT_EQ(CPUSparseSeedDispatch::count_seeds(sparse_mask, true), width * height - 1);
+
+        for (const auto& test_mask : {mask, sparse_mask})
+        {
+            auto expected = exact.compute_signed_distance_field(test_mask, false);
+            auto field = automatic.compute_signed_distance_field(test_mask, false);
+            for (size_t i = 0; i < field.data.size(); i++)
+            {
+                EXPECT_NEAR(field.data[i], expected.data[i], 1e-4f) << "at index " << i;
+            }
+        }
+    }
+
+    TEST(CPUJumpFloodResources, RejectsEmptyTexture)
+    {
+        cpu_texture<float> mask (0, 16);
+        EXPECT_THROW(CPUJumpFloodResources {&mask}, std::runtime_error);
+    }
+
+    TEST(CPUJumpFloodResources, PackedVoronoiLimits)
+    {
+        const auto seed = cpuutils::pack_seed(cpuutils::max_packed_dimension - 1, cpuutils::max_packed_dimension - 1);
+        EXPECT_NE(seed, cpuutils::no_seed);
+        EXPECT_EQ(cpuutils::seed_x(seed), cpuutils::max_packed_dimension - 1);
+        EXPECT_EQ(cpuutils::seed_y(seed), cpuutils::max_packed_dimension - 1);
+
+        //too wide to pack, but the exact transform never needs a voronoi buffer.
+        cpu_texture<float> wide_mask (cpuutils::max_packed_dimension + 1, 1);
+        wide_mask.at(0, 0) = 1.0f;
+        CPUJumpFloodResources resources {&wide_mask};
+        EXPECT_THROW(resources.create_voronoi_buffer(), std::runtime_error);
+
+        Img2SDF img2sdf {};
+        img2sdf.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+        const auto field = img2sdf.compute_unsigned_distance_field(wide_mask, false);
+        EXPECT_FLOAT_EQ(field.data.back(), static_cast<float>(cpuutils::max_packed_dimension));
+
+        //AUTO falls back to the exact transform for both fields, and only the voronoi transform still throws.
+        img2sdf.set_cpu_engine(CPU_ENGINE::AUTO);
+        const auto automatic = img2sdf.compute_unsigned_distance_field(wide_mask, false);
+        EXPECT_EQ(automatic.data, field.data);
+        const auto signed_field = img2sdf.compute_signed_distance_field(wide_mask, false);
+        img2sdf.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+        EXPECT_EQ(signed_field.data, img2sdf.compute_signed_distance_field(wide_mask, false).data);
+        img2sdf.set_cpu_engine(CPU_ENGINE::AUTO);
+        EXPECT_THROW((void) img2sdf.compute_voronoi_transform(wide_mask), std::runtime_error);
+    }
+
+    TEST(CPUJumpFloodDispatch, SimdKernelsMatchScalar)
+    {
+        //odd widths leave a scalar tail, and narrow masks leave no vector body at all on the longer passes.
+        for (const auto& [width, height] : {std::pair<size_t, size_t> {97, 61}, std::pair<size_t, size_t> {256, 33},
+                                            std::pair<size_t, size_t> {5, 40}})
+        {
+            const auto mask = seeded_mask(width, height, 0.01);
+
+            CPUJumpFloodResources scalar_resources {&mask};
+            CPUJumpFloodDispatch scalar_dispatch {&scalar_resources, 2};
+            scalar_dispatch.set_simd_level(cpukernels::SIMD_LEVEL::SCALAR);
+            scalar_resources.create_voronoi_buffer();
+            scalar_dispatch.dispatch_preprocess();
+            scalar_dispatch.dispatch_voronoi();
+            const auto expected = scalar_resources.release_voronoi_buffer();
+
+            for (const auto level : cpukernels::supported_simd_levels())
+            {
+                CPUJumpFloodResources resources {&mask};
+                CPUJumpFloodDispatch dispatch {&resources, 2};
+                dispatch.set_simd_level(level);
+                resources.create_voronoi_buffer();
+                dispatch.dispatch_preprocess();
+                dispatch.dispatch_voronoi();
+                EXPECT_EQ(resources.release_voronoi_buffer().data, expected.data) << cpukernels::simd_level_name(level);
+            }
+        }
+    }
+
+    TEST(CPUJumpFloodDispatch, FloodSchedulesMatchRows)
+    {
+        //1100 wide spans two column blocks; 300x20 pads to a 512 square for the morton schedule.
+        for (const auto& [width, height] : {std::pair<size_t, size_t> {97, 61}, std::pair<size_t, size_t> {1100, 37},
+                                            std::pair<size_t, size_t> {300, 20}, std::pair<size_t, size_t> {5, 40}})
+        {
+            const auto mask = seeded_mask(width, height, 0.005);
+
+            for (const float max_distance : {0.0f, 20.0f})
+            {
+                CPUJumpFloodResources row_resources {&mask};
+                CPUJumpFloodDispatch row_dispatch {&row_resources, 2};
+                row_dispatch.set_simd_level(cpukernels::SIMD_LEVEL::SCALAR);
+                row_dispatch.set_flood_schedule(FLOOD_SCHEDULE::ROWS);
+                row_resources.create_voronoi_buffer();
+                row_dispatch.dispatch_preprocess();
+                row_dispatch.dispatch_voronoi(max_distance);
+                const auto expected = row_resources.release_voronoi_buffer();
+
+                for (const auto schedule : {FLOOD_SCHEDULE::BLOCKED, FLOOD_SCHEDULE::MORTON})
+                {
+                    for (const auto level : cpukernels::supported_simd_levels())
+                    {
+                        CPUJumpFloodResources resources {&mask};
+                        CPUJumpFloodDispatch dispatch {&resources, 3};
+                        dispatch.set_simd_level(level);
+                        dispatch.set_flood_schedule(schedule);
+                        resources.create_voronoi_buffer();
+                        dispatch.dispatch_preprocess();
+                        dispatch.dispatch_voronoi(max_distance);
+                        EXPECT_EQ(resources.release_voronoi_buffer().data, expected.data)
+                                << width << "x" << height << " schedule " << static_cast<int>(schedule) << " "
+                                << cpukernels::simd_level_name(level);
+                    }
+                }
+            }
+        }
+    }
+
+    class CPUJumpFloodNonSquare : public testing::TestWithParam<std::pair<size_t, size_t>> {};
+
+    TEST_P(CPUJumpFloodNonSquare, AllEnginesMatchGroundTruth)
+    {
+        const auto [width, height] = GetParam();
+        auto mask = seeded_mask(width, height, 0.02);
+        auto ground_truth = brute_force_distance(mask, [](float v) { return v > 0.0f; });
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM,
+                                  CPU_ENGINE::SPARSE_SEED})
+        {
+            Img2SDF img2sdf {3};
+            img2sdf.set_cpu_engine(engine);
+
+            auto field = img2sdf.compute_unsigned_distance_field(mask, false);
+            ASSERT_EQ(field.width, width);
+            ASSERT_EQ(field.height, height);
+            for (size_t i = 0; i < field.data.size(); i++)
+            {
+                EXPECT_NEAR(field.data[i], ground_truth.data[i], engine == CPU_ENGINE::JUMP_FLOOD ? 1.5f : 1e-4f)
+                    << "at index " << i;
+            }
+
+            auto voronoi = img2sdf.compute_voronoi_transform(mask, false);
+            for (const auto& seed : voronoi.data)
+            {
+                const auto sx = static_cast<size_t>(seed.x);
+                const auto sy = static_cast<size_t>(seed.y);
+                ASSERT_GT(mask.at(sx, sy), 0.0f);
+                EXPECT_FLOAT_EQ(seed.z, static_cast<float>(sy * width + sx + 1));
+            }
+        }
+    }
+
+    TEST(CPUJumpFloodDispatch, EnginesAgreeWithoutSeeds)
+    {
+        //every engine, and the streaming transform, puts a texel with no seed to measure from infinitely far away:
+        //infinite, clamped to a spread, and normalised to the end of the range.
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        const cpu_texture<float> empty (13, 9);
+        const auto full = [] {
+            cpu_texture<float> mask (13, 9);
+            std::fill(mask.data.begin(), mask.data.end(), 1.0f);
+            return mask;
+        }();
+
+        const auto expect_all = [](const cpu_texture<float>& field, float expected, const char* what) {
+            for (size_t i = 0; i < field.data.size(); i++)
+            {
+                ASSERT_EQ(field.data[i], expected) << what << " at index " << i;
+            }
+        };
+
+        for (const auto engine : {CPU_ENGINE::JUMP_FLOOD, CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM,
+                                  CPU_ENGINE::SPARSE_SEED, CPU_ENGINE::AUTO})
+        {
+            SCOPED_TRACE(static_cast<int>(engine));
+            Img2SDF img2sdf {2};
+            img2sdf.set_cpu_engine(engine);
+
+            float2 range {};
+            expect_all(img2sdf.compute_unsigned_distance_field(empty, false, 0, &range), inf, "unsigned");
+            EXPECT_EQ(range.x, inf);
+            expect_all(img2sdf.compute_unsigned_distance_field(empty, false, 4.0f), 4.0f, "unsigned spread");
+            expect_all(img2sdf.compute_unsigned_distance_field(empty, true), 1.0f, "unsigned normalised");
+            expect_all(img2sdf.compute_unsigned_distance_field(full, false), 0.0f, "unsigned full");
+
+            expect_all(img2sdf.compute_signed_distance_field(empty, false), inf, "signed empty");
+            expect_all(img2sdf.compute_signed_distance_field(empty, false, 4.0f), 4.0f, "signed empty spread");
+            expect_all(img2sdf.compute_signed_distance_field(empty, true), 1.0f, "signed empty normalised");
+            expect_all(img2sdf.compute_signed_distance_field(full, false), -inf, "signed full");
+            expect_all(img2sdf.compute_signed_distance_field(full, false, 4.0f), -4.0f, "signed full spread");
+            expect_all(img2sdf.compute_signed_distance_field(full, true), -1.0f, "signed full normalised");
+        }
+
+        for (const bool is_signed : {false, true})
+        {
+            for (const float max_distance : {0.0f, 4.0f})
+            {
+                const float far = max_distance > 0 ? max_distance : inf;
+                for (const auto* mask : {&empty, &full})
+                {
+                    cpu_texture<float> field (mask->width, mask->height);
+                    Img2SDF {}.compute_streaming_distance_field(
+                            mask->width, mask->height,
+                            [&](size_t y, float* row) { std::copy(mask->row(y), mask->row(y) + mask->width, row); },
+                            [&](size_t y, const float* row) { std::copy(row, row + field.width, field.row(y)); },
+                            is_signed, max_distance, false);
+                    const float expected = mask == &empty ? far : (is_signed ? -far : 0.0f);
+                    expect_all(field, expected, "streaming");
+                }
+            }
+        }
+    }
+
+    INSTANTIATE_TEST_SUITE_P(CPUJumpFloodTests, CPUJumpFlood, ::testing::Values(8, 16, 32, 64));
+    INSTANTIATE_TEST_SUITE_P(CPUJumpFloodTests, CPUJumpFloodNonSquare,
+                             ::testing::Values(std::pair<size_t, size_t> {37, 23}, std::pair<size_t, size_t> {100, 7},
+                                               std::pair<size_t, size_t> {1, 50}, std::pair<size_t, size_t> {60, 45}));
+}
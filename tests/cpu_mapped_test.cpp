@@ -0,0 +1,271 @@
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/cpumap.h"
+#include "test_masks.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    using test_masks::random_mask;
+    using test_masks::temp_path;
+    using test_masks::values;
+
+    std::vector<float> read_image(const cpumap::mapped_image& image)
+    {
+        std::vector<float> texels (image.get_width() * image.get_height());
+        for (size_t y = 0; y < image.get_height(); y++)
+        {
+            image.read_row(y, texels.data() + y * image.get_width());
+        }
+        return texels;
+    }
+
+    TEST(CPUMapped, EncodesStraightIntoTheFile)
+    {
+        const auto mask = random_mask(45, 31, 0.05, 1);
+        const cpu_bitmask bits {mask};
+        Img2SDF img2sdf {2};
+
+        for (const auto file_format : {cpumap::FILE_FORMAT::RAW, cpumap::FILE_FORMAT::PGM, cpumap::FILE_FORMAT::PFM})
+        {
+            for (const auto texel_format : {OUTPUT_FORMAT::FLOAT32, OUTPUT_FORMAT::UNORM16, OUTPUT_FORMAT::UNORM8})
+            {
+                if ((file_format == cpumap::FILE_FORMAT::PGM && texel_format == OUTPUT_FORMAT::FLOAT32) ||
+                    (file_format == cpumap::FILE_FORMAT::PFM && texel_format != OUTPUT_FORMAT::FLOAT32))
+                {
+                    EXPECT_THROW(static_cast<void>(cpumap::mapped_image::create("unused", file_format, 1, 1, texel_format)),
+                                 std::runtime_error);
+                    continue;
+                }
+
+                const auto encoding = output_encoding::full_range(texel_format, true);
+                const auto expected = img2sdf.compute_signed_distance_field(bits, encoding, true, 8.0f);
+
+                const temp_path path {"img2sdf_mapped_out"};
+                {
+                    auto image = cpumap::mapped_image::create(path.path, file_format, mask.width, mask.height, texel_format);
+                    img2sdf.compute_signed_distance_field(bits, encoding, image.view(), true, 8.0f);
+                }
+
+                //read back through a fresh mapping, as another process would.
+                const auto image = file_format == cpumap::FILE_FORMAT::RAW
+                        ? cpumap::mapped_image::open(path.path, mask.width, mask.height, texel_format)
+                        : cpumap::mapped_image::open(path.path);
+                EXPECT_EQ(image.get_format(), file_format);
+                EXPECT_EQ(image.get_texel_format(), texel_format);
+
+                const auto texels = read_image(image);
+                for (size_t texel = 0; texel < texels.size(); texel++)
+                {
+                    const float value = texel_format == OUTPUT_FORMAT::FLOAT32 ? texels[texel]
+                                      : texels[texel] * (texel_format == OUTPUT_FORMAT::UNORM8 ? 255.0f : 65535.0f);
+                    float stored = 0;
+                    if (texel_format == OUTPUT_FORMAT::FLOAT32)
+                    {
+                        std::memcpy(&stored, expected.data.data() + texel * 4, 4);
+                    }
+                    else if (texel_format == OUTPUT_FORMAT::UNORM16)
+                    {
+                        uint16_t sample = 0;
+                        std::memcpy(&sample, expected.data.data() + texel * 2, 2);
+                        stored = sample;
+                    }
+                    else
+                    {
+                        stored = expected.data[texel];
+                    }
+                    ASSERT_FLOAT_EQ(value, stored) << texel;
+                }
+            }
+        }
+    }
+
+    TEST(CPUMapped, ReadsPGMAndPFMHeaders)
+    {
+        //a comment, a 12 bit maximum, and big-endian samples.
+        const temp_path pgm {"img2sdf_mapped.pgm"};
+        {
+            std::ofstream stream (pgm.path, std::ios::binary);
+            stream << "P5\n# mask\n3 1\n4095\n";
+            const unsigned char samples[] = {0x00, 0x00, 0x0f, 0xff, 0x08, 0x00};
+            stream.write(reinterpret_cast<const char*>(samples), sizeof(samples));
+        }
+        const auto grey = cpumap::mapped_image::open(pgm.path);
+        EXPECT_EQ(grey.get_format(), cpumap::FILE_FORMAT::PGM);
+        const auto grey_texels = read_image(grey);
+        EXPECT_FLOAT_EQ(grey_texels[0], 0.0f);
+        EXPECT_FLOAT_EQ(grey_texels[1], 1.0f);
+        EXPECT_FLOAT_EQ(grey_texels[2], 2048.0f / 4095.0f);
+        EXPECT_EQ(grey.load_bitmask().count(), 2);
+        EXPECT_EQ(grey.load_bitmask(0.75f).count(), 1);
+
+        //an RGB float map, bottom row first: only red is read.
+        const temp_path pfm {"img2sdf_mapped.pfm"};
+        {
+            std::ofstream stream (pfm.path, std::ios::binary);
+            stream << "PF\n1 2\n-1.0\n";
+            const float samples[] = {2.0f, 9.0f, 9.0f, 5.0f, 9.0f, 9.0f};
+            stream.write(reinterpret_cast<const char*>(samples), sizeof(samples));
+        }
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            EXPECT_EQ(read_image(cpumap::mapped_image::open(pfm.path)), (std::vector<float> {5.0f, 2.0f}));
+        }
+
+        const temp_path truncated {"img2sdf_mapped_truncated.pgm"};
+        {
+            std::ofstream stream (truncated.path, std::ios::binary);
+            stream << "P5\n4 4\n255\n";
+        }
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(truncated.path)), std::runtime_error);
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(pgm.path + ".missing")), std::runtime_error);
+        //headerless files need their size.
+        const temp_path headerless {"img2sdf_mapped_headerless.raw"};
+        {
+            std::ofstream stream (headerless.path, std::ios::binary);
+            stream << "0123456789abcdef";
+        }
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(headerless.path)), std::runtime_error);
+        EXPECT_EQ(cpumap::mapped_image::open(headerless.path, 2, 2).get_width(), 2);
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(headerless.path, 3, 2)), std::runtime_error);
+        EXPECT_EQ(cpumap::format_from_extension("field.TILES"), cpumap::FILE_FORMAT::TILED);
+        EXPECT_EQ(cpumap::format_from_extension("field.bin"), cpumap::FILE_FORMAT::RAW);
+    }
+
+    TEST(CPUMapped, RejectsOverflowingHeaders)
+    {
+        const temp_path pgm {"img2sdf_mapped_overflow.pgm"};
+        const auto open_pgm = [&](const std::string& header) {
+            {
+                std::ofstream stream (pgm.path, std::ios::binary);
+                stream << header << std::string(16, '\0');
+            }
+            return cpumap::mapped_image::open(pgm.path);
+        };
+
+        //width * height wraps to 2 texels, which the 16 bytes after the header would hold.
+        EXPECT_THROW(static_cast<void>(open_pgm("P5\n9223372036854775809 2\n255\n")), std::runtime_error);
+        EXPECT_THROW(static_cast<void>(open_pgm("P5\n18446744073709551617 1\n255\n")), std::runtime_error);
+        EXPECT_THROW(static_cast<void>(open_pgm("P5\n-2 2\n255\n")), std::runtime_error);
+        EXPECT_THROW(static_cast<void>(open_pgm("P5\n2x 2\n255\n")), std::runtime_error);
+        EXPECT_THROW(static_cast<void>(open_pgm("P5\n2 2\n-255\n")), std::runtime_error);
+        EXPECT_EQ(open_pgm("P5\n4 4\n255\n").get_width(), 4);
+
+        //a tiled header whose width, at byte 16, needs more tiles than size_t can count.
+        const temp_path tiled {"img2sdf_mapped_overflow.tiles"};
+        {
+            auto image = cpumap::mapped_image::create(tiled.path, cpumap::FILE_FORMAT::TILED, 4, 4, OUTPUT_FORMAT::FLOAT32, 4);
+        }
+        const auto patch_width = [&](uint64_t width) {
+            std::fstream stream (tiled.path, std::ios::binary | std::ios::in | std::ios::out);
+            stream.seekp(16);
+            stream.write(reinterpret_cast<const char*>(&width), sizeof(width));
+        };
+        patch_width(uint64_t {1} << 62);
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(tiled.path)), std::runtime_error);
+        patch_width(8);
+        EXPECT_THROW(static_cast<void>(cpumap::mapped_image::open(tiled.path)), std::runtime_error);
+        patch_width(4);
+        EXPECT_EQ(cpumap::mapped_image::open(tiled.path).get_width(), 4);
+    }
+
+    TEST(CPUMapped, TransformsMasksWiderThanPackedSeeds)
+    {
+        //the CLI path: a mapped PGM loaded as a bitmask, transformed under AUTO, and encoded into a mapped PFM.
+        constexpr size_t width = cpuutils::max_packed_dimension + 1;
+        const temp_path pgm {"img2sdf_mapped_wide.pgm"};
+        {
+            std::vector<char> samples (width * 2, 0);
+            samples.front() = static_cast<char>(255);
+            samples.back() = static_cast<char>(255);
+            std::ofstream stream (pgm.path, std::ios::binary);
+            stream << "P5\n" << width << " 2\n255\n";
+            stream.write(samples.data(), static_cast<std::streamsize>(samples.size()));
+        }
+        const auto input = cpumap::mapped_image::open(pgm.path);
+        const auto mask = input.load_bitmask();
+        ASSERT_EQ(mask.width, width);
+        EXPECT_EQ(mask.count(), 2);
+
+        Img2SDF img2sdf {};
+        img2sdf.set_cpu_engine(CPU_ENGINE::AUTO);
+        const temp_path pfm {"img2sdf_mapped_wide.pfm"};
+        {
+            auto output = cpumap::mapped_image::create(pfm.path, cpumap::FILE_FORMAT::PFM, width, 2);
+            img2sdf.compute_unsigned_distance_field(mask, output_encoding {}, output.view(), false);
+        }
+        const auto field = read_image(cpumap::mapped_image::open(pfm.path));
+        EXPECT_FLOAT_EQ(field[0], 0.0f);
+        EXPECT_FLOAT_EQ(field[1], 1.0f);
+        EXPECT_FLOAT_EQ(field[width / 2], static_cast<float>(width / 2 - 1));
+        EXPECT_FLOAT_EQ(field[width - 1], 1.0f);
+        EXPECT_FLOAT_EQ(field.back(), 0.0f);
+    }
+
+    TEST(CPUMapped, TiledContainerMatchesUntiledField)
+    {
+        const auto mask = random_mask(150, 70, 0.05, 2);
+        const temp_path in_path {"img2sdf_mapped_in.tiles"};
+        const temp_path out_path {"img2sdf_mapped_out.tiles"};
+
+        {
+            auto input = cpumap::mapped_image::create(in_path.path, cpumap::FILE_FORMAT::TILED, mask.width, mask.height,
+                                                      OUTPUT_FORMAT::FLOAT32, 32);
+            input.region_writer()(0, 0, mask);
+        }
+        const auto input = cpumap::mapped_image::open(in_path.path);
+        EXPECT_EQ(input.get_format(), cpumap::FILE_FORMAT::TILED);
+        EXPECT_EQ(input.get_tile_size(), 32);
+        EXPECT_EQ(read_image(input), values(mask));
+
+        Img2SDF img2sdf {2};
+        const auto expected = img2sdf.compute_signed_distance_field(mask, true, 6.0f);
+        {
+            auto output = cpumap::mapped_image::create(out_path.path, cpumap::FILE_FORMAT::TILED, mask.width,
+                                                       mask.height, OUTPUT_FORMAT::FLOAT32, 32);
+            EXPECT_THROW(static_cast<void>(output.view()), std::runtime_error);
+            img2sdf.compute_tiled_distance_field(mask.width, mask.height, input.region_reader(), output.region_writer(),
+                                                 6.0f, true, true, output.get_tile_size());
+        }
+        EXPECT_EQ(read_image(cpumap::mapped_image::open(out_path.path)), values(expected));
+    }
+
+    TEST(CPUMapped, StreamsRowsInPlace)
+    {
+        const auto mask = random_mask(200, 300, 0.05, 3);
+        const temp_path in_path {"img2sdf_mapped_in.raw"};
+        const temp_path out_path {"img2sdf_mapped_out.pfm"};
+        {
+            auto input = cpumap::mapped_image::create(in_path.path, cpumap::FILE_FORMAT::RAW, mask.width, mask.height);
+            input.row_writer()(0, mask.row(0));
+            input.region_writer()(0, 1, cpu_texture<float> {std::vector<float>(mask.row(1), mask.row(mask.height)),
+                                                            mask.width, mask.height - 1});
+        }
+
+        Img2SDF img2sdf {2};
+        std::vector<float> expected;
+        img2sdf.compute_streaming_distance_field(mask.width, mask.height,
+                [&](size_t y, float* row) { std::copy(mask.row(y), mask.row(y) + mask.width, row); },
+                [&](size_t, const float* row) { expected.insert(expected.end(), row, row + mask.width); });
+
+        const auto input = cpumap::mapped_image::open(in_path.path, mask.width, mask.height);
+        {
+            auto output = cpumap::mapped_image::create(out_path.path, cpumap::FILE_FORMAT::PFM, mask.width, mask.height);
+            img2sdf.compute_streaming_distance_field(mask.width, mask.height, input.row_reader(), output.row_writer());
+            output.flush();
+        }
+        EXPECT_EQ(read_image(cpumap::mapped_image::open(out_path.path)), expected);
+
+        //unorm images have no float writers.
+        auto narrow = cpumap::mapped_image::create(out_path.path, cpumap::FILE_FORMAT::PGM, 4, 4, OUTPUT_FORMAT::UNORM8);
+        EXPECT_THROW(static_cast<void>(narrow.row_writer()), std::runtime_error);
+    }
+}
@@ -0,0 +1,118 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/ComputePipeline.h"
+#include "../src/CPUJumpFloodPipeline.h"
+#include "../src/CPUJumpFloodResources.h"
+#include "../src/CPUJumpFloodDispatch.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    ///Stands in for a D3D11 device: kernels are numbered as created, and each creation is logged.
+    struct mock_device
+    {
+        using kernel_type = std::shared_ptr<size_t>;
+
+        kernel_type create_kernel(SHADERS shader, const uint8_t*, size_t size)
+        {
+            if (size == 0)
+            {
+                throw std::runtime_error(std::string {"Could not create "} + shader_name(shader) + " shader.");
+            }
+            created->push_back(shader);
+            return std::make_shared<size_t>(created->size());
+        }
+
+        std::shared_ptr<std::vector<SHADERS>> created = std::make_shared<std::vector<SHADERS>>();
+    };
+
+    TEST(ComputePipeline, CreatesEachShaderOnce)
+    {
+        const uint8_t byte_code[4] = {};
+        jump_flood_shaders shaders {};
+        shaders.preprocess = byte_code;
+        shaders.preprocess_size = sizeof(byte_code);
+        shaders.voronoi = byte_code;
+        shaders.voronoi_size = sizeof(byte_code);
+        shaders.quantise = byte_code;
+        shaders.quantise_size = sizeof(byte_code);
+
+        mock_device device;
+        const ComputePipeline<mock_device> pipeline {device, shaders};
+        EXPECT_EQ(*device.created, (std::vector<SHADERS> {SHADERS::PREPROCESS, SHADERS::VORONOI, SHADERS::QUANTISE}));
+
+        //looking a shader up hands back the one kernel, however often it is asked for.
+        const auto& voronoi = pipeline.get_shader(SHADERS::VORONOI);
+        for (size_t call = 0; call < 3; call++)
+        {
+            EXPECT_EQ(pipeline.get_shader(SHADERS::VORONOI), voronoi);
+        }
+        EXPECT_EQ(device.created->size(), 3);
+        EXPECT_EQ(pipeline.get_shader(SHADERS::DISTANCE), nullptr);
+        EXPECT_THROW(static_cast<void>(pipeline.get_shader(static_cast<SHADERS>(num_shaders))), std::runtime_error);
+
+        //a shader the device rejects fails the pipeline as a whole.
+        shaders.distance_transform = byte_code;
+        EXPECT_THROW((ComputePipeline<mock_device> {device, shaders}), std::runtime_error);
+    }
+
+    TEST(CPUJumpFloodPipeline, BuiltOncePerLevel)
+    {
+        for (const auto level : cpukernels::supported_simd_levels())
+        {
+            const auto pipeline = CPUJumpFloodPipeline::shared(level);
+            EXPECT_EQ(CPUJumpFloodPipeline::shared(level), pipeline);
+            EXPECT_EQ(pipeline->get_simd_level(), level);
+            EXPECT_EQ(pipeline->get_flood_kernel(64, 64), cpukernels::jump_flood_kernel(level));
+            EXPECT_EQ(pipeline->get_flood_kernel(cpukernels::max_simd_dimension + 1, 64),
+                      cpukernels::jump_flood_kernel(cpukernels::SIMD_LEVEL::SCALAR));
+
+            const auto offsets = pipeline->get_row_offsets();
+            EXPECT_EQ(offsets[0], cpuutils::pack_seed(0, 0));
+            EXPECT_EQ(offsets[cpuutils::max_packed_dimension - 1], cpuutils::pack_seed(cpuutils::max_packed_dimension - 1, 0));
+        }
+    }
+
+    TEST(CPUJumpFloodPipeline, DispatchesShareThePipeline)
+    {
+        std::default_random_engine random_gen {20};
+        std::bernoulli_distribution distribution (0.02);
+        cpu_texture<float> mask (97, 53);
+        for (auto& texel : mask.data)
+        {
+            texel = distribution(random_gen) ? 1.0f : 0.0f;
+        }
+
+        const auto pipeline = CPUJumpFloodPipeline::shared();
+        std::vector<cpuutils::packed_seed> expected;
+        for (const auto schedule : {FLOOD_SCHEDULE::ROWS, FLOOD_SCHEDULE::BLOCKED, FLOOD_SCHEDULE::MORTON})
+        {
+            CPUJumpFloodResources resources {&mask, 2};
+            CPUJumpFloodDispatch dispatch {&resources, 2, nullptr, pipeline};
+            EXPECT_EQ(dispatch.get_pipeline(), pipeline);
+            dispatch.set_flood_schedule(schedule);
+            dispatch.dispatch_preprocess();
+            dispatch.dispatch_voronoi();
+
+            const auto& seeds = resources.create_voronoi_buffer(false).data;
+            const std::vector<cpuutils::packed_seed> result (seeds.begin(), seeds.end());
+            if (expected.empty())
+            {
+                expected = result;
+            }
+            EXPECT_EQ(result, expected);
+        }
+
+        //switching level moves a dispatch to that level's shared pipeline rather than building another.
+        CPUJumpFloodResources resources {&mask, 1};
+        CPUJumpFloodDispatch dispatch {&resources, 1};
+        dispatch.set_simd_level(cpukernels::SIMD_LEVEL::SCALAR);
+        EXPECT_EQ(dispatch.get_pipeline(), CPUJumpFloodPipeline::shared(cpukernels::SIMD_LEVEL::SCALAR));
+    }
+}
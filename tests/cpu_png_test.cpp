@@ -0,0 +1,215 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/cpuimage.h"
+#include "../src/cpupng.h"
+#include "test_masks.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    using test_masks::ring_mask;
+    using test_masks::temp_path;
+
+    uint32_t load_big_endian(const uint8_t* bytes)
+    {
+        return (uint32_t {bytes[0]} << 24u) | (uint32_t {bytes[1]} << 16u) | (uint32_t {bytes[2]} << 8u) | bytes[3];
+    }
+
+    ///the chunk types of a PNG file in order, and the data of its IDAT chunks joined up.
+    struct png_chunks
+    {
+        std::vector<std::string> types;
+        std::vector<uint8_t> image_data;
+    };
+
+    png_chunks read_chunks(const std::string& path)
+    {
+        std::ifstream stream (path, std::ios::binary);
+        const std::vector<uint8_t> bytes {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+        EXPECT_GE(bytes.size(), 8u);
+        EXPECT_EQ(std::memcmp(bytes.data(), "\x89PNG\r\n\x1a\n", 8), 0);
+
+        png_chunks chunks;
+        size_t offset = 8;
+        while (offset + 12 <= bytes.size())
+        {
+            const uint32_t size = load_big_endian(bytes.data() + offset);
+            const std::string type (reinterpret_cast<const char*>(bytes.data() + offset + 4), 4);
+            chunks.types.push_back(type);
+            if (type == "IDAT")
+            {
+                chunks.image_data.insert(chunks.image_data.end(), bytes.begin() + offset + 8,
+                                         bytes.begin() + offset + 8 + size);
+            }
+            offset += 12 + size;
+        }
+        EXPECT_EQ(offset, bytes.size());
+        return chunks;
+    }
+
+    ///Undoes filter_row, as a decoder would.
+    std::vector<uint8_t> unfilter_row(const uint8_t* filtered, const std::vector<uint8_t>& previous, size_t texel_bytes)
+    {
+        std::vector<uint8_t> row (previous.size());
+        for (size_t x = 0; x < row.size(); x++)
+        {
+            const int left = x >= texel_bytes ? row[x - texel_bytes] : 0;
+            const int up = previous[x];
+            const int up_left = x >= texel_bytes ? previous[x - texel_bytes] : 0;
+            int prediction = 0;
+            switch (static_cast<cpupng::ROW_FILTER>(filtered[0]))
+            {
+                case cpupng::ROW_FILTER::SUB: prediction = left; break;
+                case cpupng::ROW_FILTER::UP: prediction = up; break;
+                case cpupng::ROW_FILTER::AVERAGE: prediction = (left + up) / 2; break;
+                case cpupng::ROW_FILTER::PAETH:
+                {
+                    const int estimate = left + up - up_left;
+                    const int to_left = std::abs(estimate - left);
+                    const int to_up = std::abs(estimate - up);
+                    const int to_up_left = std::abs(estimate - up_left);
+                    prediction = to_left <= to_up && to_left <= to_up_left ? left : to_up <= to_up_left ? up : up_left;
+                    break;
+                }
+                default: break;
+            }
+            row[x] = static_cast<uint8_t>(filtered[x + 1] + prediction);
+        }
+        return row;
+    }
+
+    TEST(CPUPNG, FiltersRowsLosslessly)
+    {
+        for (const size_t texel_bytes : {1, 2})
+        {
+            //a slanted ramp, as a distance field is, with a kink.
+            const size_t row_bytes = 90;
+            std::vector<uint8_t> previous (row_bytes, 0);
+            auto preferred = cpupng::ROW_FILTER::SUB;
+            for (size_t y = 0; y < 6; y++)
+            {
+                std::vector<uint8_t> row (row_bytes);
+                for (size_t x = 0; x < row_bytes; x++)
+                {
+                    row[x] = static_cast<uint8_t>(std::abs(static_cast<int>(x / texel_bytes) - 20) * 3 + y * 5);
+                }
+
+                std::vector<uint8_t> filtered (row_bytes + 1);
+                preferred = cpupng::filter_row(row.data(), y == 0 ? nullptr : previous.data(), row_bytes,
+                                               texel_bytes, preferred, filtered.data());
+                EXPECT_EQ(filtered[0], static_cast<uint8_t>(preferred));
+                EXPECT_NE(preferred, cpupng::ROW_FILTER::NONE);
+                EXPECT_EQ(unfilter_row(filtered.data(), previous, texel_bytes), row);
+                previous = row;
+            }
+        }
+
+        //a row repeating the one above leaves nothing but zeros under UP.
+        const std::vector<uint8_t> row {10, 40, 7, 200, 3};
+        std::vector<uint8_t> filtered (row.size() + 1);
+        EXPECT_EQ(cpupng::filter_row(row.data(), row.data(), row.size(), 1, cpupng::ROW_FILTER::SUB, filtered.data()),
+                  cpupng::ROW_FILTER::UP);
+        EXPECT_EQ(filtered, (std::vector<uint8_t> {2, 0, 0, 0, 0, 0}));
+    }
+
+    TEST(CPUPNG, ChunksFormOneStreamWhateverTheThreads)
+    {
+        if (!cpupng::is_available())
+        {
+            GTEST_SKIP() << "built without zlib";
+        }
+
+        const auto mask = ring_mask(53, 47, 4.0f, 15.0f, 1.0f / 3);
+        Img2SDF img2sdf {2};
+        const auto encoding = output_encoding::full_range(OUTPUT_FORMAT::UNORM16, true);
+        const auto field = img2sdf.compute_signed_distance_field(mask, encoding, true, 8.0f);
+
+        //chunks of a few rows, so the stream is spliced together from many primed pieces and several batches.
+        std::vector<std::vector<uint8_t>> streams;
+        for (const size_t num_threads : {1, 3, 8})
+        {
+            const temp_path path {"img2sdf_parallel.png"};
+            cpupng::encoder_options options;
+            options.chunk_bytes = 300;
+            options.num_threads = num_threads;
+            options.pool = img2sdf.get_thread_pool().get();
+            {
+                cpupng::parallel_writer writer {path.path, mask.width, mask.height, OUTPUT_FORMAT::UNORM16, options};
+                //rows arrive in uneven bands.
+                size_t y = 0;
+                for (const size_t rows : {1, 10, 13, 23})
+                {
+                    writer.write_rows(field.data.data() + y * field.row_pitch(), rows);
+                    y += rows;
+                }
+                writer.finish();
+            }
+
+            const auto chunks = read_chunks(path.path);
+            EXPECT_EQ(chunks.types.front(), "IHDR");
+            EXPECT_EQ(chunks.types.back(), "IEND");
+            streams.push_back(chunks.image_data);
+        }
+        EXPECT_EQ(streams[0], streams[1]);
+        EXPECT_EQ(streams[0], streams[2]);
+
+        const temp_path short_path {"img2sdf_short.png"};
+        cpupng::parallel_writer short_writer {short_path.path, 4, 4, OUTPUT_FORMAT::UNORM8};
+        const std::vector<uint8_t> row (4);
+        short_writer.write_rows(row.data(), 1);
+        EXPECT_THROW(short_writer.finish(), std::runtime_error);
+        EXPECT_THROW(cpupng::parallel_writer(short_path.path, 4, 4, OUTPUT_FORMAT::FLOAT16), std::runtime_error);
+    }
+
+    TEST(CPUPNG, DecodesToTheField)
+    {
+        if (!cpupng::is_available() || !cpuimage::is_supported(cpuimage::IMAGE_FORMAT::PNG))
+        {
+            GTEST_SKIP() << "built without zlib or libpng";
+        }
+
+        const auto mask = ring_mask(37, 29, 4.0f, 15.0f, 1.0f / 3);
+        Img2SDF img2sdf {2};
+        const auto encoding = output_encoding::full_range(OUTPUT_FORMAT::UNORM8, true);
+        const auto field = img2sdf.compute_signed_distance_field(mask, encoding, true, 6.0f);
+
+        const temp_path path {"img2sdf_decoded.png"};
+        cpupng::encoder_options options;
+        options.chunk_bytes = 100;
+        options.num_threads = 4;
+        {
+            cpupng::parallel_writer writer {path.path, mask.width, mask.height, OUTPUT_FORMAT::UNORM8, options};
+            writer.write_rows(field.data.data(), mask.height);
+            writer.finish();
+        }
+
+        //the decoder only thresholds, so each texel is rebuilt by counting the levels it lies above.
+        std::vector<int> decoded (field.data.size(), 0);
+        for (int level = 0; level < 255; level++)
+        {
+            cpuimage::mask_reader reader {path.path, (static_cast<float>(level) + 0.5f) / 255.0f};
+            std::vector<uint8_t> row (mask.width);
+            for (size_t y = 0; y < mask.height; y++)
+            {
+                reader.read_row(row.data());
+                for (size_t x = 0; x < mask.width; x++)
+                {
+                    decoded[y * mask.width + x] += row[x];
+                }
+            }
+        }
+        for (size_t texel = 0; texel < decoded.size(); texel++)
+        {
+            ASSERT_EQ(decoded[texel], field.data[texel]) << texel;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/cpureduce.h"
+#include "../src/CPUThreadPool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    cpukernels::float_statistics serial_statistics(const std::vector<float>& values)
+    {
+        cpukernels::float_statistics statistics {};
+        for (const float value : values)
+        {
+            statistics.minimum = std::min(statistics.minimum, value);
+            statistics.maximum = std::max(statistics.maximum, value);
+            statistics.sum += value;
+        }
+        statistics.count = values.size();
+        return statistics;
+    }
+
+    TEST(CPUReduce, MatchesSerialOnStridedViews)
+    {
+        std::default_random_engine random_gen {11};
+        std::uniform_real_distribution<float> distribution (-250.0f, 750.0f);
+        CPUThreadPool pool {3};
+
+        //odd widths leave tails for the scalar loop, and a row pitch with padding as a staging texture has.
+        for (const size_t width : {1, 7, 37, 64, 301})
+        {
+            const size_t height = 53;
+            const size_t pitch_values = width + 5;
+            std::vector<float> padded (pitch_values * height, std::numeric_limits<float>::quiet_NaN());
+            cpu_texture<float4> vectors (width, height);
+            std::vector<float> values;
+            for (size_t y = 0; y < height; y++)
+            {
+                for (size_t x = 0; x < width; x++)
+                {
+                    const float value = distribution(random_gen);
+                    padded[y * pitch_values + x] = value;
+                    vectors.at(x, y) = {-value, value, 0.0f, 1.0f};
+                    values.push_back(value);
+                }
+            }
+            const auto expected = serial_statistics(values);
+
+            const cpureduce::float_view padded_view {padded.data(), width, height, pitch_values * sizeof(float)};
+            for (const auto level : cpukernels::supported_simd_levels())
+            {
+                for (const size_t num_bands : {1, 4})
+                {
+                    const auto computed = cpureduce::statistics(padded_view, num_bands, &pool, level);
+                    EXPECT_EQ(computed.minimum, expected.minimum) << cpukernels::simd_level_name(level) << " width " << width;
+                    EXPECT_EQ(computed.maximum, expected.maximum) << cpukernels::simd_level_name(level) << " width " << width;
+                    EXPECT_EQ(computed.count, expected.count);
+                    EXPECT_NEAR(computed.mean(), expected.mean(), 1e-9);
+                }
+
+                const auto channel = cpureduce::min_max(cpureduce::channel_view(vectors, 0), 4, &pool, level);
+                EXPECT_EQ(channel.first, -expected.maximum);
+                EXPECT_EQ(channel.second, -expected.minimum);
+            }
+        }
+    }
+
+    TEST(CPUReduce, SkipsNaNs)
+    {
+        cpu_texture<float> field (97, 33, std::numeric_limits<float>::quiet_NaN());
+        field.at(5, 3) = -2.5f;
+        field.at(90, 30) = inf;
+        field.at(41, 17) = 0.5f;
+
+        for (const auto level : cpukernels::supported_simd_levels())
+        {
+            const auto range = cpureduce::min_max(cpureduce::view(field), 2, nullptr, level);
+            EXPECT_EQ(range.first, -2.5f) << cpukernels::simd_level_name(level);
+            EXPECT_EQ(range.second, inf) << cpukernels::simd_level_name(level);
+        }
+    }
+
+    TEST(CPUReduce, EmptyView)
+    {
+        const auto range = cpureduce::min_max(cpureduce::float_view {});
+        EXPECT_EQ(range.first, inf);
+        EXPECT_EQ(range.second, -inf);
+        EXPECT_EQ(cpureduce::min_max(std::vector<float> {}).first, inf);
+    }
+
+    TEST(CPUReduce, ArraysSplitIntoRows)
+    {
+        std::default_random_engine random_gen {13};
+        std::uniform_real_distribution<float> distribution (-1.0f, 1.0f);
+        CPUThreadPool pool {3};
+
+        //whole rows of min_band_values and a remainder, with the extremes in the first row, the last and the remainder.
+        std::vector<float> values (3 * cpureduce::min_band_values + 123);
+        for (auto& value : values)
+        {
+            value = distribution(random_gen);
+        }
+        for (const auto& [minimum_at, maximum_at] : {std::pair<size_t, size_t> {7, values.size() - 1},
+                                                     std::pair<size_t, size_t> {values.size() - 5, 3 * cpureduce::min_band_values - 1}})
+        {
+            auto array = values;
+            array[minimum_at] = -9.0f;
+            array[maximum_at] = 9.0f;
+            for (const size_t num_bands : {1, 4})
+            {
+                EXPECT_EQ(cpureduce::min_max(array, num_bands, &pool), std::make_pair(-9.0f, 9.0f)) << num_bands << " bands";
+            }
+        }
+
+        //shorter than a row, all remainder.
+        EXPECT_EQ(cpureduce::min_max(std::vector<float> {3.0f, -1.0f, 2.0f}), std::make_pair(-1.0f, 3.0f));
+    }
+
+    TEST(CPUReduce, Histogram)
+    {
+        std::default_random_engine random_gen {12};
+        std::uniform_real_distribution<float> distribution (-1.5f, 1.5f);
+        cpu_texture<float> field (129, 77);
+        for (auto& value : field.data)
+        {
+            value = distribution(random_gen);
+        }
+        field.at(0, 0) = std::numeric_limits<float>::quiet_NaN();
+
+        constexpr size_t num_bins = 10;
+        std::vector<size_t> expected (num_bins, 0);
+        for (const float value : field.data)
+        {
+            if (!std::isnan(value))
+            {
+                const auto bin = static_cast<int64_t>(std::floor((value + 1.0) * num_bins / 2.0));
+                expected[std::clamp<int64_t>(bin, 0, num_bins - 1)]++;
+            }
+        }
+
+        CPUThreadPool pool {3};
+        EXPECT_EQ(cpureduce::histogram(cpureduce::view(field), num_bins, -1.0f, 1.0f, 5, &pool), expected);
+        EXPECT_THROW(cpureduce::histogram(cpureduce::view(field), 0, -1.0f, 1.0f), std::runtime_error);
+        EXPECT_THROW(cpureduce::histogram(cpureduce::view(field), 4, 1.0f, 1.0f), std::runtime_error);
+    }
+}
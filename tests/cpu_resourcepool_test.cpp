@@ -0,0 +1,190 @@
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/ResourcePool.h"
+#include "../src/CPUResourcePool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+    ///Stands in for a device: resources are numbered as created, and counted while alive.
+    struct mock_backend
+    {
+        struct mock_resource
+        {
+            mock_resource(size_t id, std::shared_ptr<size_t> live) : id(id), live(std::move(live)) { (*this->live)++; }
+            ~mock_resource() { (*live)--; }
+
+            size_t id;
+            std::shared_ptr<size_t> live;
+        };
+
+        using format_type = int;
+        using resource_type = std::unique_ptr<mock_resource>;
+
+        resource_type create(size_t, size_t, format_type)
+        {
+            return std::make_unique<mock_resource>(created++, live);
+        }
+
+        size_t size_in_bytes(size_t width, size_t height, format_type format) const
+        {
+            return width * height * static_cast<size_t>(format);
+        }
+
+        size_t created = 0;
+        std::shared_ptr<size_t> live = std::make_shared<size_t>(0);
+    };
+
+    using mock_pool = ResourcePool<mock_backend>;
+
+    TEST(ResourcePool, RecyclesByKey)
+    {
+        mock_backend backend;
+        const auto live = backend.live;
+        mock_pool pool {backend, 1 << 20};
+
+        size_t first_id;
+        {
+            auto lease = pool.acquire(16, 8, 4);
+            first_id = (*lease)->id;
+        }
+        EXPECT_EQ(pool.get_statistics().idle_resources, 1);
+        EXPECT_EQ(pool.get_statistics().idle_bytes, 16 * 8 * 4);
+
+        //the same key gets the idle resource back, any other key a new one.
+        auto same = pool.acquire(16, 8, 4);
+        EXPECT_EQ((*same)->id, first_id);
+        auto other_format = pool.acquire(16, 8, 2);
+        auto other_size = pool.acquire(8, 16, 4);
+        EXPECT_NE((*other_format)->id, first_id);
+        EXPECT_NE((*other_size)->id, (*other_format)->id);
+
+        const auto statistics = pool.get_statistics();
+        EXPECT_EQ(statistics.hits, 1);
+        EXPECT_EQ(statistics.misses, 3);
+        EXPECT_EQ(statistics.idle_resources, 0);
+        EXPECT_EQ(*live, 3);
+    }
+
+    TEST(ResourcePool, EvictsLeastRecentlyReturned)
+    {
+        mock_backend backend;
+        const auto live = backend.live;
+        //room for three idle 10x10x1 resources.
+        mock_pool pool {backend, 300};
+
+        std::vector<mock_pool::lease> leases;
+        for (size_t i = 0; i < 4; i++)
+        {
+            leases.push_back(pool.acquire(10, 10, 1));
+        }
+        const size_t oldest_id = (*leases[0])->id;
+        const size_t newest_id = (*leases[3])->id;
+        //returned in order, so the first to come back is the first to go.
+        for (auto& lease : leases)
+        {
+            lease.reset();
+        }
+
+        auto statistics = pool.get_statistics();
+        EXPECT_EQ(statistics.evictions, 1);
+        EXPECT_EQ(statistics.idle_resources, 3);
+        EXPECT_EQ(statistics.idle_bytes, 300);
+        EXPECT_EQ(*live, 3);
+
+        auto recent = pool.acquire(10, 10, 1);
+        EXPECT_EQ((*recent)->id, newest_id);
+        EXPECT_NE((*recent)->id, oldest_id);
+
+        //shrinking the cap evicts right away; resources larger than it are never kept.
+        pool.set_memory_cap(100);
+        EXPECT_EQ(pool.get_statistics().idle_resources, 1);
+        pool.acquire(20, 20, 1).reset();
+        EXPECT_EQ(pool.get_statistics().idle_bytes, 100);
+
+        pool.trim();
+        EXPECT_EQ(pool.get_statistics().idle_resources, 0);
+        EXPECT_EQ(*live, 1);
+    }
+
+    TEST(ResourcePool, ReleasedResourcesLeaveThePool)
+    {
+        mock_backend backend;
+        const auto live = backend.live;
+        mock_pool pool {backend, 1 << 20};
+
+        auto lease = pool.acquire(4, 4, 1);
+        auto resource = lease.release();
+        EXPECT_FALSE(lease.has_value());
+        EXPECT_THROW(lease.release(), std::runtime_error);
+        lease.reset();
+        EXPECT_EQ(pool.get_statistics().idle_resources, 0);
+
+        resource.reset();
+        EXPECT_EQ(*live, 0);
+    }
+
+    TEST(ResourcePool, LeasesOutliveThePool)
+    {
+        mock_backend backend;
+        const auto live = backend.live;
+        mock_pool::lease lease;
+        {
+            mock_pool pool {backend, 1 << 20};
+            pool.acquire(4, 4, 1).reset();
+            lease = pool.acquire(8, 8, 1);
+            EXPECT_EQ(*live, 2);
+        }
+        //the idle resource went with the pool; the leased one is freed once returned.
+        EXPECT_EQ(*live, 1);
+        lease.reset();
+        EXPECT_EQ(*live, 0);
+    }
+
+    TEST(ResourcePool, Img2SDFReusesBuffers)
+    {
+        std::default_random_engine random_gen {19};
+        std::bernoulli_distribution distribution (0.01);
+        std::vector<cpu_texture<float>> masks;
+        for (size_t i = 0; i < 3; i++)
+        {
+            cpu_texture<float> mask (83, 61);
+            for (auto& texel : mask.data)
+            {
+                texel = distribution(random_gen) ? 1.0f : 0.0f;
+            }
+            masks.push_back(std::move(mask));
+        }
+
+        Img2SDF pooled {2};
+        EXPECT_EQ(pooled.get_resource_pool()->get_memory_cap(), default_pool_memory_cap);
+        for (const auto& mask : masks)
+        {
+            //recycled buffers still hold the last mask's seeds, so they must be cleared as new ones are.
+            Img2SDF fresh {2};
+            EXPECT_EQ(pooled.compute_signed_distance_field(mask, true).data,
+                      fresh.compute_signed_distance_field(mask, true).data);
+            const auto voronoi = pooled.compute_voronoi_transform(mask);
+            const auto expected = fresh.compute_voronoi_transform(mask);
+            for (size_t i = 0; i < expected.data.size(); i++)
+            {
+                ASSERT_EQ(voronoi.data[i].x, expected.data[i].x) << "texel " << i;
+                ASSERT_EQ(voronoi.data[i].y, expected.data[i].y) << "texel " << i;
+            }
+        }
+
+        //the voronoi buffers are recycled; the distance buffer is handed to the caller each time.
+        const auto statistics = pooled.get_resource_pool()->get_statistics();
+        EXPECT_GT(statistics.hits, 0);
+        EXPECT_EQ(statistics.idle_bytes, 2 * 83 * 61 * sizeof(cpuutils::packed_seed));
+
+        pooled.get_resource_pool()->set_memory_cap(0);
+        EXPECT_EQ(pooled.get_resource_pool()->get_statistics().idle_bytes, 0);
+        EXPECT_THROW(pooled.set_resource_pool(nullptr), std::runtime_error);
+    }
+}
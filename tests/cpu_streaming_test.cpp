@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "../src/img2sdf.h"
+#include "../src/CPUStreamingDistanceTransform.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+    ///random blocky mask: runs of set rows and columns, so distances along both axes are longer than a texel.
+    cpu_texture<float> block_mask(size_t width, size_t height, double density)
+    {
+        std::default_random_engine random_gen {1};
+        std::bernoulli_distribution distribution (density);
+
+        cpu_texture<float> mask (width, height);
+        for (size_t y = 0; y < height; y += 3)
+        {
+            for (size_t x = 0; x < width; x += 3)
+            {
+                const float value = distribution(random_gen) ? 1.0f : 0.0f;
+                for (size_t dy = y; dy < std::min(height, y + 3); dy++)
+                {
+                    for (size_t dx = x; dx < std::min(width, x + 3); dx++)
+                    {
+                        mask.at(dx, dy) = value;
+                    }
+                }
+            }
+        }
+        return mask;
+    }
+
+    ///streams `mask` through Img2SDF::compute_streaming_distance_field, checking rows arrive in order.
+    cpu_texture<float> stream_field(const cpu_texture<float>& mask, bool is_signed, float max_distance, bool normalise)
+    {
+        Img2SDF img2sdf {};
+        cpu_texture<float> out (mask.width, mask.height);
+        size_t next_row = 0;
+
+        const cpuio::row_reader reader = [&](size_t y, float* row) {
+            std::copy(mask.row(y), mask.row(y) + mask.width, row);
+        };
+        const cpuio::row_writer writer = [&](size_t y, const float* row) {
+            EXPECT_EQ(y, next_row++);
+            std::copy(row, row + mask.width, out.row(y));
+        };
+
+        img2sdf.compute_streaming_distance_field(mask.width, mask.height, reader, writer, is_signed, max_distance,
+                                                 normalise, 5);
+        EXPECT_EQ(next_row, mask.height);
+        return out;
+    }
+
+    class CPUStreaming : public testing::TestWithParam<std::pair<size_t, size_t>> {};
+
+    TEST_P(CPUStreaming, MatchesExactEDT)
+    {
+        const auto [width, height] = GetParam();
+        Img2SDF exact {};
+        exact.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+
+        for (const double density : {0.02, 0.5})
+        {
+            const auto mask = block_mask(width, height, density);
+            for (const bool is_signed : {false, true})
+            {
+                for (const float max_distance : {0.0f, 4.0f})
+                {
+                    const auto expected = is_signed ? exact.compute_signed_distance_field(mask, false, max_distance)
+                                                    : exact.compute_unsigned_distance_field(mask, false, max_distance);
+                    const auto field = stream_field(mask, is_signed, max_distance, false);
+
+                    for (size_t i = 0; i < field.data.size(); i++)
+                    {
+                        if (std::isinf(expected.data[i]))
+                        {
+                            EXPECT_EQ(field.data[i], expected.data[i]) << "at index " << i;
+                            continue;
+                        }
+                        EXPECT_NEAR(field.data[i], expected.data[i], 1e-4f) << "at index " << i;
+                    }
+                }
+            }
+        }
+    }
+
+    TEST_P(CPUStreaming, NormalisesAgainstSpread)
+    {
+        const auto [width, height] = GetParam();
+        const auto mask = block_mask(width, height, 0.3);
+
+        Img2SDF exact {};
+        exact.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+        const auto expected = exact.compute_signed_distance_field(mask, true, 6.0f);
+        const auto field = stream_field(mask, true, 6.0f, true);
+
+        for (size_t i = 0; i < field.data.size(); i++)
+        {
+            EXPECT_NEAR(field.data[i], expected.data[i], 1e-5f) << "at index " << i;
+        }
+    }
+
+    TEST(CPUStreaming, BandIsBoundedBySpread)
+    {
+        constexpr size_t width = 40;
+        constexpr size_t height = 200;
+        constexpr float max_distance = 7.0f;
+        //no seeds at all: without the spread, every row would wait for the end of the input.
+        const std::vector<float> empty_row (width, 0.0f);
+
+        size_t emitted = 0;
+        CPUStreamingDistanceTransform transform {width, height, [&](size_t, const float*) { emitted++; }, false, max_distance};
+
+        size_t peak_buffered = 0;
+        for (size_t y = 0; y < height; y++)
+        {
+            transform.push_row(empty_row.data());
+            peak_buffered = std::max(peak_buffered, transform.rows_buffered());
+        }
+
+        EXPECT_EQ(emitted, height);
+        EXPECT_LE(peak_buffered, static_cast<size_t>(max_distance) + 1);
+    }
+
+    TEST(CPUStreaming, RawFileRoundTrip)
+    {
+        constexpr size_t width = 31;
+        constexpr size_t height = 47;
+        const auto mask = block_mask(width, height, 0.2);
+
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto in_path = (directory / "img2sdf_streaming_in.raw").string();
+        const auto out_path = (directory / "img2sdf_streaming_out.raw").string();
+        {
+            std::ofstream in_file (in_path, std::ios::binary);
+            in_file.write(reinterpret_cast<const char*>(mask.data.data()), static_cast<std::streamsize>(mask.data.size() * sizeof(float)));
+        }
+
+        Img2SDF img2sdf {};
+        img2sdf.compute_streaming_distance_field(width, height, cpuio::raw_row_reader(in_path, width, height),
+                                                 cpuio::raw_row_writer(out_path, width), true, 0, false, 8);
+
+        cpu_texture<float> field (width, height);
+        std::ifstream out_file (out_path, std::ios::binary);
+        out_file.read(reinterpret_cast<char*>(field.data.data()), static_cast<std::streamsize>(field.data.size() * sizeof(float)));
+        ASSERT_TRUE(out_file);
+
+        img2sdf.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+        const auto expected = img2sdf.compute_signed_distance_field(mask, false);
+        for (size_t i = 0; i < expected.data.size(); i++)
+        {
+            EXPECT_NEAR(field.data[i], expected.data[i], 1e-4f) << "at index " << i;
+        }
+
+        std::remove(in_path.c_str());
+        std::remove(out_path.c_str());
+    }
+
+    TEST(CPUStreaming, NormaliseRequiresSpread)
+    {
+        EXPECT_THROW((CPUStreamingDistanceTransform {8, 8, [](size_t, const float*) {}, true, 0.0f, true}), std::runtime_error);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(CPUStreamingTests, CPUStreaming,
+                             ::testing::Values(std::pair<size_t, size_t> {32, 32}, std::pair<size_t, size_t> {57, 23},
+                                               std::pair<size_t, size_t> {9, 70}));
+}
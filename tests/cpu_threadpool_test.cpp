@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/img2sdf.h"
+#include "../src/CPUThreadPool.h"
+#include "../src/CPUJumpFloodResources.h"
+
+#include "gtest/gtest.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+    TEST(CPUThreadPool, BandsCoverRangeOnce)
+    {
+        CPUThreadPool pool {4};
+        ASSERT_EQ(pool.get_num_threads(), 4);
+
+        for (const size_t count : {1, 3, 4, 5, 1000})
+        {
+            for (const size_t max_bands : {1, 3, 4, 16})
+            {
+                std::vector<std::atomic<int32_t>> hits (count);
+                std::atomic<size_t> bands = 0;
+
+                pool.parallel_for(count, max_bands, [&](size_t begin, size_t end) {
+                    bands++;
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        hits[i]++;
+                    }
+                });
+
+                EXPECT_LE(bands.load(), std::min(count, max_bands));
+                for (size_t i = 0; i < count; i++)
+                {
+                    EXPECT_EQ(hits[i].load(), 1) << "count " << count << " bands " << max_bands << " at " << i;
+                }
+            }
+        }
+    }
+
+    TEST(CPUThreadPool, NestedCallsStayWithinPool)
+    {
+        constexpr size_t num_threads = 3;
+        CPUThreadPool pool {num_threads};
+
+        std::mutex ids_mutex;
+        std::set<std::thread::id> ids;
+        std::atomic<int32_t> running = 0;
+        std::atomic<int32_t> peak_running = 0;
+        std::atomic<size_t> total = 0;
+
+        //a batch of "images", each split into bands of its own.
+        pool.parallel_for(8, 8, [&](size_t begin, size_t end) {
+            for (size_t image = begin; image < end; image++)
+            {
+                pool.parallel_for(64, num_threads, [&](size_t inner_begin, size_t inner_end) {
+                    const int32_t now = ++running;
+                    int32_t peak = peak_running.load();
+                    while (now > peak && !peak_running.compare_exchange_weak(peak, now)) {}
+                    {
+                        std::lock_guard lock (ids_mutex);
+                        ids.insert(std::this_thread::get_id());
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    total += inner_end - inner_begin;
+                    --running;
+                });
+            }
+        });
+
+        EXPECT_EQ(total.load(), 8 * 64);
+        EXPECT_LE(ids.size(), num_threads);
+        EXPECT_LE(peak_running.load(), static_cast<int32_t>(num_threads));
+    }
+
+    TEST(CPUThreadPool, RethrowsBandException)
+    {
+        CPUThreadPool pool {3};
+        std::atomic<size_t> completed = 0;
+
+        EXPECT_THROW(pool.parallel_for(9, 9, [&](size_t begin, size_t) {
+            if (begin == 5)
+            {
+                throw std::runtime_error("band failed");
+            }
+            completed++;
+        }), std::runtime_error);
+        EXPECT_EQ(completed.load(), 8);
+
+        //the pool is still usable afterwards.
+        std::atomic<size_t> total = 0;
+        pool.parallel_for(100, 3, [&](size_t begin, size_t end) { total += end - begin; });
+        EXPECT_EQ(total.load(), 100);
+    }
+
+    TEST(CPUThreadPool, SharedBetweenInstances)
+    {
+        std::default_random_engine random_gen {3};
+        std::bernoulli_distribution distribution (0.01);
+        std::vector<cpu_texture<float>> masks;
+        for (size_t i = 0; i < 4; i++)
+        {
+            cpu_texture<float> mask (61 + i * 7, 45);
+            for (auto& texel : mask.data)
+            {
+                texel = distribution(random_gen) ? 1.0f : 0.0f;
+            }
+            masks.push_back(std::move(mask));
+        }
+
+        Img2SDF reference {2};
+        std::vector<cpu_texture<float>> expected;
+        for (const auto& mask : masks)
+        {
+            expected.push_back(reference.compute_signed_distance_field(mask, true));
+        }
+
+        const auto pool = std::make_shared<CPUThreadPool>(3);
+        std::vector<cpu_texture<float>> fields (masks.size());
+        pool->parallel_for(masks.size(), masks.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                Img2SDF img2sdf {pool};
+                fields[i] = img2sdf.compute_signed_distance_field(masks[i], true);
+            }
+        });
+
+        for (size_t i = 0; i < masks.size(); i++)
+        {
+            EXPECT_EQ(fields[i].data, expected[i].data) << "image " << i;
+        }
+    }
+
+    TEST(CPUThreadPool, RejectsNullPool)
+    {
+        EXPECT_THROW(Img2SDF {std::shared_ptr<CPUThreadPool> {}}, std::runtime_error);
+    }
+
+    TEST(CPUThreadPool, NumaPlacement)
+    {
+        const auto nodes = CPUThreadPool::numa_nodes();
+        ASSERT_FALSE(nodes.empty());
+        std::set<size_t> cpus;
+        for (const auto& node : nodes)
+        {
+            for (const size_t cpu : node)
+            {
+                EXPECT_TRUE(cpus.insert(cpu).second) << "CPU " << cpu << " is on two nodes";
+            }
+        }
+
+        const auto pool = std::make_shared<CPUThreadPool>(3, THREAD_PLACEMENT::NUMA);
+        ASSERT_EQ(pool->get_num_threads(), 3);
+
+        //the caller may be on any node, so it leaves every band to the workers.
+        std::mutex ids_mutex;
+        std::set<std::thread::id> ids;
+        pool->parallel_for(12, 3, [&](size_t, size_t) {
+            std::lock_guard lock (ids_mutex);
+            ids.insert(std::this_thread::get_id());
+        });
+        EXPECT_EQ(ids.count(std::this_thread::get_id()), 0);
+
+        std::default_random_engine random_gen {5};
+        std::bernoulli_distribution distribution (0.005);
+        cpu_texture<float> mask (150, 97);
+        for (auto& texel : mask.data)
+        {
+            texel = distribution(random_gen) ? 1.0f : 0.0f;
+        }
+
+        Img2SDF reference {1};
+        const auto expected = reference.compute_signed_distance_field(mask, true);
+        for (const auto schedule : {FLOOD_SCHEDULE::ROWS, FLOOD_SCHEDULE::BLOCKED, FLOOD_SCHEDULE::MORTON})
+        {
+            Img2SDF img2sdf {pool};
+            img2sdf.set_flood_schedule(schedule);
+            EXPECT_EQ(img2sdf.compute_signed_distance_field(mask, true).data, expected.data);
+        }
+    }
+
+    TEST(CPUThreadPool, FirstTouchFillsBuffers)
+    {
+        cpu_texture<float> mask (37, 29, 1.0f);
+        CPUThreadPool pool {3};
+        CPUJumpFloodResources resources {&mask, 4, &pool};
+
+        const auto& voronoi = resources.create_voronoi_buffer();
+        EXPECT_TRUE(std::all_of(voronoi.data.begin(), voronoi.data.end(), [](auto seed) { return seed == cpuutils::no_seed; }));
+        const auto& scratch = resources.get_voronoi_scratch();
+        EXPECT_TRUE(std::all_of(scratch.data.begin(), scratch.data.end(), [](auto seed) { return seed == cpuutils::no_seed; }));
+        const auto& distance = resources.create_distance_buffer();
+        EXPECT_TRUE(std::all_of(distance.data.begin(), distance.data.end(), [](float value) { return value == 0.0f; }));
+    }
+
+#ifdef __linux__
+    TEST(CPUThreadPool, PinsWorkers)
+    {
+        //every process may run on some CPU, though not necessarily CPU 0.
+        cpu_set_t allowed;
+        ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+        size_t cpu = 0;
+        while (!CPU_ISSET(cpu, &allowed))
+        {
+            cpu++;
+        }
+
+        CPUThreadPool pool {3, {cpu}};
+        std::atomic<size_t> total = 0;
+        pool.parallel_for(30, 3, [&](size_t begin, size_t end) { total += end - begin; });
+        EXPECT_EQ(total.load(), 30);
+
+        EXPECT_THROW((CPUThreadPool {2, {CPU_SETSIZE}}), std::runtime_error);
+    }
+#endif
+}
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+
+#include "../src/img2sdf.h"
+#include "../src/cpuio.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+    ///mask of random discs, so both the inside and outside have distances longer than a texel.
+    cpu_texture<float> disc_mask(size_t width, size_t height)
+    {
+        std::default_random_engine random_gen {0};
+        std::uniform_real_distribution<float> x_distribution (0.0f, static_cast<float>(width));
+        std::uniform_real_distribution<float> y_distribution (0.0f, static_cast<float>(height));
+        std::uniform_real_distribution<float> radius_distribution (1.0f, 6.0f);
+
+        cpu_texture<float> mask (width, height);
+        for (int32_t disc = 0; disc < 12; disc++)
+        {
+            const float cx = x_distribution(random_gen);
+            const float cy = y_distribution(random_gen);
+            const float radius = radius_distribution(random_gen);
+            for (size_t y = 0; y < height; y++)
+            {
+                for (size_t x = 0; x < width; x++)
+                {
+                    const float dx = static_cast<float>(x) - cx;
+                    const float dy = static_cast<float>(y) - cy;
+                    if (dx * dx + dy * dy <= radius * radius)
+                    {
+                        mask.at(x, y) = 1.0f;
+                    }
+                }
+            }
+        }
+        return mask;
+    }
+
+    class CPUTiled : public testing::TestWithParam<CPU_ENGINE> {};
+
+    TEST_P(CPUTiled, MatchesUntiledField)
+    {
+        constexpr size_t width = 100;
+        constexpr size_t height = 70;
+        constexpr float max_distance = 5.0f;
+        constexpr size_t num_threads = 3;
+        const auto mask = disc_mask(width, height);
+
+        for (const bool is_signed : {true, false})
+        {
+            Img2SDF img2sdf {num_threads};
+            img2sdf.set_cpu_engine(GetParam());
+
+            const auto expected = is_signed ? img2sdf.compute_signed_distance_field(mask, true, max_distance)
+                                            : img2sdf.compute_unsigned_distance_field(mask, true, max_distance);
+
+            cpu_texture<float> stitched (width, height, std::numeric_limits<float>::quiet_NaN());
+            std::mutex stitched_mutex;
+            std::atomic<int32_t> resident = 0;
+            std::atomic<int32_t> peak_resident = 0;
+
+            const cpuio::region_reader reader = [&](size_t x, size_t y, cpu_texture<float>& region) {
+                peak_resident = std::max(peak_resident.load(), ++resident);
+                for (size_t row = 0; row < region.height; row++)
+                {
+                    std::copy(mask.row(y + row) + x, mask.row(y + row) + x + region.width, region.row(row));
+                }
+            };
+            const cpuio::region_writer writer = [&](size_t x, size_t y, const cpu_texture<float>& region) {
+                std::lock_guard lock (stitched_mutex);
+                for (size_t row = 0; row < region.height; row++)
+                {
+                    for (size_t column = 0; column < region.width; column++)
+                    {
+                        EXPECT_TRUE(std::isnan(stitched.at(x + column, y + row))) << "texel written twice";
+                        stitched.at(x + column, y + row) = region.at(column, row);
+                    }
+                }
+                resident--;
+            };
+
+            img2sdf.compute_tiled_distance_field(width, height, reader, writer, max_distance, is_signed, true, 16);
+
+            EXPECT_LE(peak_resident.load(), static_cast<int32_t>(num_threads));
+            const float tolerance = GetParam() == CPU_ENGINE::JUMP_FLOOD ? 0.3f : 1e-5f;
+            for (size_t i = 0; i < expected.data.size(); i++)
+            {
+                EXPECT_NEAR(stitched.data[i], expected.data[i], tolerance) << "at index " << i;
+            }
+        }
+    }
+
+    TEST(CPUTiled, RawFileRoundTrip)
+    {
+        constexpr size_t width = 45;
+        constexpr size_t height = 33;
+        const auto mask = disc_mask(width, height);
+
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto in_path = (directory / "img2sdf_tiled_in.raw").string();
+        const auto out_path = (directory / "img2sdf_tiled_out.raw").string();
+        {
+            std::ofstream in_file (in_path, std::ios::binary);
+            in_file.write(reinterpret_cast<const char*>(mask.data.data()), static_cast<std::streamsize>(mask.data.size() * sizeof(float)));
+        }
+
+        Img2SDF img2sdf {2};
+        img2sdf.set_cpu_engine(CPU_ENGINE::EXACT_EDT);
+        {
+            cpuio::raw_region_file out_file (out_path, width, height);
+            img2sdf.compute_tiled_distance_field(width, height, cpuio::raw_region_reader(in_path, width, height),
+                                                 out_file.writer(), 4.0f, true, true, 8);
+        }
+
+        cpu_texture<float> stitched (width, height);
+        std::ifstream out_file (out_path, std::ios::binary);
+        out_file.read(reinterpret_cast<char*>(stitched.data.data()), static_cast<std::streamsize>(stitched.data.size() * sizeof(float)));
+        ASSERT_TRUE(out_file);
+
+        const auto expected = img2sdf.compute_signed_distance_field(mask, true, 4.0f);
+        for (size_t i = 0; i < expected.data.size(); i++)
+        {
+            EXPECT_FLOAT_EQ(stitched.data[i], expected.data[i]) << "at index " << i;
+        }
+
+        std::remove(in_path.c_str());
+        std::remove(out_path.c_str());
+    }
+
+    TEST(CPUTiled, RequiresMaxDistance)
+    {
+        Img2SDF img2sdf {};
+        const cpuio::region_reader reader = [](size_t, size_t, cpu_texture<float>&) {};
+        const cpuio::region_writer writer = [](size_t, size_t, const cpu_texture<float>&) {};
+        EXPECT_THROW(img2sdf.compute_tiled_distance_field(16, 16, reader, writer, 0.0f), std::runtime_error);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(CPUTiledTests, CPUTiled,
+                             ::testing::Values(CPU_ENGINE::EXACT_EDT, CPU_ENGINE::FEATURE_TRANSFORM, CPU_ENGINE::JUMP_FLOOD));
+}
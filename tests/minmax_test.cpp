@@ -5,6 +5,7 @@
 #include <filesystem>
 
 #include "../src/dxutils.h"
+#include "../src/cpureduce.h"
 #include "../src/dxinit.h"
 #include "../src/JumpFloodDispatch.h"
 #include "../src/JumpFloodResources.h"
@@ -121,13 +122,13 @@ class DXSetup : public testing::TestWithParam<int32_t> {
         //(that is, we would get OOB access with a width smaller than threads_per_group_width).
         ASSERT_LT(staging_desc.Width, JumpFloodDispatch::threads_per_group_width);
         ASSERT_LT(staging_desc.Height, JumpFloodDispatch::threads_per_group_width);
-        auto CPU_iter = dxutils::serial_min_max(minmax_data);
+        auto CPU_iter = cpuutils::combine_min_max(minmax_data);
         computed_minmax = CPU_iter;
     }
 
 
     //compute ground truth reference.
-    auto ground_truth = dxutils::serial_min_max(debug_image);
+    auto ground_truth = cpureduce::min_max(debug_image);
 
     ASSERT_FLOAT_EQ(computed_minmax.first, ground_truth.first);
     ASSERT_FLOAT_EQ(computed_minmax.second, ground_truth.second);
@@ -0,0 +1,78 @@
+#ifndef IMG2SDF_TEST_MASKS_H
+#define IMG2SDF_TEST_MASKS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/cpu_texture.h"
+
+///Masks and temp files shared by the CPU tests.
+namespace test_masks
+{
+    ///a path in the temp directory, removed again on destruction.
+    struct temp_path
+    {
+        explicit temp_path(const std::string& name) : path((std::filesystem::temp_directory_path() / name).string()) {}
+
+        ///As above, with `bytes` written to the file.
+        temp_path(const std::string& name, const std::vector<uint8_t>& bytes) : temp_path(name)
+        {
+            std::ofstream stream (path, std::ios::binary);
+            stream.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        temp_path(const temp_path&) = delete;
+        temp_path& operator=(const temp_path&) = delete;
+
+        ~temp_path() { std::remove(path.c_str()); }
+
+        std::string path;
+    };
+
+    ///random mask with roughly `density` of the texels set. The same mask for the same `seed` every time.
+    inline cpu_texture<float> random_mask(size_t width, size_t height, double density, unsigned seed = 0)
+    {
+        std::default_random_engine random_gen {seed};
+        std::bernoulli_distribution distribution (density);
+        cpu_texture<float> mask (width, height);
+        for (auto& texel : mask.data)
+        {
+            texel = distribution(random_gen) ? 1.0f : 0.0f;
+        }
+        return mask;
+    }
+
+    ///a disc with a hole, so the signed field crosses its edge several times along each row: texels between
+    ///`inner_radius` and `outer_radius` of (centre_x * width, height / 2) are set.
+    inline cpu_texture<float> ring_mask(size_t width, size_t height, float inner_radius, float outer_radius,
+                                        float centre_x = 0.5f)
+    {
+        cpu_texture<float> mask (width, height);
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                const float dx = static_cast<float>(x) - static_cast<float>(width) * centre_x;
+                const float dy = static_cast<float>(y) - static_cast<float>(height) / 2;
+                const float radius = std::sqrt(dx * dx + dy * dy);
+                mask.at(x, y) = radius > inner_radius && radius < outer_radius ? 1.0f : 0.0f;
+            }
+        }
+        return mask;
+    }
+
+    ///the texels of `texture`, comparable with EXPECT_EQ whatever the texture's allocator.
+    inline std::vector<float> values(const cpu_texture<float>& texture)
+    {
+        return {texture.data.begin(), texture.data.end()};
+    }
+}
+
+#endif //IMG2SDF_TEST_MASKS_H